@@ -0,0 +1,227 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Benchmark for the BFD write path.  Writes the same synthetic records to two scratch BFD files, once
+    with a binaryFeatureData_write_record_image_file call per record (what build_feature used to do) and
+    once through the batching BFD_WRITER, and reports wall time and read/write system call counts
+    (from /proc/self/io, Linux only) scaled to 1M records.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "bfd_writer.h"
+
+
+typedef struct
+{
+  uint64_t            syscr;
+  uint64_t            syscw;
+} IO_COUNTS;
+
+
+/*  Read the system call counters for this process.  Returns NVFalse if they aren't available.  */
+
+static uint8_t get_io_counts (IO_COUNTS *io)
+{
+  FILE                *fp;
+  char                string[128];
+  unsigned long long  value;
+
+
+  memset (io, 0, sizeof (IO_COUNTS));
+
+  if ((fp = fopen ("/proc/self/io", "r")) == NULL) return (NVFalse);
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      if (sscanf (string, "syscr: %llu", &value) == 1) io->syscr = value;
+      if (sscanf (string, "syscw: %llu", &value) == 1) io->syscw = value;
+    }
+
+  fclose (fp);
+
+  return (NVTrue);
+}
+
+
+
+static double now_seconds ()
+{
+  struct timespec tp;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+
+  return ((double) tp.tv_sec + (double) tp.tv_nsec * 1.0e-9);
+}
+
+
+
+static void make_record (int32_t i, BFDATA_RECORD *record)
+{
+  memset (record, 0, sizeof (BFDATA_RECORD));
+
+  record->latitude = -60.0 + (double) (i % 120000) * 0.001;
+  record->longitude = -170.0 + (double) (i % 340000) * 0.001;
+  record->depth = (float) (i % 5000) * 0.1;
+  record->event_tv_sec = 1400000000 + i;
+  record->confidence_level = 3;
+  sprintf (record->remarks, "Benchmark contact %d", i);
+  strcpy (record->analyst_activity, "NAVOCEANO BHY");
+}
+
+
+
+/*  Writes count records to a new BFD file either directly or through a BFD_WRITER.  */
+
+static void run (char *path, int32_t count, int32_t batch_size, char *image, uint8_t batched)
+{
+  BFDATA_HEADER       bfd_header;
+  BFDATA_RECORD       record;
+  BFD_WRITER          *writer = NULL;
+  IO_COUNTS           before, after;
+  uint8_t             have_io;
+  int32_t             i, bfd_handle;
+  double              start, elapsed, scale;
+
+
+  unlink (path);
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+  strcpy (bfd_header.creation_software, "bench_bfd_write");
+
+  if ((bfd_handle = binaryFeatureData_create_file (path, bfd_header)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  if (batched && (writer = bfd_writer_open (bfd_handle, batch_size, 0)) == NULL)
+    {
+      perror ("bfd_writer_open");
+      exit (-1);
+    }
+
+  have_io = get_io_counts (&before);
+  start = now_seconds ();
+
+  for (i = 0 ; i < count ; i++)
+    {
+      make_record (i, &record);
+
+      if (batched)
+        {
+          if (bfd_writer_add (writer, &record, image) < 0)
+            {
+              binaryFeatureData_perror ();
+              exit (-1);
+            }
+        }
+      else
+        {
+          if (binaryFeatureData_write_record_image_file (bfd_handle, BFDATA_NEXT_RECORD, &record, NULL, image) < 0)
+            {
+              binaryFeatureData_perror ();
+              exit (-1);
+            }
+        }
+    }
+
+  if (batched && bfd_writer_close (writer) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  binaryFeatureData_close_file (bfd_handle);
+
+  elapsed = now_seconds () - start;
+  get_io_counts (&after);
+
+  scale = 1000000.0 / (double) count;
+
+  printf ("%-8s  %10.3f s/1M records", batched ? "batched" : "direct", elapsed * scale);
+
+  if (have_io)
+    {
+      printf ("  %12.0f read syscalls/1M  %12.0f write syscalls/1M", (double) (after.syscr - before.syscr) * scale,
+              (double) (after.syscw - before.syscw) * scale);
+    }
+
+  printf ("\n");
+  fflush (stdout);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  char                path[1024], image[1024] = "";
+  int32_t             option, count = 1000000, batch_size = BFD_WRITER_BATCH_SIZE;
+
+
+  while ((option = getopt (argc, argv, "n:b:i:")) != EOF)
+    {
+      switch (option)
+        {
+        case 'n':
+          sscanf (optarg, "%d", &count);
+          break;
+
+        case 'b':
+          sscanf (optarg, "%d", &batch_size);
+          break;
+
+        case 'i':
+          strcpy (image, optarg);
+          break;
+
+        default:
+          fprintf (stderr, "Usage: bench_bfd_write [-n RECORDS] [-b BATCH] [-i IMAGE_FILE] <scratch directory>\n");
+          exit (-1);
+        }
+    }
+
+  if (optind >= argc || count < 1)
+    {
+      fprintf (stderr, "Usage: bench_bfd_write [-n RECORDS] [-b BATCH] [-i IMAGE_FILE] <scratch directory>\n");
+      exit (-1);
+    }
+
+  printf ("%d records, batch size %d, image %s\n\n", count, batch_size, image[0] ? image : "none");
+
+  sprintf (path, "%s/bench_direct.bfd", argv[optind]);
+  run (path, count, batch_size, image, NVFalse);
+  unlink (path);
+
+  sprintf (path, "%s/bench_batched.bfd", argv[optind]);
+  run (path, count, batch_size, image, NVTrue);
+  unlink (path);
+
+  return (0);
+}
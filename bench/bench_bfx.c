@@ -0,0 +1,403 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Benchmark for box lookups with the spatial index (see spatial_index.c).  Writes a BFD file of synthetic features
+    (half spread over the world, half packed into a few small survey areas) and its index, the same way
+    build_feature --index does, then times random box queries through the index.  The first few queries are also
+    answered by reading every record in the BFD file, which is what a client without the index has to do for each
+    query, and the answers are checked against each other.  The BFD file and index are left in the scratch
+    directory and reused by the next run with the same number of features.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "bfd_writer.h"
+#include "spatial_index.h"
+
+
+/*  Survey areas (half a degree on a side) that half of the features are packed into.  */
+
+#define BENCH_AREAS             16
+#define BENCH_AREA_SIZE         0.5
+
+
+static double now_seconds ()
+{
+  struct timespec tp;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+
+  return ((double) tp.tv_sec + (double) tp.tv_nsec * 1.0e-9);
+}
+
+
+
+static uint64_t mix (uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+  return (x ^ (x >> 31));
+}
+
+
+static double uniform (uint64_t row, int32_t field)
+{
+  return ((double) (mix ((row << 8) ^ (uint64_t) field) >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+
+/*  Position of feature i.  Odd features are anywhere between 80S and 80N, even ones are in one of the survey
+    areas.  */
+
+static void make_position (uint32_t i, double *latitude, double *longitude)
+{
+  uint64_t            area;
+
+
+  if (i & 1)
+    {
+      *latitude = uniform (i, 0) * 160.0 - 80.0;
+      *longitude = uniform (i, 1) * 360.0 - 180.0;
+    }
+  else
+    {
+      area = (1ULL << 40) + (uint64_t) (uniform (i, 2) * BENCH_AREAS);
+
+      *latitude = uniform (area, 0) * 150.0 - 75.0 + (uniform (i, 0) - 0.5) * BENCH_AREA_SIZE;
+      *longitude = uniform (area, 1) * 350.0 - 175.0 + (uniform (i, 1) - 0.5) * BENCH_AREA_SIZE;
+    }
+}
+
+
+
+/*  Writes count features to a new BFD file and builds its index.  */
+
+static void build (char *path, uint32_t count)
+{
+  BFDATA_HEADER       bfd_header;
+  BFDATA_RECORD       record;
+  BFD_WRITER          *writer;
+  SPATIAL_INDEX_WRITER  *index;
+  int32_t             bfd_handle;
+  uint32_t            i;
+  double              start;
+
+
+  unlink (path);
+
+  memset (&bfd_header, 0, sizeof (BFDATA_HEADER));
+  strcpy (bfd_header.creation_software, "bench_bfx");
+
+  if ((bfd_handle = binaryFeatureData_create_file (path, bfd_header)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  if ((writer = bfd_writer_open (bfd_handle, 0, 0)) == NULL || (index = spatial_index_writer_open (path, 0)) == NULL)
+    {
+      perror ("Allocating writer memory");
+      exit (-1);
+    }
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < count ; i++)
+    {
+      memset (&record, 0, sizeof (BFDATA_RECORD));
+
+      make_position (i, &record.latitude, &record.longitude);
+      record.event_tv_sec = 1400000000 + i;
+      record.confidence_level = 3;
+      sprintf (record.description, "Benchmark contact %u", i);
+      strcpy (record.analyst_activity, "NAVOCEANO BHY");
+
+      if (bfd_writer_add (writer, &record, NULL) < 0)
+        {
+          binaryFeatureData_perror ();
+          exit (-1);
+        }
+
+      if (spatial_index_add (index, record.latitude, record.longitude) < 0)
+        {
+          perror ("Allocating spatial index memory");
+          exit (-1);
+        }
+    }
+
+  if (bfd_writer_close (writer) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  binaryFeatureData_close_file (bfd_handle);
+
+  if (spatial_index_finish (index) < 0)
+    {
+      perror (index->path);
+      exit (-1);
+    }
+
+  printf ("Wrote %u features in %.3f s (%.3f s of that building the index)\n", count, now_seconds () - start,
+          (double) index->ns * 1.0e-9);
+
+  spatial_index_writer_close (index);
+}
+
+
+
+static uint32_t parse_count (const char *string)
+{
+  int32_t             value;
+  char                suffix = 0;
+
+
+  if (sscanf (string, "%d%c", &value, &suffix) < 1 || value < 1) return (0);
+  if (suffix == 'k' || suffix == 'K') value *= 1000;
+  if (suffix == 'm' || suffix == 'M') value *= 1000000;
+
+  return ((uint32_t) value);
+}
+
+
+
+static void usage ()
+{
+  fprintf (stderr, "Usage: bench_bfx [-n FEATURES] [-q QUERIES] [-s DEGREES] [-v SCANS] <scratch directory>\n");
+  exit (-1);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  char                path[1024], index_name[1024];
+  int32_t             option, bfd_handle, found, scans = 3, queries = 1000, i;
+  uint32_t            count = 10000000, record, *scan_count, mismatches = 0;
+  uint64_t            total_found = 0, total_checked = 0;
+  double              size = 0.25, latitude, longitude, start, elapsed, total = 0.0, slowest = 0.0, scan_seconds;
+  SPATIAL_INDEX_NODE  *box;
+  SPATIAL_INDEX_HITS  hits, *scan_hits;
+  SPATIAL_INDEX       *index;
+  BFDATA_HEADER       bfd_header;
+  BFDATA_RECORD       bfd_record;
+  struct stat         st;
+
+
+  while ((option = getopt (argc, argv, "n:q:s:v:")) != EOF)
+    {
+      switch (option)
+        {
+        case 'n':
+          if (!(count = parse_count (optarg))) usage ();
+          break;
+
+        case 'q':
+          if (sscanf (optarg, "%d", &queries) != 1 || queries < 1) usage ();
+          break;
+
+        case 's':
+          if (sscanf (optarg, "%lf", &size) != 1 || size <= 0.0) usage ();
+          break;
+
+        case 'v':
+          if (sscanf (optarg, "%d", &scans) != 1 || scans < 0) usage ();
+          break;
+
+        default:
+          usage ();
+          break;
+        }
+    }
+
+  if (optind >= argc) usage ();
+
+  if (scans > queries) scans = queries;
+
+  sprintf (path, "%s/bench_bfx.bfd", argv[optind]);
+  spatial_index_name (path, index_name);
+
+
+  /*  Writing 10M features takes a while, only do it if the last run didn't leave the same file behind.  */
+
+  index = NULL;
+
+  if ((bfd_handle = binaryFeatureData_open_file (path, &bfd_header, BFDATA_READONLY)) >= 0)
+    {
+      if (bfd_header.number_of_records != count || (index = spatial_index_open (index_name)) == NULL ||
+          index->header.records != count)
+        {
+          spatial_index_close (index);
+          index = NULL;
+        }
+
+      binaryFeatureData_close_file (bfd_handle);
+    }
+
+  if (index == NULL)
+    {
+      build (path, count);
+
+      if ((index = spatial_index_open (index_name)) == NULL)
+        {
+          perror (index_name);
+          exit (-1);
+        }
+    }
+  else
+    {
+      printf ("Reusing %s\n", path);
+    }
+
+  if ((bfd_handle = binaryFeatureData_open_file (path, &bfd_header, BFDATA_READONLY)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  stat (index_name, &st);
+
+  printf ("%u features, index %.1f MB (%.2f bytes per feature, %u segment%s)\n\n", count,
+          (double) st.st_size / (1024.0 * 1024.0), (double) st.st_size / (double) count, index->header.segments,
+          index->header.segments == 1 ? "" : "s");
+
+
+  /*  Each box is centered on a feature so it's never empty (some are in the survey areas, some aren't).  */
+
+  box = (SPATIAL_INDEX_NODE *) malloc (queries * sizeof (SPATIAL_INDEX_NODE));
+  scan_hits = (SPATIAL_INDEX_HITS *) calloc (scans ? scans : 1, sizeof (SPATIAL_INDEX_HITS));
+  scan_count = (uint32_t *) calloc (scans ? scans : 1, sizeof (uint32_t));
+
+  if (box == NULL || scan_hits == NULL || scan_count == NULL)
+    {
+      perror ("Allocating query memory");
+      exit (-1);
+    }
+
+  for (i = 0 ; i < queries ; i++)
+    {
+      make_position ((uint32_t) (uniform ((1ULL << 41) + i, 0) * count), &latitude, &longitude);
+
+      box[i].south = latitude - size * 0.5;
+      box[i].north = latitude + size * 0.5;
+      box[i].west = longitude - size * 0.5;
+      box[i].east = longitude + size * 0.5;
+    }
+
+  memset (&hits, 0, sizeof (SPATIAL_INDEX_HITS));
+
+  for (i = 0 ; i < queries ; i++)
+    {
+      start = now_seconds ();
+
+      if ((found = spatial_index_query (index, bfd_handle, bfd_header.number_of_records, box[i].south, box[i].west,
+                                        box[i].north, box[i].east, i < scans ? &scan_hits[i] : &hits)) < 0)
+        {
+          if (index->bfd_error)
+            {
+              binaryFeatureData_perror ();
+            }
+          else
+            {
+              perror (index_name);
+            }
+          exit (-1);
+        }
+
+      elapsed = now_seconds () - start;
+
+      total += elapsed;
+      if (elapsed > slowest) slowest = elapsed;
+
+      total_found += found;
+      total_checked += (i < scans) ? scan_hits[i].checked : hits.checked;
+    }
+
+  printf ("%d queries, %g x %g degree boxes through the index\n", queries, size, size);
+  printf ("    %10.3f ms per query (slowest %.3f ms)\n", total * 1000.0 / queries, slowest * 1000.0);
+  printf ("    %10.1f features found per query\n", (double) total_found / queries);
+  printf ("    %10.2f records read from the BFD file per query to check features on the edge\n\n",
+          (double) total_checked / queries);
+
+
+  /*  Without the index every query reads every record.  One pass answers all of the checked queries but that's
+      what each query would cost on its own.  */
+
+  if (scans)
+    {
+      start = now_seconds ();
+
+      for (record = 0 ; record < bfd_header.number_of_records ; record++)
+        {
+          if (binaryFeatureData_read_record (bfd_handle, record, &bfd_record) < 0)
+            {
+              binaryFeatureData_perror ();
+              exit (-1);
+            }
+
+          for (i = 0 ; i < scans ; i++)
+            {
+              if (bfd_record.latitude >= box[i].south && bfd_record.latitude <= box[i].north &&
+                  bfd_record.longitude >= box[i].west && bfd_record.longitude <= box[i].east)
+                {
+                  if (scan_count[i] >= scan_hits[i].count || scan_hits[i].record[scan_count[i]] != record) mismatches++;
+
+                  scan_count[i]++;
+                }
+            }
+        }
+
+      scan_seconds = now_seconds () - start;
+
+      for (i = 0 ; i < scans ; i++)
+        {
+          if (scan_count[i] != scan_hits[i].count) mismatches++;
+        }
+
+      printf ("Full scan of the BFD file (%d queries checked, %s)\n", scans,
+              mismatches ? "RESULTS DIFFER" : "same features found");
+      printf ("    %10.3f ms per query\n", scan_seconds * 1000.0);
+      printf ("    %10.0f times slower than the index\n", scan_seconds / (total / queries));
+    }
+
+  for (i = 0 ; i < scans ; i++) spatial_index_hits_free (&scan_hits[i]);
+  spatial_index_hits_free (&hits);
+  free (scan_hits);
+  free (scan_count);
+  free (box);
+  spatial_index_close (index);
+  binaryFeatureData_close_file (bfd_handle);
+
+  return (mismatches ? -1 : 0);
+}
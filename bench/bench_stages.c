@@ -0,0 +1,678 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Per stage microbenchmarks for build_feature.  A synthetic corpus of each input format is generated in
+    memory and each stage of the ingest is timed on its own: the .txt position parser, .uni field
+    splitting, the delimiter indexer (each of its scalar/SSE2/AVX2 versions the CPU supports), the per line
+    parsers, the DTG parser, the time conversions (one record at a time and the batch conversions parse_chunk uses),
+    contact ID formatting, and whole chunk parsing (with the fixed parsers and with a --columns mapping of
+    the same layout).
+    The BFD write path has its own benchmark (bench_bfd_write) since it needs a scratch directory.
+
+    Every stage prints ns/row and Mrows/s so runs before and after a change can be compared line for line.
+    The checksum at the end of each line keeps the compiler from throwing the work away (and changes if
+    a parser's output changes).  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nvutility.h"
+
+#include "column_map.h"
+#include "contact_id.h"
+#include "convert.h"
+#include "corpus.h"
+#include "delim_index.h"
+#include "dtg.h"
+#include "parse_record.h"
+#include "sget_coord.h"
+#include "string_view.h"
+
+
+typedef struct
+{
+  char                *text;
+  size_t              size;
+  STRING_VIEW         *line;
+  int32_t             count;
+} CORPUS;
+
+
+static double now_seconds ()
+{
+  struct timespec tp;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+
+  return ((double) tp.tv_sec + (double) tp.tv_nsec * 1.0e-9);
+}
+
+
+
+static void report (const char *stage, int32_t rows, double elapsed, double checksum)
+{
+  printf ("%-32s %10.1f ns/row %10.2f Mrows/s    [%.6g]\n", stage, elapsed * 1.0e9 / (double) rows,
+          (double) rows / elapsed * 1.0e-6, checksum);
+  fflush (stdout);
+}
+
+
+
+/*  Generates rows lines of a format into one block of memory (no header).  */
+
+static void make_corpus (int32_t format, int32_t rows, CORPUS *corpus)
+{
+  char                line[CORPUS_LINE_MAX];
+  size_t              used = 0;
+  int32_t             i, len;
+
+
+  corpus->size = (size_t) rows * 256;
+
+  if ((corpus->text = (char *) malloc (corpus->size)) == NULL ||
+      (corpus->line = (STRING_VIEW *) malloc (rows * sizeof (STRING_VIEW))) == NULL)
+    {
+      perror ("Allocating corpus memory");
+      exit (-1);
+    }
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      len = corpus_line (format, 1, i, line);
+
+      if (used + len > corpus->size)
+        {
+          corpus->size *= 2;
+
+          if ((corpus->text = (char *) realloc (corpus->text, corpus->size)) == NULL)
+            {
+              perror ("Allocating corpus memory");
+              exit (-1);
+            }
+        }
+
+      memcpy (corpus->text + used, line, len);
+      used += len;
+    }
+
+  corpus->size = used;
+  corpus->count = rows;
+
+
+  /*  Line views (without the newline), set up after the last realloc.  */
+
+  used = 0;
+  for (i = 0 ; i < rows ; i++)
+    {
+      len = (int32_t) ((const char *) memchr (corpus->text + used, '\n', corpus->size - used) - (corpus->text + used));
+      corpus->line[i] = sv_make (corpus->text + used, len);
+      used += len + 1;
+    }
+}
+
+
+
+static void bench_sget_coord (CORPUS *corpus)
+{
+  COORD_RECORD        coord;
+  double              start, sum = 0.0;
+  int32_t             i;
+
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < corpus->count ; i++)
+    {
+      sget_coord (corpus->line[i], &coord);
+      sum += coord.lat_sec + coord.lon_sec + coord.depth;
+    }
+
+  report ("sget_coord (.txt)", corpus->count, now_seconds () - start, sum);
+}
+
+
+
+static void bench_uni_split (CORPUS *corpus)
+{
+  STRING_VIEW         rest, field;
+  double              start, sum = 0.0;
+  int32_t             i;
+
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < corpus->count ; i++)
+    {
+      rest = corpus->line[i];
+      while (sv_next_token (&rest, ',', &field)) sum += (double) field.len;
+    }
+
+  report (".uni field split", corpus->count, now_seconds () - start, sum);
+}
+
+
+
+static const char *level_name[3] = {"scalar", "sse2", "avx2"};
+
+
+/*  parse_line and parse_chunk use the same checksum so it's easy to see that they agree.  */
+
+static double record_checksum (FEATURE_RECORD *feature)
+{
+  return (feature->bfd_record.latitude + feature->bfd_record.longitude + (double) feature->bfd_record.depth +
+          (double) feature->bfd_record.event_tv_sec + (double) feature->bfd_record.event_tv_nsec * 1.0e-9 +
+          (double) feature->day);
+}
+
+
+/*  Cuts the corpus into the same 1 MB (line aligned) chunks the pipeline would.  */
+
+static STRING_VIEW next_chunk (CORPUS *corpus, size_t offset)
+{
+  STRING_VIEW         chunk;
+  const char          *nl;
+
+
+  chunk.ptr = corpus->text + offset;
+  chunk.len = corpus->size - offset;
+
+  if (chunk.len > 1024 * 1024 && (nl = (const char *) memchr (chunk.ptr + 1024 * 1024, '\n', chunk.len - 1024 * 1024)) != NULL)
+    chunk.len = (nl - chunk.ptr) + 1;
+
+  return (chunk);
+}
+
+
+
+/*  Times each version of the delimiter indexer.  The checksums have to match or the vector versions
+    don't find the same offsets as the scalar one.  */
+
+static void bench_delim_index (int32_t format, CORPUS *corpus)
+{
+  DELIM_INDEX         index;
+  STRING_VIEW         chunk;
+  char                stage[64];
+  size_t              offset, i;
+  double              start, sum, elapsed;
+  int32_t             level, best;
+
+
+  memset (&index, 0, sizeof (DELIM_INDEX));
+
+  best = delim_index_level (DELIM_INDEX_BEST);
+
+  for (level = DELIM_INDEX_SCALAR ; level <= best ; level++)
+    {
+      delim_index_level (level);
+
+      sum = 0.0;
+      offset = 0;
+
+      start = now_seconds ();
+
+      while (offset < corpus->size)
+        {
+          chunk = next_chunk (corpus, offset);
+
+          delim_index_build (chunk, &index);
+
+          for (i = 0 ; i < index.commas ; i++) sum += (double) index.comma[i];
+          for (i = 0 ; i < index.newlines ; i++) sum += (double) index.newline[i] * 3.0;
+          for (i = 0 ; i < index.letter_ls ; i++) sum += (double) index.letter_l[i] * 7.0;
+
+          offset += chunk.len;
+        }
+
+      elapsed = now_seconds () - start;
+
+      sprintf (stage, "delim_index (%s, %s)", input_format_name (format), level_name[level]);
+      report (stage, corpus->count, elapsed, sum);
+    }
+
+  delim_index_level (DELIM_INDEX_BEST);
+  delim_index_free (&index);
+}
+
+
+
+static void bench_parse_line (int32_t format, CORPUS *corpus, const CONTACT_TIME *now, const PARSE_OPTIONS *options)
+{
+  FEATURE_RECORD      feature;
+  CONVERT_CHECK       check;
+  char                stage[64];
+  double              start, sum = 0.0;
+  int32_t             i;
+
+
+  memset (&check, 0, sizeof (CONVERT_CHECK));
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < corpus->count ; i++)
+    {
+      if (parse_line (format, corpus->line[i], now, options, &check, &feature)) sum += record_checksum (&feature);
+    }
+
+  sprintf (stage, "parse_line (%s)", input_format_name (format));
+  report (stage, corpus->count, now_seconds () - start, sum);
+}
+
+
+
+static void bench_parse_chunk (int32_t format, CORPUS *corpus, const CONTACT_TIME *now, const PARSE_OPTIONS *options)
+{
+  RECORD_BATCH        batch;
+  STRING_VIEW         chunk;
+  char                stage[64];
+  size_t              offset;
+  double              start, sum, elapsed;
+  int32_t             i, level, best;
+
+
+  memset (&batch, 0, sizeof (RECORD_BATCH));
+
+  best = delim_index_level (DELIM_INDEX_BEST);
+
+  for (level = DELIM_INDEX_SCALAR ; level <= best ; level++)
+    {
+      delim_index_level (level);
+
+      sum = 0.0;
+      elapsed = 0.0;
+      offset = 0;
+
+      while (offset < corpus->size)
+        {
+          chunk = next_chunk (corpus, offset);
+
+          start = now_seconds ();
+          parse_chunk (format, chunk, now, options, &batch);
+          elapsed += now_seconds () - start;
+
+
+          /*  The checksum isn't timed, reading the records back costs about as much as parsing them.  */
+
+          for (i = 0 ; i < batch.count ; i++) sum += record_checksum (&batch.record[i]);
+
+          offset += chunk.len;
+        }
+
+      sprintf (stage, "parse_chunk (%s, %s, %.0f MB/s)", input_format_name (format), level_name[level],
+               (double) corpus->size / elapsed * 1.0e-6);
+      report (stage, corpus->count, elapsed, sum);
+    }
+
+  delim_index_level (DELIM_INDEX_BEST);
+  record_batch_free (&batch);
+}
+
+
+
+static void bench_time (int32_t rows)
+{
+  int32_t             i, year, day, hour, minute, jday;
+  float               second;
+  time_t              tv_sec;
+  long                tv_nsec;
+  double              start, sum = 0.0;
+
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      cvtime ((time_t) (1000000000 + i * 7919), 0, &year, &day, &hour, &minute, &second);
+      sum += (double) (day + minute);
+    }
+
+  report ("cvtime", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      inv_cvtime (100 + i % 25, 1 + i % 365, i % 24, i % 60, (float) (i % 6000) * 0.01f, &tv_sec, &tv_nsec);
+      sum += (double) tv_sec;
+    }
+
+  report ("inv_cvtime", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      mday2jday (2000 + i % 25, 1 + i % 12, 1 + i % 28, &jday);
+      sum += (double) jday;
+    }
+
+  report ("mday2jday", rows, now_seconds () - start, sum);
+}
+
+
+
+/*  Times dtg_parse against the sv_scanf it replaced (on the same .uni DTGs, plus the same times in ISO 8601)
+    and dtg_jday/dtg_midnight against mday2jday/inv_cvtime.  */
+
+static void bench_dtg (int32_t rows)
+{
+  static char         mdy[64][32], iso[64][40];
+  STRING_VIEW         field;
+  int32_t             i, year, month, mday, hour, minute, jday;
+  float               second;
+  time_t              tv_sec;
+  long                tv_nsec;
+  double              start, sum;
+
+
+  for (i = 0 ; i < 64 ; i++)
+    {
+      sprintf (mdy[i], "%02d-%02d-20%02d  %02d:%02d:%05.2f", 1 + i % 12, 1 + i % 28, i % 25, i % 24, i % 60,
+               (double) (i * 97 % 6000) * 0.01);
+      sprintf (iso[i], "20%02d-%02d-%02dT%02d:%02d:%05.2f-05:00", i % 25, 1 + i % 12, 1 + i % 28, i % 24, i % 60,
+               (double) (i * 97 % 6000) * 0.01);
+    }
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      field = sv_make (mdy[i & 63], strlen (mdy[i & 63]));
+      sv_scanf (field, "%d-%d-%d  %d:%d:%f", &month, &mday, &year, &hour, &minute, &second);
+      sum += (double) (month + mday + year + hour + minute) + second;
+    }
+
+  report ("sv_scanf (dtg)", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      field = sv_make (mdy[i & 63], strlen (mdy[i & 63]));
+      dtg_parse (field, &year, &month, &mday, &hour, &minute, &second);
+      sum += (double) (month + mday + year + hour + minute) + second;
+    }
+
+  report ("dtg_parse (mdy)", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      field = sv_make (iso[i & 63], strlen (iso[i & 63]));
+      dtg_parse (field, &year, &month, &mday, &hour, &minute, &second);
+      sum += (double) (month + mday + year + hour + minute) + second;
+    }
+
+  report ("dtg_parse (ISO 8601)", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      mday2jday (2000 + i % 25, 1 + i % 12, 1 + i % 28, &jday);
+      inv_cvtime (100 + i % 25, jday, 0, 0, 0.0, &tv_sec, &tv_nsec);
+      sum += (double) tv_sec;
+    }
+
+  report ("mday2jday + inv_cvtime", rows, now_seconds () - start, sum);
+
+
+  sum = 0.0;
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      dtg_jday (2000 + i % 25, 1 + i % 12, 1 + i % 28, &jday);
+      dtg_midnight (2000 + i % 25, jday, &tv_sec);
+      sum += (double) tv_sec;
+    }
+
+  report ("dtg_jday + dtg_midnight", rows, now_seconds () - start, sum);
+}
+
+
+
+/*  Times the batch conversions against converting one record at a time (the way parse_line does it) and
+    checks that they give exactly the same answers.  The DTGs are a few seconds apart, like a survey's
+    contacts, and the positions are a sweep of degrees, minutes, and seconds.  */
+
+static void bench_convert (int32_t rows)
+{
+  static double       degrees[CONVERT_BATCH_SIZE];
+  static time_t       expect_sec[CONVERT_BATCH_SIZE];
+  static long         expect_nsec[CONVERT_BATCH_SIZE];
+  CONVERT_BATCH       *convert;
+  struct tm           tm;
+  time_t              t;
+  double              start, scalar_dms = 0.0, batch_dms = 0.0, scalar_time = 0.0, batch_time = 0.0, dms_sum = 0.0,
+                      time_sum = 0.0;
+  int32_t             i, n, done, day, deg, min, differ = 0;
+  float               sec;
+
+
+  if ((convert = (CONVERT_BATCH *) calloc (1, sizeof (CONVERT_BATCH))) == NULL)
+    {
+      perror ("Allocating conversion memory");
+      exit (-1);
+    }
+
+  for (done = 0 ; done < rows ; done += n)
+    {
+      n = rows - done;
+      if (n > CONVERT_BATCH_SIZE) n = CONVERT_BATCH_SIZE;
+
+      for (i = 0 ; i < n ; i++)
+        {
+          convert->lat_total[i] = (double) ((done + i) % 90000) * 0.001013;
+          convert->lat_negative[i] = (done + i) & 1;
+
+          t = (time_t) 1100000000 + (time_t) (done + i) * 3;
+          gmtime_r (&t, &tm);
+
+          convert->year[i] = tm.tm_year + 1900;
+          convert->month[i] = tm.tm_mon + 1;
+          convert->mday[i] = tm.tm_mday;
+          convert->hour[i] = tm.tm_hour;
+          convert->minute[i] = tm.tm_min;
+          convert->second[i] = (float) tm.tm_sec + (float) ((done + i) % 100) * 0.01f;
+        }
+
+      convert->count = n;
+
+
+      /*  One at a time.  */
+
+      start = now_seconds ();
+
+      for (i = 0 ; i < n ; i++)
+        {
+          convert_split_dms (convert->lat_total[i], &deg, &min, &sec);
+          degrees[i] = convert_dms_degrees ((double) deg, (double) min, (double) sec, convert->lat_negative[i]);
+          dms_sum += degrees[i];
+        }
+
+      scalar_dms += now_seconds () - start;
+
+      start = now_seconds ();
+
+      for (i = 0 ; i < n ; i++)
+        {
+          mday2jday (convert->year[i], convert->month[i], convert->mday[i], &day);
+          inv_cvtime (convert->year[i] - 1900, day, convert->hour[i], convert->minute[i], convert->second[i],
+                      &expect_sec[i], &expect_nsec[i]);
+          time_sum += (double) expect_sec[i] + (double) expect_nsec[i] * 1.0e-9;
+        }
+
+      scalar_time += now_seconds () - start;
+
+
+      /*  In a batch.  */
+
+      start = now_seconds ();
+
+      convert_split_degrees (n, convert->lat_total, convert->lat_deg, convert->lat_min, convert->lat_sec);
+      convert_degrees (n, convert->lat_deg, convert->lat_min, convert->lat_sec, convert->lat_negative,
+                       convert->latitude);
+
+      batch_dms += now_seconds () - start;
+
+      start = now_seconds ();
+
+      convert_event_times (convert);
+
+      batch_time += now_seconds () - start;
+
+      for (i = 0 ; i < n ; i++)
+        {
+          if (convert->latitude[i] != degrees[i] || convert->tv_sec[i] != expect_sec[i] ||
+              convert->tv_nsec[i] != expect_nsec[i])
+            differ++;
+        }
+    }
+
+  report ("dms to degrees (per record)", rows, scalar_dms, dms_sum);
+  report ("dms to degrees (batch)", rows, batch_dms, dms_sum);
+  report ("DTG to event time (per record)", rows, scalar_time, time_sum);
+  report ("DTG to event time (batch)", rows, batch_time, time_sum);
+
+  if (differ) printf ("\n*** %d batch conversions don't match the one at a time conversions ***\n\n", differ);
+
+  free (convert);
+}
+
+
+
+static void bench_contact_id (int32_t rows)
+{
+  char                contact_id[60];
+  double              start, sum = 0.0;
+  int32_t             i;
+
+
+  start = now_seconds ();
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      contact_id_format (contact_id, 2000 + i % 25, 1 + i % 365, i % 24, i % 60, (float) (i % 60), (uint32_t) i);
+      sum += (double) contact_id[12];
+    }
+
+  report ("contact_id_format", rows, now_seconds () - start, sum);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  CORPUS              corpus;
+  CONTACT_TIME        now;
+  COLUMN_MAP          column_map;
+  PARSE_OPTIONS       options;
+  int32_t             option, rows = 1000000, format;
+  char                suffix = 0;
+
+
+  while ((option = getopt (argc, argv, "n:")) != EOF)
+    {
+      switch (option)
+        {
+        case 'n':
+          if (sscanf (optarg, "%d%c", &rows, &suffix) < 1) rows = 0;
+          if (suffix == 'k' || suffix == 'K') rows *= 1000;
+          if (suffix == 'm' || suffix == 'M') rows *= 1000000;
+          break;
+
+        default:
+          fprintf (stderr, "Usage: bench_stages [-n ROWS]\n");
+          exit (-1);
+        }
+    }
+
+  if (rows < 1)
+    {
+      fprintf (stderr, "Usage: bench_stages [-n ROWS]\n");
+      exit (-1);
+    }
+
+  printf ("%d rows per stage\n\n", rows);
+
+
+  /*  Use a fixed run time so the checksums don't change from run to run.  */
+
+  contact_time_set (&now, 1500000000);
+
+  memset (&options, 0, sizeof (PARSE_OPTIONS));
+
+
+  for (format = INPUT_FORMAT_CSV ; format <= INPUT_FORMAT_UNI ; format++)
+    {
+      make_corpus (format, rows, &corpus);
+      column_map.columns = 0;
+
+      if (format == INPUT_FORMAT_TXT) bench_sget_coord (&corpus);
+      if (format == INPUT_FORMAT_UNI) bench_uni_split (&corpus);
+
+      bench_delim_index (format, &corpus);
+      bench_parse_line (format, &corpus, &now, &options);
+      bench_parse_chunk (format, &corpus, &now, &options);
+
+
+      /*  The same layout as a column mapping (the .uni depth field isn't a plain number so it's left out).  */
+
+      if (format == INPUT_FORMAT_TXT) column_map_compile ("lat:dms,lon:dms,remarks,depth", &column_map);
+      if (format == INPUT_FORMAT_UNI)
+        column_map_compile ("skip,image,lat,lon,skip,skip,skip,heading,length,width,height,dtg", &column_map);
+
+      if (column_map.columns)
+        {
+          options.map = &column_map;
+          bench_parse_chunk (INPUT_FORMAT_MAPPED, &corpus, &now, &options);
+          options.map = NULL;
+        }
+
+      free (corpus.text);
+      free (corpus.line);
+    }
+
+  bench_time (rows);
+  bench_dtg (rows);
+  bench_convert (rows);
+  bench_contact_id (rows);
+
+  return (0);
+}
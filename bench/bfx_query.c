@@ -0,0 +1,169 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Small query tool for the spatial index build_feature --index keeps next to a BFD file (BFD_FILE.bfx).  Prints
+    the record number, position, and description of every feature inside a box, in record number order, or just
+    how many there are.  Records added since the index was last updated are checked by reading them.  */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "spatial_index.h"
+
+
+static double now_seconds ()
+{
+  struct timespec tp;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+
+  return ((double) tp.tv_sec + (double) tp.tv_nsec * 1.0e-9);
+}
+
+
+
+static void usage ()
+{
+  fprintf (stderr, "Usage: bfx_query [-c] <bfd feature file> <south> <west> <north> <east>\n\n");
+  fprintf (stderr, "Prints the features inside the box (in degrees, west negative, south negative).  A box with\n");
+  fprintf (stderr, "west greater than east crosses the 180 degree meridian.  -c just prints how many there are.\n");
+  exit (-1);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  char                bfd_name[512], index_name[1024];
+  int32_t             arg = 1, bfd_handle, found;
+  uint8_t             count_only = NVFalse;
+  uint32_t            i;
+  double              south, west, north, east, start, elapsed;
+  BFDATA_HEADER       bfd_header;
+  BFDATA_RECORD       bfd_record;
+  SPATIAL_INDEX       *index;
+  SPATIAL_INDEX_HITS  hits;
+
+
+  /*  Not getopt, it would take the negative coordinates for options.  */
+
+  if (argc > 1 && !strcmp (argv[1], "-c"))
+    {
+      count_only = NVTrue;
+      arg++;
+    }
+
+  if (arg + 5 != argc || sscanf (argv[arg + 1], "%lf", &south) != 1 || sscanf (argv[arg + 2], "%lf", &west) != 1 ||
+      sscanf (argv[arg + 3], "%lf", &north) != 1 || sscanf (argv[arg + 4], "%lf", &east) != 1) usage ();
+
+  if (south > north)
+    {
+      fprintf (stderr, "The south edge of the box is north of the north edge.\n");
+      exit (-1);
+    }
+
+  strcpy (bfd_name, argv[arg]);
+
+  if ((bfd_handle = binaryFeatureData_open_file (bfd_name, &bfd_header, BFDATA_READONLY)) < 0)
+    {
+      binaryFeatureData_perror ();
+      exit (-1);
+    }
+
+  spatial_index_name (bfd_name, index_name);
+
+  if ((index = spatial_index_open (index_name)) == NULL)
+    {
+      if (errno == EINVAL)
+        {
+          fprintf (stderr, "%s isn't a spatial index for this version, rebuild it with build_feature --index.\n",
+                   index_name);
+        }
+      else
+        {
+          perror (index_name);
+        }
+      exit (-1);
+    }
+
+  if (index->header.records > bfd_header.number_of_records)
+    {
+      fprintf (stderr, "%s indexes more records than %s has, rebuild it with build_feature --index.\n", index_name,
+               bfd_name);
+      exit (-1);
+    }
+
+  memset (&hits, 0, sizeof (SPATIAL_INDEX_HITS));
+
+  start = now_seconds ();
+
+  if ((found = spatial_index_query (index, bfd_handle, bfd_header.number_of_records, south, west, north, east, &hits)) < 0)
+    {
+      if (index->bfd_error)
+        {
+          binaryFeatureData_perror ();
+        }
+      else
+        {
+          perror (index_name);
+        }
+      exit (-1);
+    }
+
+  elapsed = now_seconds () - start;
+
+  if (count_only)
+    {
+      printf ("%d\n", found);
+    }
+  else
+    {
+      for (i = 0 ; i < hits.count ; i++)
+        {
+          if (binaryFeatureData_read_record (bfd_handle, hits.record[i], &bfd_record) < 0)
+            {
+              binaryFeatureData_perror ();
+              exit (-1);
+            }
+
+          printf ("%u %.9f %.9f %s\n", hits.record[i], bfd_record.latitude, bfd_record.longitude,
+                  bfd_record.description);
+        }
+    }
+
+  fprintf (stderr, "%d features in %.3f ms (%u records read to check them, %u of %u records not indexed)\n", found,
+           elapsed * 1000.0, hits.checked, bfd_header.number_of_records - (uint32_t) index->header.records,
+           bfd_header.number_of_records);
+
+  spatial_index_hits_free (&hits);
+  spatial_index_close (index);
+  binaryFeatureData_close_file (bfd_handle);
+
+  return (0);
+}
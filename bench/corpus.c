@@ -0,0 +1,204 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Synthetic .txt, .uni, and .csv lines for the benchmarks.  The .txt lines cycle through every position
+    style that sget_coord understands (hemisphere or signed, degrees, degrees minutes, or degrees minutes
+    seconds, space or tab separated, upper or lower case hemisphere).  The .uni lines have the B: / T: / A:
+    depth field and a DTG.  The .csv lines are NAVO style with signed degrees minutes seconds.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "parse_record.h"
+
+
+/*  Small, fast, and reproducible.  We don't care about quality, just that the numbers move around.  */
+
+static uint64_t mix (uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+
+  return (x);
+}
+
+
+
+/*  Returns a number in [0, 1) for a row and field.  */
+
+static double uniform (uint32_t seed, uint64_t row, int32_t field)
+{
+  return ((double) (mix (((uint64_t) seed << 40) ^ (row << 8) ^ (uint64_t) field) >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+
+/*  Writes a position in one of the styles sget_coord accepts.  */
+
+static int32_t put_position (char *ptr, double value, uint8_t latitude, int32_t style, char sep)
+{
+  char                hemi;
+  double              mag = value < 0.0 ? -value : value, fmin;
+  int32_t             deg, min;
+
+
+  if (latitude)
+    {
+      hemi = value < 0.0 ? 'S' : 'N';
+    }
+  else
+    {
+      hemi = value < 0.0 ? 'W' : 'E';
+    }
+
+  if (style & 8) hemi = hemi - 'A' + 'a';
+
+  deg = (int32_t) mag;
+  fmin = (mag - (double) deg) * 60.0;
+  min = (int32_t) fmin;
+
+
+  /*  Styles 0-2 use a hemisphere character, 3-5 use a sign.  */
+
+  switch (style & 7)
+    {
+    case 0:
+      return (sprintf (ptr, "%c %.6f", hemi, mag));
+
+    case 1:
+      return (sprintf (ptr, "%c %d%c%.4f", hemi, deg, sep, fmin));
+
+    case 2:
+      return (sprintf (ptr, "%c %d%c%d%c%.2f", hemi, deg, sep, min, sep, (fmin - (double) min) * 60.0));
+
+    case 3:
+      return (sprintf (ptr, "%+.6f", value));
+
+    case 4:
+      return (sprintf (ptr, "%s%d%c%.4f", value < 0.0 ? "-" : "", deg, sep, fmin));
+
+    default:
+      return (sprintf (ptr, "%s%d%c%d%c%.2f", value < 0.0 ? "-" : "", deg, sep, min, sep, (fmin - (double) min) * 60.0));
+    }
+}
+
+
+
+/*  Pick the corpus format from "txt", "uni", or "csv".  Returns -1 if we don't recognize it.  */
+
+int32_t corpus_format (const char *name)
+{
+  return (input_format_from_name (name));
+}
+
+
+
+/*  Writes the header line (if the format has one) and returns its length (0 if it doesn't).  */
+
+int32_t corpus_header (int32_t format, char *line)
+{
+  switch (format)
+    {
+    case INPUT_FORMAT_TXT:
+      return (sprintf (line, "LAT,LONG,REMARKS,DEPTH\n"));
+
+    case INPUT_FORMAT_UNI:
+      return (sprintf (line, "unisips file,snippet file,latitude,longitude,row,column,depth,heading,length,width,height,dtg,desc,remarks\n"));
+    }
+
+  line[0] = 0;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        corpus_line                                         *
+*                                                                           *
+*   Purpose:            Generates one input line (with its newline).        *
+*                                                                           *
+*   Inputs:             format              -   INPUT_FORMAT_TXT, _UNI, or  *
+*                                               _CSV                        *
+*                       seed                -   corpus seed                 *
+*                       row                 -   row number                  *
+*                       line                -   returned line, at least     *
+*                                               CORPUS_LINE_MAX bytes       *
+*                                                                           *
+*   Outputs:            int32_t             -   length of the line          *
+*                                                                           *
+\***************************************************************************/
+
+int32_t corpus_line (int32_t format, uint32_t seed, uint64_t row, char *line)
+{
+  double              lat, lon;
+  int32_t             len, style;
+  char                sep;
+
+
+  lat = uniform (seed, row, 0) * 160.0 - 80.0;
+  lon = uniform (seed, row, 1) * 360.0 - 180.0;
+
+  switch (format)
+    {
+    case INPUT_FORMAT_TXT:
+      style = (int32_t) (row % 6) | ((row % 5 == 0) ? 8 : 0);
+      sep = (row % 3 == 0) ? '\t' : ' ';
+
+      len = put_position (line, lat, NVTrue, style, sep);
+      line[len++] = ',';
+      len += put_position (line + len, lon, NVFalse, (style + (int32_t) (row / 6)) % 6, sep);
+      len += sprintf (line + len, ",contact %llu,%.1f\n", (unsigned long long) row, uniform (seed, row, 2) * 500.0);
+      break;
+
+
+    case INPUT_FORMAT_UNI:
+      len = sprintf (line, "/unisips/k5-survey-%04d%03d-%06llu-s.u,%llu-%llu.gif,%.6f,%.6f,%llu,%llu,"
+                     "B: %.1f / T: %.1f /  A: %.1f,%.4f, %.2f, %.2f, %.2f,%02d-%02d-%04d  %02d:%02d:%05.2f,"
+                     "contact %llu,remarks %llu\n",
+                     2000 + (int32_t) (row % 25), 1 + (int32_t) (row % 365), (unsigned long long) (row / 100),
+                     (unsigned long long) row, (unsigned long long) (row % 1000), lat, lon,
+                     (unsigned long long) (row % 8000), (unsigned long long) (row % 1000),
+                     uniform (seed, row, 3) * 100.0, uniform (seed, row, 4) * 20.0, uniform (seed, row, 5) * 50.0,
+                     uniform (seed, row, 6) * 360.0, uniform (seed, row, 7) * 60.0, uniform (seed, row, 8) * 20.0,
+                     uniform (seed, row, 9) * 20.0, 1 + (int32_t) (row % 12), 1 + (int32_t) (row % 28),
+                     2000 + (int32_t) (row % 25), (int32_t) (row % 24), (int32_t) (row % 60),
+                     uniform (seed, row, 10) * 60.0, (unsigned long long) row, (unsigned long long) row);
+      break;
+
+
+    default:
+      len = sprintf (line, "CONTACT %llu,REMARKS %llu,%d %d %d,%d %d %d, %.1f\n", (unsigned long long) row,
+                     (unsigned long long) row, (int32_t) lon, abs ((int32_t) ((lon - (int32_t) lon) * 60.0)),
+                     (int32_t) (row % 60), (int32_t) lat, abs ((int32_t) ((lat - (int32_t) lat) * 60.0)),
+                     (int32_t) ((row / 60) % 60), uniform (seed, row, 2) * 500.0);
+      break;
+    }
+
+  return (len);
+}
@@ -0,0 +1,40 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __CORPUS_H__
+#define __CORPUS_H__
+
+#include "nvutility.h"
+
+
+/*  Synthetic input generator shared by the benchmark programs.  Every line is a pure function of the
+    format, seed, and row number so a corpus can be regenerated (or generated in pieces) exactly.  */
+
+#define CORPUS_LINE_MAX         1024
+
+
+int32_t corpus_format (const char *name);
+int32_t corpus_header (int32_t format, char *line);
+int32_t corpus_line (int32_t format, uint32_t seed, uint64_t row, char *line);
+
+
+#endif
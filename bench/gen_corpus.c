@@ -0,0 +1,107 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+/*  Writes a synthetic .txt, .uni, or .csv corpus for benchmarking build_feature.  Row counts can have a K
+    or M suffix (e.g. 50M).  The output is the same for the same format, seed, and row count.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nvutility.h"
+
+#include "corpus.h"
+
+
+static void usage ()
+{
+  fprintf (stderr, "Usage: gen_corpus [-s SEED] <txt | uni | csv> <rows (e.g. 1000, 100K, 50M)> <output file | ->\n");
+  exit (-1);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  char                line[CORPUS_LINE_MAX], suffix = 0;
+  int32_t             option, format, len;
+  uint32_t            seed = 1;
+  unsigned long long  rows;
+  uint64_t            row;
+  FILE                *fp;
+
+
+  while ((option = getopt (argc, argv, "s:")) != EOF)
+    {
+      switch (option)
+        {
+        case 's':
+          sscanf (optarg, "%u", &seed);
+          break;
+
+        default:
+          usage ();
+          break;
+        }
+    }
+
+  if (optind + 3 > argc) usage ();
+
+  if ((format = corpus_format (argv[optind])) < 0) usage ();
+
+  if (sscanf (argv[optind + 1], "%llu%c", &rows, &suffix) < 1) usage ();
+
+  if (suffix == 'k' || suffix == 'K') rows *= 1000;
+  if (suffix == 'm' || suffix == 'M') rows *= 1000000;
+
+
+  if (!strcmp (argv[optind + 2], "-"))
+    {
+      fp = stdout;
+    }
+  else if ((fp = fopen (argv[optind + 2], "w")) == NULL)
+    {
+      perror (argv[optind + 2]);
+      exit (-1);
+    }
+
+  setvbuf (fp, NULL, _IOFBF, 1024 * 1024);
+
+
+  if ((len = corpus_header (format, line))) fwrite (line, 1, len, fp);
+
+  for (row = 0 ; row < rows ; row++)
+    {
+      len = corpus_line (format, seed, row, line);
+
+      if (fwrite (line, 1, len, fp) != (size_t) len)
+        {
+          perror (argv[optind + 2]);
+          exit (-1);
+        }
+    }
+
+  if (fp != stdout) fclose (fp);
+
+  return (0);
+}
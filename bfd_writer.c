@@ -0,0 +1,329 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "bfd_writer.h"
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        bfd_writer_open                                     *
+*                                                                           *
+*   Purpose:            Creates a staging writer for an open BFD file.      *
+*                       Snippet images are read (or copied from the parse   *
+*                       threads' batches) into memory ahead of the writes   *
+*                       so the BFD library doesn't open and read each       *
+*                       image file itself.  The records still go to the     *
+*                       BFD library one call at a time (it has no multi     *
+*                       record write) so this doesn't save any system       *
+*                       calls on the BFD file.                              *
+*                                                                           *
+*   Inputs:             bfd_handle          -   open BFD file handle        *
+*                       batch_size          -   records per flush (0 for    *
+*                                               the default)                *
+*                       image_bytes         -   staged image byte limit (0  *
+*                                               for the default)            *
+*                                                                           *
+*   Outputs:            BFD_WRITER *        -   writer or NULL on error     *
+*                                                                           *
+\***************************************************************************/
+
+BFD_WRITER *bfd_writer_open (int32_t bfd_handle, int32_t batch_size, size_t image_bytes)
+{
+  BFD_WRITER *writer;
+
+
+  if ((writer = (BFD_WRITER *) calloc (1, sizeof (BFD_WRITER))) == NULL) return (NULL);
+
+  writer->bfd_handle = bfd_handle;
+  writer->batch_size = batch_size > 0 ? batch_size : BFD_WRITER_BATCH_SIZE;
+  writer->image_size = image_bytes > 0 ? image_bytes : BFD_WRITER_IMAGE_BYTES;
+
+  if ((writer->entry = (BFD_WRITER_ENTRY *) malloc (writer->batch_size * sizeof (BFD_WRITER_ENTRY))) == NULL)
+    {
+      free (writer);
+      return (NULL);
+    }
+
+  return (writer);
+}
+
+
+
+/*  Reads an image into the staging buffer.  Returns the image size, or -1 if the image isn't staged
+    (can't be opened, too big for the buffer) and should be left to the BFD library.  Returns -2 if the
+    image is fine but won't fit until the buffer has been flushed.  */
+
+static int64_t stage_image (BFD_WRITER *writer, const char *image_name)
+{
+  struct stat         st;
+  FILE                *fp;
+  size_t              size;
+
+
+  if (stat (image_name, &st) < 0 || st.st_size <= 0 || (size_t) st.st_size > writer->image_size ||
+      st.st_size > 0x7fffffff)
+    return (-1);
+
+  size = (size_t) st.st_size;
+
+  if (writer->image_used + size > writer->image_size) return (-2);
+
+
+  /*  The image buffer isn't allocated until we actually see an image (.txt and .csv never have any).  */
+
+  if (writer->image == NULL && (writer->image = (uint8_t *) malloc (writer->image_size)) == NULL) return (-1);
+
+  if ((fp = fopen (image_name, "rb")) == NULL) return (-1);
+
+  if (fread (writer->image + writer->image_used, 1, size, fp) != size)
+    {
+      fclose (fp);
+      return (-1);
+    }
+
+  fclose (fp);
+
+  return ((int64_t) size);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        bfd_writer_add                                      *
+*                                                                           *
+*   Purpose:            Stages a record (and its image, if any) for         *
+*                       writing.  Flushes first if the batch is full or     *
+*                       the image won't fit in the staging buffer.          *
+*                                                                           *
+*   Inputs:             writer              -   BFD writer                  *
+*                       record              -   record to write             *
+*                       image_name          -   image file name or NULL/""  *
+*                                                                           *
+*   Outputs:            int32_t             -   0 on success, -1 if a       *
+*                                               flush failed (use           *
+*                                               binaryFeatureData_perror)   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t bfd_writer_add (BFD_WRITER *writer, BFDATA_RECORD *record, const char *image_name)
+{
+  BFD_WRITER_ENTRY    *entry;
+  int64_t             size = 0;
+  uint64_t            start;
+
+
+  if (writer->count == writer->batch_size && bfd_writer_flush (writer) < 0) return (-1);
+
+
+  if (image_name && image_name[0])
+    {
+      start = stats_clock_ns ();
+
+      if ((size = stage_image (writer, image_name)) == -2)
+        {
+          if (bfd_writer_flush (writer) < 0) return (-1);
+
+          start = stats_clock_ns ();
+          size = stage_image (writer, image_name);
+        }
+
+      writer->image_ns += stats_clock_ns () - start;
+    }
+
+  entry = &writer->entry[writer->count++];
+
+  entry->record = *record;
+  entry->image_offset = writer->image_used;
+  entry->image_file = NVFalse;
+
+  if (size > 0)
+    {
+      entry->record.image_size = (uint32_t) size;
+      writer->image_used += size;
+      writer->images++;
+      writer->image_bytes += size;
+    }
+  else if (size < 0)
+    {
+      writer->image_fallbacks++;
+      entry->image_file = NVTrue;
+      strncpy (entry->image_name, image_name, sizeof (entry->image_name) - 1);
+      entry->image_name[sizeof (entry->image_name) - 1] = 0;
+    }
+  else
+    {
+      entry->record.image_size = 0;
+    }
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        bfd_writer_add_image                                *
+*                                                                           *
+*   Purpose:            Stages a record whose image is already in memory    *
+*                       (e.g. loaded by the parse threads).  The image is   *
+*                       copied so the caller can reuse its buffer as soon   *
+*                       as this returns.  An image too big for the staging  *
+*                       buffer is written straight through.                 *
+*                                                                           *
+*   Inputs:             writer              -   BFD writer                  *
+*                       record              -   record to write             *
+*                       image               -   image bytes                 *
+*                       size                -   image size                  *
+*                                                                           *
+*   Outputs:            int32_t             -   0 on success, -1 if a       *
+*                                               write failed (use           *
+*                                               binaryFeatureData_perror)   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t bfd_writer_add_image (BFD_WRITER *writer, BFDATA_RECORD *record, const uint8_t *image, size_t size)
+{
+  BFD_WRITER_ENTRY    *entry;
+  BFDATA_RECORD       direct;
+  uint64_t            start;
+  int32_t             status;
+
+
+  if (!size) return (bfd_writer_add (writer, record, NULL));
+
+  if (writer->count == writer->batch_size && bfd_writer_flush (writer) < 0) return (-1);
+
+  if (writer->image_used + size > writer->image_size && bfd_writer_flush (writer) < 0) return (-1);
+
+  if (writer->image == NULL) writer->image = (uint8_t *) malloc (writer->image_size);
+
+  writer->images++;
+  writer->image_bytes += size;
+
+
+  /*  Too big to stage (or no staging buffer), everything before it has been flushed so just write it.  The
+      image size goes in a copy, the caller's record is left alone the same as when it's staged.  */
+
+  if (size > writer->image_size || writer->image == NULL)
+    {
+      if (bfd_writer_flush (writer) < 0) return (-1);
+
+      direct = *record;
+      direct.image_size = (uint32_t) size;
+
+      start = stats_clock_ns ();
+      status = binaryFeatureData_write_record (writer->bfd_handle, BFDATA_NEXT_RECORD, &direct, NULL, (uint8_t *) image);
+      writer->write_ns += stats_clock_ns () - start;
+
+      return (status < 0 ? -1 : 0);
+    }
+
+  memcpy (writer->image + writer->image_used, image, size);
+
+  entry = &writer->entry[writer->count++];
+
+  entry->record = *record;
+  entry->record.image_size = (uint32_t) size;
+  entry->image_offset = writer->image_used;
+  entry->image_file = NVFalse;
+
+  writer->image_used += size;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        bfd_writer_flush                                    *
+*                                                                           *
+*   Purpose:            Writes all staged records to the BFD file in the    *
+*                       order they were added, one BFD library call per     *
+*                       record.  If a write fails the records before it     *
+*                       have been written and the rest are discarded.       *
+*                                                                           *
+*   Inputs:             writer              -   BFD writer                  *
+*                                                                           *
+*   Outputs:            int32_t             -   0 on success, -1 on error   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t bfd_writer_flush (BFD_WRITER *writer)
+{
+  BFD_WRITER_ENTRY    *entry;
+  int32_t             i, status = 0;
+  uint64_t            start;
+
+
+  start = stats_clock_ns ();
+
+  for (i = 0 ; i < writer->count ; i++)
+    {
+      entry = &writer->entry[i];
+
+      if (entry->image_file)
+        {
+          status = binaryFeatureData_write_record_image_file (writer->bfd_handle, BFDATA_NEXT_RECORD, &entry->record,
+                                                              NULL, entry->image_name);
+        }
+      else
+        {
+          status = binaryFeatureData_write_record (writer->bfd_handle, BFDATA_NEXT_RECORD, &entry->record, NULL,
+                                                   entry->record.image_size ? writer->image + entry->image_offset : NULL);
+        }
+
+      if (status < 0) break;
+    }
+
+  writer->write_ns += stats_clock_ns () - start;
+  writer->count = 0;
+  writer->image_used = 0;
+  writer->flushes++;
+
+  return (status < 0 ? -1 : 0);
+}
+
+
+
+/*  Flushes anything that is still staged and frees the writer.  The BFD file itself is left open.  */
+
+int32_t bfd_writer_close (BFD_WRITER *writer)
+{
+  int32_t status;
+
+
+  status = bfd_writer_flush (writer);
+
+  free (writer->entry);
+  free (writer->image);
+  free (writer);
+
+  return (status);
+}
@@ -0,0 +1,79 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __BFD_WRITER_H__
+#define __BFD_WRITER_H__
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "stats.h"
+
+
+/*  Default number of records staged before a flush and the default limit on staged image bytes.  */
+
+#define BFD_WRITER_BATCH_SIZE   4096
+#define BFD_WRITER_IMAGE_BYTES  (64 * 1024 * 1024)
+
+
+/*  A staged record.  If image_file is set the image couldn't be (or wasn't worth) staging and the BFD
+    library will read it from image_name when the record is flushed.  */
+
+typedef struct
+{
+  BFDATA_RECORD       record;
+  size_t              image_offset;       /*  Offset of the image in the writer's image buffer  */
+  uint8_t             image_file;
+  char                image_name[512];
+} BFD_WRITER_ENTRY;
+
+
+/*  Staging writer around an open BFD handle.  It stages records and their images, it doesn't batch the
+    BFD writes themselves.  Not thread safe, it is meant to be driven by a single writer (e.g. the pipeline
+    writer thread).  */
+
+typedef struct
+{
+  int32_t             bfd_handle;
+  BFD_WRITER_ENTRY    *entry;
+  int32_t             count;              /*  Number of staged records  */
+  int32_t             batch_size;         /*  Flush when this many records are staged  */
+  uint8_t             *image;             /*  Staged image bytes  */
+  size_t              image_used;
+  size_t              image_size;         /*  Flush when the next image won't fit  */
+  uint32_t            flushes;            /*  Number of flushes so far  */
+  uint64_t            image_ns;           /*  Time spent reading images into the buffer  */
+  uint64_t            write_ns;           /*  Time spent in the BFD library  */
+  uint64_t            images;             /*  Images staged  */
+  uint64_t            image_bytes;        /*  Bytes of images staged  */
+  uint64_t            image_fallbacks;    /*  Images left to the BFD library  */
+} BFD_WRITER;
+
+
+BFD_WRITER *bfd_writer_open (int32_t bfd_handle, int32_t batch_size, size_t image_bytes);
+int32_t bfd_writer_add (BFD_WRITER *writer, BFDATA_RECORD *record, const char *image_name);
+int32_t bfd_writer_add_image (BFD_WRITER *writer, BFDATA_RECORD *record, const uint8_t *image, size_t size);
+int32_t bfd_writer_flush (BFD_WRITER *writer);
+int32_t bfd_writer_close (BFD_WRITER *writer);
+
+
+#endif
@@ -1,5 +1,5 @@
 INCLUDEPATH += /c/PFM/compile/include
-LIBS += -L /c/PFM/compile/lib -lBinaryFeatureData -lnvutility -lgdal -lxml2 -lpoppler -lm -liconv -lstdc++
+LIBS += -L /c/PFM/compile/lib -lBinaryFeatureData -lnvutility -lgdal -lxml2 -lpoppler -lzstd -lz -lpthread -lm -liconv -lstdc++
 DEFINES += NVWIN3X
 CONFIG += console
 CONFIG -= qt
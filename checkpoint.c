@@ -0,0 +1,334 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "checkpoint.h"
+
+
+#define CHECKPOINT_MAGIC        "build_feature checkpoint 1"
+
+
+/*  The journal lives next to the BFD file.  */
+
+void checkpoint_name (const char *bfd_name, char *path)
+{
+  sprintf (path, "%s.ckpt", bfd_name);
+}
+
+
+
+/*  Forces a file's data to disk.  Returns 0 or -1 (errno is set).  */
+
+int32_t checkpoint_sync_file (const char *path)
+{
+  int32_t             fd, status, err;
+
+
+  if ((fd = open (path, O_RDONLY)) < 0) return (-1);
+
+#ifdef WIN32
+  status = _commit (fd);
+#else
+  status = fsync (fd);
+#endif
+
+  err = errno;
+  close (fd);
+  errno = err;
+
+  return (status);
+}
+
+
+
+/*  Cuts a file back to size bytes (e.g. to drop what was written after a commit point).  Returns 0 or -1
+    (errno is set).  */
+
+int32_t checkpoint_truncate_file (const char *path, int64_t size)
+{
+#ifdef WIN32
+  int32_t             fd, status;
+
+
+  if ((fd = open (path, O_RDWR)) < 0) return (-1);
+
+  if ((status = _chsize_s (fd, size)) != 0) errno = status;
+
+  close (fd);
+
+  return (status ? -1 : 0);
+#else
+  return (truncate (path, (off_t) size));
+#endif
+}
+
+
+
+/*  Forces the BFD file and the BFD library's attachment file (the polygons and snippet images, the BFD file
+    name with a .bfa extension) to disk.  No other files are touched, the spatial index and the reject file
+    are synced by whoever writes them.  The BFD file has to be closed first so the library has written
+    everything out.  */
+
+int32_t checkpoint_sync_bfd (const char *bfd_name)
+{
+  char                path[1024], *dot;
+
+
+  if (checkpoint_sync_file (bfd_name) < 0) return (-1);
+
+  if (strlen (bfd_name) + strlen (CHECKPOINT_BFD_ATTACHMENTS) >= sizeof (path))
+    {
+      errno = ENAMETOOLONG;
+      return (-1);
+    }
+
+  strcpy (path, bfd_name);
+  if ((dot = strrchr (path, '.')) != NULL && strchr (dot, '/') == NULL && strchr (dot, '\\') == NULL) *dot = 0;
+  strcat (path, CHECKPOINT_BFD_ATTACHMENTS);
+
+
+  /*  There's no attachment file until the first polygon or image is written.  */
+
+  if (checkpoint_sync_file (path) < 0 && errno != ENOENT) return (-1);
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        checkpoint_write                                    *
+*                                                                           *
+*   Purpose:            Writes the checkpoint journal.  The new journal is  *
+*                       written to a temporary file, forced to disk, and    *
+*                       then renamed over the old one so there is always    *
+*                       a complete journal on disk no matter when we die.   *
+*                                                                           *
+*   Inputs:             path                -   journal file name           *
+*                       checkpoint          -   checkpoint to write         *
+*                                                                           *
+*   Outputs:            int32_t             -   0 or -1 on error (errno is  *
+*                                               set)                        *
+*                                                                           *
+\***************************************************************************/
+
+int32_t checkpoint_write (const char *path, CHECKPOINT *checkpoint)
+{
+  char                tmp[1024];
+  FILE                *fp;
+  int32_t             status, err, i;
+
+
+  sprintf (tmp, "%s.tmp", path);
+
+  if ((fp = fopen (tmp, "w")) == NULL) return (-1);
+
+  fprintf (fp, "%s\n", CHECKPOINT_MAGIC);
+  fprintf (fp, "file_index %d\n", checkpoint->file_index);
+  fprintf (fp, "file %s\n", checkpoint->file);
+  fprintf (fp, "file_size %lld\n", (long long) checkpoint->file_size);
+  fprintf (fp, "file_mtime %lld\n", (long long) checkpoint->file_mtime);
+  fprintf (fp, "offset %llu\n", (unsigned long long) checkpoint->offset);
+  fprintf (fp, "records %u\n", checkpoint->records);
+  fprintf (fp, "sequence %u\n", checkpoint->sequence);
+  fprintf (fp, "count %d\n", checkpoint->count);
+  fprintf (fp, "lines %llu\n", (unsigned long long) checkpoint->lines);
+  fprintf (fp, "reject_size %lld\n", (long long) checkpoint->reject_size);
+
+  for (i = 1 ; i < CHECKPOINT_REJECT_REASONS ; i++)
+    {
+      if (checkpoint->rejected[i]) fprintf (fp, "rejected %d %d\n", i, checkpoint->rejected[i]);
+    }
+
+  status = fflush (fp);
+
+#ifdef WIN32
+  if (!status) status = _commit (fileno (fp));
+#else
+  if (!status) status = fsync (fileno (fp));
+#endif
+
+  err = errno;
+  if (fclose (fp) && !status)
+    {
+      status = -1;
+      err = errno;
+    }
+
+  if (status)
+    {
+      remove (tmp);
+      errno = err;
+      return (-1);
+    }
+
+
+  /*  Windoze won't rename over an existing file.  */
+
+#ifdef WIN32
+  remove (path);
+#endif
+
+  if (rename (tmp, path)) return (-1);
+
+
+  /*  Make the rename itself durable.  */
+
+#ifndef WIN32
+  {
+    char dir[1024], *slash;
+    int32_t fd;
+
+    strcpy (dir, path);
+    if ((slash = strrchr (dir, '/')) == NULL)
+      {
+        strcpy (dir, ".");
+      }
+    else if (slash == dir)
+      {
+        dir[1] = 0;
+      }
+    else
+      {
+        *slash = 0;
+      }
+
+    if ((fd = open (dir, O_RDONLY)) >= 0)
+      {
+        fsync (fd);
+        close (fd);
+      }
+  }
+#endif
+
+  return (0);
+}
+
+
+
+/*  Reads a checkpoint journal.  Returns 0, or -1 if it can't be read or isn't a complete journal.  The tolerant
+    mode fields are optional (older journals don't have them).  */
+
+int32_t checkpoint_read (const char *path, CHECKPOINT *checkpoint)
+{
+  char                string[1024];
+  FILE                *fp;
+  int32_t             fields = 0, len, reason, rejected;
+  long long           value;
+  unsigned long long  uvalue;
+
+
+  memset (checkpoint, 0, sizeof (CHECKPOINT));
+
+  if ((fp = fopen (path, "r")) == NULL) return (-1);
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, CHECKPOINT_MAGIC, strlen (CHECKPOINT_MAGIC)))
+    {
+      fclose (fp);
+      errno = EINVAL;
+      return (-1);
+    }
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      len = strlen (string);
+      while (len && (string[len - 1] == '\n' || string[len - 1] == '\r')) string[--len] = 0;
+
+      if (!strncmp (string, "file ", 5))
+        {
+          len = (int32_t) strlen (string + 5);
+          if (len > (int32_t) sizeof (checkpoint->file) - 1) len = (int32_t) sizeof (checkpoint->file) - 1;
+
+          memcpy (checkpoint->file, string + 5, len);
+          checkpoint->file[len] = 0;
+          fields++;
+        }
+      else if (sscanf (string, "file_index %d", &checkpoint->file_index) == 1)
+        {
+          fields++;
+        }
+      else if (sscanf (string, "file_size %lld", &value) == 1)
+        {
+          checkpoint->file_size = value;
+          fields++;
+        }
+      else if (sscanf (string, "file_mtime %lld", &value) == 1)
+        {
+          checkpoint->file_mtime = value;
+          fields++;
+        }
+      else if (sscanf (string, "offset %llu", &uvalue) == 1)
+        {
+          checkpoint->offset = uvalue;
+          fields++;
+        }
+      else if (sscanf (string, "records %u", &checkpoint->records) == 1)
+        {
+          fields++;
+        }
+      else if (sscanf (string, "sequence %u", &checkpoint->sequence) == 1)
+        {
+          fields++;
+        }
+      else if (sscanf (string, "count %d", &checkpoint->count) == 1)
+        {
+          fields++;
+        }
+      else if (sscanf (string, "lines %llu", &uvalue) == 1)
+        {
+          checkpoint->lines = uvalue;
+        }
+      else if (sscanf (string, "reject_size %lld", &value) == 1)
+        {
+          checkpoint->reject_size = value;
+        }
+      else if (sscanf (string, "rejected %d %d", &reason, &rejected) == 2 && reason > 0 &&
+               reason < CHECKPOINT_REJECT_REASONS)
+        {
+          checkpoint->rejected[reason] = rejected;
+        }
+    }
+
+  fclose (fp);
+
+  if (fields != 8)
+    {
+      errno = EINVAL;
+      return (-1);
+    }
+
+  return (0);
+}
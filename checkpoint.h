@@ -0,0 +1,75 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include "nvutility.h"
+
+
+/*  Default number of records between durable commit points.  Checkpoints cost a sync and a BFD reopen each
+    time so they're off unless --checkpoint is given.  */
+
+#define CHECKPOINT_RECORDS      0
+
+
+/*  Room for the rejected line counts (one per REJECT_ reason, see parse_record.h).  */
+
+#define CHECKPOINT_REJECT_REASONS 8
+
+
+/*  Extension of the BFD library's attachment file (it replaces the BFD file's extension).  */
+
+#define CHECKPOINT_BFD_ATTACHMENTS ".bfa"
+
+
+/*  Where a run had gotten to at its last durable commit point.  Everything up to offset in input file
+    file_index is in the BFD file (which had records records in it) and nothing after it is, except
+    possibly records written after the commit point by a run that then died.  Those are skipped, not
+    rewritten, by --resume.  The line count and the reject file fields are only used in tolerant mode (a
+    journal without them reads as zeros).  */
+
+typedef struct
+{
+  int32_t             file_index;         /*  Index of the input file in the input list  */
+  char                file[512];          /*  Fully qualified input file name  */
+  int64_t             file_size;          /*  Size and modification time, to make sure it's the same file  */
+  int64_t             file_mtime;
+  uint64_t            offset;             /*  Input byte offset just past the last committed line  */
+  uint32_t            records;            /*  Number of records in the BFD file  */
+  uint32_t            sequence;           /*  Next contact ID sequence number  */
+  int32_t             count;              /*  Records written by the run so far  */
+  uint64_t            lines;              /*  Lines of the input file up to offset  */
+  int64_t             reject_size;        /*  Size of the reject file  */
+  int32_t             rejected[CHECKPOINT_REJECT_REASONS];  /*  Lines rejected by the run so far, by reason  */
+} CHECKPOINT;
+
+
+void checkpoint_name (const char *bfd_name, char *path);
+int32_t checkpoint_write (const char *path, CHECKPOINT *checkpoint);
+int32_t checkpoint_read (const char *path, CHECKPOINT *checkpoint);
+int32_t checkpoint_sync_file (const char *path);
+int32_t checkpoint_sync_bfd (const char *bfd_name);
+int32_t checkpoint_truncate_file (const char *path, int64_t size);
+
+
+#endif
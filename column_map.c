@@ -0,0 +1,594 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+
+#include "column_map.h"
+#include "sget_coord.h"
+
+
+#ifndef M_PI
+    #define M_PI                3.14159265358979323846
+#endif
+
+#define RAD2DEG                 (180.0 / M_PI)
+
+
+/*  How a field's values are written and so which units it takes.  */
+
+#define KIND_NONE               0
+#define KIND_POSITION           1       /*  deg, dms, or rad  */
+#define KIND_DISTANCE           2       /*  m, ft, or fm  */
+#define KIND_ANGLE              3       /*  deg or rad  */
+#define KIND_TEXT               4
+#define KIND_DTG                5       /*  mdy  */
+#define KIND_TIME               6       /*  s  */
+
+
+static const char *field_name[COLUMN_FIELDS] = {"skip", "lat", "lon", "depth", "heading", "length", "width", "height",
+                                                "remarks", "image", "dtg", "time"};
+
+static const int32_t field_kind[COLUMN_FIELDS] = {KIND_NONE, KIND_POSITION, KIND_POSITION, KIND_DISTANCE, KIND_ANGLE,
+                                                  KIND_DISTANCE, KIND_DISTANCE, KIND_DISTANCE, KIND_TEXT, KIND_TEXT,
+                                                  KIND_DTG, KIND_TIME};
+
+
+/*  The units each kind of field takes (the first one is the default) and what they're multiplied by to
+    get degrees or meters.  A scale of 0.0 means the value isn't a plain number (dms).  */
+
+typedef struct
+{
+  int32_t             kind;
+  const char          *name;
+  double              scale;
+} COLUMN_UNIT;
+
+static const COLUMN_UNIT unit_table[] = {{KIND_POSITION, "deg", 1.0},
+                                         {KIND_POSITION, "dms", 0.0},
+                                         {KIND_POSITION, "rad", RAD2DEG},
+                                         {KIND_DISTANCE, "m", 1.0},
+                                         {KIND_DISTANCE, "ft", 0.3048},
+                                         {KIND_DISTANCE, "fm", 1.8288},
+                                         {KIND_ANGLE, "deg", 1.0},
+                                         {KIND_ANGLE, "rad", RAD2DEG},
+                                         {KIND_TEXT, "text", 1.0},
+                                         {KIND_DTG, "mdy", 1.0},
+                                         {KIND_TIME, "s", 1.0}};
+
+#define UNITS                   ((int32_t) (sizeof (unit_table) / sizeof (COLUMN_UNIT)))
+
+
+/*  The column parsers.  Each one only does what its column needs so the per record work is one indirect
+    call per mapped column.  Empty or unreadable numbers leave the zero the record was cleared to.  */
+
+#define TARGET(type) (*(type *) ((char *) value->feature + value->column->offset))
+
+
+static void parse_double (const COLUMN_VALUE *value)
+{
+  sv_scan_double (value->field.ptr, value->field.ptr + value->field.len, &TARGET (double));
+}
+
+
+static void parse_double_scaled (const COLUMN_VALUE *value)
+{
+  double              number;
+
+
+  if (sv_scan_double (value->field.ptr, value->field.ptr + value->field.len, &number) != NULL)
+    TARGET (double) = number * value->column->scale;
+}
+
+
+static void parse_latitude_dms (const COLUMN_VALUE *value)
+{
+  value->feature->bfd_record.latitude = sget_coord_degrees (value->field, 'S');
+}
+
+
+static void parse_longitude_dms (const COLUMN_VALUE *value)
+{
+  value->feature->bfd_record.longitude = sget_coord_degrees (value->field, 'W');
+}
+
+
+static void parse_float (const COLUMN_VALUE *value)
+{
+  sv_scan_float (value->field.ptr, value->field.ptr + value->field.len, &TARGET (float));
+}
+
+
+static void parse_float_scaled (const COLUMN_VALUE *value)
+{
+  float               number;
+
+
+  if (sv_scan_float (value->field.ptr, value->field.ptr + value->field.len, &number) != NULL)
+    TARGET (float) = (float) (number * value->column->scale);
+}
+
+
+static void parse_remarks (const COLUMN_VALUE *value)
+{
+  sv_copy (value->field, value->feature->bfd_record.remarks, sizeof (value->feature->bfd_record.remarks));
+}
+
+
+static void parse_image (const COLUMN_VALUE *value)
+{
+  sv_copy (value->field, value->feature->image_name, sizeof (value->feature->image_name));
+}
+
+
+/*  Same as the .uni DTG.  With convert set it's staged for convert_event_times, otherwise parse_line
+    converts it.  */
+
+static void parse_dtg (const COLUMN_VALUE *value)
+{
+  FEATURE_RECORD      *feature = value->feature;
+  CONVERT_BATCH       *convert = value->convert;
+  int32_t             month = 0, mday = 0, n;
+
+
+  feature->year = feature->hour = feature->minute = 0;
+  feature->second = 0.0;
+
+  dtg_parse (value->field, &feature->year, &month, &mday, &feature->hour, &feature->minute, &feature->second);
+
+  if (convert != NULL)
+    {
+      n = convert->count;
+      convert->year[n] = feature->year;
+      convert->month[n] = month;
+      convert->mday[n] = mday;
+      convert->hour[n] = feature->hour;
+      convert->minute[n] = feature->minute;
+      convert->second[n] = feature->second;
+      return;
+    }
+
+  dtg_jday (feature->year, month, mday, &feature->day);
+}
+
+
+static void parse_time (const COLUMN_VALUE *value)
+{
+  FEATURE_RECORD      *feature = value->feature;
+  BFDATA_RECORD       *bfd_record = &feature->bfd_record;
+  double              seconds = 0.0;
+
+
+  sv_scan_double (value->field.ptr, value->field.ptr + value->field.len, &seconds);
+
+  bfd_record->event_tv_sec = (time_t) floor (seconds);
+  bfd_record->event_tv_nsec = (long) ((seconds - floor (seconds)) * 1000000000.0);
+
+  cvtime (bfd_record->event_tv_sec, bfd_record->event_tv_nsec, &feature->year, &feature->day, &feature->hour,
+          &feature->minute, &feature->second);
+
+  feature->year += 1900;
+}
+
+
+
+/*  Compiles one "field[:unit]" entry of a spec into column number col.  */
+
+static int32_t compile_column (STRING_VIEW entry, int32_t col, COLUMN_MAP *map)
+{
+  COLUMN              *column = &map->column[col];
+  STRING_VIEW         name, unit;
+  const COLUMN_UNIT   *use = NULL;
+  int32_t             i, kind;
+  size_t              len;
+
+
+  name = entry;
+  unit = sv_make (entry.ptr + entry.len, 0);
+
+  for (i = 0 ; i < (int32_t) entry.len ; i++)
+    {
+      if (entry.ptr[i] == ':')
+        {
+          name = sv_make (entry.ptr, i);
+          unit = sv_make (entry.ptr + i + 1, entry.len - i - 1);
+          break;
+        }
+    }
+
+  memset (column, 0, sizeof (COLUMN));
+
+  if (!name.len)
+    {
+      column->field = COLUMN_SKIP;
+    }
+  else
+    {
+      for (column->field = 0 ; column->field < COLUMN_FIELDS ; column->field++)
+        {
+          if (strlen (field_name[column->field]) == name.len && !memcmp (field_name[column->field], name.ptr, name.len))
+            break;
+        }
+
+      if (column->field == COLUMN_FIELDS)
+        {
+          snprintf (map->error, sizeof (map->error), "column %d: unknown field %.*s", col + 1, (int32_t) name.len,
+                    name.ptr);
+          return (-1);
+        }
+    }
+
+  kind = field_kind[column->field];
+
+
+  /*  Find the unit (or the default).  */
+
+  for (i = 0 ; i < UNITS ; i++)
+    {
+      if (unit_table[i].kind != kind) continue;
+
+      if (!unit.len || (strlen (unit_table[i].name) == unit.len && !memcmp (unit_table[i].name, unit.ptr, unit.len)))
+        {
+          use = &unit_table[i];
+          break;
+        }
+    }
+
+  if (kind == KIND_NONE ? unit.len != 0 : use == NULL)
+    {
+      snprintf (map->error, sizeof (map->error), "column %d: %s doesn't take unit %.*s", col + 1,
+                field_name[column->field], (int32_t) unit.len, unit.ptr);
+      return (-1);
+    }
+
+  if (use != NULL) column->scale = use->scale;
+
+
+  /*  Pick the parser.  */
+
+  switch (column->field)
+    {
+    case COLUMN_LATITUDE:
+    case COLUMN_LONGITUDE:
+      column->offset = offsetof (FEATURE_RECORD, bfd_record) + ((column->field == COLUMN_LATITUDE) ?
+                                                                offsetof (BFDATA_RECORD, latitude) :
+                                                                offsetof (BFDATA_RECORD, longitude));
+
+      if (column->scale == 0.0)
+        {
+          column->parse = (column->field == COLUMN_LATITUDE) ? parse_latitude_dms : parse_longitude_dms;
+        }
+      else
+        {
+          column->parse = (column->scale == 1.0) ? parse_double : parse_double_scaled;
+        }
+
+      if (column->field == COLUMN_LATITUDE) map->header_column = col;
+      break;
+
+    case COLUMN_DEPTH:
+    case COLUMN_HEADING:
+    case COLUMN_LENGTH:
+    case COLUMN_WIDTH:
+    case COLUMN_HEIGHT:
+      column->offset = offsetof (FEATURE_RECORD, bfd_record);
+
+      switch (column->field)
+        {
+        case COLUMN_DEPTH:
+          column->offset += offsetof (BFDATA_RECORD, depth);
+          break;
+
+        case COLUMN_HEADING:
+          column->offset += offsetof (BFDATA_RECORD, heading);
+          break;
+
+        case COLUMN_LENGTH:
+          column->offset += offsetof (BFDATA_RECORD, length);
+          break;
+
+        case COLUMN_WIDTH:
+          column->offset += offsetof (BFDATA_RECORD, width);
+          break;
+
+        default:
+          column->offset += offsetof (BFDATA_RECORD, height);
+          break;
+        }
+
+      column->parse = (column->scale == 1.0) ? parse_float : parse_float_scaled;
+      break;
+
+    case COLUMN_REMARKS:
+      column->parse = parse_remarks;
+      break;
+
+    case COLUMN_IMAGE:
+      column->parse = parse_image;
+      map->has_image = NVTrue;
+      break;
+
+    case COLUMN_DTG:
+      column->parse = parse_dtg;
+      map->has_dtg = map->has_time = NVTrue;
+      break;
+
+    case COLUMN_TIME:
+      column->parse = parse_time;
+      map->has_time = NVTrue;
+      break;
+    }
+
+
+  /*  Add it to the canonical spec.  */
+
+  len = strlen (map->spec);
+
+  snprintf (map->spec + len, sizeof (map->spec) - len, "%s%s%s%s", col ? "," : "", field_name[column->field],
+            use != NULL ? ":" : "", use != NULL ? use->name : "");
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        column_map_compile                                  *
+*                                                                           *
+*   Purpose:            Compiles a column mapping spec into a table of      *
+*                       column parsers.  The spec is a comma (or newline)   *
+*                       separated list with one entry per input column, in  *
+*                       column order.  Each entry is field[:unit] where     *
+*                       field is one of skip, lat, lon, depth, heading,     *
+*                       length, width, height, remarks, image, dtg, or      *
+*                       time.  An empty entry is the same as skip.  The     *
+*                       units (the first is the default) are:               *
+*                                                                           *
+*                           lat, lon            deg, dms, rad               *
+*                           depth, length,      m, ft, fm                   *
+*                           width, height                                   *
+*                           heading             deg, rad                    *
+*                           dtg                 mdy (MM-DD-YYYY HH:MM:SS)   *
+*                                               or ISO 8601 (see dtg.h)     *
+*                           time                s (since 1970, UTC)         *
+*                                                                           *
+*                       dms takes anything a .txt position can be (e.g.     *
+*                       S 28 27 11.52 or -28 27.192).  Columns past the     *
+*                       last entry are ignored.                             *
+*                                                                           *
+*   Inputs:             spec                -   column mapping spec         *
+*                       map                 -   returned mapping            *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 if the spec is     *
+*                                               bad (map->error says why)   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t column_map_compile (const char *spec, COLUMN_MAP *map)
+{
+  STRING_VIEW         rest, entry;
+  const char          *end;
+  int32_t             col, seen[COLUMN_FIELDS];
+
+
+  memset (map, 0, sizeof (COLUMN_MAP));
+  memset (seen, 0, sizeof (seen));
+
+  map->header_column = -1;
+
+  rest = sv_make (spec, strlen (spec));
+
+  for (col = 0 ; rest.len ; col++)
+    {
+      if (col == COLUMN_MAP_MAX)
+        {
+          snprintf (map->error, sizeof (map->error), "more than %d columns", COLUMN_MAP_MAX);
+          return (-1);
+        }
+
+
+      /*  Entries end at a comma or a newline.  Empty entries count (they're skipped columns) so we can't
+          use sv_next_token.  */
+
+      for (end = rest.ptr ; end < rest.ptr + rest.len && *end != ',' && *end != '\n' ; end++);
+
+      entry = sv_make (rest.ptr, end - rest.ptr);
+
+      if (end < rest.ptr + rest.len)
+        {
+          rest = sv_make (end + 1, rest.len - entry.len - 1);
+        }
+      else
+        {
+          rest = sv_make (end, 0);
+        }
+
+      while (entry.len && (entry.ptr[0] == ' ' || entry.ptr[0] == '\t'))
+        {
+          entry.ptr++;
+          entry.len--;
+        }
+
+      while (entry.len && (entry.ptr[entry.len - 1] == ' ' || entry.ptr[entry.len - 1] == '\t' ||
+                           entry.ptr[entry.len - 1] == '\r'))
+        entry.len--;
+
+      if (compile_column (entry, col, map) < 0) return (-1);
+
+      if (map->column[col].field != COLUMN_SKIP)
+        {
+          if (seen[map->column[col].field]++)
+            {
+              snprintf (map->error, sizeof (map->error), "column %d: %s is already mapped", col + 1,
+                        field_name[map->column[col].field]);
+              return (-1);
+            }
+
+          map->columns = col + 1;
+        }
+    }
+
+  if (!seen[COLUMN_LATITUDE] || !seen[COLUMN_LONGITUDE])
+    {
+      snprintf (map->error, sizeof (map->error), "a lat and a lon column are required");
+      return (-1);
+    }
+
+  if (seen[COLUMN_DTG] && seen[COLUMN_TIME])
+    {
+      snprintf (map->error, sizeof (map->error), "use a dtg or a time column, not both");
+      return (-1);
+    }
+
+
+  /*  FNV-1a.  */
+
+  map->key = 2166136261U;
+  for (end = map->spec ; *end ; end++) map->key = (map->key ^ (uint8_t) *end) * 16777619U;
+
+  return (0);
+}
+
+
+
+/*  Reads a column mapping spec from a file and compiles it.  The file has one or more entries per line
+    (see column_map_compile).  Blank lines and anything after a # are ignored.  Returns -1 with errno set
+    and map->error empty if the file can't be read.  */
+
+int32_t column_map_read (const char *path, COLUMN_MAP *map)
+{
+  FILE                *fp;
+  char                string[1024], spec[COLUMN_MAP_SPEC_MAX * 2] = "", *start, *end;
+  size_t              len = 0;
+
+
+  map->error[0] = 0;
+
+  if ((fp = fopen (path, "r")) == NULL) return (-1);
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      if ((end = strchr (string, '#')) != NULL) *end = 0;
+
+      for (start = string ; *start == ' ' || *start == '\t' ; start++);
+
+      end = start + strlen (start);
+      while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+      *end = 0;
+
+      if (!*start) continue;
+
+      if (len + strlen (start) + 2 > sizeof (spec))
+        {
+          fclose (fp);
+          snprintf (map->error, sizeof (map->error), "%s is too long", path);
+          return (-1);
+        }
+
+      len += sprintf (spec + len, "%s%s", len ? "," : "", start);
+    }
+
+  fclose (fp);
+
+  return (column_map_compile (spec, map));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        column_map_parse                                    *
+*                                                                           *
+*   Purpose:            Parses the columns of one line with a compiled      *
+*                       mapping.  Unlike the fixed formats, empty columns   *
+*                       count (a,,b is three columns).  Missing columns at  *
+*                       the end of the line are left empty.                 *
+*                                                                           *
+*   Inputs:             map                 -   compiled column mapping     *
+*                       fields              -   cursor at the start of the  *
+*                                               line                        *
+*                       feature             -   returned record (already    *
+*                                               cleared)                    *
+*                       convert             -   where to stage a DTG for    *
+*                                               batch conversion, or NULL   *
+*                                                                           *
+*   Outputs:            int32_t             -   number of columns found (up *
+*                                               to map->columns), or 0 if   *
+*                                               the line is a header (no    *
+*                                               digits in the latitude      *
+*                                               column).  Lines that don't  *
+*                                               get as far as the latitude  *
+*                                               column are skipped as well. *
+*                                                                           *
+\***************************************************************************/
+
+int32_t column_map_parse (const COLUMN_MAP *map, FIELD_CURSOR *fields, FEATURE_RECORD *feature, CONVERT_BATCH *convert)
+{
+  COLUMN_VALUE        value;
+  const char          *ptr = fields->ptr, *next;
+  STRING_VIEW         field;
+  int32_t             col;
+  size_t              i;
+
+
+  value.feature = feature;
+  value.convert = convert;
+
+
+  for (col = 0 ; col < map->columns ; col++)
+    {
+      if (fields->comma != NULL)
+        {
+          next = (fields->comma < fields->comma_end) ? fields->base + *fields->comma++ : fields->end;
+        }
+      else if ((next = (const char *) memchr (ptr, ',', fields->end - ptr)) == NULL)
+        {
+          next = fields->end;
+        }
+
+      field = sv_make (ptr, next - ptr);
+      if (next == fields->end && field.len && field.ptr[field.len - 1] == '\r') field.len--;
+
+      if (col == map->header_column)
+        {
+          for (i = 0 ; i < field.len ; i++) if (field.ptr[i] >= '0' && field.ptr[i] <= '9') break;
+
+          if (i == field.len) return (0);
+        }
+
+      value.column = &map->column[col];
+
+      if (value.column->parse != NULL)
+        {
+          value.field = field;
+          (*value.column->parse) (&value);
+        }
+
+      if (next == fields->end) break;
+
+      ptr = next + 1;
+    }
+
+  return ((col < map->columns) ? col + 1 : map->columns);
+}
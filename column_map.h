@@ -0,0 +1,106 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __COLUMN_MAP_H__
+#define __COLUMN_MAP_H__
+
+#include "nvutility.h"
+
+#include "convert.h"
+#include "delim_index.h"
+#include "parse_record.h"
+#include "string_view.h"
+
+
+/*  Most columns a spec can describe and the longest (canonical) spec.  */
+
+#define COLUMN_MAP_MAX          64
+#define COLUMN_MAP_SPEC_MAX     1024
+
+
+/*  What a column holds.  */
+
+#define COLUMN_SKIP             0       /*  Ignored  */
+#define COLUMN_LATITUDE         1
+#define COLUMN_LONGITUDE        2
+#define COLUMN_DEPTH            3
+#define COLUMN_HEADING          4
+#define COLUMN_LENGTH           5
+#define COLUMN_WIDTH            6
+#define COLUMN_HEIGHT           7
+#define COLUMN_REMARKS          8
+#define COLUMN_IMAGE            9       /*  Snippet image file name  */
+#define COLUMN_DTG              10      /*  MM-DD-YYYY HH:MM:SS.SS (the .uni layout) or ISO 8601  */
+#define COLUMN_TIME             11      /*  Seconds since 1970 (UTC)  */
+#define COLUMN_FIELDS           12
+
+
+struct COLUMN_S;
+
+
+/*  What a column parser is handed.  Each parser only looks at the parts it needs.  */
+
+typedef struct
+{
+  STRING_VIEW         field;              /*  The column's text  */
+  const struct COLUMN_S *column;
+  FEATURE_RECORD      *feature;           /*  Record being parsed  */
+  CONVERT_BATCH       *convert;           /*  Where to stage a DTG for batch conversion, or NULL  */
+} COLUMN_VALUE;
+
+typedef void (*COLUMN_PARSER) (const COLUMN_VALUE *value);
+
+
+/*  One input column compiled down to the function that parses it, where in the FEATURE_RECORD it goes,
+    and the scale that converts it to the BFD units (degrees and meters).  */
+
+typedef struct COLUMN_S
+{
+  COLUMN_PARSER       parse;              /*  NULL for skipped columns  */
+  size_t              offset;             /*  Offset of the value in the FEATURE_RECORD  */
+  double              scale;
+  int32_t             field;              /*  COLUMN_SKIP, _LATITUDE, ...  */
+} COLUMN;
+
+
+/*  A compiled column mapping (see column_map_compile).  */
+
+typedef struct COLUMN_MAP_S
+{
+  COLUMN              column[COLUMN_MAP_MAX];
+  int32_t             columns;            /*  Up to and including the last column that isn't skipped  */
+  int32_t             header_column;      /*  Latitude column, a line with no digits there is a header  */
+  uint8_t             has_dtg;            /*  Event times come from a DTG column  */
+  uint8_t             has_time;           /*  Event times come from a DTG or time column  */
+  uint8_t             has_image;
+  uint32_t            key;                /*  Hash of spec (e.g. to tell parse caches apart)  */
+  char                spec[COLUMN_MAP_SPEC_MAX];  /*  Canonical spec (every unit spelled out)  */
+  char                error[256];         /*  Why the spec wouldn't compile  */
+} COLUMN_MAP;
+
+
+int32_t column_map_compile (const char *spec, COLUMN_MAP *map);
+int32_t column_map_read (const char *path, COLUMN_MAP *map);
+int32_t column_map_parse (const COLUMN_MAP *map, FIELD_CURSOR *fields, FEATURE_RECORD *feature, CONVERT_BATCH *convert);
+
+
+#endif
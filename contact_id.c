@@ -0,0 +1,155 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+    #include <windows.h>
+#endif
+
+#include "contact_id.h"
+
+
+/*  Breaks a time down for the contact ID and BFD record.  */
+
+void contact_time_set (CONTACT_TIME *contact_time, time_t now)
+{
+  cvtime (now, 0, &contact_time->year, &contact_time->day, &contact_time->hour, &contact_time->minute,
+          &contact_time->second);
+
+  inv_cvtime (contact_time->year, contact_time->day, contact_time->hour, contact_time->minute, contact_time->second,
+              &contact_time->tv_sec, &contact_time->tv_nsec);
+
+  contact_time->year += 1900;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        contact_id_init                                     *
+*                                                                           *
+*   Purpose:            Sets up the contact ID allocator for a run.         *
+*                                                                           *
+*   Inputs:             ids                 -   allocator to initialize     *
+*                       now                 -   time of this run            *
+*                       first               -   first sequence number (the  *
+*                                               number of records already   *
+*                                               in the BFD file)            *
+*                                                                           *
+*   Outputs:            none                                                *
+*                                                                           *
+\***************************************************************************/
+
+void contact_id_init (CONTACT_ID_ALLOCATOR *ids, time_t now, uint32_t first)
+{
+  memset (ids, 0, sizeof (CONTACT_ID_ALLOCATOR));
+
+  contact_time_set (&ids->run_time, now);
+  ids->next = first;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        contact_id_reserve                                  *
+*                                                                           *
+*   Purpose:            Reserves a block of count consecutive sequence      *
+*                       numbers.  This is a single atomic add so it can be  *
+*                       called from any thread without a lock.  Reserve a   *
+*                       whole batch at a time, not a record at a time.      *
+*                                                                           *
+*   Inputs:             ids                 -   allocator                   *
+*                       count               -   number of IDs needed        *
+*                                                                           *
+*   Outputs:            uint32_t            -   first reserved number       *
+*                                                                           *
+\***************************************************************************/
+
+uint32_t contact_id_reserve (CONTACT_ID_ALLOCATOR *ids, uint32_t count)
+{
+#ifdef _MSC_VER
+  return ((uint32_t) InterlockedExchangeAdd ((volatile LONG *) &ids->next, (LONG) count));
+#else
+  return (__sync_fetch_and_add (&ids->next, count));
+#endif
+}
+
+
+
+/*  Writes a zero padded decimal number, most significant digit first.  Negative numbers (from a garbled
+    DTG) come out the same way printf would write them.  */
+
+static char *put_digits (char *ptr, int64_t value, int32_t width)
+{
+  char                digits[24];
+  int32_t             i = 0;
+  uint64_t            uvalue;
+
+
+  if (value < 0)
+    {
+      *ptr++ = '-';
+      width--;
+      uvalue = (uint64_t) -value;
+    }
+  else
+    {
+      uvalue = (uint64_t) value;
+    }
+
+  do
+    {
+      digits[i++] = '0' + (char) (uvalue % 10);
+      uvalue /= 10;
+    } while (uvalue);
+
+  while (i < width) digits[i++] = '0';
+
+  while (i) *ptr++ = digits[--i];
+
+  return (ptr);
+}
+
+
+
+/*  Builds the contact ID (YYDDDHHMMSS followed by the sequence number, at least three digits).  This is
+    the same text that "%02d%03d%02d%02d%02d%03d" gives without the trip through sprintf.  */
+
+void contact_id_format (char *contact_id, int32_t year, int32_t day, int32_t hour, int32_t minute, float second,
+                        uint32_t sequence)
+{
+  char                *ptr = contact_id;
+
+
+  ptr = put_digits (ptr, year % 100, 2);
+  ptr = put_digits (ptr, day, 3);
+  ptr = put_digits (ptr, hour, 2);
+  ptr = put_digits (ptr, minute, 2);
+  ptr = put_digits (ptr, (int32_t) second, 2);
+  ptr = put_digits (ptr, sequence, 3);
+
+  *ptr = 0;
+}
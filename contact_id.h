@@ -0,0 +1,70 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __CONTACT_ID_H__
+#define __CONTACT_ID_H__
+
+#include <time.h>
+
+#include "nvutility.h"
+
+
+/*  A point in time broken down the way the contact IDs and the BFD event times want it.  This is filled in
+    once per run so the parsers never have to call time, cvtime, or inv_cvtime for .txt and .csv records.  */
+
+typedef struct
+{
+  time_t              tv_sec;             /*  Event time as stored in the BFD record  */
+  long                tv_nsec;
+  int32_t             year;               /*  Full year (e.g. 2005)  */
+  int32_t             day;                /*  Day of year  */
+  int32_t             hour;
+  int32_t             minute;
+  float               second;
+} CONTACT_TIME;
+
+
+/*  Hands out contact ID sequence numbers.  Any number of threads can reserve numbers at the same time.
+    The sequence starts at the number of records already in the BFD file.  Every record this program has
+    written to that file got a smaller sequence number than that so new IDs can't collide with old ones,
+    even if the time prefix is the same (two runs in the same second, or .uni DTGs that repeat).
+
+    IDs are only unique within one BFD file (and its --also outputs).  Two runs that start in the same
+    second into different files, or into files with the same record count, hand out the same IDs.  The ID
+    is YYDDDHHMMSS plus the sequence with no spare digits, so there's nowhere to put a per run
+    discriminator (a pid or a random salt) without making the IDs longer.  */
+
+typedef struct
+{
+  CONTACT_TIME        run_time;           /*  Time of this run (the event time for .txt and .csv)  */
+  volatile uint32_t   next;               /*  Next unreserved sequence number  */
+} CONTACT_ID_ALLOCATOR;
+
+
+void contact_time_set (CONTACT_TIME *contact_time, time_t now);
+void contact_id_init (CONTACT_ID_ALLOCATOR *ids, time_t now, uint32_t first);
+uint32_t contact_id_reserve (CONTACT_ID_ALLOCATOR *ids, uint32_t count);
+void contact_id_format (char *contact_id, int32_t year, int32_t day, int32_t hour, int32_t minute, float second,
+                        uint32_t sequence);
+
+
+#endif
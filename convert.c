@@ -0,0 +1,278 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#include "convert.h"
+
+
+/*  The loops in here are written to be vectorized but -O2 (what qmake gives us) only vectorizes the very
+    simplest loops, if any.  */
+
+#if defined (__GNUC__) && !defined (__clang__)
+#pragma GCC optimize ("tree-vectorize")
+#endif
+
+
+/*  Splits .txt total degrees into degrees, minutes, and seconds exactly the way sget_coord does.  The
+    results are whole numbers (and float seconds) stored as doubles for convert_degrees.  */
+
+void convert_split_degrees (int32_t count, const double *total, double *deg, double *min, double *sec)
+{
+  int32_t             i, d, m;
+  float               s;
+
+
+  for (i = 0 ; i < count ; i++)
+    {
+      convert_split_dms (total[i], &d, &m, &s);
+
+      deg[i] = (double) d;
+      min[i] = (double) m;
+      sec[i] = (double) s;
+    }
+}
+
+
+
+/*  Degrees, minutes, and seconds to signed decimal degrees for count rows.  */
+
+void convert_degrees (int32_t count, const double *deg, const double *min, const double *sec, const uint8_t *negative,
+                      double *degrees)
+{
+  int32_t             i;
+
+
+  for (i = 0 ; i < count ; i++) degrees[i] = convert_dms_degrees (deg[i], min[i], sec[i], negative[i]);
+}
+
+
+
+/*  Rows with an hour, minute, or second outside the normal range (or a NaN second) are converted the old
+    way.  Everything else is added on to midnight.  */
+
+static inline uint8_t normal_time (int32_t hour, int32_t minute, float second)
+{
+  return (hour >= 0 && hour < 24 && minute >= 0 && minute < 60 && second >= 0.0f && second < 61.0f);
+}
+
+
+
+/*  The event time of a record given the event time of midnight on its day.  With the time zone set to
+    GMT (which inv_cvtime does) mktime is linear in the time of day.  The nanoseconds fit in 32 bits
+    (which is what lets the compiler vectorize this without AVX-512).  */
+
+static inline time_t time_of_day (time_t midnight, int32_t hour, int32_t minute, float second)
+{
+  return (midnight + (time_t) (hour * 3600 + minute * 60 + (int32_t) second));
+}
+
+
+static inline long nanoseconds (float second)
+{
+  return ((long) (int32_t) (((double) second - (double) ((int32_t) second)) * 1000000000.0));
+}
+
+
+
+/*  Finds (or adds) the remembered day for row i.  The first CONVERT_DAY_CHECKS new days are checked by
+    converting row i the old way and comparing it to what we'd get from the remembered midnight.  After
+    that a new day is just the table lookups in dtg_jday and dtg_midnight.  */
+
+static CONVERT_DAY *find_day (CONVERT_BATCH *convert, int32_t i)
+{
+  CONVERT_DAY         *entry;
+  time_t              tv_sec;
+  long                tv_nsec, midnight_nsec;
+  int32_t             j;
+
+
+  for (j = 0 ; j < convert->day_count ; j++)
+    {
+      entry = &convert->days[j];
+
+      if (entry->mday == convert->mday[i] && entry->month == convert->month[i] && entry->year == convert->year[i])
+        return (entry);
+    }
+
+  entry = &convert->days[convert->next_day];
+
+  convert->next_day = (convert->next_day + 1) % CONVERT_DAY_CACHE;
+  if (convert->day_count < CONVERT_DAY_CACHE) convert->day_count++;
+
+  entry->year = convert->year[i];
+  entry->month = convert->month[i];
+  entry->mday = convert->mday[i];
+
+  dtg_jday (entry->year, entry->month, entry->mday, &entry->day);
+
+  if (!dtg_midnight (entry->year, entry->day, &entry->midnight))
+    {
+      inv_cvtime (entry->year - 1900, entry->day, 0, 0, 0.0, &entry->midnight, &midnight_nsec);
+
+      if (midnight_nsec) convert->check.nonlinear = NVTrue;
+    }
+
+  if (convert->check.checks >= CONVERT_DAY_CHECKS ||
+      !normal_time (convert->hour[i], convert->minute[i], convert->second[i]))
+    return (entry);
+
+  convert->check.checks++;
+
+  inv_cvtime (entry->year - 1900, entry->day, convert->hour[i], convert->minute[i], convert->second[i], &tv_sec,
+              &tv_nsec);
+
+  if (tv_sec != time_of_day (entry->midnight, convert->hour[i], convert->minute[i], convert->second[i]) ||
+      tv_nsec != nanoseconds (convert->second[i]))
+    convert->check.nonlinear = NVTrue;
+
+  return (entry);
+}
+
+
+
+/*  The old way, one record at a time.  */
+
+static void convert_row (CONVERT_BATCH *convert, int32_t i, time_t *tv_sec, long *tv_nsec)
+{
+  mday2jday (convert->year[i], convert->month[i], convert->mday[i], &convert->day[i]);
+  inv_cvtime (convert->year[i] - 1900, convert->day[i], convert->hour[i], convert->minute[i], convert->second[i], tv_sec,
+              tv_nsec);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        convert_event_times                                 *
+*                                                                           *
+*   Purpose:            Converts the staged .uni DTGs to day of year and    *
+*                       BFD event times.  Each day's day of year and        *
+*                       midnight are worked out once (from day counts, not  *
+*                       mktime) and the time of day is added on in a loop   *
+*                       over the rows.  If that ever disagrees with         *
+*                       inv_cvtime the rows are converted one at a time     *
+*                       like they used to be.                               *
+*                                                                           *
+*   Inputs:             convert             -   staged rows                 *
+*                                                                           *
+*   Outputs:            none (day, tv_sec, and tv_nsec are set, and the     *
+*                       time of day of odd rows is zeroed)                  *
+*                                                                           *
+\***************************************************************************/
+
+void convert_event_times (CONVERT_BATCH *convert)
+{
+  CONVERT_DAY         *entry = NULL;
+  int32_t             i, j, odd = 0;
+
+
+  /*  Look up each row's day (almost every record is on the same day as the one before it).  Odd rows are
+      converted here and their time of day is zeroed so the loop below is harmless for them.  */
+
+  for (i = 0 ; i < convert->count && !convert->check.nonlinear ; i++)
+    {
+      if (!normal_time (convert->hour[i], convert->minute[i], convert->second[i]))
+        {
+          convert_row (convert, i, &convert->odd_sec[odd], &convert->odd_nsec[odd]);
+          convert->odd[odd++] = i;
+
+          convert->midnight[i] = 0;
+          convert->hour[i] = convert->minute[i] = 0;
+          convert->second[i] = 0.0f;
+          continue;
+        }
+
+      if (entry == NULL || entry->mday != convert->mday[i] || entry->month != convert->month[i] ||
+          entry->year != convert->year[i])
+        entry = find_day (convert, i);
+
+      convert->day[i] = entry->day;
+      convert->midnight[i] = entry->midnight;
+    }
+
+
+  /*  A check failed (in this batch or an earlier one).  The odd rows we've already done are kept.  */
+
+  if (convert->check.nonlinear)
+    {
+      for (i = 0, j = 0 ; i < convert->count ; i++)
+        {
+          if (j < odd && convert->odd[j] == i)
+            {
+              convert->tv_sec[i] = convert->odd_sec[j];
+              convert->tv_nsec[i] = convert->odd_nsec[j];
+              j++;
+            }
+          else
+            {
+              convert_row (convert, i, &convert->tv_sec[i], &convert->tv_nsec[i]);
+            }
+        }
+
+      return;
+    }
+
+  for (i = 0 ; i < convert->count ; i++)
+    {
+      convert->tv_sec[i] = time_of_day (convert->midnight[i], convert->hour[i], convert->minute[i], convert->second[i]);
+      convert->tv_nsec[i] = nanoseconds (convert->second[i]);
+    }
+
+  for (i = 0 ; i < odd ; i++)
+    {
+      convert->tv_sec[convert->odd[i]] = convert->odd_sec[i];
+      convert->tv_nsec[convert->odd[i]] = convert->odd_nsec[i];
+    }
+}
+
+
+
+/*  Converts one record's DTG (already turned into a day of year) to the BFD event time.  This is what
+    parse_line uses.  It's the same sum convert_event_times does, without the day cache since working out
+    midnight is only a couple of table lookups.  The first CONVERT_DAY_CHECKS calls with the same check are
+    checked against inv_cvtime.  */
+
+void convert_event_time (CONVERT_CHECK *check, int32_t year, int32_t day, int32_t hour, int32_t minute, float second,
+                         time_t *tv_sec, long *tv_nsec)
+{
+  time_t              midnight;
+
+
+  if (check->nonlinear || !normal_time (hour, minute, second) || !dtg_midnight (year, day, &midnight))
+    {
+      inv_cvtime (year - 1900, day, hour, minute, second, tv_sec, tv_nsec);
+      return;
+    }
+
+  if (check->checks < CONVERT_DAY_CHECKS)
+    {
+      check->checks++;
+
+      inv_cvtime (year - 1900, day, hour, minute, second, tv_sec, tv_nsec);
+
+      if (*tv_sec != time_of_day (midnight, hour, minute, second) || *tv_nsec != nanoseconds (second))
+        check->nonlinear = NVTrue;
+
+      return;
+    }
+
+  *tv_sec = time_of_day (midnight, hour, minute, second);
+  *tv_nsec = nanoseconds (second);
+}
@@ -0,0 +1,144 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#ifndef __CONVERT_H__
+#define __CONVERT_H__
+
+#include <time.h>
+
+#include "nvutility.h"
+
+#include "dtg.h"
+
+
+/*  Number of records staged before the conversions are run.  */
+
+#define CONVERT_BATCH_SIZE      4096
+
+
+/*  Number of days whose Julian day and midnight event time are remembered, and the number of new days
+    (or single records) that get checked against a full inv_cvtime (see convert_event_times).  */
+
+#define CONVERT_DAY_CACHE       16
+#define CONVERT_DAY_CHECKS      64
+
+
+/*  How far the day table event times have been checked against a full inv_cvtime.  Each parsing thread
+    has its own (zeroed before its first record).  */
+
+typedef struct
+{
+  int32_t             checks;             /*  New days (or single records) checked so far  */
+  uint8_t             nonlinear;          /*  A check disagreed, everything is converted the old way  */
+} CONVERT_CHECK;
+
+
+/*  A remembered day (a DTG year, month, and day of the month).  */
+
+typedef struct
+{
+  int32_t             year;
+  int32_t             month;
+  int32_t             mday;
+  int32_t             day;                /*  Day of year from dtg_jday  */
+  time_t              midnight;           /*  Event time of 00:00:00 on that day (see dtg_midnight)  */
+} CONVERT_DAY;
+
+
+/*  Parsed values waiting to be converted, staged as one array per value (row i is record first + i of
+    the batch being parsed) so each conversion is a simple loop over the rows that the compiler can
+    vectorize.  .txt positions come in as total degrees (which are split into degrees, minutes, and
+    seconds the way sget_coord does it), .csv positions as degrees, minutes, and seconds, and .uni DTGs
+    as the year, month, day, and time of day.  */
+
+typedef struct
+{
+  int32_t             count;
+  int32_t             first;
+  double              lat_total[CONVERT_BATCH_SIZE];
+  double              lat_deg[CONVERT_BATCH_SIZE];
+  double              lat_min[CONVERT_BATCH_SIZE];
+  double              lat_sec[CONVERT_BATCH_SIZE];
+  uint8_t             lat_negative[CONVERT_BATCH_SIZE];
+  double              lon_total[CONVERT_BATCH_SIZE];
+  double              lon_deg[CONVERT_BATCH_SIZE];
+  double              lon_min[CONVERT_BATCH_SIZE];
+  double              lon_sec[CONVERT_BATCH_SIZE];
+  uint8_t             lon_negative[CONVERT_BATCH_SIZE];
+  double              latitude[CONVERT_BATCH_SIZE];
+  double              longitude[CONVERT_BATCH_SIZE];
+  int32_t             year[CONVERT_BATCH_SIZE];
+  int32_t             month[CONVERT_BATCH_SIZE];
+  int32_t             mday[CONVERT_BATCH_SIZE];
+  int32_t             hour[CONVERT_BATCH_SIZE];
+  int32_t             minute[CONVERT_BATCH_SIZE];
+  float               second[CONVERT_BATCH_SIZE];
+  int32_t             day[CONVERT_BATCH_SIZE];
+  time_t              midnight[CONVERT_BATCH_SIZE];
+  time_t              tv_sec[CONVERT_BATCH_SIZE];
+  long                tv_nsec[CONVERT_BATCH_SIZE];
+  int32_t             odd[CONVERT_BATCH_SIZE];        /*  Rows converted one at a time  */
+  time_t              odd_sec[CONVERT_BATCH_SIZE];
+  long                odd_nsec[CONVERT_BATCH_SIZE];
+  CONVERT_DAY         days[CONVERT_DAY_CACHE];
+  int32_t             day_count;
+  int32_t             next_day;           /*  Cache slot to replace next  */
+  CONVERT_CHECK       check;
+} CONVERT_BATCH;
+
+
+/*  Splits total degrees into whole degrees, whole minutes, and seconds.  The 0.00001's keep minutes and
+    seconds that are a hair under a whole number (e.g. 26.999999) from being truncated down.  */
+
+static inline void convert_split_dms (double degrees, int32_t *deg, int32_t *min, float *sec)
+{
+  double              fmin;
+
+
+  *deg = (int32_t) degrees;
+  fmin = (degrees - *deg) * 60.0;
+  *min = (int32_t) (fmin + 0.00001);
+  *sec = (fmin - *min) * 60.0 + 0.00001;
+}
+
+
+/*  Degrees, minutes, and seconds to signed decimal degrees.  */
+
+static inline double convert_dms_degrees (double deg, double min, double sec, uint8_t negative)
+{
+  double              degrees;
+
+
+  degrees = deg + min / 60.0 + sec / 3600.0;
+
+  return (negative ? -degrees : degrees);
+}
+
+
+void convert_split_degrees (int32_t count, const double *total, double *deg, double *min, double *sec);
+void convert_degrees (int32_t count, const double *deg, const double *min, const double *sec, const uint8_t *negative,
+                      double *degrees);
+void convert_event_times (CONVERT_BATCH *convert);
+void convert_event_time (CONVERT_CHECK *check, int32_t year, int32_t day, int32_t hour, int32_t minute, float second,
+                         time_t *tv_sec, long *tv_nsec);
+
+
+#endif
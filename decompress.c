@@ -0,0 +1,457 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include "decompress.h"
+#include "stats.h"
+
+
+/*  Picks the compression from the file name (targets.uni.zst is a zstd compressed .uni file).  */
+
+int32_t decompress_type (const char *path)
+{
+  size_t              len = strlen (path);
+
+
+  if (len > 3 && !strcmp (path + len - 3, ".gz")) return (DECOMPRESS_GZIP);
+  if (len > 4 && !strcmp (path + len - 4, ".zst")) return (DECOMPRESS_ZSTD);
+
+  return (DECOMPRESS_NONE);
+}
+
+
+
+/*  Waits for room in the ring and points out at it.  Returns the amount of contiguous room (it may wrap
+    around the end of the ring) or 0 if the reader has closed us down.  */
+
+static size_t ring_room (DECOMPRESS *dec, char **out)
+{
+  size_t              pos, room = 0;
+
+
+  pthread_mutex_lock (&dec->mutex);
+
+  while (dec->head - dec->tail == dec->size && !dec->stop) pthread_cond_wait (&dec->room_cond, &dec->mutex);
+
+  if (!dec->stop)
+    {
+      pos = (size_t) (dec->head % dec->size);
+      room = dec->size - (size_t) (dec->head - dec->tail);
+      if (room > dec->size - pos) room = dec->size - pos;
+
+      *out = dec->ring + pos;
+    }
+
+  pthread_mutex_unlock (&dec->mutex);
+
+  return (room);
+}
+
+
+
+/*  Hands len bytes that were decompressed into the ring to the reader.  */
+
+static void ring_add (DECOMPRESS *dec, size_t len)
+{
+  if (!len) return;
+
+  pthread_mutex_lock (&dec->mutex);
+  dec->head += len;
+  pthread_cond_signal (&dec->data_cond);
+  pthread_mutex_unlock (&dec->mutex);
+}
+
+
+
+/*  Reads the next block of compressed input.  Returns the number of bytes, 0 at end of file, or -1 on
+    error (dec->error is set).  */
+
+static int32_t read_input (DECOMPRESS *dec, uint8_t *in)
+{
+  int32_t             n;
+  uint64_t            start;
+
+
+  start = stats_clock_ns ();
+
+  while ((n = (int32_t) read (dec->fd, in, DECOMPRESS_READ_SIZE)) < 0 && errno == EINTR);
+
+  dec->ns += stats_clock_ns () - start;
+
+  if (n < 0)
+    {
+      dec->error = errno;
+      return (-1);
+    }
+
+  dec->compressed_bytes += n;
+
+  return (n);
+}
+
+
+
+/*  Inflates a gzip (or zlib) file.  Concatenated gzip members (pigz, cat a.gz b.gz) are handled by starting
+    over after each one.  */
+
+static void gzip_run (DECOMPRESS *dec, uint8_t *in)
+{
+  z_stream            strm;
+  char                *out;
+  size_t              room;
+  int32_t             n, status;
+  uint8_t             full = NVFalse;
+  uint64_t            start;
+
+
+  memset (&strm, 0, sizeof (z_stream));
+
+
+  /*  15 + 32 is the biggest window with automatic gzip/zlib header detection.  */
+
+  if (inflateInit2 (&strm, 15 + 32) != Z_OK)
+    {
+      dec->error = ENOMEM;
+      return;
+    }
+
+  while (1)
+    {
+      /*  If the last inflate filled the ring there may be more output waiting without any more input.  */
+
+      if (!strm.avail_in && !full)
+        {
+          if ((n = read_input (dec, in)) < 0) break;
+
+
+          /*  Ending part way through a member (total_in is reset for each one) means the file was
+              truncated.  */
+
+          if (!n)
+            {
+              if (strm.total_in) dec->error = EIO;
+              break;
+            }
+
+          strm.next_in = in;
+          strm.avail_in = n;
+        }
+
+      if (!(room = ring_room (dec, &out))) break;
+
+      strm.next_out = (Bytef *) out;
+      strm.avail_out = (uInt) room;
+
+      start = stats_clock_ns ();
+      status = inflate (&strm, Z_NO_FLUSH);
+      dec->ns += stats_clock_ns () - start;
+
+      full = !strm.avail_out;
+
+      ring_add (dec, room - strm.avail_out);
+
+      if (status == Z_STREAM_END)
+        {
+          inflateReset (&strm);
+        }
+      else if (status != Z_OK && status != Z_BUF_ERROR)
+        {
+          dec->error = (status == Z_MEM_ERROR) ? ENOMEM : EIO;
+          break;
+        }
+    }
+
+  inflateEnd (&strm);
+}
+
+
+
+/*  Decompresses a zstd file (any number of frames).  */
+
+static void zstd_run (DECOMPRESS *dec, uint8_t *in)
+{
+  ZSTD_DStream        *stream;
+  ZSTD_inBuffer       input;
+  ZSTD_outBuffer      output;
+  char                *out;
+  size_t              room, status = 0;
+  int32_t             n;
+  uint8_t             full = NVFalse;
+  uint64_t            start;
+
+
+  if ((stream = ZSTD_createDStream ()) == NULL)
+    {
+      dec->error = ENOMEM;
+      return;
+    }
+
+  ZSTD_initDStream (stream);
+
+  input.src = in;
+  input.size = input.pos = 0;
+
+  while (1)
+    {
+      if (input.pos == input.size && !full)
+        {
+          if ((n = read_input (dec, in)) < 0) break;
+
+
+          /*  A non-zero status from the last call means the frame isn't finished, i.e. it's truncated.  */
+
+          if (!n)
+            {
+              if (status) dec->error = EIO;
+              break;
+            }
+
+          input.size = n;
+          input.pos = 0;
+        }
+
+      if (!(room = ring_room (dec, &out))) break;
+
+      output.dst = out;
+      output.size = room;
+      output.pos = 0;
+
+      start = stats_clock_ns ();
+      status = ZSTD_decompressStream (stream, &output, &input);
+      dec->ns += stats_clock_ns () - start;
+
+      if (ZSTD_isError (status))
+        {
+          dec->error = EIO;
+          break;
+        }
+
+      full = (output.pos == output.size);
+
+      ring_add (dec, output.pos);
+    }
+
+  ZSTD_freeDStream (stream);
+}
+
+
+
+/*  The decompression thread.  Runs until the whole file is in the ring, there's an error, or the reader
+    closes us down.  */
+
+static void *decompress_thread (void *data)
+{
+  DECOMPRESS          *dec = (DECOMPRESS *) data;
+  uint8_t             *in;
+
+
+  if ((in = (uint8_t *) malloc (DECOMPRESS_READ_SIZE)) == NULL)
+    {
+      dec->error = ENOMEM;
+    }
+  else
+    {
+      if (dec->type == DECOMPRESS_GZIP)
+        {
+          gzip_run (dec, in);
+        }
+      else
+        {
+          zstd_run (dec, in);
+        }
+
+      free (in);
+    }
+
+  pthread_mutex_lock (&dec->mutex);
+  dec->eof = NVTrue;
+  pthread_cond_broadcast (&dec->data_cond);
+  pthread_mutex_unlock (&dec->mutex);
+
+  return (NULL);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        decompress_open                                     *
+*                                                                           *
+*   Purpose:            Sets up decompressing an open file on its own       *
+*                       thread so that decompression overlaps with parsing  *
+*                       and writing.  The thread is started by the first    *
+*                       decompress_read (so a file that's never read, e.g.  *
+*                       loaded from a parse cache, isn't decompressed).     *
+*                                                                           *
+*   Inputs:             fd                  -   compressed file descriptor  *
+*                                               (closed by decompress_close)*
+*                       type                -   DECOMPRESS_GZIP or          *
+*                                               DECOMPRESS_ZSTD             *
+*                                                                           *
+*   Outputs:            DECOMPRESS *        -   decompressor or NULL on     *
+*                                               error (errno is set)        *
+*                                                                           *
+\***************************************************************************/
+
+DECOMPRESS *decompress_open (int32_t fd, int32_t type)
+{
+  DECOMPRESS          *dec;
+
+
+  if ((dec = (DECOMPRESS *) calloc (1, sizeof (DECOMPRESS))) == NULL) return (NULL);
+
+  dec->type = type;
+  dec->fd = fd;
+  dec->size = DECOMPRESS_RING_SIZE;
+
+  if ((dec->ring = (char *) malloc (dec->size)) == NULL)
+    {
+      free (dec);
+      errno = ENOMEM;
+      return (NULL);
+    }
+
+  pthread_mutex_init (&dec->mutex, NULL);
+  pthread_cond_init (&dec->data_cond, NULL);
+  pthread_cond_init (&dec->room_cond, NULL);
+
+  return (dec);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        decompress_read                                     *
+*                                                                           *
+*   Purpose:            Takes up to size bytes of decompressed text out of  *
+*                       the ring, waiting for the decompression thread if   *
+*                       the ring is empty.  Works like read (2).            *
+*                                                                           *
+*   Inputs:             dec                 -   decompressor                *
+*                       buf                 -   where to put the text       *
+*                       size                -   most bytes to return        *
+*                                                                           *
+*   Outputs:            int64_t             -   bytes returned, 0 at end of *
+*                                               file, -1 on error (errno is *
+*                                               set, EIO for a corrupt or   *
+*                                               truncated file)             *
+*                                                                           *
+\***************************************************************************/
+
+int64_t decompress_read (DECOMPRESS *dec, char *buf, size_t size)
+{
+  size_t              avail, pos, first;
+  int32_t             err;
+
+
+  if (!dec->started)
+    {
+      if ((err = pthread_create (&dec->thread, NULL, decompress_thread, dec)))
+        {
+          errno = err;
+          return (-1);
+        }
+
+      dec->started = NVTrue;
+    }
+
+  pthread_mutex_lock (&dec->mutex);
+
+  while (dec->head == dec->tail && !dec->eof) pthread_cond_wait (&dec->data_cond, &dec->mutex);
+
+  avail = (size_t) (dec->head - dec->tail);
+
+
+  /*  An error is only reported once everything that was decompressed before it has been read.  */
+
+  if (!avail)
+    {
+      err = dec->error;
+      pthread_mutex_unlock (&dec->mutex);
+
+      if (!err) return (0);
+
+      errno = err;
+      return (-1);
+    }
+
+  pthread_mutex_unlock (&dec->mutex);
+
+
+  /*  The thread never writes over text that hasn't been taken out so we can copy without the lock.  */
+
+  if (size > avail) size = avail;
+
+  pos = (size_t) (dec->tail % dec->size);
+  first = dec->size - pos;
+  if (first > size) first = size;
+
+  memcpy (buf, dec->ring + pos, first);
+  if (first < size) memcpy (buf + first, dec->ring, size - first);
+
+  pthread_mutex_lock (&dec->mutex);
+  dec->tail += size;
+  pthread_cond_signal (&dec->room_cond);
+  pthread_mutex_unlock (&dec->mutex);
+
+  return ((int64_t) size);
+}
+
+
+
+/*  Stops the decompression thread (if it was started and isn't already finished), closes the file, and
+    frees everything.  */
+
+void decompress_close (DECOMPRESS *dec)
+{
+  if (dec->started)
+    {
+      pthread_mutex_lock (&dec->mutex);
+      dec->stop = NVTrue;
+      pthread_cond_broadcast (&dec->room_cond);
+      pthread_mutex_unlock (&dec->mutex);
+
+      pthread_join (dec->thread, NULL);
+    }
+
+  close (dec->fd);
+
+  pthread_mutex_destroy (&dec->mutex);
+  pthread_cond_destroy (&dec->data_cond);
+  pthread_cond_destroy (&dec->room_cond);
+
+  free (dec->ring);
+  free (dec);
+}
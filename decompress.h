@@ -0,0 +1,75 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+#ifndef __DECOMPRESS_H__
+#define __DECOMPRESS_H__
+
+#include <pthread.h>
+
+#include "nvutility.h"
+
+
+/*  Compressed input types (picked from the file name extension).  */
+
+#define DECOMPRESS_NONE             0
+#define DECOMPRESS_GZIP             1       /*  .gz  */
+#define DECOMPRESS_ZSTD             2       /*  .zst  */
+
+
+/*  Size of the ring buffer between the decompression thread and the reader, and of the compressed blocks
+    the thread reads from the file.  */
+
+#define DECOMPRESS_RING_SIZE        (4 * 1024 * 1024)
+#define DECOMPRESS_READ_SIZE        (256 * 1024)
+
+
+/*  A compressed file being decompressed on its own thread.  The thread inflates straight into the ring
+    buffer and blocks when it's full, the reader takes text out of it and blocks when it's empty.  head and
+    tail are the total bytes put in and taken out so head - tail is what's waiting to be read.  */
+
+typedef struct
+{
+  pthread_mutex_t     mutex;
+  pthread_cond_t      data_cond;          /*  Text was added (or end of file, or an error)  */
+  pthread_cond_t      room_cond;          /*  Text was taken out (or we're closing)  */
+  pthread_t           thread;
+  uint8_t             started;            /*  The thread is started by the first read  */
+  int32_t             type;
+  int32_t             fd;                 /*  Compressed file  */
+  char                *ring;
+  size_t              size;
+  uint64_t            head;
+  uint64_t            tail;
+  uint8_t             eof;                /*  The thread has put everything in the ring  */
+  uint8_t             stop;               /*  Closed before the end of the file  */
+  int32_t             error;              /*  errno from the thread (EIO for corrupt data)  */
+  uint64_t            compressed_bytes;   /*  Compressed bytes read  */
+  uint64_t            ns;                 /*  Time the thread spent reading and decompressing  */
+} DECOMPRESS;
+
+
+int32_t decompress_type (const char *path);
+DECOMPRESS *decompress_open (int32_t fd, int32_t type);
+int64_t decompress_read (DECOMPRESS *dec, char *buf, size_t size);
+void decompress_close (DECOMPRESS *dec);
+
+
+#endif
@@ -0,0 +1,431 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dedupe.h"
+
+
+/*  Mean earth radius in meters.  */
+
+#define EARTH_RADIUS            6371008.8
+
+#ifndef M_PI
+    #define M_PI                3.14159265358979323846
+#endif
+
+#define DEG2RAD                 (M_PI / 180.0)
+
+
+/*  Smallest cell we'll use (about a centimeter) so the cell numbers always fit in 32 bits.  */
+
+#define MIN_CELL_DEGREES        1.0e-7
+
+
+
+static uint32_t hash_key (uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+
+  return ((uint32_t) key);
+}
+
+
+
+static double normalize_longitude (double longitude)
+{
+  if (longitude < -180.0 || longitude >= 180.0)
+    {
+      longitude = fmod (longitude + 180.0, 360.0);
+      if (longitude < 0.0) longitude += 360.0;
+      longitude -= 180.0;
+    }
+
+  return (longitude);
+}
+
+
+
+static int64_t lat_cell (DEDUPE_INDEX *index, double latitude)
+{
+  return ((int64_t) floor ((latitude + 90.0) / index->cell_degrees));
+}
+
+
+
+static int64_t lon_cell (DEDUPE_INDEX *index, double longitude)
+{
+  int64_t cell = (int64_t) floor ((normalize_longitude (longitude) + 180.0) / index->lon_cell_degrees);
+
+  return (cell % index->lon_cells);
+}
+
+
+
+/*  Key 0 marks an empty slot so the packed cell numbers are offset by one.  */
+
+static uint64_t cell_key (int64_t lat, int64_t lon)
+{
+  return ((((uint64_t) lat << 32) | (uint64_t) lon) + 1);
+}
+
+
+
+/*  Returns the slot for key, which is either the cell's slot or the empty slot where it would go.  */
+
+static DEDUPE_CELL *find_cell (DEDUPE_INDEX *index, uint64_t key)
+{
+  uint32_t slot = hash_key (key) & index->cell_mask;
+
+
+  while (index->cell[slot].key && index->cell[slot].key != key) slot = (slot + 1) & index->cell_mask;
+
+  return (&index->cell[slot]);
+}
+
+
+
+static int32_t grow_cells (DEDUPE_INDEX *index)
+{
+  DEDUPE_CELL         *old = index->cell, *cell;
+  uint32_t            old_size = index->cell_mask + 1, i;
+
+
+  if ((index->cell = (DEDUPE_CELL *) calloc (old_size * 2, sizeof (DEDUPE_CELL))) == NULL)
+    {
+      index->cell = old;
+      return (-1);
+    }
+
+  index->cell_mask = old_size * 2 - 1;
+
+  for (i = 0 ; i < old_size ; i++)
+    {
+      if (old[i].key)
+        {
+          cell = find_cell (index, old[i].key);
+          *cell = old[i];
+        }
+    }
+
+  free (old);
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dedupe_open                                         *
+*                                                                           *
+*   Purpose:            Creates an empty duplicate index.                   *
+*                                                                           *
+*   Inputs:             meters              -   features closer than this   *
+*                                               are duplicates              *
+*                                                                           *
+*   Outputs:            DEDUPE_INDEX *      -   index or NULL on error      *
+*                                                                           *
+\***************************************************************************/
+
+DEDUPE_INDEX *dedupe_open (double meters)
+{
+  DEDUPE_INDEX *index;
+
+
+  if ((index = (DEDUPE_INDEX *) calloc (1, sizeof (DEDUPE_INDEX))) == NULL) return (NULL);
+
+  index->meters = meters;
+  index->cell_degrees = (meters / EARTH_RADIUS) / DEG2RAD;
+  if (index->cell_degrees < MIN_CELL_DEGREES) index->cell_degrees = MIN_CELL_DEGREES;
+
+  /*  Longitude cells have to divide the world evenly or the cells either side of 180 wouldn't be neighbors.  */
+
+  index->lon_cells = (int64_t) ceil (360.0 / index->cell_degrees);
+  index->lon_cell_degrees = 360.0 / (double) index->lon_cells;
+  index->polar = -1;
+
+  index->cell_mask = 1023;
+
+  if ((index->cell = (DEDUPE_CELL *) calloc (index->cell_mask + 1, sizeof (DEDUPE_CELL))) == NULL)
+    {
+      free (index);
+      return (NULL);
+    }
+
+  return (index);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dedupe_load_bfd                                     *
+*                                                                           *
+*   Purpose:            Adds every feature already in an open BFD file to   *
+*                       the index.  Only the short features are read so     *
+*                       the images never leave the disk.  Features that     *
+*                       were flagged as duplicates are left out, just like  *
+*                       they are when they're added during a run.           *
+*                                                                           *
+*   Inputs:             index               -   duplicate index             *
+*                       bfd_handle          -   open BFD file handle        *
+*                       records             -   only load records numbered  *
+*                                               below this (e.g. when       *
+*                                               resuming), 0 for all        *
+*                                                                           *
+*   Outputs:            int32_t             -   number of features loaded   *
+*                                               or -1 on error              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t dedupe_load_bfd (DEDUPE_INDEX *index, int32_t bfd_handle, uint32_t records)
+{
+  BFDATA_SHORT_FEATURE  *feature = NULL;
+  int32_t               count, loaded = 0, i;
+
+
+  if ((count = binaryFeatureData_read_all_short_features (bfd_handle, &feature)) < 0) return (-1);
+
+  for (i = 0 ; i < count ; i++)
+    {
+      if (records && feature[i].record_number >= records) continue;
+
+      if (!strncmp (feature[i].description, DEDUPE_FLAG_DESCRIPTION, strlen (DEDUPE_FLAG_DESCRIPTION))) continue;
+
+      if (dedupe_add (index, feature[i].latitude, feature[i].longitude, feature[i].record_number) < 0)
+        {
+          free (feature);
+          return (-1);
+        }
+
+      loaded++;
+    }
+
+  free (feature);
+
+  return (loaded);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dedupe_add                                          *
+*                                                                           *
+*   Purpose:            Adds a feature to the index.                        *
+*                                                                           *
+*   Inputs:             index               -   duplicate index             *
+*                       latitude            -   feature latitude            *
+*                       longitude           -   feature longitude           *
+*                       record_number       -   BFD record number           *
+*                                                                           *
+*   Outputs:            int32_t             -   0 or -1 if we ran out of    *
+*                                               memory                      *
+*                                                                           *
+\***************************************************************************/
+
+int32_t dedupe_add (DEDUPE_INDEX *index, double latitude, double longitude, uint32_t record_number)
+{
+  DEDUPE_POINT        *point;
+  DEDUPE_CELL         *cell;
+  int32_t             new_size;
+
+
+  if (index->count == index->size)
+    {
+      new_size = index->size ? index->size * 2 : 4096;
+
+      if ((point = (DEDUPE_POINT *) realloc (index->point, new_size * sizeof (DEDUPE_POINT))) == NULL) return (-1);
+
+      index->point = point;
+      index->size = new_size;
+    }
+
+  point = &index->point[index->count];
+  point->latitude = latitude;
+  point->longitude = longitude;
+  point->record_number = record_number;
+
+
+  if (fabs (latitude) > DEDUPE_POLAR_LATITUDE)
+    {
+      point->next = index->polar;
+      index->polar = index->count;
+    }
+  else
+    {
+      /*  Keep the hash table under 70% full.  */
+
+      if ((uint64_t) (index->cells_used + 1) * 10 > (uint64_t) (index->cell_mask + 1) * 7 && grow_cells (index) < 0)
+        return (-1);
+
+      cell = find_cell (index, cell_key (lat_cell (index, latitude), lon_cell (index, longitude)));
+
+      if (!cell->key)
+        {
+          cell->key = cell_key (lat_cell (index, latitude), lon_cell (index, longitude));
+          cell->head = -1;
+          index->cells_used++;
+        }
+
+      point->next = cell->head;
+      cell->head = index->count;
+    }
+
+  index->count++;
+
+  return (0);
+}
+
+
+
+/*  Returns NVTrue if the point is within the tolerance of the given position (great circle distance).  */
+
+static uint8_t within (DEDUPE_POINT *point, double latitude, double longitude, double limit)
+{
+  double              dlat, dlon, a;
+
+
+  dlat = sin ((point->latitude - latitude) * DEG2RAD * 0.5);
+  dlon = sin ((point->longitude - longitude) * DEG2RAD * 0.5);
+
+  a = dlat * dlat + cos (point->latitude * DEG2RAD) * cos (latitude * DEG2RAD) * dlon * dlon;
+
+  return (a <= limit);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dedupe_find                                         *
+*                                                                           *
+*   Purpose:            Looks for an indexed feature within the tolerance   *
+*                       of a position.  Only the cells that the tolerance   *
+*                       circle can touch are searched (plus the polar list  *
+*                       if we're close to a pole).                          *
+*                                                                           *
+*   Inputs:             index               -   duplicate index             *
+*                       latitude            -   new feature latitude        *
+*                       longitude           -   new feature longitude       *
+*                       record_number       -   returned record number of   *
+*                                               the first match             *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVTrue if there's a match   *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t dedupe_find (DEDUPE_INDEX *index, double latitude, double longitude, uint32_t *record_number)
+{
+  DEDUPE_CELL         *cell;
+  double              angle, limit, phi, s;
+  int64_t             lat0, lon0, lat, lon, span, n;
+  int32_t             i;
+
+
+  /*  Compare squared half angle sines (haversine) so there's no asin or sqrt per candidate.  */
+
+  angle = index->meters / EARTH_RADIUS;
+  limit = sin (angle * 0.5);
+  limit *= limit;
+
+
+  /*  How many longitude cells either side we have to look at.  The farther from the equator the more
+      degrees of longitude the tolerance covers.  Grid points are never past DEDUPE_POLAR_LATITUDE.  */
+
+  phi = fabs (latitude) + index->cell_degrees;
+  if (phi > DEDUPE_POLAR_LATITUDE) phi = DEDUPE_POLAR_LATITUDE;
+
+  s = sin (angle) / cos (phi * DEG2RAD);
+
+  if (s >= 1.0)
+    {
+      span = index->lon_cells;
+    }
+  else
+    {
+      span = (int64_t) ((asin (s) / DEG2RAD) / index->lon_cell_degrees) + 1;
+    }
+
+  if (span * 2 + 1 >= index->lon_cells) span = -1;
+
+
+  lat0 = lat_cell (index, latitude);
+  lon0 = lon_cell (index, longitude);
+
+  for (lat = lat0 - 1 ; lat <= lat0 + 1 ; lat++)
+    {
+      if (lat < 0) continue;
+
+      for (n = (span < 0 ? 0 : -span) ; n <= (span < 0 ? index->lon_cells - 1 : span) ; n++)
+        {
+          lon = (span < 0) ? n : ((lon0 + n) % index->lon_cells + index->lon_cells) % index->lon_cells;
+
+          cell = find_cell (index, cell_key (lat, lon));
+
+          if (!cell->key) continue;
+
+          for (i = cell->head ; i >= 0 ; i = index->point[i].next)
+            {
+              if (within (&index->point[i], latitude, longitude, limit))
+                {
+                  *record_number = index->point[i].record_number;
+                  return (NVTrue);
+                }
+            }
+        }
+    }
+
+
+  if (fabs (latitude) + index->cell_degrees > DEDUPE_POLAR_LATITUDE)
+    {
+      for (i = index->polar ; i >= 0 ; i = index->point[i].next)
+        {
+          if (within (&index->point[i], latitude, longitude, limit))
+            {
+              *record_number = index->point[i].record_number;
+              return (NVTrue);
+            }
+        }
+    }
+
+  return (NVFalse);
+}
+
+
+
+void dedupe_close (DEDUPE_INDEX *index)
+{
+  if (index == NULL) return;
+
+  free (index->point);
+  free (index->cell);
+  free (index);
+}
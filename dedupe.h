@@ -0,0 +1,89 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __DEDUPE_H__
+#define __DEDUPE_H__
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+
+
+/*  Features closer to a pole than this go in a plain list instead of the grid.  Up there a longitude cell
+    is so narrow that a tolerance circle can cover hundreds of them.  */
+
+#define DEDUPE_POLAR_LATITUDE   85.0
+
+
+/*  Description given to a duplicate that is kept (--dedupe-flag), followed by the record it duplicates.  */
+
+#define DEDUPE_FLAG_DESCRIPTION "Possible duplicate of record"
+
+
+/*  One indexed feature.  next chains the features that share a grid cell.  */
+
+typedef struct
+{
+  double              latitude;
+  double              longitude;
+  uint32_t            record_number;
+  int32_t             next;
+} DEDUPE_POINT;
+
+
+/*  Hash table slot for one occupied grid cell.  */
+
+typedef struct
+{
+  uint64_t            key;                /*  Packed latitude/longitude cell numbers, 0 if unused  */
+  int32_t             head;               /*  First point in the cell  */
+} DEDUPE_CELL;
+
+
+/*  Spatial hash of feature positions.  The grid cells are tolerance sized (in latitude) so a lookup only
+    looks at the features in a handful of cells around the new position no matter how many features are
+    indexed.  */
+
+typedef struct
+{
+  double              meters;             /*  Duplicate tolerance  */
+  double              cell_degrees;       /*  Cell size in degrees (tolerance as an angle)  */
+  int64_t             lon_cells;          /*  Number of cells around the world  */
+  double              lon_cell_degrees;   /*  360 / lon_cells  */
+  DEDUPE_POINT        *point;
+  int32_t             count;
+  int32_t             size;               /*  Allocated size of point  */
+  DEDUPE_CELL         *cell;
+  uint32_t            cell_mask;          /*  Hash table size - 1 (power of 2)  */
+  uint32_t            cells_used;
+  int32_t             polar;              /*  First point in the polar list  */
+} DEDUPE_INDEX;
+
+
+DEDUPE_INDEX *dedupe_open (double meters);
+int32_t dedupe_load_bfd (DEDUPE_INDEX *index, int32_t bfd_handle, uint32_t records);
+int32_t dedupe_add (DEDUPE_INDEX *index, double latitude, double longitude, uint32_t record_number);
+uint8_t dedupe_find (DEDUPE_INDEX *index, double latitude, double longitude, uint32_t *record_number);
+void dedupe_close (DEDUPE_INDEX *index);
+
+
+#endif
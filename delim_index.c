@@ -0,0 +1,284 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "delim_index.h"
+
+
+/*  The vector versions are built with GCC's per function target attributes so the rest of the program
+    doesn't have to be compiled for a newer CPU than it runs on.  Which one gets used is decided at run
+    time.  */
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+    #define DELIM_INDEX_X86
+    #include <immintrin.h>
+#endif
+
+
+/*  Room for at least this many more of each delimiter is made before each block is scanned.  */
+
+#define BLOCK_ROOM              64
+
+
+/*  Only ever set by delim_index_level, which has to be called before any threads are indexing text.
+    DELIM_INDEX_BEST is resolved by each delim_index_build so the worker threads never write it.  */
+
+static int32_t forced_level = DELIM_INDEX_BEST;
+
+
+
+/*  Makes sure each array has room for BLOCK_ROOM more offsets.  Returns -1 (errno is ENOMEM) if it
+    couldn't, in which case the arrays are left the way they were.  */
+
+static int32_t make_room (DELIM_INDEX *index)
+{
+  uint32_t            *array;
+  size_t              size;
+
+
+  if (index->commas + BLOCK_ROOM <= index->size && index->newlines + BLOCK_ROOM <= index->size &&
+      index->letter_ls + BLOCK_ROOM <= index->size)
+    return (0);
+
+  size = index->size ? index->size * 2 : 16384;
+
+  if ((array = (uint32_t *) realloc (index->comma, size * sizeof (uint32_t))) == NULL) return (-1);
+  index->comma = array;
+
+  if ((array = (uint32_t *) realloc (index->newline, size * sizeof (uint32_t))) == NULL) return (-1);
+  index->newline = array;
+
+  if ((array = (uint32_t *) realloc (index->letter_l, size * sizeof (uint32_t))) == NULL) return (-1);
+  index->letter_l = array;
+
+  index->size = size;
+
+  return (0);
+}
+
+
+
+/*  The best version the CPU supports.  */
+
+static int32_t best_level ()
+{
+  int32_t             best = DELIM_INDEX_SCALAR;
+
+
+#ifdef DELIM_INDEX_X86
+  if (__builtin_cpu_supports ("sse2")) best = DELIM_INDEX_SSE2;
+  if (__builtin_cpu_supports ("avx2")) best = DELIM_INDEX_AVX2;
+#endif
+
+  return (best);
+}
+
+
+
+/*  Scalar version, also used for whatever is left over after the last full vector.  */
+
+static int32_t index_scalar (const char *text, size_t start, size_t len, DELIM_INDEX *index)
+{
+  size_t              i;
+
+
+  for (i = start ; i < len ; i++)
+    {
+      if (!((i - start) % BLOCK_ROOM) && make_room (index) < 0) return (-1);
+
+      switch (text[i])
+        {
+        case ',':
+          index->comma[index->commas++] = (uint32_t) i;
+          break;
+
+        case '\n':
+          index->newline[index->newlines++] = (uint32_t) i;
+          break;
+
+        case 'L':
+        case 'l':
+          index->letter_l[index->letter_ls++] = (uint32_t) i;
+          break;
+        }
+    }
+
+  return (0);
+}
+
+
+
+#ifdef DELIM_INDEX_X86
+
+/*  Appends the offset of every set bit of mask (bit n is byte pos + n).  */
+
+#define ADD_OFFSETS(mask, array, count, pos)                                \
+  while (mask)                                                              \
+    {                                                                       \
+      array[count++] = (uint32_t) (pos) + (uint32_t) __builtin_ctz (mask);  \
+      mask &= mask - 1;                                                     \
+    }
+
+
+__attribute__ ((target ("sse2")))
+static size_t index_sse2 (const char *text, size_t len, DELIM_INDEX *index)
+{
+  const __m128i       comma = _mm_set1_epi8 (','), newline = _mm_set1_epi8 ('\n'), upper_l = _mm_set1_epi8 ('L'),
+                      lower_l = _mm_set1_epi8 ('l');
+  __m128i             block;
+  uint32_t            mask;
+  size_t              i;
+
+
+  for (i = 0 ; i + 16 <= len ; i += 16)
+    {
+      if (make_room (index) < 0) break;
+
+      block = _mm_loadu_si128 ((const __m128i *) (text + i));
+
+      mask = (uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, comma));
+      ADD_OFFSETS (mask, index->comma, index->commas, i);
+
+      mask = (uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, newline));
+      ADD_OFFSETS (mask, index->newline, index->newlines, i);
+
+      mask = (uint32_t) _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (block, upper_l), _mm_cmpeq_epi8 (block, lower_l)));
+      ADD_OFFSETS (mask, index->letter_l, index->letter_ls, i);
+    }
+
+  return (i);
+}
+
+
+
+__attribute__ ((target ("avx2")))
+static size_t index_avx2 (const char *text, size_t len, DELIM_INDEX *index)
+{
+  const __m256i       comma = _mm256_set1_epi8 (','), newline = _mm256_set1_epi8 ('\n'),
+                      upper_l = _mm256_set1_epi8 ('L'), lower_l = _mm256_set1_epi8 ('l');
+  __m256i             block;
+  uint32_t            mask;
+  size_t              i;
+
+
+  for (i = 0 ; i + 32 <= len ; i += 32)
+    {
+      if (make_room (index) < 0) break;
+
+      block = _mm256_loadu_si256 ((const __m256i *) (text + i));
+
+      mask = (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, comma));
+      ADD_OFFSETS (mask, index->comma, index->commas, i);
+
+      mask = (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, newline));
+      ADD_OFFSETS (mask, index->newline, index->newlines, i);
+
+      mask = (uint32_t) _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8 (block, upper_l),
+                                                               _mm256_cmpeq_epi8 (block, lower_l)));
+      ADD_OFFSETS (mask, index->letter_l, index->letter_ls, i);
+    }
+
+  return (i);
+}
+
+#endif
+
+
+
+/*  Sets the version delim_index_build uses (for testing and benchmarking) and returns the one it will
+    actually use, which is the best one the CPU supports if level is DELIM_INDEX_BEST or isn't
+    supported.  Don't call this while other threads are building indexes.  */
+
+int32_t delim_index_level (int32_t level)
+{
+  int32_t             best = best_level ();
+
+
+  forced_level = (level >= 0 && level < best) ? level : DELIM_INDEX_BEST;
+
+  return ((forced_level == DELIM_INDEX_BEST) ? best : forced_level);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        delim_index_build                                   *
+*                                                                           *
+*   Purpose:            Finds every comma, newline, and L/l in a block of   *
+*                       text in one pass, 32 (AVX2) or 16 (SSE2) bytes at   *
+*                       a time where the CPU can do it.  The parsers walk   *
+*                       the lines and fields from these offsets instead of  *
+*                       searching each line again.                          *
+*                                                                           *
+*   Inputs:             text                -   text to index (at most      *
+*                                               DELIM_INDEX_MAX_TEXT bytes) *
+*                       index               -   returned offsets            *
+*                                                                           *
+*   Outputs:            0 on success, -1 (errno is ENOMEM) if there wasn't  *
+*                       memory for the offsets                              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t delim_index_build (STRING_VIEW text, DELIM_INDEX *index)
+{
+  size_t              done = 0;
+  int32_t             level;
+
+
+  index->commas = index->newlines = index->letter_ls = 0;
+
+  level = (forced_level == DELIM_INDEX_BEST) ? best_level () : forced_level;
+
+#ifdef DELIM_INDEX_X86
+  if (level == DELIM_INDEX_AVX2)
+    {
+      done = index_avx2 (text.ptr, text.len, index);
+    }
+  else if (level == DELIM_INDEX_SSE2)
+    {
+      done = index_sse2 (text.ptr, text.len, index);
+    }
+#endif
+
+  if (index_scalar (text.ptr, done, text.len, index) < 0)
+    {
+      errno = ENOMEM;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+void delim_index_free (DELIM_INDEX *index)
+{
+  free (index->comma);
+  free (index->newline);
+  free (index->letter_l);
+  memset (index, 0, sizeof (DELIM_INDEX));
+}
@@ -0,0 +1,141 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __DELIM_INDEX_H__
+#define __DELIM_INDEX_H__
+
+#include "nvutility.h"
+
+#include "string_view.h"
+
+
+/*  Largest block of text that can be indexed (the offsets are 32 bits).  parse_chunk falls back to
+    searching each line if a chunk is bigger than this (i.e. it's one enormous line).  */
+
+#define DELIM_INDEX_MAX_TEXT        0xffffffffULL
+
+
+/*  Which code delim_index_build uses.  DELIM_INDEX_BEST picks the fastest one the CPU supports.  */
+
+#define DELIM_INDEX_BEST            -1
+#define DELIM_INDEX_SCALAR          0
+#define DELIM_INDEX_SSE2            1
+#define DELIM_INDEX_AVX2            2
+
+
+/*  Offsets (from the start of the text) of every comma and newline in a block of text, plus every L or
+    l (every header line has one, so lines without one don't have to be checked).  The arrays are
+    reused from block to block so they only grow.  */
+
+typedef struct
+{
+  uint32_t            *comma;
+  size_t              commas;
+  uint32_t            *newline;
+  size_t              newlines;
+  uint32_t            *letter_l;
+  size_t              letter_ls;
+  size_t              size;               /*  Allocated size of each array  */
+} DELIM_INDEX;
+
+
+/*  Walks the comma separated fields of one line.  The fields come back the way strtok would return them
+    (empty fields are collapsed).  With comma set to NULL the line is just searched for the commas.  */
+
+typedef struct
+{
+  const char          *ptr;               /*  Rest of the line  */
+  const char          *end;
+  const char          *base;              /*  Text the comma offsets are from  */
+  const uint32_t      *comma;             /*  Next comma in the line  */
+  const uint32_t      *comma_end;         /*  Just past the line's last comma  */
+} FIELD_CURSOR;
+
+
+static inline void field_cursor_init (FIELD_CURSOR *cursor, STRING_VIEW line, const char *base, const uint32_t *comma,
+                                      const uint32_t *comma_end)
+{
+  cursor->ptr = line.ptr;
+  cursor->end = line.ptr + line.len;
+  cursor->base = base;
+  cursor->comma = comma;
+  cursor->comma_end = comma_end;
+}
+
+
+/*  Same results as sv_next_token (&rest, ',', token) on the rest of the line.  */
+
+static inline uint8_t field_next (FIELD_CURSOR *cursor, STRING_VIEW *token)
+{
+  STRING_VIEW         rest;
+  const char          *next;
+  uint8_t             status;
+
+
+  if (cursor->comma == NULL)
+    {
+      rest = sv_make (cursor->ptr, cursor->end - cursor->ptr);
+      status = sv_next_token (&rest, ',', token);
+      cursor->ptr = rest.ptr;
+
+      return (status);
+    }
+
+
+  /*  Skip leading commas.  */
+
+  while (cursor->comma < cursor->comma_end && cursor->base + *cursor->comma == cursor->ptr)
+    {
+      cursor->ptr++;
+      cursor->comma++;
+    }
+
+  if (cursor->ptr == cursor->end)
+    {
+      *token = sv_make (cursor->end, 0);
+      return (NVFalse);
+    }
+
+  next = (cursor->comma < cursor->comma_end) ? cursor->base + *cursor->comma : cursor->end;
+
+  *token = sv_make (cursor->ptr, next - cursor->ptr);
+
+  if (next < cursor->end)
+    {
+      cursor->ptr = next + 1;
+      cursor->comma++;
+    }
+  else
+    {
+      cursor->ptr = cursor->end;
+    }
+
+  return (NVTrue);
+}
+
+
+int32_t delim_index_level (int32_t level);
+int32_t delim_index_build (STRING_VIEW text, DELIM_INDEX *index);
+void delim_index_free (DELIM_INDEX *index);
+
+
+#endif
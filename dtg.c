@@ -0,0 +1,361 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "dtg.h"
+
+
+/*  Days in the year before the first of each month (the last entry is the length of the year), for
+    normal and leap years.  */
+
+static const int32_t days_before_month[2][13] = {{0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365},
+                                                 {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366}};
+
+
+/*  Range of years dtg_midnight works out itself.  Anything else goes through inv_cvtime.  */
+
+#define DTG_FIRST_YEAR          1900
+#define DTG_LAST_YEAR           9999
+
+
+
+static inline int32_t leap_year (int32_t year)
+{
+  return ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0);
+}
+
+
+static inline uint8_t is_digit (char c)
+{
+  return (c >= '0' && c <= '9');
+}
+
+
+static inline uint8_t is_space (char c)
+{
+  return (c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r');
+}
+
+
+static inline const char *skip_space (const char *ptr, const char *end)
+{
+  while (ptr < end && is_space (*ptr)) ptr++;
+
+  return (ptr);
+}
+
+
+/*  Exactly two digits (ISO 8601 fields are fixed width).  Returns NULL if they aren't there.  */
+
+static inline const char *two_digits (const char *ptr, const char *end, int32_t *value)
+{
+  if (end - ptr < 2 || !is_digit (ptr[0]) || !is_digit (ptr[1])) return (NULL);
+
+  *value = (ptr[0] - '0') * 10 + (ptr[1] - '0');
+
+  return (ptr + 2);
+}
+
+
+
+/*  Number of days in a month (0 if the month isn't 1 through 12).  */
+
+uint8_t dtg_month_days (int32_t year, int32_t month)
+{
+  int32_t             leap;
+
+
+  if (month < 1 || month > 12) return (0);
+
+  leap = leap_year (year);
+
+  return ((uint8_t) (days_before_month[leap][month] - days_before_month[leap][month - 1]));
+}
+
+
+
+/*  The legacy layout.  This takes exactly what sv_scanf (field, "%d-%d-%d  %d:%d:%f", ...) did (including
+    the values it leaves set when it stops part way through) so old files load the same as they always
+    have.  month has already been scanned and ptr is just past it.  */
+
+static int32_t parse_mdy (const char *ptr, const char *end, int32_t *year, int32_t *mday, int32_t *hour,
+                          int32_t *minute, float *second)
+{
+  int32_t             *value[4], i;
+  static const char   separator[4] = {'-', '-', 0, ':'};
+
+
+  value[0] = mday;
+  value[1] = year;
+  value[2] = hour;
+  value[3] = minute;
+
+  for (i = 0 ; i < 4 ; i++)
+    {
+      if (separator[i])
+        {
+          if (ptr == end || *ptr != separator[i]) return (i + 1);
+          ptr++;
+        }
+
+      ptr = skip_space (ptr, end);
+
+      if (ptr == end || (ptr = sv_scan_int32 (ptr, end, value[i])) == NULL) return (i + 1);
+    }
+
+  if (ptr == end || *ptr != ':') return (5);
+
+  ptr = skip_space (ptr + 1, end);
+
+  if (ptr == end || sv_scan_float (ptr, end, second) == NULL) return (5);
+
+  return (6);
+}
+
+
+
+/*  Moves a DTG that's offset minutes ahead of UTC back to UTC.  The offset is less than a day so at most
+    one day is crossed.  */
+
+static void shift_to_utc (int32_t *year, int32_t *month, int32_t *mday, int32_t *hour, int32_t *minute, int32_t offset)
+{
+  int32_t             total;
+
+
+  total = *hour * 60 + *minute - offset;
+
+  if (total < 0)
+    {
+      total += 1440;
+
+      if (--(*mday) < 1)
+        {
+          if (--(*month) < 1)
+            {
+              *month = 12;
+              (*year)--;
+            }
+
+          *mday = dtg_month_days (*year, *month);
+        }
+    }
+  else if (total >= 1440)
+    {
+      total -= 1440;
+
+      if (++(*mday) > dtg_month_days (*year, *month))
+        {
+          *mday = 1;
+
+          if (++(*month) > 12)
+            {
+              *month = 1;
+              (*year)++;
+            }
+        }
+    }
+
+  *hour = total / 60;
+  *minute = total % 60;
+}
+
+
+
+/*  ISO 8601.  year has already been scanned and ptr is on the dash after it.  Seconds are optional (they're
+    zero if they're missing) and a time without a zone is taken to be UTC.  A zone that doesn't make sense
+    leaves the DTG short so it can be rejected.  */
+
+static int32_t parse_iso (const char *ptr, const char *end, int32_t *year, int32_t *month, int32_t *mday,
+                          int32_t *hour, int32_t *minute, float *second)
+{
+  int32_t             zone_hour, zone_minute = 0, offset;
+  float               sec = 0.0f;
+  uint8_t             negative;
+
+
+  if ((ptr = two_digits (ptr + 1, end, month)) == NULL) return (1);
+
+  if (ptr == end || *ptr != '-' || (ptr = two_digits (ptr + 1, end, mday)) == NULL) return (2);
+
+  if (ptr < end && (*ptr == 'T' || *ptr == 't'))
+    {
+      ptr++;
+    }
+  else if (ptr < end && is_space (*ptr))
+    {
+      ptr = skip_space (ptr, end);
+    }
+  else
+    {
+      return (3);
+    }
+
+  if ((ptr = two_digits (ptr, end, hour)) == NULL) return (3);
+
+  if (ptr == end || *ptr != ':' || (ptr = two_digits (ptr + 1, end, minute)) == NULL) return (4);
+
+  if (ptr < end && *ptr == ':')
+    {
+      if (end - ptr < 3 || !is_digit (ptr[1]) || !is_digit (ptr[2])) return (5);
+
+      ptr = sv_scan_float (ptr + 1, end, &sec);
+    }
+
+  *second = sec;
+
+  if (ptr == end || (*ptr != '+' && *ptr != '-')) return (6);
+
+
+  /*  +HH, +HHMM, or +HH:MM (or -).  */
+
+  negative = (*ptr == '-');
+
+  if ((ptr = two_digits (ptr + 1, end, &zone_hour)) == NULL) return (5);
+
+  if (ptr < end && *ptr == ':') ptr++;
+
+  if (ptr < end && is_digit (*ptr) && two_digits (ptr, end, &zone_minute) == NULL) return (5);
+
+  if (zone_hour > 23 || zone_minute > 59) return (5);
+
+  offset = zone_hour * 60 + zone_minute;
+  if (negative) offset = -offset;
+
+  if (offset && *mday >= 1 && *mday <= dtg_month_days (*year, *month) && *hour < 24 && *minute < 60)
+    shift_to_utc (year, month, mday, hour, minute, offset);
+
+  return (6);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dtg_parse                                           *
+*                                                                           *
+*   Purpose:            Parses a DTG in either the .uni layout or ISO 8601  *
+*                       (see dtg.h).  Only the values that were found are   *
+*                       set.  An ISO 8601 DTG with a zone is converted to   *
+*                       UTC.                                                *
+*                                                                           *
+*   Inputs:             field               -   DTG text                    *
+*                       year                -   returned full year          *
+*                       month               -   returned month (1 - 12)     *
+*                       mday                -   returned day of the month   *
+*                       hour                -   returned hour               *
+*                       minute              -   returned minute             *
+*                       second              -   returned second             *
+*                                                                           *
+*   Outputs:            int32_t             -   number of values found (6   *
+*                                               for a whole DTG) or EOF if  *
+*                                               the field is blank, the     *
+*                                               same as sscanf              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t dtg_parse (STRING_VIEW field, int32_t *year, int32_t *month, int32_t *mday, int32_t *hour, int32_t *minute,
+                   float *second)
+{
+  const char          *ptr, *end, *next;
+  int32_t             first;
+
+
+  end = field.ptr + field.len;
+  ptr = skip_space (field.ptr, end);
+
+  if (ptr == end) return (EOF);
+
+  if ((next = sv_scan_int32 (ptr, end, &first)) == NULL) return (0);
+
+  if (next - ptr == 4 && is_digit (*ptr) && next < end && *next == '-')
+    {
+      *year = first;
+      return (parse_iso (next, end, year, month, mday, hour, minute, second));
+    }
+
+  *month = first;
+
+  return (parse_mdy (next, end, year, mday, hour, minute, second));
+}
+
+
+
+/*  Whether a DTG could be a real date and time (a DTG that didn't parse is left with a zero month).  */
+
+uint8_t dtg_valid (int32_t year, int32_t month, int32_t mday, int32_t hour, int32_t minute, float second)
+{
+  return (year >= 1900 && month >= 1 && month <= 12 && mday >= 1 && mday <= dtg_month_days (year, month) &&
+          hour >= 0 && hour < 24 && minute >= 0 && minute < 60 && second >= 0.0 && second < 61.0);
+}
+
+
+
+/*  Day of the year, the same as mday2jday (which it falls back to for a month that's out of range).  */
+
+void dtg_jday (int32_t year, int32_t month, int32_t mday, int32_t *day)
+{
+  if (month < 1 || month > 12)
+    {
+      mday2jday (year, month, mday, day);
+      return;
+    }
+
+  *day = days_before_month[leap_year (year)][month - 1] + mday;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        dtg_midnight                                        *
+*                                                                           *
+*   Purpose:            Works out the event time of 00:00:00 UTC on a day   *
+*                       of the year from the day counts instead of going    *
+*                       through mktime like inv_cvtime does.  The caller    *
+*                       adds on the time of day.                            *
+*                                                                           *
+*   Inputs:             year                -   full year                   *
+*                       day                 -   day of year                 *
+*                       midnight            -   returned seconds since 1970 *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse if the year or day  *
+*                                               is out of range (use        *
+*                                               inv_cvtime)                 *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t dtg_midnight (int32_t year, int32_t day, time_t *midnight)
+{
+  int64_t             days, before;
+
+
+  if (year < DTG_FIRST_YEAR || year > DTG_LAST_YEAR || day < 1 || day > 366) return (NVFalse);
+
+
+  /*  Leap days before this year less the 477 before 1970.  */
+
+  before = year - 1;
+  days = (int64_t) (year - 1970) * 365 + (before / 4 - before / 100 + before / 400) - 477 + day - 1;
+
+  *midnight = (time_t) (days * 86400);
+
+  return (NVTrue);
+}
@@ -0,0 +1,51 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __DTG_H__
+#define __DTG_H__
+
+#include <time.h>
+
+#include "nvutility.h"
+
+#include "string_view.h"
+
+
+/*  Date/time groups (DTGs) are parsed without sv_scanf.  Two layouts are taken:
+
+        MM-DD-YYYY HH:MM:SS.SS                  the .uni layout, with any amount of white space between
+                                                the date and the time
+        YYYY-MM-DD[T| ]HH:MM[:SS[.SSS]][Z|+HH[:MM]|-HH[:MM]]
+                                                ISO 8601 (extended format), converted to UTC
+
+    The first number tells them apart (an ISO 8601 DTG starts with a four digit year and a dash).  */
+
+
+uint8_t dtg_month_days (int32_t year, int32_t month);
+int32_t dtg_parse (STRING_VIEW field, int32_t *year, int32_t *month, int32_t *mday, int32_t *hour, int32_t *minute,
+                   float *second);
+uint8_t dtg_valid (int32_t year, int32_t month, int32_t mday, int32_t hour, int32_t minute, float second);
+void dtg_jday (int32_t year, int32_t month, int32_t mday, int32_t *day);
+uint8_t dtg_midnight (int32_t year, int32_t day, time_t *midnight);
+
+
+#endif
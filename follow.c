@@ -0,0 +1,409 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+    #include <io.h>
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#ifdef NVLinux
+    #include <poll.h>
+    #include <sys/inotify.h>
+#endif
+
+#include "follow.h"
+
+
+/*  Set from a signal handler to make follow_run finish up and return.  */
+
+static volatile sig_atomic_t stop_following = 0;
+
+
+/*  The file being followed.  buf holds the (partial) line(s) read but not yet committed, starting at file
+    offset offset.  */
+
+typedef struct
+{
+  const char          *path;
+  int32_t             fd;                 /*  -1 while the file doesn't exist (e.g. between rotations)  */
+  uint64_t            dev;                /*  Device and inode of the open file, to spot rotations  */
+  uint64_t            ino;
+  uint64_t            offset;
+  char                *buf;
+  size_t              used;
+  size_t              size;
+  int32_t             format;
+  const CONTACT_TIME  *now;
+  const PARSE_OPTIONS *options;
+  COMMIT_FUNC         commit;
+  void                *data;
+  INGEST_STATS        *stats;
+  RECORD_BATCH        batch;
+  uint8_t             pending;            /*  Records committed but not published yet  */
+  uint64_t            deadline;           /*  When the pending records have to be published  */
+  int32_t             latency_ms;
+  int32_t             notify_fd;          /*  inotify instance (-1 if we're just polling)  */
+} FOLLOW;
+
+
+
+/*  Async signal safe, this is meant to be called from a SIGINT/SIGTERM handler.  */
+
+void follow_stop ()
+{
+  stop_following = 1;
+}
+
+
+
+static int32_t follow_open (FOLLOW *follow, uint64_t offset)
+{
+  struct stat         st;
+
+
+  if ((follow->fd = open (follow->path, O_RDONLY)) < 0) return (-1);
+
+  if (fstat (follow->fd, &st) < 0 || lseek (follow->fd, (off_t) offset, SEEK_SET) < 0)
+    {
+      close (follow->fd);
+      follow->fd = -1;
+      return (-1);
+    }
+
+  follow->dev = (uint64_t) st.st_dev;
+  follow->ino = (uint64_t) st.st_ino;
+  follow->offset = offset;
+  follow->used = 0;
+
+  return (0);
+}
+
+
+
+/*  Parses and commits the first len bytes of the buffer (which must end at a line boundary, or be the
+    last of a file we're done with) and moves whatever is left to the front.  Returns -1 if the commit
+    failed.  */
+
+static int32_t follow_commit (FOLLOW *follow, size_t len)
+{
+  if (follow->stats != NULL)
+    {
+      follow->stats->bytes_read += len;
+      follow->stats->chunks++;
+    }
+
+  follow->batch.input_offset = follow->offset + len;
+
+  parse_chunk (follow->format, sv_make (follow->buf, len), follow->now, follow->options, &follow->batch);
+  if (pipeline_commit (&follow->batch, follow->commit, follow->data, follow->stats) < 0) return (-1);
+
+  follow->used -= len;
+  follow->offset += len;
+  if (follow->used) memmove (follow->buf, follow->buf + len, follow->used);
+
+
+  /*  The clock starts when the first unpublished record shows up.  */
+
+  if (follow->batch.count && !follow->pending)
+    {
+      follow->pending = NVTrue;
+      follow->deadline = stats_clock_ns () + (uint64_t) follow->latency_ms * 1000000ULL;
+    }
+
+  return (0);
+}
+
+
+
+/*  Reads whatever has been appended to the file and commits all of the complete lines.  A partial line
+    at the end stays in the buffer until the rest of it shows up.  */
+
+static int32_t follow_read (FOLLOW *follow)
+{
+  ssize_t             n;
+  size_t              i;
+  uint64_t            start;
+  char                *buf;
+
+
+  if (follow->fd < 0) return (0);
+
+  while (NVTrue)
+    {
+      if (follow->used == follow->size)
+        {
+          if ((buf = (char *) realloc (follow->buf, follow->size * 2)) == NULL) return (-1);
+
+          follow->buf = buf;
+          follow->size *= 2;
+        }
+
+      start = stats_clock_ns ();
+
+      n = read (follow->fd, follow->buf + follow->used, follow->size - follow->used);
+
+      if (follow->stats != NULL) follow->stats->read_ns += stats_clock_ns () - start;
+
+      if (n < 0)
+        {
+          if (errno == EINTR) continue;
+          return (-1);
+        }
+
+      if (!n) return (0);
+
+      follow->used += n;
+
+
+      /*  Commit up to the last newline we have.  */
+
+      for (i = follow->used ; i > 0 && follow->buf[i - 1] != '\n' ; i--);
+
+      if (i && follow_commit (follow, i) < 0) return (-1);
+    }
+}
+
+
+
+/*  Looks for the file having been truncated or rotated out from under us.  Either way we start over at
+    the beginning of whatever is at the path now.  A file that is truncated and then grows past where we
+    were before we get to look at it can't be told from one that just grew, but a logger that truncates
+    will normally also send us an inotify event long before that happens.  */
+
+static int32_t follow_check (FOLLOW *follow)
+{
+  struct stat         st;
+
+
+  if (follow->fd >= 0)
+    {
+      if (fstat (follow->fd, &st) == 0 && (uint64_t) st.st_size < follow->offset + follow->used)
+        {
+          fprintf (stderr, "%s was truncated, starting over at the beginning\n", follow->path);
+          fflush (stderr);
+
+          if (lseek (follow->fd, 0, SEEK_SET) < 0) return (-1);
+
+          follow->offset = 0;
+          follow->used = 0;
+        }
+
+      if (stat (follow->path, &st) == 0 && (uint64_t) st.st_dev == follow->dev && (uint64_t) st.st_ino == follow->ino)
+        return (0);
+
+
+      /*  Rotated (or removed).  Get anything the logger wrote to the old file before it moved on.  The last
+          line is complete even without its newline since nothing more is coming.  */
+
+      if (follow_read (follow) < 0) return (-1);
+
+      if (follow->used && follow_commit (follow, follow->used) < 0) return (-1);
+
+      close (follow->fd);
+      follow->fd = -1;
+
+      fprintf (stderr, "%s was rotated, waiting for the new file\n", follow->path);
+      fflush (stderr);
+    }
+
+
+  if (follow_open (follow, 0) < 0) return (errno == ENOENT ? 0 : -1);
+
+  fprintf (stderr, "Following new %s\n", follow->path);
+  fflush (stderr);
+
+  return (0);
+}
+
+
+
+/*  Waits for something to happen to the file (or for ms milliseconds, whichever comes first).  */
+
+static void follow_wait (FOLLOW *follow, int32_t ms)
+{
+#ifdef NVLinux
+  struct pollfd       pfd;
+  char                events[4096];
+
+
+  if (follow->notify_fd >= 0)
+    {
+      pfd.fd = follow->notify_fd;
+      pfd.events = POLLIN;
+
+      if (poll (&pfd, 1, ms) > 0)
+        {
+          /*  We don't care what the events were, we look at the file either way.  */
+
+          while (read (follow->notify_fd, events, sizeof (events)) > 0);
+        }
+
+      return;
+    }
+#endif
+
+#ifdef WIN32
+  Sleep (ms);
+#else
+  usleep (ms * 1000);
+#endif
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        follow_run                                          *
+*                                                                           *
+*   Purpose:            Follows a file that is being appended to (like      *
+*                       tail -F).  Complete lines are parsed and committed  *
+*                       as they show up and publish is called within        *
+*                       latency_ms of the first unpublished record being    *
+*                       committed.  Truncation and rotation are handled by  *
+*                       starting over at the beginning of whatever file is  *
+*                       then at path.  On Linux the directory is watched    *
+*                       with inotify so we're idle until something changes, *
+*                       elsewhere the file is polled.  Runs until           *
+*                       follow_stop is called or a commit or publish fails. *
+*                                                                           *
+*   Inputs:             path                -   input file name             *
+*                       offset              -   byte offset to start at     *
+*                                               (must be a line boundary)   *
+*                       format              -   input format                *
+*                       now                 -   run time (event time for    *
+*                                               .txt and .csv records)      *
+*                       options             -   parse settings (column map, *
+*                                               tolerant parsing)           *
+*                       latency_ms          -   publish latency bound       *
+*                       commit              -   called with each batch      *
+*                       publish             -   called to make the          *
+*                                               committed records visible   *
+*                       data                -   passed through to commit    *
+*                                               and publish                 *
+*                       stats               -   stage counters to add to,   *
+*                                               or NULL to skip the timing  *
+*                                                                           *
+*   Outputs:            int32_t             -   0 when stopped, -1 on error *
+*                                               (errno is set for a read    *
+*                                               error, commit and publish   *
+*                                               report their own)           *
+*                                                                           *
+\***************************************************************************/
+
+int32_t follow_run (const char *path, uint64_t offset, int32_t format, const CONTACT_TIME *now,
+                    const PARSE_OPTIONS *options, int32_t latency_ms, COMMIT_FUNC commit, PUBLISH_FUNC publish,
+                    void *data, INGEST_STATS *stats)
+{
+  FOLLOW              follow;
+  uint64_t            clock;
+  int32_t             status = 0, wait_ms;
+#ifdef NVLinux
+  char                dir[512];
+#endif
+
+
+  memset (&follow, 0, sizeof (FOLLOW));
+
+  follow.path = path;
+  follow.format = format;
+  follow.now = now;
+  follow.options = options;
+  follow.latency_ms = latency_ms;
+  follow.commit = commit;
+  follow.data = data;
+  follow.stats = stats;
+  follow.notify_fd = -1;
+  follow.batch.timed = (stats != NULL);
+  follow.batch.load_images = NVTrue;
+  follow.size = LINE_READER_STREAM_BLOCK;
+
+  if ((follow.buf = (char *) malloc (follow.size)) == NULL) return (-1);
+
+  if (follow_open (&follow, offset) < 0)
+    {
+      free (follow.buf);
+      return (-1);
+    }
+
+
+  /*  Watch the directory rather than the file so we also hear about the file being replaced.  */
+
+#ifdef NVLinux
+  strcpy (dir, gen_dirname ((char *) path));
+
+  if ((follow.notify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC)) >= 0 &&
+      inotify_add_watch (follow.notify_fd, dir, IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                         IN_CLOSE_WRITE | IN_ATTRIB) < 0)
+    {
+      close (follow.notify_fd);
+      follow.notify_fd = -1;
+    }
+#endif
+
+
+  while (NVTrue)
+    {
+      if ((status = follow_read (&follow)) < 0 || (status = follow_check (&follow)) < 0) break;
+
+
+      clock = stats_clock_ns ();
+
+      if (follow.pending && clock >= follow.deadline)
+        {
+          if ((status = (*publish) (data)) < 0) break;
+          follow.pending = NVFalse;
+        }
+
+      if (stop_following) break;
+
+
+      wait_ms = FOLLOW_IDLE_MS;
+      if (follow.pending) wait_ms = (int32_t) ((follow.deadline - clock) / 1000000ULL) + 1;
+
+      follow_wait (&follow, wait_ms);
+    }
+
+
+  /*  Whatever we committed before stopping still gets published.  A partial last line is left for the
+      next run.  */
+
+  if (follow.pending && (*publish) (data) < 0) status = -1;
+
+#ifdef NVLinux
+  if (follow.notify_fd >= 0) close (follow.notify_fd);
+#endif
+
+  if (follow.fd >= 0) close (follow.fd);
+
+  free (follow.buf);
+  record_batch_free (&follow.batch);
+
+  return (status < 0 ? -1 : 0);
+}
@@ -0,0 +1,54 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __FOLLOW_H__
+#define __FOLLOW_H__
+
+#include "pipeline.h"
+
+
+/*  Default time (in milliseconds) from a line being appended to the input to its record being visible
+    in the BFD file.  */
+
+#define FOLLOW_LATENCY_MS       250
+
+
+/*  How often (in milliseconds) we look at the input file when nothing is happening.  inotify normally
+    wakes us up long before this, it's just a backstop for rotations we didn't get an event for (and the
+    polling interval where there is no inotify).  */
+
+#define FOLLOW_IDLE_MS          1000
+
+
+/*  Called once the records committed since the last call should be made visible to readers of the BFD
+    file.  data is what was given to follow_run.  Returns 0, or -1 if they couldn't be published.  */
+
+typedef int32_t (*PUBLISH_FUNC) (void *data);
+
+
+int32_t follow_run (const char *path, uint64_t offset, int32_t format, const CONTACT_TIME *now,
+                    const PARSE_OPTIONS *options, int32_t latency_ms, COMMIT_FUNC commit, PUBLISH_FUNC publish,
+                    void *data, INGEST_STATS *stats);
+void follow_stop ();
+
+
+#endif
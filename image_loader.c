@@ -0,0 +1,214 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "image_loader.h"
+
+
+/*  Makes sure the batch image buffer can take another size bytes.  */
+
+static uint8_t reserve_image_bytes (RECORD_BATCH *batch, size_t size)
+{
+  uint8_t             *image;
+  size_t              new_size;
+
+
+  if (batch->image_used + size <= batch->image_size) return (NVTrue);
+
+  new_size = batch->image_size ? batch->image_size : 1024 * 1024;
+  while (new_size < batch->image_used + size) new_size *= 2;
+
+  if ((image = (uint8_t *) realloc (batch->image, new_size)) == NULL) return (NVFalse);
+
+  batch->image = image;
+  batch->image_size = new_size;
+
+  return (NVTrue);
+}
+
+
+
+/*  Reads a whole image file into the batch buffer.  */
+
+static uint8_t read_image (RECORD_BATCH *batch, FEATURE_RECORD *feature, int32_t fd)
+{
+  size_t              got = 0;
+  int32_t             n;
+
+
+  while (got < feature->image_size)
+    {
+      n = (int32_t) read (fd, batch->image + batch->image_used + got, (uint32_t) (feature->image_size - got));
+
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return (NVFalse);
+
+      got += n;
+    }
+
+  feature->image_offset = batch->image_used;
+  batch->image_used += got;
+
+  return (NVTrue);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        image_load_batch                                    *
+*                                                                           *
+*   Purpose:            Reads the snippet images for a batch of parsed      *
+*                       records into the batch so the BFD writer doesn't    *
+*                       have to read them one at a time when the batch is   *
+*                       committed.  This runs in the parse threads so       *
+*                       several batches' images are read at once.  Within   *
+*                       a batch the images are opened a group at a time     *
+*                       and the kernel is told we'll need all of them so    *
+*                       it can read them concurrently before we copy them.  *
+*                                                                           *
+*                       Each record ends up with image_status set to        *
+*                       IMAGE_LOADED (image_offset/image_size are in the    *
+*                       batch buffer), IMAGE_MISSING (couldn't be opened    *
+*                       or read), IMAGE_DEFERRED (over the batch limit, or  *
+*                       we're out of file descriptors, the writer reads     *
+*                       it), or IMAGE_NONE.                                 *
+*                                                                           *
+*   Inputs:             batch               -   parsed batch                *
+*                                                                           *
+*   Outputs:            none                                                *
+*                                                                           *
+\***************************************************************************/
+
+void image_load_batch (RECORD_BATCH *batch)
+{
+  FEATURE_RECORD      *feature;
+  struct stat         st;
+  int32_t             fd[IMAGE_LOADER_GROUP], member[IMAGE_LOADER_GROUP], count, i, j, first;
+  size_t              total = 0;
+
+
+  batch->image_used = 0;
+
+  for (i = 0 ; i < batch->count ; i++) batch->record[i].image_status = IMAGE_NONE;
+
+
+  for (first = 0 ; first < batch->count ; first = i)
+    {
+      /*  Open the next group and get the kernel started on all of them.  */
+
+      count = 0;
+
+      for (i = first ; i < batch->count && count < IMAGE_LOADER_GROUP ; i++)
+        {
+          feature = &batch->record[i];
+
+          if (!feature->image_name[0]) continue;
+
+#ifdef WIN32
+          if ((fd[count] = open (feature->image_name, O_RDONLY | O_BINARY)) < 0)
+#else
+          if ((fd[count] = open (feature->image_name, O_RDONLY)) < 0)
+#endif
+            {
+              /*  Running out of descriptors (other threads have groups open too) doesn't mean the image
+                  isn't there.  Read what we have open and try this one again in the next group, or if
+                  we don't have anything open leave it to the writer.  */
+
+              if (errno == EMFILE || errno == ENFILE)
+                {
+                  if (count) break;
+
+                  feature->image_status = IMAGE_DEFERRED;
+                  continue;
+                }
+
+              feature->image_status = IMAGE_MISSING;
+              continue;
+            }
+
+          if (fstat (fd[count], &st) < 0 || st.st_size > 0x7fffffff)
+            {
+              feature->image_status = IMAGE_MISSING;
+              close (fd[count]);
+              continue;
+            }
+
+
+          /*  An empty image is just no image.  */
+
+          if (!st.st_size)
+            {
+              close (fd[count]);
+              continue;
+            }
+
+          if (total + (size_t) st.st_size > IMAGE_LOADER_BATCH_BYTES)
+            {
+              feature->image_status = IMAGE_DEFERRED;
+              close (fd[count]);
+              continue;
+            }
+
+          total += (size_t) st.st_size;
+          feature->image_size = (uint32_t) st.st_size;
+
+#if defined (POSIX_FADV_WILLNEED) && !defined (WIN32)
+          posix_fadvise (fd[count], 0, st.st_size, POSIX_FADV_WILLNEED);
+#endif
+
+          member[count++] = i;
+        }
+
+
+      /*  Now copy them in, in record order.  */
+
+      for (j = 0 ; j < count ; j++)
+        {
+          feature = &batch->record[member[j]];
+
+          if (reserve_image_bytes (batch, feature->image_size) && read_image (batch, feature, fd[j]))
+            {
+              feature->image_status = IMAGE_LOADED;
+            }
+          else
+            {
+              feature->image_status = IMAGE_MISSING;
+            }
+
+          close (fd[j]);
+        }
+    }
+}
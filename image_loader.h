@@ -0,0 +1,49 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __IMAGE_LOADER_H__
+#define __IMAGE_LOADER_H__
+
+#include "nvutility.h"
+
+#include "parse_record.h"
+
+
+/*  Most image bytes loaded for one batch.  Images past this are left for the BFD writer to read when the
+    batch is committed so a batch of huge snippets can't eat all of memory (there are up to 2N + 2 batches
+    in flight).  */
+
+#define IMAGE_LOADER_BATCH_BYTES    (16 * 1024 * 1024)
+
+
+/*  Number of image files each parse thread keeps open at once while the kernel reads them ahead.  This
+    is per thread so it has to stay well under the usual 1024 descriptor limit with a lot of threads.  If
+    we run out of descriptors anyway the group is cut short and whatever can't be opened is left for the
+    BFD writer.  */
+
+#define IMAGE_LOADER_GROUP          32
+
+
+void image_load_batch (RECORD_BATCH *batch);
+
+
+#endif
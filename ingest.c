@@ -0,0 +1,1257 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "follow.h"
+#include "ingest.h"
+#include "line_reader.h"
+#include "parse_cache.h"
+#include "pipeline.h"
+
+
+static uint8_t failed (INGEST *ingest)
+{
+  return (ingest->bfd_error || ingest->error || ingest->message[0]);
+}
+
+
+static void system_error (INGEST *ingest, const char *name)
+{
+  ingest->error = errno ? errno : EIO;
+  ingest->error_name = name;
+}
+
+
+/*  An extra output failed.  The sink's error message (path and GDAL message) is what gets printed.  */
+
+static void sink_error (INGEST *ingest, OGR_SINK *sink)
+{
+  ingest->error = EIO;
+  ingest->error_name = sink->error;
+}
+
+
+/*  The spatial index failed, reading the BFD file or (if it set its error) on its own.  */
+
+static void index_error (INGEST *ingest)
+{
+  if (!ingest->index->error)
+    {
+      ingest->bfd_error = NVTrue;
+      return;
+    }
+
+  ingest->error = ingest->index->error;
+  ingest->error_name = (ingest->index->error == ENOMEM) ? "Allocating spatial index memory" : ingest->index->path;
+}
+
+
+/*  A write failed, while ordering or indexing the records or in the BFD library.  */
+
+static void write_error (INGEST *ingest)
+{
+  if (ingest->order != NULL)
+    {
+      system_error (ingest, "Buffering records for spatial ordering");
+    }
+  else if (ingest->index != NULL && ingest->index->error)
+    {
+      index_error (ingest);
+    }
+  else
+    {
+      ingest->bfd_error = NVTrue;
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_open                                         *
+*                                                                           *
+*   Purpose:            Starts an ingest into an open BFD file.  Contact    *
+*                       ID sequence numbers start at records (so they       *
+*                       never collide with IDs already in the file) and     *
+*                       .txt and .csv records get the time of this call as  *
+*                       their event time.                                   *
+*                                                                           *
+*   Inputs:             bfd_handle          -   open BFD file handle        *
+*                       bfd_name            -   BFD file name (needed to    *
+*                                               publish records and for     *
+*                                               checkpoints), or NULL       *
+*                       records             -   number of records already   *
+*                                               in the BFD file             *
+*                       batch_size          -   records staged per BFD      *
+*                                               write (0 for the default)   *
+*                                                                           *
+*   Outputs:            INGEST *            -   ingest context or NULL if   *
+*                                               we ran out of memory        *
+*                                                                           *
+\***************************************************************************/
+
+INGEST *ingest_open (int32_t bfd_handle, const char *bfd_name, uint32_t records, int32_t batch_size)
+{
+  INGEST              *ingest;
+
+
+  if ((ingest = (INGEST *) calloc (1, sizeof (INGEST))) == NULL) return (NULL);
+
+  if ((ingest->writer = bfd_writer_open (bfd_handle, batch_size, 0)) == NULL)
+    {
+      free (ingest);
+      return (NULL);
+    }
+
+  ingest->bfd_handle = bfd_handle;
+
+  if (bfd_name != NULL && bfd_name[0])
+    {
+      strncpy (ingest->bfd_name, bfd_name, sizeof (ingest->bfd_name) - 1);
+      checkpoint_name (ingest->bfd_name, ingest->journal);
+    }
+
+  contact_id_init (&ingest->ids, time (NULL), records);
+  ingest->next_record = records;
+  ingest->batch.load_images = NVTrue;
+
+  return (ingest);
+}
+
+
+
+/*  Turns on duplicate checking (see dedupe.c).  If load_existing is set the features already in the BFD
+    file (only those numbered below records, unless it's 0) are indexed first.  Returns the number of
+    existing features indexed or -1 on error.  */
+
+int32_t ingest_dedupe (INGEST *ingest, double meters, uint8_t flag, uint8_t load_existing, uint32_t records)
+{
+  int32_t             existing = 0;
+
+
+  if ((ingest->dedupe = dedupe_open (meters)) == NULL)
+    {
+      system_error (ingest, "Allocating duplicate index memory");
+      return (-1);
+    }
+
+  ingest->dedupe_flag = flag;
+
+  if (load_existing && (existing = dedupe_load_bfd (ingest->dedupe, ingest->bfd_handle, records)) < 0)
+    {
+      ingest->bfd_error = NVTrue;
+      return (-1);
+    }
+
+  return (existing);
+}
+
+
+
+/*  Turns on space filling curve ordering (see spatial_order.c).  Records are buffered (and spilled to disk past
+    memory bytes) and only written, in curve order, by ingest_close.  Nothing is durable before that so
+    commit points are turned off.  Duplicates shouldn't be flagged (their descriptions would have the record
+    numbers the features would have had in input order).  Needs the BFD file name (spilled runs go next to it).
+    Returns 0, or -1 on error.  */
+
+int32_t ingest_spatial_order (INGEST *ingest, int32_t curve, size_t memory)
+{
+  if (!ingest->bfd_name[0] || (curve != SPATIAL_ORDER_HILBERT && curve != SPATIAL_ORDER_MORTON))
+    {
+      errno = EINVAL;
+      system_error (ingest, "Spatial ordering");
+      return (-1);
+    }
+
+  if ((ingest->order = spatial_order_open (curve, memory, ingest->bfd_name)) == NULL)
+    {
+      system_error (ingest, "Allocating spatial ordering memory");
+      return (-1);
+    }
+
+  ingest->checkpoint_records = 0;
+
+  return (0);
+}
+
+
+
+/*  Turns on the spatial index (see spatial_index.c).  Every record staged for the BFD file is added to a new
+    segment that ingest_close appends to BFD_FILE.bfx.  records is the number of records in the BFD file now.  Any
+    of them that the index doesn't have (appended without an index, or written by a run that died before it got
+    to update the index) are read back and indexed first.  Needs the BFD file name.  Returns the number of those
+    records, or -1 on error.  */
+
+int32_t ingest_index (INGEST *ingest, uint32_t records)
+{
+  int32_t             loaded;
+
+
+  if (!ingest->bfd_name[0])
+    {
+      errno = EINVAL;
+      system_error (ingest, "Indexing the BFD file");
+      return (-1);
+    }
+
+  if ((ingest->index = spatial_index_writer_open (ingest->bfd_name, records)) == NULL)
+    {
+      system_error (ingest, "Allocating spatial index memory");
+      return (-1);
+    }
+
+  if ((loaded = spatial_index_load_bfd (ingest->index, ingest->bfd_handle, records)) < 0)
+    {
+      index_error (ingest);
+      return (-1);
+    }
+
+  return (loaded);
+}
+
+
+
+/*  Adds an OGR output (see ogr_sink.c, the format comes from the extension of path) that gets a copy of every
+    feature written to the BFD file, in the order they're committed (so not in spatial order, if that's on).  Each
+    output is written by its own thread.  Returns 0, or -1 on error.  */
+
+int32_t ingest_also (INGEST *ingest, const char *path)
+{
+  OGR_SINK            *sink;
+
+
+  if (ingest->sinks == OGR_SINK_MAX)
+    {
+      errno = EINVAL;
+      system_error (ingest, "Adding an extra output");
+      return (-1);
+    }
+
+  if ((sink = ogr_sink_open (path)) == NULL)
+    {
+      system_error (ingest, "Allocating extra output memory");
+      return (-1);
+    }
+
+  ingest->sink[ingest->sinks++] = sink;
+
+  if (sink->error[0])
+    {
+      sink_error (ingest, sink);
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_resume                                       *
+*                                                                           *
+*   Purpose:            Checks the checkpoint journal a run that died left  *
+*                       behind.  When resuming, the ingest picks up at the  *
+*                       journal's last commit point (contact IDs, counts,   *
+*                       and the records after it that are already in the    *
+*                       BFD file, see ingest_commit_batch).  Otherwise a    *
+*                       journal for a file we're appending to means just    *
+*                       appending would load some of the input twice so     *
+*                       it's an error, and one for a new file is removed.   *
+*                                                                           *
+*   Inputs:             ingest              -   ingest context              *
+*                       resume              -   pick up where the journal   *
+*                                               says the last run got to    *
+*                       appending           -   the BFD file already        *
+*                                               existed                     *
+*                       records             -   number of records in it     *
+*                       files               -   number of input files       *
+*                                                                           *
+*   Outputs:            int32_t             -   index of the input file to  *
+*                                               start with, or -1 on error  *
+*                                               (see ingest_perror)         *
+*                                                                           *
+\***************************************************************************/
+
+int32_t ingest_resume (INGEST *ingest, uint8_t resume, uint8_t appending, uint32_t records, int32_t files)
+{
+  struct stat         st;
+
+
+  if (failed (ingest)) return (-1);
+
+  if (!resume)
+    {
+      if (stat (ingest->journal, &st) == 0)
+        {
+          if (appending)
+            {
+              snprintf (ingest->message, sizeof (ingest->message), "Found checkpoint journal %s, a previous run into %s "
+                        "didn't finish.\nUse --resume to finish it or remove the journal to append anyway.",
+                        ingest->journal, ingest->bfd_name);
+              return (-1);
+            }
+
+          remove (ingest->journal);
+        }
+
+      return (0);
+    }
+
+  if (checkpoint_read (ingest->journal, &ingest->resume) < 0)
+    {
+      snprintf (ingest->message, sizeof (ingest->message), "Unable to read checkpoint journal %s, nothing to resume.",
+                ingest->journal);
+      return (-1);
+    }
+
+  if (!appending || records < ingest->resume.records || ingest->resume.file_index >= files)
+    {
+      snprintf (ingest->message, sizeof (ingest->message),
+                "Checkpoint journal %s doesn't match %s and the input files, unable to resume.", ingest->journal,
+                ingest->bfd_name);
+      return (-1);
+    }
+
+  ingest->resuming = NVTrue;
+  ingest->checkpoint = ingest->resume;
+  ingest->count = ingest->resume.count;
+  ingest->skip = records - ingest->resume.records;
+
+  contact_id_init (&ingest->ids, time (NULL), ingest->resume.sequence);
+  ingest->next_record = ingest->resume.records;
+
+  return (ingest->resume.file_index);
+}
+
+
+
+/*  Turns on tolerant parsing (see PARSE_OPTIONS, ingest->parse is what the parse threads should be given) and
+    writes the rejected lines to reject_name, one per line, as tab separated input file name, line number, byte
+    offset, reason, and the line itself.  When resuming (call ingest_resume first) whatever was rejected after
+    the commit point is dropped from the reject file (those lines are parsed again) and the counts pick up where
+    it left off.  Otherwise a new reject file is started.  Returns 0, or -1 on error.  */
+
+int32_t ingest_tolerant (INGEST *ingest, const char *reject_name)
+{
+  int32_t             i;
+
+
+  strncpy (ingest->reject_name, reject_name, sizeof (ingest->reject_name) - 1);
+
+  if (ingest->resuming)
+    {
+      if (checkpoint_truncate_file (ingest->reject_name, ingest->resume.reject_size) < 0 && errno != ENOENT)
+        {
+          system_error (ingest, ingest->reject_name);
+          return (-1);
+        }
+
+      for (i = 1 ; i < REJECT_REASONS ; i++)
+        {
+          ingest->rejected[i] = ingest->resume.rejected[i];
+          ingest->rejects += ingest->resume.rejected[i];
+        }
+    }
+
+  if ((ingest->reject_fp = fopen (ingest->reject_name, ingest->resuming ? "a" : "w")) == NULL)
+    {
+      system_error (ingest, ingest->reject_name);
+      return (-1);
+    }
+
+  if (!ftell (ingest->reject_fp)) fprintf (ingest->reject_fp, "#input\tline\tbyte_offset\treason\ttext\n");
+
+  ingest->parse.tolerant = NVTrue;
+
+  return (0);
+}
+
+
+
+/*  Starts a new input (for the reject file).  lines is the number of lines of it that have already been loaded
+    (when resuming part way through it).  */
+
+void ingest_input (INGEST *ingest, const char *name, uint64_t lines)
+{
+  strncpy (ingest->reject_input, name, sizeof (ingest->reject_input) - 1);
+  ingest->input_lines = lines;
+}
+
+
+
+/*  Writes a batch's rejected lines to the reject file.  */
+
+static int32_t write_rejects (INGEST *ingest, RECORD_BATCH *batch)
+{
+  PARSE_REJECT        *reject;
+  uint64_t            chunk_start = batch->input_offset - batch->chunk_size;
+  int32_t             i;
+
+
+  for (i = 0 ; i < batch->rejects ; i++)
+    {
+      reject = &batch->reject[i];
+
+      ingest->rejected[reject->reason]++;
+      ingest->rejects++;
+
+      if (ingest->reject_fp != NULL &&
+          fprintf (ingest->reject_fp, "%s\t%llu\t%llu\t%s\t%.*s\n", ingest->reject_input,
+                   (unsigned long long) (ingest->input_lines + reject->line),
+                   (unsigned long long) (chunk_start + reject->offset), reject_reason_name (reject->reason),
+                   (int32_t) reject->length, batch->reject_text + reject->text) < 0)
+        {
+          system_error (ingest, ingest->reject_name);
+          return (-1);
+        }
+    }
+
+  return (0);
+}
+
+
+
+/*  The BFD library only writes its header when the file is closed so, to make the records written so far
+    visible to anyone else reading the file, we flush, close, and reopen it (syncing it to disk in between
+    if sync is set).  That's only worth it at a checkpoint and when follow mode publishes, everywhere else
+    just flush the writer.  Without a file name all we can do is flush.  Returns the number of records in
+    the file or -1 on error.  */
+
+static int64_t reopen_bfd (INGEST *ingest, uint8_t sync)
+{
+  BFDATA_HEADER       bfd_header;
+
+
+  if (bfd_writer_flush (ingest->writer) < 0)
+    {
+      write_error (ingest);
+      return (-1);
+    }
+
+  if (!ingest->bfd_name[0]) return ((int64_t) ingest->next_record);
+
+  binaryFeatureData_close_file (ingest->bfd_handle);
+  ingest->bfd_handle = -1;
+
+  if (sync && checkpoint_sync_bfd (ingest->bfd_name) < 0)
+    {
+      system_error (ingest, ingest->bfd_name);
+      return (-1);
+    }
+
+  if ((ingest->bfd_handle = binaryFeatureData_open_file (ingest->bfd_name, &bfd_header, BFDATA_UPDATE)) < 0)
+    {
+      ingest->bfd_error = NVTrue;
+      return (-1);
+    }
+
+  ingest->writer->bfd_handle = ingest->bfd_handle;
+  ingest->unpublished = 0;
+
+  return ((int64_t) bfd_header.number_of_records);
+}
+
+
+
+/*  Records how far we've gotten in the checkpoint journal.  Everything up to offset in the current input
+    must already be durable in the BFD file.  The reject file (if any) is made durable here.  */
+
+int32_t ingest_journal (INGEST *ingest, uint64_t offset, uint32_t records)
+{
+  int32_t             i;
+
+
+  ingest->checkpoint.offset = offset;
+  ingest->checkpoint.records = records;
+  ingest->checkpoint.sequence = ingest->ids.next;
+  ingest->checkpoint.count = ingest->count;
+  ingest->checkpoint.lines = ingest->input_lines;
+
+  for (i = 1 ; i < REJECT_REASONS ; i++) ingest->checkpoint.rejected[i] = ingest->rejected[i];
+
+  if (ingest->reject_fp != NULL)
+    {
+      if (fflush (ingest->reject_fp) || checkpoint_sync_file (ingest->reject_name) < 0)
+        {
+          system_error (ingest, ingest->reject_name);
+          return (-1);
+        }
+
+      ingest->checkpoint.reject_size = (int64_t) ftell (ingest->reject_fp);
+    }
+
+  if (checkpoint_write (ingest->journal, &ingest->checkpoint) < 0)
+    {
+      system_error (ingest, ingest->journal);
+      return (-1);
+    }
+
+  ingest->since_checkpoint = 0;
+
+  return (0);
+}
+
+
+
+/*  Durable commit point.  Everything is synced to disk and then the journal is moved up to offset.  */
+
+int32_t ingest_checkpoint (INGEST *ingest, uint64_t offset)
+{
+  int64_t             records;
+
+
+  if (failed (ingest) || (records = reopen_bfd (ingest, NVTrue)) < 0) return (-1);
+
+  return (ingest_journal (ingest, offset, (uint32_t) records));
+}
+
+
+
+/*  Follow mode publish callback.  New records just have to be visible to the display within the latency
+    bound, they only get synced at the normal commit points.  Returns -1 if the ingest has failed.  */
+
+int32_t ingest_publish (void *data)
+{
+  INGEST              *ingest = (INGEST *) data;
+
+
+  if (ingest->unpublished && !failed (ingest)) reopen_bfd (ingest, NVFalse);
+
+  return (failed (ingest) ? -1 : 0);
+}
+
+
+
+/*  Stages a record for the BFD file, or buffers it if we're ordering the output.  The spatial index gets
+    records as they're staged for the BFD file since that's when their record numbers are settled.  */
+
+static int32_t stage (INGEST *ingest, BFDATA_RECORD *record, const char *image_name)
+{
+  if (ingest->order != NULL) return (spatial_order_add (ingest->order, record, NULL, 0, image_name));
+
+  if (ingest->index != NULL && spatial_index_add (ingest->index, record->latitude, record->longitude) < 0) return (-1);
+
+  return (bfd_writer_add (ingest->writer, record, image_name));
+}
+
+
+static int32_t stage_image (INGEST *ingest, BFDATA_RECORD *record, const uint8_t *image, size_t size)
+{
+  if (ingest->order != NULL) return (spatial_order_add (ingest->order, record, image, (uint32_t) size, NULL));
+
+  if (ingest->index != NULL && spatial_index_add (ingest->index, record->latitude, record->longitude) < 0) return (-1);
+
+  return (bfd_writer_add_image (ingest->writer, record, image, size));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_commit_batch                                 *
+*                                                                           *
+*   Purpose:            Commits a batch of parsed records to the BFD file   *
+*                       in order.  This is the pipeline commit function     *
+*                       (data is the INGEST).                               *
+*                                                                           *
+*   Inputs:             batch               -   parsed records              *
+*                       data                -   INGEST context              *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error (see      *
+*                                               ingest_perror)              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t ingest_commit_batch (RECORD_BATCH *batch, void *data)
+{
+  INGEST              *ingest = (INGEST *) data;
+  FEATURE_RECORD      *feature;
+  int32_t             i, j;
+  uint32_t            sequence, match;
+  int32_t             status;
+
+
+  if (failed (ingest)) return (-1);
+
+  if (batch->error)
+    {
+      errno = batch->error;
+      system_error (ingest, "Parsing input");
+      return (-1);
+    }
+
+
+  /*  Rejected lines are written (in input order) before the batch's records.  The line numbers of the next
+      batch start after all of this batch's lines.  */
+
+  if (batch->rejects && write_rejects (ingest, batch) < 0) return (-1);
+
+  ingest->input_lines += batch->lines;
+
+
+  /*  One reservation covers the whole batch.  */
+
+  sequence = contact_id_reserve (&ingest->ids, batch->count);
+
+  for (i = 0 ; i < batch->count ; i++)
+    {
+      feature = &batch->record[i];
+
+      contact_id_format (feature->contact_id, feature->year, feature->day, feature->hour, feature->minute,
+                         feature->second, sequence + i);
+
+      /*  Check for a feature at (nearly) the same spot.  New features go into the index too so the same
+          contact showing up twice in one run is caught as well.  */
+
+      if (ingest->dedupe != NULL)
+        {
+          if (dedupe_find (ingest->dedupe, feature->bfd_record.latitude, feature->bfd_record.longitude, &match))
+            {
+              ingest->duplicates++;
+
+              if (!ingest->dedupe_flag) continue;
+
+              snprintf (feature->bfd_record.description, sizeof (feature->bfd_record.description),
+                        "%s %u", DEDUPE_FLAG_DESCRIPTION, match);
+            }
+          else if (dedupe_add (ingest->dedupe, feature->bfd_record.latitude, feature->bfd_record.longitude,
+                               ingest->next_record) < 0)
+            {
+              system_error (ingest, "Allocating duplicate index memory");
+              return (-1);
+            }
+        }
+
+      ingest->count++;
+      ingest->next_record++;
+
+
+      /*  When resuming, the run that died may have written some records after its last commit point.  They're
+          the first ones we get to so they're already in the BFD file, just don't write them again.  */
+
+      if (ingest->skip)
+        {
+          ingest->skip--;
+          continue;
+        }
+
+      ingest->since_checkpoint++;
+      ingest->unpublished++;
+
+
+      /*  Images were loaded by the parse threads.  A missing image is reported here (in input order) and
+          the record is written without it.  */
+
+      switch (feature->image_status)
+        {
+        case IMAGE_LOADED:
+          status = stage_image (ingest, &feature->bfd_record, batch->image + feature->image_offset, feature->image_size);
+          break;
+
+        case IMAGE_MISSING:
+          if (ingest->report_missing && ingest->images_missing < INGEST_MISSING_REPORTS)
+            {
+              fprintf (stderr, "Unable to read image %s, record written without it\n", feature->image_name);
+              fflush (stderr);
+            }
+          ingest->images_missing++;
+          status = stage (ingest, &feature->bfd_record, NULL);
+          break;
+
+        default:
+          status = stage (ingest, &feature->bfd_record, feature->image_name);
+          break;
+        }
+
+      if (status < 0)
+        {
+          write_error (ingest);
+          return (-1);
+        }
+
+
+      /*  The extra outputs get the same feature (their threads do the writing).  */
+
+      for (j = 0 ; j < ingest->sinks ; j++)
+        {
+          if (ogr_sink_add (ingest->sink[j], &feature->bfd_record, feature->contact_id) < 0)
+            {
+              sink_error (ingest, ingest->sink[j]);
+              return (-1);
+            }
+        }
+    }
+
+
+  if (ingest->checkpoint_records && ingest->since_checkpoint >= ingest->checkpoint_records)
+    return (ingest_checkpoint (ingest, batch->input_offset));
+
+  return (0);
+}
+
+
+
+/*  Parses complete lines of text and commits them, INGEST_CHUNK_SIZE (or one line, if it's longer than
+    that) at a time.  */
+
+static void parse_text (INGEST *ingest, int32_t format, const char *text, size_t len)
+{
+  const char          *nl;
+  size_t              size;
+
+
+  while (len && !failed (ingest))
+    {
+      size = len;
+
+      if (size > INGEST_CHUNK_SIZE)
+        {
+          for (size = INGEST_CHUNK_SIZE ; size && text[size - 1] != '\n' ; size--);
+
+          if (!size)
+            {
+              nl = (const char *) memchr (text + INGEST_CHUNK_SIZE, '\n', len - INGEST_CHUNK_SIZE);
+              size = (nl != NULL) ? (size_t) (nl - text) + 1 : len;
+            }
+        }
+
+      ingest->batch.timed = (ingest->stats != NULL);
+
+      parse_chunk (format, sv_make (text, size), &ingest->ids.run_time, &ingest->parse, &ingest->batch);
+
+      ingest->input_offset += size;
+      ingest->batch.input_offset = ingest->input_offset;
+
+      if (ingest->stats != NULL)
+        {
+          ingest->stats->chunks++;
+          ingest->stats->bytes_read += size;
+        }
+
+      pipeline_commit (&ingest->batch, ingest_commit_batch, ingest, ingest->stats);
+
+      text += size;
+      len -= size;
+    }
+}
+
+
+
+/*  Saves text that doesn't end in a newline until the rest of its line shows up.  */
+
+static int32_t save_pending (INGEST *ingest, const char *text, size_t len)
+{
+  char                *pending;
+  size_t              size;
+
+
+  if (ingest->pending_len + len > ingest->pending_size)
+    {
+      size = ingest->pending_size ? ingest->pending_size : 4096;
+      while (size < ingest->pending_len + len) size *= 2;
+
+      if ((pending = (char *) realloc (ingest->pending, size)) == NULL)
+        {
+          system_error (ingest, "Allocating ingest buffer memory");
+          return (-1);
+        }
+
+      ingest->pending = pending;
+      ingest->pending_size = size;
+    }
+
+  memcpy (ingest->pending + ingest->pending_len, text, len);
+  ingest->pending_len += len;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_buffer                                       *
+*                                                                           *
+*   Purpose:            Parses lines of input text from memory and writes  *
+*                       the records.  The text doesn't have to end on a     *
+*                       line boundary, a partial last line is held until    *
+*                       the rest of it is pushed (or ingest_flush).  The    *
+*                       text can be reused as soon as this returns.         *
+*                                                                           *
+*   Inputs:             ingest              -   ingest context              *
+*                       format              -   INPUT_FORMAT_CSV, _TXT,     *
+*                                               _UNI, or _MAPPED            *
+*                       text                -   input text                  *
+*                       len                 -   length of text              *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error (see      *
+*                                               ingest_perror)              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t ingest_buffer (INGEST *ingest, int32_t format, const char *text, size_t len)
+{
+  const char          *nl;
+  size_t              whole;
+
+
+  if (failed (ingest)) return (-1);
+
+  ingest->pending_format = format;
+
+
+  /*  Finish the partial line we're holding.  */
+
+  if (ingest->pending_len)
+    {
+      if ((nl = (const char *) memchr (text, '\n', len)) == NULL) return (save_pending (ingest, text, len));
+
+      whole = (size_t) (nl - text) + 1;
+
+      if (save_pending (ingest, text, whole) < 0) return (-1);
+
+      parse_text (ingest, format, ingest->pending, ingest->pending_len);
+      ingest->pending_len = 0;
+
+      text += whole;
+      len -= whole;
+    }
+
+
+  /*  The complete lines are parsed straight out of the caller's text.  */
+
+  for (whole = len ; whole && text[whole - 1] != '\n' ; whole--);
+
+  parse_text (ingest, format, text, whole);
+
+  if (save_pending (ingest, text + whole, len - whole) < 0) return (-1);
+
+  return (failed (ingest) ? -1 : 0);
+}
+
+
+
+/*  Writes records that were parsed (or built) by the caller.  Only the BFD record (with its confidence level
+    and analyst activity set), the time fields the contact ID is built from, and the image name (read from
+    the file, if not empty) are used.  Returns 0, or -1 on error.  */
+
+int32_t ingest_records (INGEST *ingest, FEATURE_RECORD *record, int32_t count)
+{
+  RECORD_BATCH        batch;
+  int32_t             i;
+
+
+  if (failed (ingest)) return (-1);
+
+  memset (&batch, 0, sizeof (RECORD_BATCH));
+
+  batch.record = record;
+  batch.count = count;
+  batch.input_offset = ingest->input_offset;
+
+  for (i = 0 ; i < count ; i++) record[i].image_status = IMAGE_NONE;
+
+  pipeline_commit (&batch, ingest_commit_batch, ingest, ingest->stats);
+
+  return (failed (ingest) ? -1 : 0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_file                                         *
+*                                                                           *
+*   Purpose:            Reads, parses, and writes one input file.  Files    *
+*                       are mapped (standard input, FIFOs, and compressed   *
+*                       files are streamed) and parsed by threads parse     *
+*                       threads (see pipeline_run), or loaded from the      *
+*                       parse cache if parse_cache is set.  A resumed file  *
+*                       picks up right after its last committed line and    *
+*                       has to be the file the run that died was reading.   *
+*                       With checkpoints on, everything from the earlier    *
+*                       files is made durable before the journal moves on   *
+*                       to this one.  A followed file is read as it grows   *
+*                       until follow_stop is called.                        *
+*                                                                           *
+*   Inputs:             ingest              -   ingest context              *
+*                       name                -   fully qualified input file  *
+*                                               name ("-" for standard      *
+*                                               input)                      *
+*                       format              -   input format                *
+*                       index               -   index of the file in the    *
+*                                               input list (for the         *
+*                                               checkpoint journal)         *
+*                       follow_ms           -   publish latency to follow   *
+*                                               the file, or 0 to just      *
+*                                               read it                     *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 if the file        *
+*                                               couldn't be read (errno is  *
+*                                               set, the ingest can go on   *
+*                                               with the next file) or the  *
+*                                               ingest failed (see          *
+*                                               ingest_perror)              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t ingest_file (INGEST *ingest, const char *name, int32_t format, int32_t index, int32_t follow_ms)
+{
+  LINE_READER         reader;
+  PARSE_CACHE_WRITER  cache;
+  struct stat         st;
+  uint64_t            offset = 0;
+  uint8_t             resumed, cacheable;
+  int32_t             status = 0, error;
+
+
+  if (failed (ingest)) return (-1);
+
+  ingest->cached = NVFalse;
+  ingest->cache_error = 0;
+
+  if (!follow_ms && line_reader_open (&reader, name) < 0) return (-1);
+
+  resumed = (ingest->resuming && index == ingest->resume.file_index);
+
+  ingest_input (ingest, name, resumed ? ingest->resume.lines : 0);
+
+
+  /*  A followed file was still growing when the run died so it can only be checked for being long enough.  */
+
+  if (resumed)
+    {
+      offset = ingest->resume.offset;
+
+      if (stat (name, &st) < 0 || strcmp (name, ingest->resume.file) ||
+          (ingest->resume.file_size ? ((int64_t) st.st_size != ingest->resume.file_size ||
+                                       (int64_t) st.st_mtime != ingest->resume.file_mtime) :
+           (uint64_t) st.st_size < offset) || (!follow_ms && line_reader_seek (&reader, offset) < 0))
+        {
+          snprintf (ingest->message, sizeof (ingest->message),
+                    "%s isn't the input file in checkpoint journal %s, unable to resume.", name, ingest->journal);
+          if (!follow_ms) line_reader_close (&reader);
+          return (-1);
+        }
+    }
+  else if (ingest->checkpoint_records)
+    {
+      ingest->checkpoint.file_index = index;
+      strncpy (ingest->checkpoint.file, name, sizeof (ingest->checkpoint.file) - 1);
+      ingest->checkpoint.file_size = ingest->checkpoint.file_mtime = 0;
+
+      if (!follow_ms && (!reader.stream || reader.decompress != NULL) && stat (name, &st) == 0)
+        {
+          ingest->checkpoint.file_size = (int64_t) st.st_size;
+          ingest->checkpoint.file_mtime = (int64_t) st.st_mtime;
+        }
+
+      if (!ingest->files)
+        {
+          ingest_journal (ingest, 0, ingest->next_record);
+        }
+      else
+        {
+          ingest_checkpoint (ingest, 0);
+        }
+
+      if (failed (ingest))
+        {
+          if (!follow_ms) line_reader_close (&reader);
+          return (-1);
+        }
+    }
+
+  ingest->files++;
+
+  if (follow_ms)
+    {
+      status = follow_run (name, offset, format, &ingest->ids.run_time, &ingest->parse, follow_ms, ingest_commit_batch,
+                           ingest_publish, ingest, ingest->stats);
+
+      return (failed (ingest) ? -1 : status);
+    }
+
+
+  /*  A resumed file starts part way through so it's always parsed.  */
+
+  cacheable = (ingest->parse_cache && (!reader.stream || reader.decompress != NULL) && !resumed);
+
+  /*  A cache name that doesn't fit is reported the same as any other cache error, the file is just parsed.  */
+
+  if (cacheable && parse_cache_name (ingest->cache_dir, name, ingest->cache_name, sizeof (ingest->cache_name)) < 0)
+    {
+      ingest->cache_error = errno;
+      cacheable = NVFalse;
+    }
+
+  if (cacheable && parse_cache_load (ingest->cache_name, name, format, &ingest->ids.run_time, &ingest->parse,
+                                     ingest_commit_batch, ingest, ingest->stats))
+    {
+      ingest->cached = NVTrue;
+
+      if (ingest->stats != NULL) ingest->stats->cached_files++;
+    }
+  else if (cacheable && parse_cache_create (&cache, ingest->cache_name, name, format, &ingest->parse,
+                                            ingest_commit_batch, ingest) == 0)
+    {
+      if (pipeline_run (&reader, format, &ingest->ids.run_time, &ingest->parse, ingest->threads, parse_cache_commit,
+                        &cache, ingest->stats) < 0)
+        {
+          system_error (ingest, "Starting the parse threads");
+          parse_cache_finish (&cache, NVFalse);
+        }
+      else if (parse_cache_finish (&cache, !reader.error) < 0)
+        {
+          ingest->cache_error = errno ? errno : EIO;
+        }
+    }
+  else
+    {
+      if (cacheable) ingest->cache_error = errno ? errno : EIO;
+
+      if (pipeline_run (&reader, format, &ingest->ids.run_time, &ingest->parse, ingest->threads, ingest_commit_batch,
+                        ingest, ingest->stats) < 0)
+        system_error (ingest, "Starting the parse threads");
+    }
+
+  if (reader.decompress != NULL && ingest->stats != NULL)
+    {
+      ingest->stats->decompress_ns += reader.decompress->ns;
+      ingest->stats->compressed_bytes += reader.decompress->compressed_bytes;
+    }
+
+  error = reader.error;
+
+  line_reader_close (&reader);
+
+  if (failed (ingest)) return (-1);
+
+  if (error)
+    {
+      errno = error;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/*  Parses any partial last line and writes everything that's staged to the BFD file.  The file isn't
+    reopened so the header (and the record count other readers see) isn't updated until the next checkpoint
+    or until the file is closed.  Returns 0, or -1 on error.  */
+
+int32_t ingest_flush (INGEST *ingest)
+{
+  if (failed (ingest)) return (-1);
+
+  if (ingest->pending_len)
+    {
+      parse_text (ingest, ingest->pending_format, ingest->pending, ingest->pending_len);
+      ingest->pending_len = 0;
+    }
+
+  if (failed (ingest)) return (-1);
+
+  if (bfd_writer_flush (ingest->writer) < 0)
+    {
+      write_error (ingest);
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/*  Spatial ordering output function.  Stages the records, now in curve order, for the BFD file.  */
+
+static int32_t write_ordered (BFDATA_RECORD *record, const uint8_t *image, uint32_t image_size, const char *image_name,
+                              void *data)
+{
+  INGEST              *ingest = (INGEST *) data;
+  int32_t             status;
+
+
+  status = (image != NULL) ? stage_image (ingest, record, image, image_size) : stage (ingest, record, image_name);
+
+  if (status < 0) write_error (ingest);
+
+  return (status);
+}
+
+
+
+/*  Adds a writer's staging and write counts to the stats.  */
+
+static void add_writer_stats (INGEST_STATS *stats, BFD_WRITER *writer)
+{
+  stats->image_ns += writer->image_ns;
+  stats->write_ns += writer->write_ns;
+  stats->images += writer->images;
+  stats->image_bytes += writer->image_bytes;
+  stats->image_fallbacks += writer->image_fallbacks;
+  stats->flushes += writer->flushes;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_close                                        *
+*                                                                           *
+*   Purpose:            Parses any partial last line, writes everything     *
+*                       that's staged, adds the final counts to the stats   *
+*                       (if any), and frees the context.  The BFD file is   *
+*                       left open, even after a failure, so the caller can  *
+*                       close it and get the records that were written      *
+*                       into its header.                                    *
+*                                                                           *
+*   Inputs:             ingest              -   ingest context              *
+*                       bfd_handle          -   returns the BFD file handle *
+*                                               (which is not the one given *
+*                                               to ingest_open if the file  *
+*                                               was reopened), or -1 if a   *
+*                                               reopen failed and the file  *
+*                                               isn't open                  *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error (see      *
+*                                               ingest_perror, before this  *
+*                                               returns)                    *
+*                                                                           *
+\***************************************************************************/
+
+int32_t ingest_close (INGEST *ingest, int32_t *bfd_handle)
+{
+  SPATIAL_ORDER       *order = ingest->order;
+  int32_t             status = 0, i;
+
+
+  if (ingest->pending_len && !failed (ingest)) parse_text (ingest, ingest->pending_format, ingest->pending,
+                                                           ingest->pending_len);
+
+
+  /*  Everything has been buffered, write it out in curve order.  */
+
+  ingest->order = NULL;
+
+  if (order != NULL && !failed (ingest) && spatial_order_finish (order, write_ordered, ingest) < 0 && !failed (ingest))
+    system_error (ingest, "Merging spatially ordered records");
+
+  if (!failed (ingest) && bfd_writer_flush (ingest->writer) < 0) write_error (ingest);
+
+
+  /*  The new records are all in the BFD file, add their segment to the index.  If anything failed the index is
+      left as it was (the next run with an index catches up from the BFD file).  */
+
+  if (ingest->index != NULL && !failed (ingest) && spatial_index_finish (ingest->index) < 0) index_error (ingest);
+
+
+  /*  Finish the extra outputs (this waits for their threads to write everything).  */
+
+  for (i = 0 ; i < ingest->sinks ; i++)
+    {
+      if (ogr_sink_close (ingest->sink[i]) < 0 && !failed (ingest)) sink_error (ingest, ingest->sink[i]);
+    }
+
+  if (failed (ingest))
+    {
+      ingest_perror (ingest);
+      status = -1;
+    }
+
+  if (ingest->stats != NULL)
+    {
+      add_writer_stats (ingest->stats, ingest->writer);
+
+      if (order != NULL)
+        {
+          ingest->stats->sort_ns += order->ns;
+          ingest->stats->sort_runs += order->runs;
+        }
+
+      for (i = 0 ; i < ingest->sinks ; i++)
+        {
+          ingest->stats->sink_ns += ingest->sink[i]->ns;
+          ingest->stats->sink_features += ingest->sink[i]->features;
+          ingest->stats->sink_stalls += ingest->sink[i]->stalls;
+        }
+
+      if (ingest->index != NULL) ingest->stats->index_ns += ingest->index->ns;
+
+      ingest->stats->sinks = ingest->sinks;
+      ingest->stats->records_written += ingest->count;
+      ingest->stats->duplicates += ingest->duplicates;
+      ingest->stats->images_missing += ingest->images_missing;
+    }
+
+  if (ingest->reject_fp != NULL && fclose (ingest->reject_fp) && status >= 0)
+    {
+      system_error (ingest, ingest->reject_name);
+      ingest_perror (ingest);
+      status = -1;
+    }
+
+  *bfd_handle = ingest->bfd_handle;
+
+  for (i = 0 ; i < ingest->sinks ; i++) ogr_sink_free (ingest->sink[i]);
+
+  spatial_order_close (order);
+  spatial_index_writer_close (ingest->index);
+  bfd_writer_close (ingest->writer);
+  dedupe_close (ingest->dedupe);
+  record_batch_free (&ingest->batch);
+  free (ingest->pending);
+  free (ingest);
+
+  return (status);
+}
+
+
+
+/*  Prints what went wrong (on stderr).  */
+
+void ingest_perror (INGEST *ingest)
+{
+  if (ingest->bfd_error)
+    {
+      binaryFeatureData_perror ();
+    }
+  else if (ingest->error)
+    {
+      errno = ingest->error;
+      perror (ingest->error_name);
+    }
+  else if (ingest->message[0])
+    {
+      fprintf (stderr, "\n%s\n\n", ingest->message);
+      fflush (stderr);
+    }
+}
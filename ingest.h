@@ -0,0 +1,143 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __INGEST_H__
+#define __INGEST_H__
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "bfd_writer.h"
+#include "checkpoint.h"
+#include "contact_id.h"
+#include "dedupe.h"
+#include "ogr_sink.h"
+#include "parse_record.h"
+#include "spatial_index.h"
+#include "spatial_order.h"
+#include "stats.h"
+
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+
+/*  Buffered text bigger than this is parsed and committed in pieces (at line boundaries).  */
+
+#define INGEST_CHUNK_SIZE       (1024 * 1024)
+
+
+/*  Number of missing images that get reported one by one (if report_missing is set).  After that we just
+    count them.  */
+
+#define INGEST_MISSING_REPORTS  20
+
+
+/*  An ingest into one open BFD file.  This is everything build_feature does after the input has been
+    parsed (contact IDs, duplicate checks, staged BFD writes, and checkpoints), plus parsing text handed
+    to it in memory.  It isn't thread safe, only one thread at a time should be using it (e.g. the
+    pipeline writer thread).
+
+    After a failure the context stops writing and every call returns -1.  ingest_perror says what went
+    wrong.  The fields below are public so the caller can read the counts and, before any records are
+    pushed, adjust the settings (e.g. checkpoint_records, report_missing, parse.map, threads).  */
+
+typedef struct
+{
+  BFD_WRITER          *writer;
+  CONTACT_ID_ALLOCATOR ids;
+  int32_t             count;              /*  Records written (or skipped when resuming) so far  */
+  DEDUPE_INDEX        *dedupe;            /*  NULL unless ingest_dedupe was called  */
+  SPATIAL_ORDER       *order;             /*  NULL unless ingest_spatial_order was called  */
+  SPATIAL_INDEX_WRITER  *index;           /*  NULL unless ingest_index was called  */
+  OGR_SINK            *sink[OGR_SINK_MAX];  /*  Extra outputs (see ingest_also)  */
+  int32_t             sinks;
+  uint8_t             dedupe_flag;        /*  Flag duplicates instead of dropping them  */
+  uint32_t            next_record;        /*  BFD record number of the next record written  */
+  int32_t             duplicates;
+  int32_t             images_missing;
+  FILE                *reject_fp;         /*  NULL unless ingest_tolerant was called  */
+  char                reject_name[1024];
+  char                reject_input[512];  /*  Input file name for the reject file (see ingest_input)  */
+  uint64_t            input_lines;        /*  Lines of the current input committed so far  */
+  int32_t             rejected[REJECT_REASONS];  /*  Rejected lines by reason  */
+  int32_t             rejects;
+  uint8_t             report_missing;     /*  Print the first INGEST_MISSING_REPORTS missing images  */
+  PARSE_OPTIONS       parse;              /*  Column map and tolerant parsing for the input  */
+  int32_t             threads;            /*  Parse threads for ingest_file (0 parses in the calling thread)  */
+  uint8_t             parse_cache;        /*  Load ingest_file input from (or save it to) the parse cache  */
+  char                cache_dir[512];     /*  Parse cache directory (empty to put the cache next to the input)  */
+  char                cache_name[1024];   /*  Parse cache of the last ingest_file input  */
+  uint8_t             cached;             /*  The last ingest_file input was loaded from its parse cache  */
+  int32_t             cache_error;        /*  errno if its parse cache couldn't be written (0 if it was)  */
+  CHECKPOINT          resume;             /*  The commit point we're resuming from (see ingest_resume)  */
+  uint8_t             resuming;
+  int32_t             files;              /*  Input files given to ingest_file so far  */
+  int32_t             bfd_handle;         /*  Changes when the BFD file is reopened (by name)  */
+  char                bfd_name[512];      /*  Empty if the BFD file can't be reopened  */
+  char                journal[1024];      /*  Checkpoint journal file name  */
+  CHECKPOINT          checkpoint;         /*  The caller sets the input file fields  */
+  int32_t             checkpoint_records; /*  Records between commit points (0 for none)  */
+  int32_t             since_checkpoint;
+  int32_t             unpublished;        /*  Records written since the BFD file was last reopened  */
+  uint32_t            skip;               /*  Records already in the BFD file past the resume point  */
+  RECORD_BATCH        batch;              /*  Records parsed from (or pushed as) memory  */
+  char                *pending;           /*  Text after the last complete line pushed so far  */
+  size_t              pending_len;
+  size_t              pending_size;
+  int32_t             pending_format;
+  uint64_t            input_offset;       /*  Bytes of text parsed so far (the checkpoint offset)  */
+  INGEST_STATS        *stats;             /*  Counters to update (NULL for none)  */
+  uint8_t             bfd_error;          /*  A BFD library call failed (see binaryFeatureData_perror)  */
+  int32_t             error;              /*  errno of a failed system call  */
+  const char          *error_name;        /*  What it failed on  */
+  char                message[2048];      /*  What went wrong when it wasn't a system call  */
+} INGEST;
+
+
+INGEST *ingest_open (int32_t bfd_handle, const char *bfd_name, uint32_t records, int32_t batch_size);
+int32_t ingest_dedupe (INGEST *ingest, double meters, uint8_t flag, uint8_t load_existing, uint32_t records);
+int32_t ingest_spatial_order (INGEST *ingest, int32_t curve, size_t memory);
+int32_t ingest_index (INGEST *ingest, uint32_t records);
+int32_t ingest_also (INGEST *ingest, const char *path);
+int32_t ingest_resume (INGEST *ingest, uint8_t resume, uint8_t appending, uint32_t records, int32_t files);
+int32_t ingest_tolerant (INGEST *ingest, const char *reject_name);
+void ingest_input (INGEST *ingest, const char *name, uint64_t lines);
+int32_t ingest_file (INGEST *ingest, const char *name, int32_t format, int32_t index, int32_t follow_ms);
+int32_t ingest_buffer (INGEST *ingest, int32_t format, const char *text, size_t len);
+int32_t ingest_records (INGEST *ingest, FEATURE_RECORD *record, int32_t count);
+int32_t ingest_commit_batch (RECORD_BATCH *batch, void *data);
+int32_t ingest_publish (void *data);
+int32_t ingest_journal (INGEST *ingest, uint64_t offset, uint32_t records);
+int32_t ingest_checkpoint (INGEST *ingest, uint64_t offset);
+int32_t ingest_flush (INGEST *ingest);
+int32_t ingest_close (INGEST *ingest, int32_t *bfd_handle);
+void ingest_perror (INGEST *ingest);
+
+
+#ifdef  __cplusplus
+}
+#endif
+
+
+#endif
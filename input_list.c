@@ -0,0 +1,174 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+    #include <glob.h>
+#endif
+
+#include "input_list.h"
+
+
+static void append_name (INPUT_LIST *list, const char *name)
+{
+  if (list->count == list->size)
+    {
+      list->size = list->size ? list->size * 2 : 64;
+
+      if ((list->name = (char **) realloc (list->name, list->size * sizeof (char *))) == NULL)
+        {
+          perror ("Allocating input file list memory");
+          exit (-1);
+        }
+    }
+
+  if ((list->name[list->count] = strdup (name)) == NULL)
+    {
+      perror ("Allocating input file list memory");
+      exit (-1);
+    }
+
+  list->count++;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        input_list_add                                      *
+*                                                                           *
+*   Purpose:            Adds an input file to the list.  If the name has    *
+*                       wildcards in it (*, ?, or [) it is expanded and     *
+*                       all of the matching files are added in sorted       *
+*                       order.  On Windoze the C runtime has already        *
+*                       expanded the command line for us so we don't try.   *
+*                                                                           *
+*   Inputs:             list                -   input file list             *
+*                       pattern             -   file name or wildcard       *
+*                                                                           *
+*   Outputs:            int32_t             -   number of files added       *
+*                                                                           *
+\***************************************************************************/
+
+int32_t input_list_add (INPUT_LIST *list, const char *pattern)
+{
+#ifndef WIN32
+
+  glob_t              files;
+  size_t              i;
+  int32_t             status;
+
+
+  if (strpbrk (pattern, "*?[") != NULL)
+    {
+      if ((status = glob (pattern, 0, NULL, &files)) == GLOB_NOMATCH)
+        {
+          fprintf (stderr, "No files match %s\n", pattern);
+          fflush (stderr);
+          return (0);
+        }
+
+      if (status)
+        {
+          fprintf (stderr, "Error expanding %s\n", pattern);
+          fflush (stderr);
+          return (0);
+        }
+
+      for (i = 0 ; i < files.gl_pathc ; i++) append_name (list, files.gl_pathv[i]);
+
+      globfree (&files);
+
+      return ((int32_t) i);
+    }
+
+#endif
+
+  append_name (list, pattern);
+
+  return (1);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        input_list_read_manifest                            *
+*                                                                           *
+*   Purpose:            Adds the files named in a manifest file.  One file  *
+*                       name (or wildcard) per line.  Blank lines and       *
+*                       lines starting with # are ignored.                  *
+*                                                                           *
+*   Inputs:             list                -   input file list             *
+*                       manifest            -   manifest file name          *
+*                                                                           *
+*   Outputs:            int32_t             -   number of files added or    *
+*                                               -1 if the manifest couldn't *
+*                                               be opened                   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t input_list_read_manifest (INPUT_LIST *list, const char *manifest)
+{
+  FILE                *fp;
+  char                string[1024], *start, *end;
+  int32_t             count = 0;
+
+
+  if ((fp = fopen (manifest, "r")) == NULL) return (-1);
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      /*  Trim leading and trailing white space (including the newline).  */
+
+      for (start = string ; *start == ' ' || *start == '\t' ; start++);
+
+      end = start + strlen (start);
+      while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+      *end = 0;
+
+      if (!*start || *start == '#') continue;
+
+      count += input_list_add (list, start);
+    }
+
+  fclose (fp);
+
+  return (count);
+}
+
+
+
+void input_list_free (INPUT_LIST *list)
+{
+  int32_t i;
+
+
+  for (i = 0 ; i < list->count ; i++) free (list->name[i]);
+
+  free (list->name);
+
+  memset (list, 0, sizeof (INPUT_LIST));
+}
@@ -0,0 +1,585 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "line_reader.h"
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        line_reader_open                                    *
+*                                                                           *
+*   Purpose:            Maps the input file into memory so that lines can   *
+*                       be handed to the parsers without copying them.      *
+*                       On Windoze we don't have mmap so we just read the   *
+*                       whole file in one shot.  Standard input, pipes,     *
+*                       FIFOs, and the like are set up for streaming.       *
+*                       Compressed files (.gz, .zst) are streamed through   *
+*                       a decompression thread.                             *
+*                                                                           *
+*   Inputs:             reader              -   line reader to initialize   *
+*                       path                -   input file name or "-" for  *
+*                                               standard input              *
+*                                                                           *
+*   Outputs:            int32_t             -   0 on success, -1 on error   *
+*                                               (errno is set)              *
+*                                                                           *
+\***************************************************************************/
+
+int32_t line_reader_open (LINE_READER *reader, const char *path)
+{
+  struct stat         st;
+  int32_t             fd, err, type;
+
+
+  memset (reader, 0, sizeof (LINE_READER));
+
+  if (!strcmp (path, "-"))
+    {
+      fd = 0;
+#ifdef WIN32
+      setmode (fd, O_BINARY);
+#endif
+    }
+  else
+    {
+#ifdef WIN32
+      if ((fd = open (path, O_RDONLY | O_BINARY)) < 0) return (-1);
+#else
+      if ((fd = open (path, O_RDONLY)) < 0) return (-1);
+#endif
+    }
+
+  if (fstat (fd, &st) < 0)
+    {
+      err = errno;
+      if (fd) close (fd);
+      errno = err;
+      return (-1);
+    }
+
+
+  /*  A compressed file is decompressed on its own thread and the text is streamed out of it.  */
+
+  if ((type = decompress_type (path)) != DECOMPRESS_NONE)
+    {
+      if ((reader->decompress = decompress_open (fd, type)) == NULL)
+        {
+          err = errno;
+          close (fd);
+          errno = err;
+          return (-1);
+        }
+
+      reader->data = "";
+      reader->stream = NVTrue;
+      reader->fd = fd;
+      return (0);
+    }
+
+
+  /*  Anything that isn't a regular file can't be mapped (or sized) so we have to read it as it comes.  */
+
+  if (!S_ISREG (st.st_mode))
+    {
+      reader->data = "";
+      reader->stream = NVTrue;
+      reader->fd = fd;
+      return (0);
+    }
+
+
+  /*  Nothing to map in an empty file.  */
+
+  if (!st.st_size)
+    {
+      if (fd) close (fd);
+      reader->data = "";
+      return (0);
+    }
+
+  reader->size = (size_t) st.st_size;
+
+#ifdef WIN32
+
+  {
+    char *buf;
+    size_t got = 0;
+    int32_t n;
+
+    if ((buf = (char *) malloc (reader->size)) == NULL)
+      {
+        if (fd) close (fd);
+        errno = ENOMEM;
+        return (-1);
+      }
+
+    while (got < reader->size && (n = read (fd, buf + got, (uint32_t) (reader->size - got))) > 0) got += n;
+
+    if (!got)
+      {
+        free (buf);
+        if (fd) close (fd);
+        reader->size = 0;
+        reader->data = "";
+        return (0);
+      }
+
+    reader->size = got;
+    reader->data = buf;
+    reader->mapped = NVFalse;
+  }
+
+#else
+
+  {
+    void *map;
+
+    if ((map = mmap (NULL, reader->size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+      {
+        err = errno;
+        if (fd) close (fd);
+        errno = err;
+        return (-1);
+      }
+
+
+    /*  We're going straight through the file so let the kernel read ahead aggressively.  */
+
+    madvise (map, reader->size, MADV_SEQUENTIAL);
+
+    reader->data = (const char *) map;
+    reader->mapped = NVTrue;
+  }
+
+#endif
+
+
+  /*  The mapping (or buffer) doesn't need the descriptor (we leave standard input alone though).  */
+
+  if (fd) close (fd);
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        stream_chunk                                        *
+*                                                                           *
+*   Purpose:            Reads a block of complete lines from a stream.  The *
+*                       block is allocated here and freed by                *
+*                       line_reader_release.  The partial line at the end   *
+*                       of the block is saved and put at the start of the   *
+*                       next block.  A line longer than the block just      *
+*                       makes the block grow until the newline shows up.    *
+*                                                                           *
+*   Inputs:             reader              -   line reader                 *
+*                       size                -   minimum chunk size          *
+*                       chunk               -   returned block of lines     *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse at end of file (or  *
+*                                               on a read error, in which   *
+*                                               case reader->error is set)  *
+*                                                                           *
+\***************************************************************************/
+
+static uint8_t stream_chunk (LINE_READER *reader, size_t size, STRING_VIEW *chunk)
+{
+  char                *block, *new_block;
+  size_t              block_size, used, scan, end, want, i;
+  int32_t             n;
+
+
+  if (reader->eof && !reader->carry_len) return (NVFalse);
+
+  if (!size) size = 1;
+
+  block_size = size + reader->carry_len;
+
+  if ((block = (char *) malloc (block_size)) == NULL)
+    {
+      reader->error = ENOMEM;
+      reader->eof = NVTrue;
+      return (NVFalse);
+    }
+
+  if (reader->carry_len) memcpy (block, reader->carry, reader->carry_len);
+  used = reader->carry_len;
+  reader->carry_len = 0;
+
+
+  /*  Keep reading until we have at least size bytes and a newline to end the block on.  The newline
+      search only ever looks at bytes it hasn't looked at before.  */
+
+  scan = 0;
+  end = 0;
+
+  while (1)
+    {
+      if (used >= size)
+        {
+          for (i = used ; i > scan ; i--)
+            {
+              if (block[i - 1] == '\n')
+                {
+                  end = i;
+                  break;
+                }
+            }
+
+          if (end) break;
+
+          scan = used;
+        }
+
+      if (reader->eof) break;
+
+      if (used == block_size)
+        {
+          if ((new_block = (char *) realloc (block, block_size * 2)) == NULL)
+            {
+              free (block);
+              reader->error = ENOMEM;
+              reader->eof = NVTrue;
+              return (NVFalse);
+            }
+
+          block = new_block;
+          block_size *= 2;
+        }
+
+      want = block_size - used;
+      if (want > 0x40000000) want = 0x40000000;
+
+      if (reader->decompress != NULL)
+        {
+          n = (int32_t) decompress_read (reader->decompress, block + used, want);
+        }
+      else
+        {
+          n = (int32_t) read (reader->fd, block + used, (uint32_t) want);
+        }
+
+      if (n < 0)
+        {
+          if (errno == EINTR) continue;
+
+          reader->error = errno;
+          reader->eof = NVTrue;
+          break;
+        }
+
+      if (!n)
+        {
+          reader->eof = NVTrue;
+          break;
+        }
+
+      used += n;
+    }
+
+
+  if (!used)
+    {
+      free (block);
+      return (NVFalse);
+    }
+
+
+  /*  At end of file the block is whatever is left.  Otherwise save everything after the last newline
+      for the next block.  */
+
+  if (!end) end = used;
+
+  if (end < used)
+    {
+      if (reader->carry_size < used - end)
+        {
+          free (reader->carry);
+          reader->carry_size = used - end;
+
+          if ((reader->carry = (char *) malloc (reader->carry_size)) == NULL)
+            {
+              free (block);
+              reader->carry_size = 0;
+              reader->error = ENOMEM;
+              reader->eof = NVTrue;
+              return (NVFalse);
+            }
+        }
+
+      memcpy (reader->carry, block + end, used - end);
+      reader->carry_len = used - end;
+    }
+
+  chunk->ptr = block;
+  chunk->len = end;
+  reader->offset += end;
+
+  return (NVTrue);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        line_reader_next                                    *
+*                                                                           *
+*   Purpose:            Returns the next line as a view into the input.     *
+*                       The trailing newline is not part of the view.  A    *
+*                       final line without a newline is still returned.     *
+*                                                                           *
+*   Inputs:             reader              -   line reader                 *
+*                       line                -   returned line               *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse at end of file      *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t line_reader_next (LINE_READER *reader, STRING_VIEW *line)
+{
+  const char *start, *nl;
+  size_t left;
+
+
+  /*  Streams are read a block at a time and the lines are handed out of the current block.  */
+
+  if (reader->stream)
+    {
+      while (reader->current_pos >= reader->current.len)
+        {
+          line_reader_release (reader, reader->current);
+          reader->current.ptr = NULL;
+          reader->current.len = 0;
+          reader->current_pos = 0;
+
+          if (!stream_chunk (reader, LINE_READER_STREAM_BLOCK, &reader->current)) return (NVFalse);
+        }
+
+      start = reader->current.ptr + reader->current_pos;
+      left = reader->current.len - reader->current_pos;
+
+      line->ptr = start;
+      if ((nl = (const char *) memchr (start, '\n', left)) == NULL)
+        {
+          line->len = left;
+        }
+      else
+        {
+          line->len = nl - start;
+        }
+      reader->current_pos += line->len + 1;
+
+      reader->line_number++;
+
+      return (NVTrue);
+    }
+
+
+  if (reader->offset >= reader->size) return (NVFalse);
+
+  start = reader->data + reader->offset;
+  left = reader->size - reader->offset;
+
+  if ((nl = (const char *) memchr (start, '\n', left)) == NULL)
+    {
+      line->ptr = start;
+      line->len = left;
+      reader->offset = reader->size;
+    }
+  else
+    {
+      line->ptr = start;
+      line->len = nl - start;
+      reader->offset += line->len + 1;
+    }
+
+  reader->line_number++;
+
+  return (NVTrue);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        line_reader_chunk                                   *
+*                                                                           *
+*   Purpose:            Returns a block of complete lines that is at least  *
+*                       size bytes long (unless we hit the end of the       *
+*                       file).  The block always ends just after a newline  *
+*                       (or at end of file) so no line is ever split.  Pass *
+*                       every chunk to line_reader_release when you're      *
+*                       done with it.                                       *
+*                                                                           *
+*   Inputs:             reader              -   line reader                 *
+*                       size                -   minimum chunk size          *
+*                       chunk               -   returned block of lines     *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse at end of file      *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t line_reader_chunk (LINE_READER *reader, size_t size, STRING_VIEW *chunk)
+{
+  const char *start, *nl;
+  size_t left;
+
+
+  if (reader->stream) return (stream_chunk (reader, size, chunk));
+
+  if (reader->offset >= reader->size) return (NVFalse);
+
+  start = reader->data + reader->offset;
+  left = reader->size - reader->offset;
+
+  if (left <= size || (nl = (const char *) memchr (start + size, '\n', left - size)) == NULL)
+    {
+      chunk->len = left;
+    }
+  else
+    {
+      chunk->len = (nl - start) + 1;
+    }
+
+  chunk->ptr = start;
+  reader->offset += chunk->len;
+
+  return (NVTrue);
+}
+
+
+
+/*  Moves a mapped reader to a byte offset (which must be the start of a line).  Streams can't be
+    repositioned, except that a compressed file that hasn't been read yet can be decompressed up to the
+    offset and the text thrown away.  Returns 0 or -1 (errno is set).  */
+
+int32_t line_reader_seek (LINE_READER *reader, size_t offset)
+{
+  char                skip[65536];
+  size_t              want;
+  int64_t             n;
+
+
+  if (reader->stream)
+    {
+      if (reader->decompress == NULL || reader->offset || reader->carry_len || reader->current.ptr != NULL)
+        {
+          errno = ESPIPE;
+          return (-1);
+        }
+
+      while (reader->offset < offset)
+        {
+          want = offset - reader->offset;
+          if (want > sizeof (skip)) want = sizeof (skip);
+
+          if ((n = decompress_read (reader->decompress, skip, want)) <= 0)
+            {
+              if (!n) errno = EINVAL;
+              return (-1);
+            }
+
+          reader->offset += n;
+        }
+
+      return (0);
+    }
+
+  if (offset > reader->size)
+    {
+      errno = EINVAL;
+      return (-1);
+    }
+
+  reader->offset = offset;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        line_reader_release                                 *
+*                                                                           *
+*   Purpose:            Frees a chunk returned by line_reader_chunk.  This  *
+*                       only does anything for streams since mapped chunks  *
+*                       are just views into the mapping.                    *
+*                                                                           *
+*   Inputs:             reader              -   line reader                 *
+*                       chunk               -   chunk to release            *
+*                                                                           *
+*   Outputs:            None                                                *
+*                                                                           *
+\***************************************************************************/
+
+void line_reader_release (LINE_READER *reader, STRING_VIEW chunk)
+{
+  if (reader->stream && chunk.ptr != NULL) free ((void *) chunk.ptr);
+}
+
+
+
+void line_reader_close (LINE_READER *reader)
+{
+  if (reader->stream)
+    {
+      line_reader_release (reader, reader->current);
+      free (reader->carry);
+
+
+      /*  The decompressor owns the file descriptor.  */
+
+      if (reader->decompress != NULL)
+        {
+          decompress_close (reader->decompress);
+        }
+      else if (reader->fd)
+        {
+          close (reader->fd);
+        }
+    }
+  else if (reader->size)
+    {
+#ifdef WIN32
+      free ((void *) reader->data);
+#else
+      munmap ((void *) reader->data, reader->size);
+#endif
+    }
+
+  memset (reader, 0, sizeof (LINE_READER));
+}
@@ -0,0 +1,73 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __LINE_READER_H__
+#define __LINE_READER_H__
+
+#include "string_view.h"
+#include "decompress.h"
+
+
+/*  Size of the blocks read from a pipe, FIFO, or standard input.  */
+
+#define LINE_READER_STREAM_BLOCK    (1024 * 1024)
+
+
+/*  A regular input file is mapped (or, on Windoze, read in one gulp) and the lines are handed out as
+    string views into that memory.  Lines can be any length and nothing is copied.  The views stay
+    valid until line_reader_close is called.
+
+    Standard input ("-"), FIFOs, and other things that can't be mapped are streamed instead.  Each chunk
+    is read into its own block of memory that stays valid until the chunk is released, so chunks can be
+    handed to other threads just like chunks of a mapped file.  Only the partial line at the end of a
+    block is ever copied (to the start of the next block).  Compressed files (.gz and .zst) are streamed
+    too, the text comes from a decompression thread instead of straight from the file.  */
+
+typedef struct
+{
+  const char          *data;              /*  Start of the mapped input text (mapped mode only)  */
+  size_t              size;               /*  Size of the mapped input text in bytes  */
+  size_t              offset;             /*  Byte offset of the next unread byte  */
+  uint32_t            line_number;        /*  One based number of the last line returned  */
+  uint8_t             mapped;             /*  NVTrue if data is mmapped, NVFalse if allocated  */
+  uint8_t             stream;             /*  NVTrue if we're reading a stream instead  */
+  int32_t             fd;                 /*  Stream file descriptor  */
+  DECOMPRESS          *decompress;        /*  Decompression thread if the input is compressed  */
+  uint8_t             eof;                /*  Stream has hit end of file  */
+  int32_t             error;              /*  errno from a failed stream read (0 if none)  */
+  char                *carry;             /*  Partial line left over from the last stream block  */
+  size_t              carry_len;
+  size_t              carry_size;
+  STRING_VIEW         current;            /*  Stream chunk that line_reader_next is working through  */
+  size_t              current_pos;
+} LINE_READER;
+
+
+int32_t line_reader_open (LINE_READER *reader, const char *path);
+uint8_t line_reader_next (LINE_READER *reader, STRING_VIEW *line);
+uint8_t line_reader_chunk (LINE_READER *reader, size_t size, STRING_VIEW *chunk);
+int32_t line_reader_seek (LINE_READER *reader, size_t offset);
+void line_reader_release (LINE_READER *reader, STRING_VIEW chunk);
+void line_reader_close (LINE_READER *reader);
+
+
+#endif
@@ -43,6 +43,9 @@
     #include <libgen.h>
 #endif
 
+#include <getopt.h>
+#include <signal.h>
+
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -50,199 +53,274 @@
 #include "nvutility.h"
 
 #include "binaryFeatureData.h"
+#include "checkpoint.h"
+#include "column_map.h"
+#include "follow.h"
+#include "ingest.h"
+#include "input_list.h"
+#include "line_reader.h"
+#include "parse_cache.h"
+#include "stats.h"
 #include "version.h"
 
 char newdirname[256];
 
 
-/***************************************************************************\
-*                                                                           *
-*   Module Name:        sget_coord                                          *
-*                                                                           *
-*   Programmer:         Jan C. Depner                                       *
-*                                                                           *
-*   Date Written:       November 2005                                       *
-*                                                                           *
-*   Module Security                                                         *
-*   Classification:     Unclassified                                        *
-*                                                                           *
-*   Data Security                                                           *
-*   Classification:     Unknown                                             *
-*                                                                           *
-*   Purpose:            Gets a pair of geographic coordinates, a remark,    *
-*                       and a depth from a string.                          *
-*                                                                           *
-*   Inputs:             lat_hemi            -   latitude hemisphere         *
-*                                               indicator (S or N)          *
-*                       lat_deg             -   latitude degrees            *
-*                       lat_min             -   latitude minutes            *
-*                       lat_sec             -   latitude seconds            *
-*                       lon_hemi            -   longitude hemisphere        *
-*                                               indicator (S or N)          *
-*                       lon_deg             -   longitude degrees           *
-*                       lon_min             -   longitude minutes           *
-*                       lon_sec             -   longitude seconds           *
-*                                                                           *
-*   Outputs:            uint8_t             -   False if end of file        *
-*                                                                           *
-*   Restrictions:       Geographic positions are entered as a lat, lon pair *
-*                       separated by a comma.  A lat or lon may be in any   *
-*                       of the following formats (degrees, minutes, and     *
-*                       seconds must be separated by a space or tab) :      *
-*                                                                           *
-*                           Degrees decimal                 : S 28.4532     *
-*                           Degrees minutes decimal         : S 28 27.192   *
-*                           Degrees minutes seconds decimal : S 28 27 11.52 *
-*                                                                           *
-*                       Hemisphere may be indicated by letter or by sign.   *
-*                       West longitude and south latitude are negative :    *
-*                                                                           *
-*                           Ex. : -28 27 11.52 = S28 27 11.52 = s 28 27.192 *
-*                                                                           *
-\***************************************************************************/
+/*  Exit status of a run that loaded everything else but rejected some lines (--tolerant).  */
+
+#define REJECTED_LINES_STATUS   2
 
-static char *sget_coord (char *string, char *lat_hemi, int32_t *lat_deg, int32_t *lat_min, float *lat_sec,
-                            char *lon_hemi, int32_t *lon_deg, int32_t *lon_min, float *lon_sec, 
-                            float *depth)
+
+static void usage ()
 {
-  int32_t     j, sign;
-  uint32_t    i;
-  char        lstring[160], lat[30], lon[30], depth_string[30];
-  double      f1, f2, f3, fdeg, fmin, fsec;
-  static char remarks[100];
+  char                remarks[100];
+
+
+  fprintf (stderr, 
+           "Usage: build_feature [-b RECORDS] [-j THREADS] [-m MANIFEST] [--format=txt|uni|csv | --columns=SPEC|@FILE] [--dedupe=METERS [--dedupe-flag]] [--stats=json[:FILE]] [--checkpoint=RECORDS] [--resume] [--follow[=MS]] [--parse-cache[=DIR]] [--spatial-order=hilbert|morton[:MB]] [--tolerant[=FILE]] [--also=FILE[,FILE...]] [--index] <.csv file | .uni file | .txt file | -> ... <bfd feature file>\n\n");
+  fprintf (stderr, "Any number of input files (or quoted wildcards such as \"contacts/*.uni\") may be given.  They\n");
+  fprintf (stderr, "are all loaded into the same BFD file, which is only opened once.  An input file name of - reads\n");
+  fprintf (stderr, "standard input.  Pipes and FIFOs are read as the data arrives so nothing has to be staged on disk.\n");
+  fprintf (stderr, "Compressed input files (.gz or .zst) are decompressed as they're read.  The format comes from the\n");
+  fprintf (stderr, "extension inside the compression extension (e.g. targets.uni.zst is a .uni file).\n\n");
+  fprintf (stderr, "Where:\n\n");
+  fprintf (stderr, "\t-b RECORDS = number of records (and their images) to stage in memory before\n");
+  fprintf (stderr, "\t             writing them to the BFD file (default %d).\n", BFD_WRITER_BATCH_SIZE);
+  fprintf (stderr, "\t-j THREADS = parse the input with THREADS worker threads while a separate\n");
+  fprintf (stderr, "\t             thread writes the records (in input order) to the BFD file.\n");
+  fprintf (stderr, "\t             The output is identical to a normal (single thread) run.\n");
+  fprintf (stderr, "\t             At most %d threads.\n", PIPELINE_MAX_THREADS);
+  fprintf (stderr, "\t-m MANIFEST = also load the input files (or wildcards) listed in MANIFEST,\n");
+  fprintf (stderr, "\t             one per line.  Blank lines and lines starting with # are ignored.\n");
+  fprintf (stderr, "\t--format=txt|uni|csv = treat every input as this format instead of going by\n");
+  fprintf (stderr, "\t             the file name extension.  Required when reading standard input.\n");
+  fprintf (stderr, "\t--columns=SPEC = read every input as comma separated columns laid out the way SPEC\n");
+  fprintf (stderr, "\t             says (see below).  Use --columns=@FILE to read the spec from FILE.\n");
+  fprintf (stderr, "\t--dedupe=METERS = drop any new feature that is within METERS of a feature that\n");
+  fprintf (stderr, "\t             is already in the BFD file (or was added earlier in this run).\n");
+  fprintf (stderr, "\t--dedupe-flag = with --dedupe, keep the duplicates but set their description\n");
+  fprintf (stderr, "\t             to the record number of the feature they duplicate.\n");
+  fprintf (stderr, "\t--stats=json = time each stage of the ingest (reading, parsing, time conversion,\n");
+  fprintf (stderr, "\t             image reading, BFD writes) and print the counters as JSON when done.\n");
+  fprintf (stderr, "\t             Use --stats=json:FILE to write them to FILE instead of standard output.\n");
+  fprintf (stderr, "\t--checkpoint=RECORDS = make the BFD file durable and record how far we've gotten\n");
+  fprintf (stderr, "\t             in BFD_FILE.ckpt every RECORDS records (e.g. 1000000).  Off by default.\n");
+  fprintf (stderr, "\t--resume = continue a run that died, from its last checkpoint.  Give it the same\n");
+  fprintf (stderr, "\t             input files and BFD file as the run that died.\n");
+  fprintf (stderr, "\t--follow[=MS] = after loading it, keep watching the last input file and load lines as\n");
+  fprintf (stderr, "\t             they're appended to it (handling rotation and truncation).  New features\n");
+  fprintf (stderr, "\t             show up in the BFD file within MS milliseconds (default %d).  Stop it\n", FOLLOW_LATENCY_MS);
+  fprintf (stderr, "\t             with Ctrl-C or kill.\n");
+  fprintf (stderr, "\t--parse-cache[=DIR] = save the parsed records of each input file in FILE%s (in DIR\n",
+           PARSE_CACHE_EXTENSION);
+  fprintf (stderr, "\t             if given) and load them from there, without parsing the text, the next\n");
+  fprintf (stderr, "\t             time the same file is loaded.  A cache is rebuilt if its input file changes.\n");
+  fprintf (stderr, "\t--spatial-order=hilbert|morton[:MB] = write the new records in Hilbert or Morton (Z\n");
+  fprintf (stderr, "\t             order) curve order by position so features that are close together are\n");
+  fprintf (stderr, "\t             close together in the BFD file.  Records are buffered in MB megabytes of\n");
+  fprintf (stderr, "\t             memory (default %d) and sorted runs are spilled next to the BFD file past\n",
+           SPATIAL_ORDER_MEMORY);
+  fprintf (stderr, "\t             that.  Can't be used with --checkpoint.\n");
+  fprintf (stderr, "\t--tolerant[=FILE] = check every line and, instead of loading bad lines (too few\n");
+  fprintf (stderr, "\t             fields, missing or out of range positions, impossible DTGs) as they are,\n");
+  fprintf (stderr, "\t             write them to FILE (default BFD_FILE.rej) with their input file, line\n");
+  fprintf (stderr, "\t             number, byte offset, and the reason.  Everything else is loaded.  If any\n");
+  fprintf (stderr, "\t             lines were rejected the exit status is %d.\n", REJECTED_LINES_STATUS);
+  fprintf (stderr, "\t--also=FILE[,FILE...] = write every feature to these GIS files as well (GeoJSON,\n");
+  fprintf (stderr, "\t             Shapefile, GeoPackage, KML, or GML, by the .geojson, .shp, .gpkg, .kml, or\n");
+  fprintf (stderr, "\t             .gml extension) in the same pass.  Each one is written by its own thread.\n");
+  fprintf (stderr, "\t             Existing files are replaced.  Can't be used with --resume.\n");
+  fprintf (stderr, "\t--index = keep a spatial index of the BFD file in BFD_FILE%s, built as the records\n",
+           SPATIAL_INDEX_EXTENSION);
+  fprintf (stderr, "\t             are written, so the features in a box can be found without reading every\n");
+  fprintf (stderr, "\t             record (see bench/bfx_query).  When appending, the new records are added to\n");
+  fprintf (stderr, "\t             the existing index (any records it doesn't have yet are indexed first).\n\n\n");
+
+  fprintf (stderr, "Press 'Enter' to continue:");
+  fflush (stderr);
+  ngets (remarks, sizeof (remarks), stdin);
+
+  fprintf (stderr, "\n\n.csv files must be in the following format:\n\n");
+  fprintf (stderr, "\tDESCRIPTION,REMARKS,SDDD MM SS,SDD MM SS,DEPTH\n\n");
+  fprintf (stderr, "Description and remarks cannot be more than 100 characters\n");
+  fprintf (stderr, "SDDD is longitude, west negative, SDD is latitude, south negative\n\n\n");
+
+  fprintf (stderr, "Press 'Enter' to continue:");
+  fflush (stderr);
+  ngets (remarks, sizeof (remarks), stdin);
 
+  fprintf (stderr, "\n\n.uni files must be in the following format:\n\n");
+  fprintf (stderr, "A one line text header (ignored) that looks like this:\n\n");
+  fprintf (stderr, "unisips file,snippet file,latitude,longitude,row,column,depth,heading,length,width,height,dtg,desc,remarks\n\n");
+  fprintf (stderr, "Followed by comma separated data records in the order indicated by the above header.\n");
+  fprintf (stderr, "The depth field is broken up into three fields - B: xx.x / T: xx.x / A: xx.x where:\n\n");
+  fprintf (stderr, "A is tow fish altitude above bottom, T is tow fish depth, and B is total water depth\n");
+  fprintf (stderr, "A typical record would look something like this:\n\n");
+  fprintf (stderr, "/unisips/k5-henson-2005306-071349-s.u,7976-606.gif,27.114496,32.570417,7975,605,B: 26.3 / T: 8.0 /  A: 18.3,227.7218, 86.04, 13.84, 14.22,11-02-2005  07:25:33.70,wreck lost in nadir\n\n");
+  fprintf (stderr, "The dtg may also be ISO 8601 (e.g. 2005-11-02T07:25:33.70Z or 2005-11-02 01:25:33.70-06:00),\n");
+  fprintf (stderr, "which is converted to UTC.\n\n\n");
 
-  /*  Break the input into a lat and lon string.*/
 
-  strcpy (lstring, string);
+  fprintf (stderr, "Press 'Enter' to continue:");
+  fflush (stderr);
+  ngets (remarks, sizeof (remarks), stdin);
+
+  fprintf (stderr, "\n\n.txt file format contains geographic positions, a description field,\n");
+  fprintf (stderr, "and a depth, separated by commas.  The geographic positions may be in any\n");
+  fprintf (stderr, "of the following formats (degrees, minutes, and seconds must be separated\n");
+  fprintf (stderr, "by a space or tab):\n\n");
+  fprintf (stderr, "\tHemisphere Degrees decimal                 : S 28.4532\n");
+  fprintf (stderr, "\tHemisphere Degrees minutes decimal         : S 28 27.192\n");
+  fprintf (stderr, "\tHemisphere Degrees minutes seconds decimal : S 28 27 11.52\n");
+  fprintf (stderr, "\tSigned Degrees decimal                     : -28.4532\n");
+  fprintf (stderr, "\tSigned Degrees minutes decimal             : -28 27.192\n");
+  fprintf (stderr, "\tSigned Degrees minutes seconds decimal     : -28 27 11.52\n\n");
+  fprintf (stderr, "West longitude and south latitude are negative :\n\n");
+  fprintf (stderr, "\tEx. : -28 27 11.52 = S28 27 11.52 = s 28 27.192\n\n");
+
+  fprintf (stderr, "Description cannot be more than 100 characters\n\n\n");
+
+  fprintf (stderr, "Press 'Enter' to continue:");
+  fflush (stderr);
+  ngets (remarks, sizeof (remarks), stdin);
+
+  fprintf (stderr, "\n\nA --columns spec lists what is in each column, in column order, as field[:unit]\n");
+  fprintf (stderr, "separated by commas (or one or more per line in a spec file, where # starts a comment).\n");
+  fprintf (stderr, "An empty entry (or skip) is a column that isn't used.  The fields and their units (the\n");
+  fprintf (stderr, "first one is the default) are:\n\n");
+  fprintf (stderr, "\tlat, lon                        : deg, dms (any .txt position form), rad\n");
+  fprintf (stderr, "\tdepth, length, width, height    : m, ft, fm\n");
+  fprintf (stderr, "\theading                         : deg, rad\n");
+  fprintf (stderr, "\tremarks, image                  : text\n");
+  fprintf (stderr, "\tdtg                             : mdy (MM-DD-YYYY HH:MM:SS.SS, or ISO 8601 such as\n");
+  fprintf (stderr, "\t                                  2005-11-02T07:25:33.70Z, converted to UTC)\n");
+  fprintf (stderr, "\ttime                            : s (seconds since 1970, UTC)\n\n");
+  fprintf (stderr, "lat and lon are required.  Lines with no digits in the lat column (headers) are skipped.\n");
+  fprintf (stderr, "Records without a dtg or time column get the time of the run.\n\n");
+  fprintf (stderr, "Example: build_feature trg31g.txt pensacola.bfd\n");
+  fprintf (stderr, "         build_feature -m survey_contacts.lst pensacola.bfd\n");
+  fprintf (stderr, "         build_feature archive/contacts.uni.zst pensacola.bfd\n");
+  fprintf (stderr, "         zcat contacts.uni.gz | build_feature --format=uni - pensacola.bfd\n");
+  fprintf (stderr, "         build_feature --columns=skip,lat,lon,depth:ft,remarks vendor.csv pensacola.bfd\n\n\n");
+  fflush (stderr);
+  exit (-1);
+}
 
-  strcpy (lat, strtok (lstring, ","));
-  strcpy (lon, strtok (NULL, ","));
-  strcpy (remarks, strtok (NULL, ","));
-  strcpy (depth_string, strtok (NULL, ","));
 
 
-  /*  Save the depth if it's there.  */
+/*  Strips any leading ./ and prepends the absolute directory to an input file name.  */
 
-  if (!sscanf (depth_string, "%f", depth)) *depth = 0.0;
+static void qualify_input_name (char *name, char *TRGfil)
+{
+  char                string[1024], new_dir[512], old_dir[512];
 
 
-  /*  Handle the latitude (j = 0) and longitude (j = 1) portions of
-      the input string. */
+  /*  Strip off leading ./ if it's there.  MSYS may cause mixed separators on Windoze.  */
 
-  for (j = 0 ; j < 2 ; j++)
+  if (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
     {
-      if (j)
-        {
-          strcpy (lstring, lon);
-        }
-      else
-        {
-          strcpy (lstring, lat);
-        }
+      strcpy (TRGfil, &name[2]);
+    }
+  else
+    {
+      strcpy (TRGfil, name);
+    }
 
-      sign = 0;
 
+  /*  Get the fully qualified input file name.  */
 
-      /*  Check for and clear sign or hemisphere indicators.*/
+#ifdef WIN32
 
-      for (i = 0 ; i < strlen (lstring) ; i++)
-        {
-          if (j)
-            {
-              if (lstring[i] == 'W' || lstring[i] == 'w' || lstring[i] == '-')
-                {
-                  lstring[i] = ' ';
-                  sign = 1;
-                }
-            }
-          else
-            {
-              if (lstring[i] == 'S' || lstring[i] == 's' || lstring[i] == '-')
-                {
-                  lstring[i] = ' ';
-                  sign = 1;
-                }
-            }
+  if (_getcwd (old_dir, sizeof (old_dir)) == NULL)
+    {
+      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
-          if (lstring[i] == 'n' || lstring[i] == 'N' || lstring[i] == 'e' ||
-              lstring[i] == 'E' || lstring[i] == '+') lstring[i] = ' ';
-        }
-    
-      fdeg = 0.0;
-      fmin = 0.0;
-      fsec = 0.0;
-      f1 = 0.0;
-      f2 = 0.0;
-      f3 = 0.0;
+  if (_chdir (gen_dirname (name)) == -1)
+    {
+      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
+  if (_getcwd (new_dir, sizeof (new_dir)) == NULL)
+    {
+      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
-      /*  Convert the string to degrees, minutes, and seconds.*/
-        
-      i = sscanf (lstring, "%lf %lf %lf", &f1, &f2, &f3);
+  sprintf (string, "%s\\%s", new_dir, gen_basename(TRGfil));
+  strcpy (TRGfil, string);
 
+  if (_chdir (old_dir) == -1)
+    {
+      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
-      /*  Based on the number of values scanned, compute the total
-          degrees.*/
-        
-      switch (i)
-        {
-        case 3:
-          fsec = f3 / 3600.0;
-#ifdef NVLinux
-          __attribute__ ((fallthrough));
-#endif
+#else 
 
-        case 2:
-          fmin = f2 / 60.0;
-#ifdef NVLinux
-          __attribute__ ((fallthrough));
-#endif
+  if (getcwd (old_dir, sizeof (old_dir)) == NULL)
+    {
+      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
-        case 1:
-          fdeg = f1;
-        }
+  if (chdir (gen_dirname (name)) == -1)
+    {
+      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
-      fdeg += fmin + fsec;
+  if (getcwd (new_dir, sizeof (new_dir)) == NULL)
+    {
+      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
+    }
 
+  if (!strcmp (new_dir, "/")) new_dir[0] = 0;
 
-      /*  Get the sign and load the lat or lon values.*/
-        
-      if (j)
-        {
-          if (sign)
-            {
-              *lon_hemi = 'W';
-            }
-          else
-            {
-              *lon_hemi = 'E';
-            }
+  sprintf (string, "%s/%s", new_dir, gen_basename (TRGfil));
+  strcpy (TRGfil, string);
 
-          *lon_deg = (int32_t) fdeg;
-          fmin = (fdeg - *lon_deg) * 60.0;
-          *lon_min = (int32_t) (fmin + 0.00001);
-          *lon_sec = (fmin - *lon_min) * 60.0 + 0.00001;
-        }
-      else
-        {
-          if (sign)
-            {
-              *lat_hemi = 'S';
-            }
-          else
-            {
-              *lat_hemi = 'N';
-            }
-            
-          *lat_deg = (int32_t) fdeg;
-          fmin = (fdeg - *lat_deg) * 60.0;
-          *lat_min = (int32_t) (fmin + 0.00001);
-          *lat_sec = (fmin - *lat_min) * 60.0 + 0.00001;
-        }
+  if (chdir (old_dir) == -1)
+    {
+      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
+      fflush (stderr);
     }
 
-  return (remarks);
+#endif
+}
+
+
+
+/*  SIGINT/SIGTERM handler for --follow.  A second signal kills us the normal way in case the shutdown hangs.  */
+
+static void stop_following (int32_t sig)
+{
+  signal (sig, SIG_DFL);
+
+  follow_stop ();
+}
+
+
+
+/*  Reports a failed ingest and quits.  The BFD file is still closed so that the records that did get written
+    make it into its header.  */
+
+static void check_ingest (INGEST *ingest)
+{
+  int32_t             bfd_handle;
+
+
+  if (ingest->bfd_error || ingest->error || ingest->message[0])
+    {
+      ingest_close (ingest, &bfd_handle);
+
+      if (bfd_handle >= 0) binaryFeatureData_close_file (bfd_handle);
+
+      exit (-1);
+    }
 }
 
 
@@ -268,17 +346,40 @@ static char *sget_coord (char *string, char *lat_hemi, int32_t *lat_deg, int32_t
 
 int32_t main (int32_t argn, char **argv)
 {
-  char                TRGfil[512], bfd_name[512], image_name[512], string[1024], new_dir[512], old_dir[512],
-                      lat_hemi = ' ', lon_hemi, contact_id[60], remarks[100], desc[100], dtg[24], cut[512],
-                      fname[512];
-  int32_t             year, day, hour, minute, month, mday, count = 0, check, latdeg, latmin, latsec,
-                      londeg, lonmin, lonsec, row, col, bfd_handle;
-  uint32_t            i;
-  float               second, flatsec = 0.0, flonsec, depth;
+  char                TRGfil[512], bfd_name[512], manifest[512] = "", stats_file[512] = "", cache_dir[512] = "",
+                      journal[1024], reject_name[1024] = "", also[2048] = "";
+  int32_t             i, option, threads = 0, batch_size = BFD_WRITER_BATCH_SIZE, bfd_handle, format, start_count,
+                      failed = 0, forced_format = -1, start_duplicates, existing, first_file = 0,
+                      checkpoint_records = CHECKPOINT_RECORDS, follow_ms = 0, count, images_missing, status,
+                      spatial_order = SPATIAL_ORDER_NONE, order_mb = SPATIAL_ORDER_MEMORY, rejects,
+                      rejected[REJECT_REASONS];
+  double              dedupe_meters = 0.0;
+  uint8_t             dedupe_flag = NVFalse, keep_stats = NVFalse, resume = NVFalse, following,
+                      parse_cache = NVFalse, columns = NVFalse, load_existing,
+                      tolerant = NVFalse, spatial_index = NVFalse;
+  char                *colon, *path, *next;
+  INGEST_STATS        stats;
+  uint64_t            start_ns;
+  FILE                *stats_fp;
   BFDATA_HEADER       bfd_header;
-  BFDATA_RECORD       bfd_record;
-  FILE                *fp;
-  time_t              current_time;
+  INGEST              *ingest;
+  uint8_t             appending = NVFalse;
+  INPUT_LIST          inputs;
+  COLUMN_MAP          column_map;
+  static struct option long_options[] = {{"format", required_argument, 0, 'f'},
+                                         {"dedupe", required_argument, 0, 'd'},
+                                         {"dedupe-flag", no_argument, 0, 'D'},
+                                         {"stats", required_argument, 0, 's'},
+                                         {"checkpoint", required_argument, 0, 'c'},
+                                         {"resume", no_argument, 0, 'r'},
+                                         {"follow", optional_argument, 0, 'F'},
+                                         {"parse-cache", optional_argument, 0, 'P'},
+                                         {"columns", required_argument, 0, 'C'},
+                                         {"spatial-order", required_argument, 0, 'O'},
+                                         {"tolerant", optional_argument, 0, 'T'},
+                                         {"also", required_argument, 0, 'A'},
+                                         {"index", no_argument, 0, 'I'},
+                                         {0, 0, 0, 0}};
 
 
 
@@ -287,138 +388,292 @@ int32_t main (int32_t argn, char **argv)
   fflush (stderr);
 
 
-  if (argn < 3)
+  memset (&stats, 0, sizeof (INGEST_STATS));
+  start_ns = stats_clock_ns ();
+
+
+  while ((option = getopt_long (argn, argv, "b:j:m:", long_options, NULL)) != EOF)
     {
-      fprintf (stderr, 
-               "Usage: build_feature <.csv file | .uni file | .txt file> <bfd feature file>\n\n\n");
+      switch (option)
+        {
+        case 'f':
+          if ((forced_format = input_format_from_name (optarg)) < 0)
+            {
+              fprintf (stderr, "\nUnknown input format %s, use txt, uni, or csv.\n\n", optarg);
+              exit (-1);
+            }
+          break;
 
-      fprintf (stderr, "Press 'Enter' to continue:");
-      fflush (stderr);
-      ngets (remarks, sizeof (remarks), stdin);
+        case 'C':
+          if ((optarg[0] == '@' ? column_map_read (&optarg[1], &column_map) : column_map_compile (optarg, &column_map)) < 0)
+            {
+              if (!column_map.error[0])
+                {
+                  perror (&optarg[1]);
+                }
+              else
+                {
+                  fprintf (stderr, "\nBad --columns spec, %s.\n\n", column_map.error);
+                }
+              exit (-1);
+            }
 
-      fprintf (stderr, "\n\n.csv files must be in the following format:\n\n");
-      fprintf (stderr, "\tDESCRIPTION,REMARKS,SDDD MM SS,SDD MM SS,DEPTH\n\n");
-      fprintf (stderr, "Description and remarks cannot be more than 100 characters\n");
-      fprintf (stderr, "SDDD is longitude, west negative, SDD is latitude, south negative\n\n\n");
+          columns = NVTrue;
+          break;
 
-      fprintf (stderr, "Press 'Enter' to continue:");
-      fflush (stderr);
-      ngets (remarks, sizeof (remarks), stdin);
+        case 'd':
+          if (sscanf (optarg, "%lf", &dedupe_meters) != 1 || dedupe_meters <= 0.0)
+            {
+              fprintf (stderr, "\nThe --dedupe distance must be a positive number of meters.\n\n");
+              exit (-1);
+            }
+          break;
 
-      fprintf (stderr, "\n\n.uni files must be in the following format:\n\n");
-      fprintf (stderr, "A one line text header (ignored) that looks like this:\n\n");
-      fprintf (stderr, "unisips file,snippet file,latitude,longitude,row,column,depth,heading,length,width,height,dtg,desc,remarks\n\n");
-      fprintf (stderr, "Followed by comma separated data records in the order indicated by the above header.\n");
-      fprintf (stderr, "The depth field is broken up into three fields - B: xx.x / T: xx.x / A: xx.x where:\n\n");
-      fprintf (stderr, "A is tow fish altitude above bottom, T is tow fish depth, and B is total water depth\n");
-      fprintf (stderr, "A typical record would look something like this:\n\n");
-      fprintf (stderr, "/unisips/k5-henson-2005306-071349-s.u,7976-606.gif,27.114496,32.570417,7975,605,B: 26.3 / T: 8.0 /  A: 18.3,227.7218, 86.04, 13.84, 14.22,11-02-2005  07:25:33.70,wreck lost in nadir\n\n\n");
+        case 'D':
+          dedupe_flag = NVTrue;
+          break;
 
+        case 's':
+          if (strncmp (optarg, "json", 4) || (optarg[4] && optarg[4] != ':'))
+            {
+              fprintf (stderr, "\nUnknown stats format %s, use --stats=json or --stats=json:FILE.\n\n", optarg);
+              exit (-1);
+            }
 
-      fprintf (stderr, "Press 'Enter' to continue:");
-      fflush (stderr);
-      ngets (remarks, sizeof (remarks), stdin);
-
-      fprintf (stderr, "\n\n.txt file format contains geographic positions, a description field,\n");
-      fprintf (stderr, "and a depth, separated by commas.  The geographic positions may be in any\n");
-      fprintf (stderr, "of the following formats (degrees, minutes, and seconds must be separated\n");
-      fprintf (stderr, "by a space or tab):\n\n");
-      fprintf (stderr, "\tHemisphere Degrees decimal                 : S 28.4532\n");
-      fprintf (stderr, "\tHemisphere Degrees minutes decimal         : S 28 27.192\n");
-      fprintf (stderr, "\tHemisphere Degrees minutes seconds decimal : S 28 27 11.52\n");
-      fprintf (stderr, "\tSigned Degrees decimal                     : -28.4532\n");
-      fprintf (stderr, "\tSigned Degrees minutes decimal             : -28 27.192\n");
-      fprintf (stderr, "\tSigned Degrees minutes seconds decimal     : -28 27 11.52\n\n");
-      fprintf (stderr, "West longitude and south latitude are negative :\n\n");
-      fprintf (stderr, "\tEx. : -28 27 11.52 = S28 27 11.52 = s 28 27.192\n\n");
-
-      fprintf (stderr, "Description cannot be more than 100 characters\n\n");
-      fprintf (stderr, "Example: build_feature trg31g.trg pensacola.bfd\n\n\n");
-      fflush (stderr);
-      exit (-1);
-    }
+          keep_stats = NVTrue;
 
+          if (optarg[4] == ':')
+            {
+              if (strlen (&optarg[5]) >= sizeof (stats_file))
+                {
+                  fprintf (stderr, "\nThe --stats file name %s is too long.\n\n", &optarg[5]);
+                  exit (-1);
+                }
 
-  /*  Strip off leading ./ if it's there.  MSYS may cause mixed separators on Windoze.  */
+              strcpy (stats_file, &optarg[5]);
+            }
+          break;
 
-  if (argv[1][0] == '.' && (argv[1][1] == '/' || argv[1][1] == '\\'))
-    {
-      strcpy (TRGfil, &argv[1][2]);
-    }
-  else
-    {
-      strcpy (TRGfil, argv[1]);
+        case 'c':
+          if (sscanf (optarg, "%d", &checkpoint_records) != 1 || checkpoint_records < 0)
+            {
+              fprintf (stderr, "\nThe --checkpoint interval must be a number of records (0 for none).\n\n");
+              exit (-1);
+            }
+          break;
+
+        case 'r':
+          resume = NVTrue;
+          break;
+
+        case 'F':
+          follow_ms = FOLLOW_LATENCY_MS;
+
+          if (optarg && (sscanf (optarg, "%d", &follow_ms) != 1 || follow_ms < 1))
+            {
+              fprintf (stderr, "\nThe --follow latency must be a positive number of milliseconds.\n\n");
+              exit (-1);
+            }
+          break;
+
+        case 'O':
+          if ((colon = strchr (optarg, ':')) != NULL)
+            {
+              *colon = 0;
+
+              if (sscanf (colon + 1, "%d", &order_mb) != 1 || order_mb < 1)
+                {
+                  fprintf (stderr, "\nThe --spatial-order memory budget must be a positive number of MB.\n\n");
+                  exit (-1);
+                }
+            }
+
+          if ((spatial_order = spatial_order_from_name (optarg)) < 0)
+            {
+              fprintf (stderr, "\nUnknown space filling curve %s, use --spatial-order=hilbert or --spatial-order=morton.\n\n",
+                       optarg);
+              exit (-1);
+            }
+          break;
+
+        case 'T':
+          tolerant = NVTrue;
+
+          if (optarg)
+            {
+              if (strlen (optarg) >= sizeof (reject_name))
+                {
+                  fprintf (stderr, "\nThe --tolerant reject file name %s is too long.\n\n", optarg);
+                  exit (-1);
+                }
+
+              strcpy (reject_name, optarg);
+            }
+          break;
+
+        case 'A':
+          if (strlen (also) + 1 + strlen (optarg) >= sizeof (also))
+            {
+              fprintf (stderr, "\nThe --also output file names are too long (%d characters at most).\n\n",
+                       (int32_t) sizeof (also) - 1);
+              exit (-1);
+            }
+
+          if (also[0]) strcat (also, ",");
+          strcat (also, optarg);
+          break;
+
+        case 'I':
+          spatial_index = NVTrue;
+          break;
+
+        case 'P':
+          parse_cache = NVTrue;
+
+          if (optarg)
+            {
+              if (strlen (optarg) >= sizeof (cache_dir))
+                {
+                  fprintf (stderr, "\nThe --parse-cache directory name %s is too long.\n\n", optarg);
+                  exit (-1);
+                }
+
+              strcpy (cache_dir, optarg);
+            }
+          break;
+
+        case 'b':
+          if (sscanf (optarg, "%d", &batch_size) != 1 || batch_size < 1)
+            {
+              fprintf (stderr, "\nThe -b batch size must be a positive number of records.\n\n");
+              exit (-1);
+            }
+          break;
+
+        case 'j':
+          if (sscanf (optarg, "%d", &threads) != 1 || threads < 0 || threads > PIPELINE_MAX_THREADS)
+            {
+              fprintf (stderr, "\nThe -j thread count must be a number from 0 to %d.\n\n", PIPELINE_MAX_THREADS);
+              exit (-1);
+            }
+          break;
+
+        case 'm':
+          if (strlen (optarg) >= sizeof (manifest))
+            {
+              fprintf (stderr, "\nThe manifest file name %s is too long.\n\n", optarg);
+              exit (-1);
+            }
+
+          strcpy (manifest, optarg);
+          break;
+
+        default:
+          usage ();
+          break;
+        }
     }
 
 
-  /*  Get the fully qualified input file name.  */
+  /*  Make sure we got the mandatory file names.  The last argument is always the BFD file and everything
+      between the options and the BFD file is an input file (or wildcard).  */
 
-#ifdef WIN32
+  if (optind + (manifest[0] ? 1 : 2) > argn) usage ();
 
-  if (_getcwd (old_dir, sizeof (old_dir)) == NULL)
+
+  memset (&inputs, 0, sizeof (INPUT_LIST));
+
+  for (i = optind ; i < argn - 1 ; i++) input_list_add (&inputs, argv[i]);
+
+  if (manifest[0] && input_list_read_manifest (&inputs, manifest) < 0)
     {
-      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      perror (manifest);
+      exit (-1);
     }
 
-  if (_chdir (gen_dirname (argv[1])) == -1)
+  if (!inputs.count)
     {
-      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      fprintf (stderr, "\nNo input files to process.\n\n");
+      exit (-1);
     }
 
-  if (_getcwd (new_dir, sizeof (new_dir)) == NULL)
+
+  /*  Following standard input is just reading it (e.g. from tail -F).  */
+
+  if (follow_ms && !strcmp (inputs.name[inputs.count - 1], "-"))
     {
-      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      fprintf (stderr, "\n--follow needs an input file name (the last input file is the one that's followed).\n\n");
+      exit (-1);
     }
 
-  sprintf (string, "%s\\%s", new_dir, gen_basename(TRGfil));
-  strcpy (TRGfil, string);
-
-  if (_chdir (old_dir) == -1)
+  if (follow_ms && decompress_type (inputs.name[inputs.count - 1]) != DECOMPRESS_NONE)
     {
-      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      fprintf (stderr, "\n--follow can't follow a compressed file (the last input file is the one that's followed).\n\n");
+      exit (-1);
     }
 
-#else 
 
-  if (getcwd (old_dir, sizeof (old_dir)) == NULL)
+  /*  A column mapping applies to every input.  */
+
+  if (columns)
     {
-      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      if (forced_format >= 0)
+        {
+          fprintf (stderr, "\nUse --format or --columns, not both.\n\n");
+          exit (-1);
+        }
+
+      forced_format = INPUT_FORMAT_MAPPED;
     }
 
-  if (chdir (gen_dirname (argv[1])) == -1)
+
+  /*  Spatially ordered records are only written at the end so there's nothing to checkpoint, resume, or follow.
+      Flagged duplicates would point at the record numbers the features had before they were reordered.  */
+
+  if (spatial_order)
     {
-      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      if (resume || follow_ms || dedupe_flag || checkpoint_records)
+        {
+          fprintf (stderr, "\n--spatial-order can't be used with --resume, --follow, --dedupe-flag, or --checkpoint.\n\n");
+          exit (-1);
+        }
     }
 
-  if (getcwd (new_dir, sizeof (new_dir)) == NULL)
+
+  /*  The extra outputs are written from scratch, they can't pick up where a run that died left off.  */
+
+  if (also[0] && resume)
     {
-      fprintf (stderr, "Error return from getcwd in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      fprintf (stderr, "\n--also can't be used with --resume.\n\n");
+      exit (-1);
     }
 
-  sprintf (string, "%s/%s", new_dir, TRGfil);
-  strcpy (TRGfil, string);
 
-  if (chdir (old_dir) == -1)
+  /*  Cached records aren't parsed so their lines can't be checked.  */
+
+  if (tolerant && parse_cache)
     {
-      fprintf (stderr, "Error return from chdir in file %s, function %s at line %d.  This should never happen!", __FILE__, __FUNCTION__, __LINE__ - 2);
-      fflush (stderr);
+      fprintf (stderr, "\n--tolerant can't be used with --parse-cache.\n\n");
+      exit (-1);
     }
 
-#endif
 
+  /*  There's no file name to tell us what's coming down a pipe.  */
 
-  fprintf (stderr, "Processing %s\n", TRGfil);
-  fflush (stderr);
+  if (forced_format < 0)
+    {
+      for (i = 0 ; i < inputs.count ; i++)
+        {
+          if (!strcmp (inputs.name[i], "-"))
+            {
+              fprintf (stderr, "\nReading standard input requires --format=txt, --format=uni, --format=csv, or --columns.\n\n");
+              exit (-1);
+            }
+        }
+    }
 
 
-  strcpy (bfd_name, argv[2]);
+  strcpy (bfd_name, argv[argn - 1]);
 
 
   /*  Check for .bfd extension.  */
@@ -430,7 +685,8 @@ int32_t main (int32_t argn, char **argv)
     }
 
 
-  /*  Make sure that we can open and write to the output .bfd file.  */
+  /*  Make sure that we can open and write to the output .bfd file.  We only open it once no matter how
+      many input files there are.  */
 
   if ((bfd_handle = binaryFeatureData_open_file (bfd_name, &bfd_header, BFDATA_UPDATE)) < 0)
     {
@@ -447,131 +703,278 @@ int32_t main (int32_t argn, char **argv)
   else
     {
       printf ("\nAppending to file %s\n", bfd_name);
+      appending = NVTrue;
     }
 
 
-  if ((fp = fopen (TRGfil, "r")) == NULL)
+  /*  Everything after the parsing (contact IDs, duplicate checks, BFD writes, and checkpoints) is done by the
+      ingest library.  */
+
+  if ((ingest = ingest_open (bfd_handle, bfd_name, appending ? bfd_header.number_of_records : 0, batch_size)) == NULL)
     {
-      perror (TRGfil);
+      perror ("Allocating BFD writer memory");
       exit (-1);
     }
 
-  while (fgets (string, sizeof (string), fp) != NULL)
+  ingest->checkpoint_records = checkpoint_records;
+  ingest->report_missing = NVTrue;
+  ingest->stats = keep_stats ? &stats : NULL;
+  ingest->threads = threads;
+  ingest->parse_cache = parse_cache;
+  snprintf (ingest->cache_dir, sizeof (ingest->cache_dir), "%s", cache_dir);
+  if (columns) ingest->parse.map = &column_map;
+
+  if (spatial_order && ingest_spatial_order (ingest, spatial_order, (size_t) order_mb * 1024 * 1024) < 0)
+    {
+      ingest_perror (ingest);
+      exit (-1);
+    }
+
+
+  /*  Every feature also goes to each of the --also files (comma separated).  */
+
+  for (path = also ; *path ; path = next)
+    {
+      if ((next = strchr (path, ',')) != NULL)
+        {
+          *next++ = 0;
+        }
+      else
+        {
+          next = path + strlen (path);
+        }
+
+      if (*path && ingest_also (ingest, path) < 0)
+        {
+          ingest_perror (ingest);
+          exit (-1);
+        }
+    }
+
+
+  /*  The checkpoint journal says how far a run got.  If there's one lying around for a file we're appending
+      to, a run died and just appending would load some of the input twice.  When resuming everything picks up
+      at the last commit point and any records written after it are skipped (see ingest_commit_batch).  */
+
+  if ((first_file = ingest_resume (ingest, resume, appending, appending ? bfd_header.number_of_records : 0,
+                                   inputs.count)) < 0)
     {
-      memset (&bfd_record, 0, sizeof (BFDATA_RECORD));
+      ingest_perror (ingest);
+      exit (-1);
+    }
+
 
+  /*  Rejected lines go next to the BFD file (like the journal) unless we were told where to put them.  When
+      resuming, the reject file is cut back to where it was at the commit point.  */
 
-      /*  Drop the header if it's there.  */
+  if (tolerant)
+    {
+      if (!reject_name[0]) sprintf (reject_name, "%s.rej", bfd_name);
+
+      if (ingest_tolerant (ingest, reject_name) < 0)
+        {
+          ingest_perror (ingest);
+          exit (-1);
+        }
+    }
 
-      if ((strstr (string, "LONG") && strstr (string, "LAT")) || strstr (string, "latitude")) continue;
 
+  /*  Index what's already in the file so duplicates can be found without scanning it for every record.  */
 
-      current_time = time (&current_time);
+  if (dedupe_meters > 0.0)
+    {
+      load_existing = (appending && (!resume || ingest->resume.records));
 
-      cvtime ((time_t) current_time, 0, &year, &day, &hour, &minute, &second);
-      year += 1900;
+      if ((existing = ingest_dedupe (ingest, dedupe_meters, dedupe_flag, load_existing,
+                                     resume ? ingest->resume.records : 0)) < 0)
+        {
+          ingest_perror (ingest);
+          exit (-1);
+        }
 
+      if (load_existing)
+        {
+          fprintf (stderr, "Indexed %d existing features for duplicate checking\n", existing);
+          fflush (stderr);
+        }
+    }
 
-      sprintf (contact_id, "%02d%03d%02d%02d%02d%03d", year % 100, day, hour, minute, (int32_t) second, count);
 
+  /*  The spatial index gets everything that's written from here on.  Records that are already in the file but
+      not in the index are read back first.  */
 
-      strcpy (image_name, "");
+  if (spatial_index)
+    {
+      if ((existing = ingest_index (ingest, appending ? bfd_header.number_of_records : 0)) < 0)
+        {
+          ingest_perror (ingest);
+          exit (-1);
+        }
 
-      if (strstr (TRGfil, ".txt"))
+      if (existing)
         {
-          strcpy (bfd_record.remarks, sget_coord (string, &lat_hemi, &latdeg, &latmin, &flatsec, &lon_hemi, 
-                                                  &londeg, &lonmin, &flonsec, &bfd_record.depth));
-          bfd_record.latitude = (double) latdeg + (double) latmin / 60.0 + (double) flatsec / 3600.0;
-          if (lat_hemi == 'S') bfd_record.latitude = -bfd_record.latitude;
+          fprintf (stderr, "Indexed %d existing features for the spatial index\n", existing);
+          fflush (stderr);
+        }
+    }
+
 
-          bfd_record.longitude = (double) londeg + (double) lonmin / 60.0 + (double) flonsec / 3600.0;
-          if (lon_hemi == 'W') bfd_record.longitude = -bfd_record.longitude;
+  for (i = first_file ; i < inputs.count ; i++)
+    {
+      if (!strcmp (inputs.name[i], "-"))
+        {
+          strcpy (TRGfil, "-");
         }
-      else if (strstr (TRGfil, ".uni"))
+      else
         {
-          strcpy (fname, strtok (string, ","));
-          strcpy (image_name, strtok (NULL, ","));
+          qualify_input_name (inputs.name[i], TRGfil);
+        }
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%lf", &bfd_record.latitude);
+      following = (follow_ms && i == inputs.count - 1);
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%lf", &bfd_record.longitude);
+      fprintf (stderr, "%s %s\n", following ? "Following" : "Processing", TRGfil);
+      fflush (stderr);
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%d", &row);
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%d", &col);
+      /*  A followed file runs until we get a SIGINT or SIGTERM, then everything is closed down normally.  */
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "B: %f / T: %f /  A: %f", &bfd_record.depth, &bfd_record.width, &bfd_record.height);
+      if (following)
+        {
+          signal (SIGINT, stop_following);
+          signal (SIGTERM, stop_following);
+        }
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%f", &bfd_record.heading);
+      format = (forced_format < 0) ? input_format (TRGfil) : forced_format;
+      start_count = ingest->count;
+      start_duplicates = ingest->duplicates;
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%f", &bfd_record.length);
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%f", &bfd_record.width);
+      /*  A bad input file doesn't stop the rest of the batch.  */
 
-          strcpy (cut, strtok (NULL, ","));
-          sscanf (cut, "%f", &bfd_record.height);
+      if (ingest_file (ingest, TRGfil, format, i, following ? follow_ms : 0) < 0)
+        {
+          check_ingest (ingest);
+          perror (TRGfil);
+          failed++;
+          continue;
+        }
+
+      if (resume && i == first_file)
+        {
+          fprintf (stderr, "Resumed at byte %llu (%u records were already in %s)\n",
+                   (unsigned long long) ingest->resume.offset, bfd_header.number_of_records, bfd_name);
+          fflush (stderr);
+        }
 
-          strcpy (dtg, strtok (NULL, ","));
-          sscanf (dtg, "%d-%d-%d  %d:%d:%f", &month, &mday, &year, &hour, &minute, &second);
+      if (ingest->cached)
+        {
+          fprintf (stderr, "Loaded from parse cache %s\n", ingest->cache_name);
+          fflush (stderr);
+        }
 
-          mday2jday (year, month, mday, &day);
-          sprintf (contact_id, "%02d%03d%02d%02d%02d%03d", year % 100, day, hour, minute, (int32_t) second, count);
+      if (ingest->cache_error)
+        {
+          errno = ingest->cache_error;
+          perror (ingest->cache_name);
+        }
 
-          strcpy (desc, strtok (NULL, ","));
+      if (ingest->dedupe != NULL)
+        {
+          printf ("%s : %d %s records, %d duplicates %s\n", TRGfil, ingest->count - start_count,
+                  input_format_name (format), ingest->duplicates - start_duplicates, dedupe_flag ? "flagged" : "dropped");
         }
       else
         {
-          /*  Look for the second comma.  */
+          printf ("%s : %d %s records\n", TRGfil, ingest->count - start_count, input_format_name (format));
+        }
+      fflush (stdout);
+    }
 
-          check = 0;
-          for (i = 0 ; i < strlen (string) ; i++)
-            {
-              if (string[i] == ',') check++;
-              if (check == 2) break;
-            }
 
-          strncpy (desc, string, i);
-          desc[i] = 0;
-          sprintf (bfd_record.remarks, "NAVO - %s", desc);
+  /*  Write whatever is still staged (this adds the write counts to the stats).  */
 
-          sscanf (&string[i + 1], "%d %d %d,%d %d %d, %f", &londeg, &lonmin, &lonsec, &latdeg, &latmin, &latsec, &depth);
+  count = ingest->count;
+  images_missing = ingest->images_missing;
+  rejects = ingest->rejects;
+  for (i = 0 ; i < REJECT_REASONS ; i++) rejected[i] = ingest->rejected[i];
+  strcpy (journal, ingest->journal);
 
+  status = ingest_close (ingest, &bfd_handle);
 
-          bfd_record.latitude = (double) latdeg + (double) latmin / 60.0 + (double) latsec / 3600.0;
-          if (latdeg < 0) bfd_record.latitude = -bfd_record.latitude;
 
-          bfd_record.longitude = (double) londeg + (double) lonmin / 60.0 + (double) lonsec / 3600.0;
-          if (londeg < 0) bfd_record.longitude = -bfd_record.longitude;
-        }
+  /*  Close the BFD file even if something failed (the header then covers the records that were written).  It's
+      only gone if reopening it at a checkpoint failed.  */
+
+  if (bfd_handle >= 0) binaryFeatureData_close_file (bfd_handle);
 
+  if (status < 0) exit (-1);
 
-      inv_cvtime (year - 1900, day, hour, minute, second, &bfd_record.event_tv_sec, &bfd_record.event_tv_nsec);
 
-      bfd_record.confidence_level = 3;
-      strcpy (bfd_record.analyst_activity, "NAVOCEANO BHY");
+  /*  The journal is only there for a run that didn't finish.  */
 
-      count++;
+  if (checkpoint_records || resume) remove (journal);
+
+
+  if (inputs.count > 1)
+    {
+      printf ("\n%d records from %d of %d input files\n", count, inputs.count - failed, inputs.count);
+      fflush (stdout);
+    }
+
+  if (images_missing)
+    {
+      fprintf (stderr, "\n%d records were written without their (missing or unreadable) images\n", images_missing);
+      fflush (stderr);
+    }
 
 
-      if (binaryFeatureData_write_record_image_file (bfd_handle, BFDATA_NEXT_RECORD, &bfd_record, NULL, image_name) < 0)
+  /*  A clean run doesn't leave an empty reject file behind.  */
+
+  if (rejects)
+    {
+      fprintf (stderr, "\n%d lines were rejected and written to %s\n", rejects, reject_name);
+
+      for (i = 1 ; i < REJECT_REASONS ; i++)
         {
-          binaryFeatureData_perror ();
-          exit (-1);
+          if (rejected[i]) fprintf (stderr, "\t%-16s : %d\n", reject_reason_name (i), rejected[i]);
+        }
+      fflush (stderr);
+    }
+  else if (tolerant)
+    {
+      remove (reject_name);
+    }
+
+
+  if (keep_stats)
+    {
+      stats.wall_ns = stats_clock_ns () - start_ns;
+      stats.files = inputs.count;
+      stats.failed = failed;
+      stats.threads = threads;
+
+      if (!stats_file[0])
+        {
+          stats_write_json (stdout, &stats);
+        }
+      else if ((stats_fp = fopen (stats_file, "w")) == NULL)
+        {
+          perror (stats_file);
+        }
+      else
+        {
+          stats_write_json (stats_fp, &stats);
+          fclose (stats_fp);
         }
     }
 
-  fclose (fp);
 
-  binaryFeatureData_close_file (bfd_handle);
+  input_list_free (&inputs);
+
+
+  if (failed) exit (-1);
 
+  if (rejects) exit (REJECTED_LINES_STATUS);
 
   return (0);
 }
@@ -0,0 +1,527 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "ogr_srs_api.h"
+#include "cpl_error.h"
+
+#include "ogr_sink.h"
+#include "stats.h"
+
+
+/*  Output formats we know by file name extension.  */
+
+typedef struct
+{
+  const char          *extension;
+  const char          *driver;
+} OGR_SINK_FORMAT;
+
+static OGR_SINK_FORMAT formats[] = {{".geojson", "GeoJSON"},
+                                    {".json", "GeoJSON"},
+                                    {".shp", "ESRI Shapefile"},
+                                    {".gpkg", "GPKG"},
+                                    {".kml", "KML"},
+                                    {".gml", "GML"},
+                                    {NULL, NULL}};
+
+
+/*  Field names (no more than 10 characters so they fit in a shapefile .dbf).  */
+
+static const char *field_name[OGR_SINK_FIELDS] = {"contact_id", "event_time", "depth", "length", "width", "height",
+                                                  "heading", "confidence", "remarks", "descript", "analyst"};
+
+
+/*  GDAL drivers are only registered once.  */
+
+static uint8_t registered = NVFalse;
+
+
+
+/*  The GDAL driver for an output file name, from its extension.  Returns NULL if we don't know it.  */
+
+const char *ogr_sink_driver (const char *path)
+{
+  const char          *dot;
+  int32_t             i;
+
+
+  if ((dot = strrchr (path, '.')) == NULL || strchr (dot, '/') != NULL) return (NULL);
+
+  for (i = 0 ; formats[i].extension != NULL ; i++)
+    {
+      if (!strcmp (dot, formats[i].extension)) return (formats[i].driver);
+    }
+
+  return (NULL);
+}
+
+
+
+/*  Saves the last GDAL error message (GDAL keeps one per thread).  */
+
+static void gdal_error (OGR_SINK *sink, const char *what)
+{
+  const char          *message = CPLGetLastErrorMsg ();
+
+
+  snprintf (sink->error, sizeof (sink->error), "%s: %s%s%s", sink->path, what, message[0] ? ", " : "", message);
+}
+
+
+
+/*  Event time (UTC) as ISO 8601 text with hundredths of a second (which is all a DTG has).  This is plain
+    arithmetic (the civil calendar from a day count) so the sink threads don't need gmtime.  */
+
+static void event_time (time_t tv_sec, long tv_nsec, char *string, size_t size)
+{
+  int64_t             days, seconds, era, doe, yoe, doy, mp, year, month, mday;
+
+
+  days = (int64_t) tv_sec / 86400;
+  seconds = (int64_t) tv_sec - days * 86400;
+
+  if (seconds < 0)
+    {
+      seconds += 86400;
+      days--;
+    }
+
+  days += 719468;
+  era = (days >= 0 ? days : days - 146096) / 146097;
+  doe = days - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+  mday = doy - (153 * mp + 2) / 5 + 1;
+  month = (mp < 10) ? mp + 3 : mp - 9;
+  year = yoe + era * 400 + (month <= 2);
+
+  snprintf (string, size, "%04d-%02d-%02dT%02d:%02d:%02d.%02dZ", (int32_t) year, (int32_t) month, (int32_t) mday,
+            (int32_t) (seconds / 3600), (int32_t) (seconds / 60 % 60), (int32_t) (seconds % 60),
+            (int32_t) (tv_nsec / 10000000));
+}
+
+
+
+/*  Writes one buffer of features.  Each buffer is one transaction if the format has them (GeoPackage does,
+    which makes a big difference, GeoJSON and shapefiles don't).  Returns 0, or -1 on error.  */
+
+static int32_t write_buffer (OGR_SINK *sink, OGR_SINK_BUFFER *buffer)
+{
+  const BFDATA_RECORD *record;
+  OGRFeatureH         feature;
+  OGRGeometryH        point;
+  char                string[64];
+  uint8_t             transaction;
+  int32_t             i, status = 0;
+
+
+  transaction = (GDALDatasetStartTransaction (sink->dataset, FALSE) == OGRERR_NONE);
+
+  for (i = 0 ; i < buffer->count ; i++)
+    {
+      record = &buffer->record[i];
+
+      if ((feature = OGR_F_Create (OGR_L_GetLayerDefn (sink->layer))) == NULL)
+        {
+          gdal_error (sink, "Creating feature");
+          status = -1;
+          break;
+        }
+
+      event_time (record->event_tv_sec, record->event_tv_nsec, string, sizeof (string));
+
+      OGR_F_SetFieldString (feature, sink->field[OGR_SINK_CONTACT_ID], buffer->contact_id[i]);
+      OGR_F_SetFieldString (feature, sink->field[OGR_SINK_EVENT_TIME], string);
+      OGR_F_SetFieldDouble (feature, sink->field[OGR_SINK_DEPTH], record->depth);
+      OGR_F_SetFieldDouble (feature, sink->field[OGR_SINK_LENGTH], record->length);
+      OGR_F_SetFieldDouble (feature, sink->field[OGR_SINK_WIDTH], record->width);
+      OGR_F_SetFieldDouble (feature, sink->field[OGR_SINK_HEIGHT], record->height);
+      OGR_F_SetFieldDouble (feature, sink->field[OGR_SINK_HEADING], record->heading);
+      OGR_F_SetFieldInteger (feature, sink->field[OGR_SINK_CONFIDENCE], record->confidence_level);
+      OGR_F_SetFieldString (feature, sink->field[OGR_SINK_REMARKS], record->remarks);
+      OGR_F_SetFieldString (feature, sink->field[OGR_SINK_DESCRIPTION], record->description);
+      OGR_F_SetFieldString (feature, sink->field[OGR_SINK_ANALYST], record->analyst_activity);
+
+      point = OGR_G_CreateGeometry (wkbPoint);
+      OGR_G_SetPoint_2D (point, 0, record->longitude, record->latitude);
+      OGR_F_SetGeometryDirectly (feature, point);
+
+      if (OGR_L_CreateFeature (sink->layer, feature) != OGRERR_NONE)
+        {
+          gdal_error (sink, "Writing feature");
+          status = -1;
+        }
+
+      OGR_F_Destroy (feature);
+
+      if (status < 0) break;
+    }
+
+  if (transaction && GDALDatasetCommitTransaction (sink->dataset) != OGRERR_NONE && !status)
+    {
+      gdal_error (sink, "Committing features");
+      status = -1;
+    }
+
+  return (status);
+}
+
+
+
+/*  Sink thread.  Writes the queued buffers in the order they were filled.  After a failure the rest are just
+    dropped (the commit thread sees failed the next time it hands one over).  */
+
+static void *sink_thread (void *data)
+{
+  OGR_SINK            *sink = (OGR_SINK *) data;
+  OGR_SINK_BUFFER     *buffer;
+  uint64_t            start;
+  int32_t             status = 0;
+
+
+  pthread_mutex_lock (&sink->mutex);
+
+  while (1)
+    {
+      while (!sink->queued && !sink->stop) pthread_cond_wait (&sink->work_cond, &sink->mutex);
+
+      if (!sink->queued) break;
+
+      buffer = &sink->buffer[sink->write];
+
+      pthread_mutex_unlock (&sink->mutex);
+
+      if (!status)
+        {
+          start = stats_clock_ns ();
+
+          if ((status = write_buffer (sink, buffer)) == 0) sink->features += buffer->count;
+
+          sink->ns += stats_clock_ns () - start;
+        }
+
+      pthread_mutex_lock (&sink->mutex);
+
+      if (status < 0) sink->failed = NVTrue;
+
+      buffer->count = 0;
+      sink->write = (sink->write + 1) % OGR_SINK_QUEUE;
+      sink->queued--;
+      pthread_cond_signal (&sink->done_cond);
+    }
+
+  pthread_mutex_unlock (&sink->mutex);
+
+  return (NULL);
+}
+
+
+
+/*  Creates the output dataset and its point layer with the feature attribute fields.  Returns 0, or -1 on
+    error.  */
+
+static int32_t create_layer (OGR_SINK *sink)
+{
+  GDALDriverH         driver;
+  OGRSpatialReferenceH srs;
+  OGRFieldDefnH       field;
+  OGRFieldType        type;
+  BFDATA_RECORD       record;
+  char                layer_name[256], *dot;
+  const char          *slash;
+  struct stat         st;
+  int32_t             i, width;
+
+
+  if ((driver = GDALGetDriverByName (sink->driver)) == NULL)
+    {
+      gdal_error (sink, "No GDAL driver for this format");
+      return (-1);
+    }
+
+
+  /*  Like the BFD file, an existing output is replaced.  */
+
+  if (stat (sink->path, &st) == 0 && GDALDeleteDataset (driver, sink->path) != CE_None) remove (sink->path);
+
+  if ((sink->dataset = GDALCreate (driver, sink->path, 0, 0, 0, GDT_Unknown, NULL)) == NULL)
+    {
+      gdal_error (sink, "Creating dataset");
+      return (-1);
+    }
+
+
+  /*  BFD positions are WGS84 degrees, written longitude first whatever the GDAL version's axis order is.  */
+
+  srs = OSRNewSpatialReference (NULL);
+  OSRImportFromEPSG (srs, 4326);
+#if GDAL_VERSION_MAJOR >= 3
+  OSRSetAxisMappingStrategy (srs, OAMS_TRADITIONAL_GIS_ORDER);
+#endif
+
+
+  /*  The layer is named after the file.  */
+
+  slash = strrchr (sink->path, '/');
+  strncpy (layer_name, slash ? slash + 1 : sink->path, sizeof (layer_name) - 1);
+  layer_name[sizeof (layer_name) - 1] = 0;
+  if ((dot = strrchr (layer_name, '.')) != NULL) *dot = 0;
+
+  sink->layer = GDALDatasetCreateLayer (sink->dataset, layer_name, srs, wkbPoint, NULL);
+
+  OSRDestroySpatialReference (srs);
+
+  if (sink->layer == NULL)
+    {
+      gdal_error (sink, "Creating layer");
+      return (-1);
+    }
+
+  for (i = 0 ; i < OGR_SINK_FIELDS ; i++)
+    {
+      switch (i)
+        {
+        case OGR_SINK_CONTACT_ID:
+          type = OFTString;
+          width = sizeof (((OGR_SINK_BUFFER *) NULL)->contact_id[0]);
+          break;
+
+        case OGR_SINK_EVENT_TIME:
+          type = OFTString;
+          width = 24;
+          break;
+
+        case OGR_SINK_CONFIDENCE:
+          type = OFTInteger;
+          width = 0;
+          break;
+
+        case OGR_SINK_REMARKS:
+          type = OFTString;
+          width = sizeof (record.remarks);
+          break;
+
+        case OGR_SINK_DESCRIPTION:
+          type = OFTString;
+          width = sizeof (record.description);
+          break;
+
+        case OGR_SINK_ANALYST:
+          type = OFTString;
+          width = sizeof (record.analyst_activity);
+          break;
+
+        default:
+          type = OFTReal;
+          width = 0;
+          break;
+        }
+
+      field = OGR_Fld_Create (field_name[i], type);
+      if (width) OGR_Fld_SetWidth (field, width);
+
+      if (OGR_L_CreateField (sink->layer, field, TRUE) != OGRERR_NONE)
+        {
+          OGR_Fld_Destroy (field);
+          gdal_error (sink, "Creating field");
+          return (-1);
+        }
+
+      OGR_Fld_Destroy (field);
+
+      sink->field[i] = OGR_FD_GetFieldIndex (OGR_L_GetLayerDefn (sink->layer), field_name[i]);
+    }
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ogr_sink_open                                       *
+*                                                                           *
+*   Purpose:            Creates an OGR output (the format comes from the    *
+*                       file name extension, see ogr_sink_driver) and       *
+*                       starts the thread that writes it.                   *
+*                                                                           *
+*   Inputs:             path                -   output file name            *
+*                                                                           *
+*   Outputs:            OGR_SINK *          -   sink (check error) or NULL  *
+*                                               if we ran out of memory     *
+*                                                                           *
+\***************************************************************************/
+
+OGR_SINK *ogr_sink_open (const char *path)
+{
+  OGR_SINK            *sink;
+  int32_t             err;
+
+
+  if ((sink = (OGR_SINK *) calloc (1, sizeof (OGR_SINK))) == NULL) return (NULL);
+
+  if ((sink->buffer = (OGR_SINK_BUFFER *) calloc (OGR_SINK_QUEUE, sizeof (OGR_SINK_BUFFER))) == NULL)
+    {
+      free (sink);
+      return (NULL);
+    }
+
+  strncpy (sink->path, path, sizeof (sink->path) - 1);
+
+  pthread_mutex_init (&sink->mutex, NULL);
+  pthread_cond_init (&sink->work_cond, NULL);
+  pthread_cond_init (&sink->done_cond, NULL);
+
+  if ((sink->driver = ogr_sink_driver (path)) == NULL)
+    {
+      snprintf (sink->error, sizeof (sink->error), "%s: Unknown output format (use .geojson, .shp, .gpkg, .kml, or .gml)",
+                path);
+      return (sink);
+    }
+
+  if (!registered)
+    {
+      GDALAllRegister ();
+      registered = NVTrue;
+    }
+
+  CPLErrorReset ();
+
+  if (create_layer (sink) < 0) return (sink);
+
+  if ((err = pthread_create (&sink->thread, NULL, sink_thread, sink)))
+    {
+      snprintf (sink->error, sizeof (sink->error), "%s: Starting writer thread, %s", path, strerror (err));
+      return (sink);
+    }
+
+  sink->started = NVTrue;
+
+  return (sink);
+}
+
+
+
+/*  Hands the buffer being filled to the sink thread and moves on to the next one, waiting for it to be
+    written if the whole queue is full.  Returns 0, or -1 if the sink thread has failed.  */
+
+static int32_t queue_buffer (OGR_SINK *sink)
+{
+  uint8_t             failed;
+
+
+  pthread_mutex_lock (&sink->mutex);
+
+  sink->queued++;
+  pthread_cond_signal (&sink->work_cond);
+
+  sink->fill = (sink->fill + 1) % OGR_SINK_QUEUE;
+
+  if (sink->queued == OGR_SINK_QUEUE)
+    {
+      sink->stalls++;
+      while (sink->queued == OGR_SINK_QUEUE) pthread_cond_wait (&sink->done_cond, &sink->mutex);
+    }
+
+  failed = sink->failed;
+
+  pthread_mutex_unlock (&sink->mutex);
+
+  return (failed ? -1 : 0);
+}
+
+
+
+/*  Adds a feature (a copy is made) to the sink.  Returns 0, or -1 on error (a failure in the sink thread shows
+    up the next time a buffer is handed over).  */
+
+int32_t ogr_sink_add (OGR_SINK *sink, const BFDATA_RECORD *record, const char *contact_id)
+{
+  OGR_SINK_BUFFER     *buffer = &sink->buffer[sink->fill];
+
+
+  if (!sink->started) return (-1);
+
+  buffer->record[buffer->count] = *record;
+  strncpy (buffer->contact_id[buffer->count], contact_id, sizeof (buffer->contact_id[0]) - 1);
+  buffer->count++;
+
+  if (buffer->count == OGR_SINK_BATCH && queue_buffer (sink) < 0) return (-1);
+
+  return (0);
+}
+
+
+
+/*  Writes whatever is still buffered, stops the sink thread, and closes the output.  Returns 0, or -1 on
+    error (error says what went wrong).  The sink still has to be freed with ogr_sink_free.  */
+
+int32_t ogr_sink_close (OGR_SINK *sink)
+{
+  if (sink->started)
+    {
+      if (sink->buffer[sink->fill].count) queue_buffer (sink);
+
+      pthread_mutex_lock (&sink->mutex);
+      sink->stop = NVTrue;
+      pthread_cond_signal (&sink->work_cond);
+      pthread_mutex_unlock (&sink->mutex);
+
+      pthread_join (sink->thread, NULL);
+      sink->started = NVFalse;
+    }
+
+  if (sink->dataset != NULL)
+    {
+      CPLErrorReset ();
+
+      GDALClose (sink->dataset);
+      sink->dataset = NULL;
+
+      if (!sink->error[0] && CPLGetLastErrorType () >= CE_Failure) gdal_error (sink, "Closing dataset");
+    }
+
+  return (sink->error[0] ? -1 : 0);
+}
+
+
+
+void ogr_sink_free (OGR_SINK *sink)
+{
+  if (sink == NULL) return;
+
+  if (sink->started || sink->dataset != NULL) ogr_sink_close (sink);
+
+  pthread_mutex_destroy (&sink->mutex);
+  pthread_cond_destroy (&sink->work_cond);
+  pthread_cond_destroy (&sink->done_cond);
+  free (sink->buffer);
+  free (sink);
+}
@@ -0,0 +1,111 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __OGR_SINK_H__
+#define __OGR_SINK_H__
+
+#include <pthread.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+
+#include "gdal.h"
+#include "ogr_api.h"
+
+
+/*  Most extra outputs we'll write (each one is a thread and an open OGR dataset).  */
+
+#define OGR_SINK_MAX            8
+
+
+/*  Features handed to a sink thread at a time, and the number of those buffers each sink has.  The commit
+    thread only waits on a sink when all of its buffers are waiting to be written.  */
+
+#define OGR_SINK_BATCH          1024
+#define OGR_SINK_QUEUE          8
+
+
+/*  Attribute fields written for each feature (the point geometry is the position).  */
+
+#define OGR_SINK_CONTACT_ID     0
+#define OGR_SINK_EVENT_TIME     1
+#define OGR_SINK_DEPTH          2
+#define OGR_SINK_LENGTH         3
+#define OGR_SINK_WIDTH          4
+#define OGR_SINK_HEIGHT         5
+#define OGR_SINK_HEADING        6
+#define OGR_SINK_CONFIDENCE     7
+#define OGR_SINK_REMARKS        8
+#define OGR_SINK_DESCRIPTION    9
+#define OGR_SINK_ANALYST        10
+#define OGR_SINK_FIELDS         11
+
+
+/*  One buffer of features waiting to be written.  */
+
+typedef struct
+{
+  BFDATA_RECORD       record[OGR_SINK_BATCH];
+  char                contact_id[OGR_SINK_BATCH][60];
+  int32_t             count;
+} OGR_SINK_BUFFER;
+
+
+/*  An OGR (GDAL vector) output that gets a copy of every feature written to the BFD file.  The commit thread
+    fills the buffers in turn and the sink's own thread writes them, in order, so a slow format (or disk)
+    doesn't hold up the parse.  Only the commit thread calls these functions.  After a failure every call
+    returns -1 and error says what went wrong (only read it after a call has returned -1).  */
+
+typedef struct
+{
+  char                path[512];
+  const char          *driver;            /*  GDAL driver name  */
+  GDALDatasetH        dataset;
+  OGRLayerH           layer;
+  int32_t             field[OGR_SINK_FIELDS];  /*  Layer field index of each attribute  */
+  OGR_SINK_BUFFER     *buffer;            /*  OGR_SINK_QUEUE buffers  */
+  int32_t             fill;               /*  Buffer the commit thread is filling  */
+  int32_t             write;              /*  Next buffer for the sink thread to write  */
+  int32_t             queued;             /*  Buffers waiting for (or being written by) the sink thread  */
+  pthread_t           thread;
+  uint8_t             started;            /*  The thread is running  */
+  uint8_t             stop;
+  uint8_t             failed;             /*  The sink thread couldn't write a feature  */
+  pthread_mutex_t     mutex;
+  pthread_cond_t      work_cond;          /*  A buffer was queued (or stop was set)  */
+  pthread_cond_t      done_cond;          /*  The sink thread finished a buffer  */
+  uint64_t            features;           /*  Features written  */
+  uint64_t            stalls;             /*  Times the commit thread had to wait for a buffer  */
+  uint64_t            ns;                 /*  Sink thread time spent writing  */
+  char                error[1024];        /*  Path and GDAL error message  */
+} OGR_SINK;
+
+
+const char *ogr_sink_driver (const char *path);
+OGR_SINK *ogr_sink_open (const char *path);
+int32_t ogr_sink_add (OGR_SINK *sink, const BFDATA_RECORD *record, const char *contact_id);
+int32_t ogr_sink_close (OGR_SINK *sink);
+void ogr_sink_free (OGR_SINK *sink);
+
+
+#endif
@@ -0,0 +1,678 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "parse_cache.h"
+#include "column_map.h"
+#include "image_loader.h"
+#include "line_reader.h"
+
+
+/*  Number of optional float values (PARSE_CACHE_DEPTH through PARSE_CACHE_HEIGHT) and the most optional bytes a
+    record can have.  */
+
+#define CACHE_FLOATS            5
+#define CACHE_OPTIONAL_MAX      (CACHE_FLOATS * sizeof (float) + sizeof (int64_t) + sizeof (int32_t) + \
+                                 sizeof (int32_t) + 4 * sizeof (int32_t) + sizeof (float))
+
+
+/*  A cache of mapped input is only good for the column mapping it was parsed with.  */
+
+static uint32_t columns_key (int32_t format, const PARSE_OPTIONS *options)
+{
+  return (format == INPUT_FORMAT_MAPPED ? options->map->key : 0);
+}
+
+
+/*  Input file modification time, in nanoseconds where we can get them so a quick edit that doesn't change
+    the size still invalidates the cache.  */
+
+static int64_t source_mtime (struct stat *st)
+{
+#ifdef NVLinux
+  return ((int64_t) st->st_mtim.tv_sec * 1000000000LL + (int64_t) st->st_mtim.tv_nsec);
+#else
+  return ((int64_t) st->st_mtime * 1000000000LL);
+#endif
+}
+
+
+
+/*  The optional float values of a BFD record, in PARSE_CACHE_ bit order.  */
+
+static void float_fields (BFDATA_RECORD *bfd_record, float **value)
+{
+  value[0] = &bfd_record->depth;
+  value[1] = &bfd_record->heading;
+  value[2] = &bfd_record->length;
+  value[3] = &bfd_record->width;
+  value[4] = &bfd_record->height;
+}
+
+
+
+/*  Bytes of optional values a record with these fields bits has.  */
+
+static size_t optional_size (uint8_t fields)
+{
+  size_t              size = 0;
+  int32_t             i;
+
+
+  for (i = 0 ; i < CACHE_FLOATS ; i++) if (fields & (1 << i)) size += sizeof (float);
+
+  if (fields & PARSE_CACHE_TIME) size += sizeof (int64_t) + sizeof (int32_t);
+  if (fields & PARSE_CACHE_WIDE_NSEC) size += sizeof (int32_t);
+  if (fields & PARSE_CACHE_DTG) size += 4 * sizeof (int32_t) + sizeof (float);
+
+  return (size);
+}
+
+
+
+/*  Breaks an event time down to the DTG fields the contact ID is built from, the way cvtime does (to the whole
+    second, which is all the contact ID uses).  cvtime itself is only called once per day.  */
+
+static void event_dtg (PARSE_CACHE_DAY *memo, time_t tv_sec, int32_t *year, int32_t *day, int32_t *hour, int32_t *minute,
+                       float *second)
+{
+  int64_t             days, rest;
+  int32_t             h, m;
+  float               s;
+
+
+  days = (int64_t) tv_sec / 86400;
+  rest = (int64_t) tv_sec - days * 86400;
+
+  if (rest < 0)
+    {
+      days--;
+      rest += 86400;
+    }
+
+  if (!memo->valid || memo->day != days)
+    {
+      cvtime ((time_t) (days * 86400), 0, &memo->year, &memo->jday, &h, &m, &s);
+
+      memo->year += 1900;
+      memo->day = days;
+      memo->valid = NVTrue;
+    }
+
+  *year = memo->year;
+  *day = memo->jday;
+  *hour = (int32_t) (rest / 3600);
+  *minute = (int32_t) (rest / 60 % 60);
+  *second = (float) (rest % 60);
+}
+
+
+
+/*  Builds the cache file name for an input file in path (size bytes).  With no directory the cache goes
+    next to the input.  Returns -1 (errno is ENAMETOOLONG) if the name doesn't fit.  */
+
+int32_t parse_cache_name (const char *dir, const char *input, char *path, size_t size)
+{
+  int32_t             len;
+
+
+  if (dir == NULL || !dir[0])
+    {
+      len = snprintf (path, size, "%s%s", input, PARSE_CACHE_EXTENSION);
+    }
+  else
+    {
+#ifdef WIN32
+      len = snprintf (path, size, "%s\\%s%s", dir, gen_basename ((char *) input), PARSE_CACHE_EXTENSION);
+#else
+      len = snprintf (path, size, "%s/%s%s", dir, gen_basename ((char *) input), PARSE_CACHE_EXTENSION);
+#endif
+    }
+
+  if (len < 0 || (size_t) len >= size)
+    {
+      errno = ENAMETOOLONG;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/*  Checks that a mapped cache file is complete and consistent before we commit anything from it.  */
+
+static uint8_t cache_valid (const char *data, size_t size)
+{
+  const PARSE_CACHE_HEADER  *header = (const PARSE_CACHE_HEADER *) data;
+  PARSE_CACHE_CHUNK         chunk;
+  PARSE_CACHE_RECORD        record;
+  size_t                    pos, end, optional;
+  uint64_t                  i, records = 0;
+  uint32_t                  j;
+
+
+  if (size < sizeof (PARSE_CACHE_HEADER) || header->size != size) return (NVFalse);
+
+  pos = sizeof (PARSE_CACHE_HEADER);
+
+  for (i = 0 ; i < header->chunks ; i++)
+    {
+      if (pos + sizeof (PARSE_CACHE_CHUNK) > size) return (NVFalse);
+
+      memcpy (&chunk, data + pos, sizeof (PARSE_CACHE_CHUNK));
+      pos += sizeof (PARSE_CACHE_CHUNK);
+
+      if (chunk.size > size - pos) return (NVFalse);
+
+      end = pos + chunk.size;
+
+      for (j = 0 ; j < chunk.count ; j++)
+        {
+          if (pos + PARSE_CACHE_RECORD_SIZE > end) return (NVFalse);
+
+          memcpy (&record, data + pos, PARSE_CACHE_RECORD_SIZE);
+          optional = optional_size (record.fields);
+
+          if (end - pos - PARSE_CACHE_RECORD_SIZE < optional + record.remarks_len + record.image_len ||
+              record.remarks_len >= sizeof (((BFDATA_RECORD *) 0)->remarks) ||
+              record.image_len >= sizeof (((FEATURE_RECORD *) 0)->image_name))
+            return (NVFalse);
+
+          pos += PARSE_CACHE_RECORD_SIZE + optional + record.remarks_len + record.image_len;
+        }
+
+      if (pos != end) return (NVFalse);
+
+      records += chunk.count;
+    }
+
+  return (pos == size && records == header->records);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        parse_cache_load                                    *
+*                                                                           *
+*   Purpose:            Loads the records for an input file from its parse  *
+*                       cache instead of parsing the text.  The cache is    *
+*                       mapped and committed in the same batches the text   *
+*                       was originally parsed in so the output (and         *
+*                       contact ID numbering) is identical.  .uni snippet   *
+*                       images are still read from their files.             *
+*                                                                           *
+*   Inputs:             path                -   cache file name             *
+*                       input               -   input file name             *
+*                       format              -   input format                *
+*                       now                 -   run time (event time for    *
+*                                               .txt and .csv records)      *
+*                       options             -   parse settings (column map, *
+*                                               tolerant parsing)           *
+*                       commit              -   called with each batch      *
+*                       data                -   passed through to commit    *
+*                       stats               -   stage counters to add to,   *
+*                                               or NULL to skip the timing  *
+*                                                                           *
+*   Outputs:            int32_t             -   NVTrue if the records were  *
+*                                               loaded, NVFalse if there's  *
+*                                               no up to date cache         *
+*                                                                           *
+\***************************************************************************/
+
+int32_t parse_cache_load (const char *path, const char *input, int32_t format, const CONTACT_TIME *now,
+                          const PARSE_OPTIONS *options, COMMIT_FUNC commit, void *data, INGEST_STATS *stats)
+{
+  LINE_READER         reader;
+  PARSE_CACHE_HEADER  header;
+  PARSE_CACHE_CHUNK   chunk;
+  PARSE_CACHE_RECORD  record;
+  PARSE_CACHE_DAY     memo;
+  RECORD_BATCH        batch;
+  FEATURE_RECORD      *feature, *records;
+  BFDATA_RECORD       *bfd_record;
+  struct stat         st;
+  const char          *ptr;
+  float               *value[CACHE_FLOATS];
+  int64_t             tv_sec, wide_nsec;
+  int32_t             tv_nsec;
+  size_t              pos;
+  uint64_t            i, start = 0;
+  uint32_t            j;
+  int32_t             k;
+
+
+  if (stat (input, &st) < 0) return (NVFalse);
+
+
+  /*  The line reader maps the file for us (or reads it in on Windoze).  */
+
+  if (line_reader_open (&reader, path) < 0) return (NVFalse);
+
+  if (reader.stream || reader.size < sizeof (PARSE_CACHE_HEADER))
+    {
+      line_reader_close (&reader);
+      return (NVFalse);
+    }
+
+  memcpy (&header, reader.data, sizeof (PARSE_CACHE_HEADER));
+
+  if (memcmp (header.magic, PARSE_CACHE_MAGIC, sizeof (header.magic)) || header.version != PARSE_CACHE_VERSION ||
+      header.byte_order != PARSE_CACHE_BYTE_ORDER || header.record_size != (int32_t) PARSE_CACHE_RECORD_SIZE ||
+      header.format != format || header.columns != columns_key (format, options) || header.source_size != (int64_t) st.st_size ||
+      header.source_mtime != source_mtime (&st) || !cache_valid (reader.data, reader.size))
+    {
+      line_reader_close (&reader);
+      return (NVFalse);
+    }
+
+
+  memset (&batch, 0, sizeof (RECORD_BATCH));
+  memset (&memo, 0, sizeof (PARSE_CACHE_DAY));
+  batch.timed = (stats != NULL);
+
+  pos = sizeof (PARSE_CACHE_HEADER);
+
+  for (i = 0 ; i < header.chunks ; i++)
+    {
+      if (stats != NULL) start = stats_clock_ns ();
+
+      memcpy (&chunk, reader.data + pos, sizeof (PARSE_CACHE_CHUNK));
+      pos += sizeof (PARSE_CACHE_CHUNK);
+
+      if (stats != NULL)
+        {
+          stats->bytes_read += chunk.size;
+          stats->chunks++;
+        }
+
+      /*  Out of memory is handed to commit the same way parse_chunk would.  */
+
+      if ((int32_t) chunk.count > batch.size)
+        {
+          if ((records = (FEATURE_RECORD *) realloc (batch.record, chunk.count * sizeof (FEATURE_RECORD))) == NULL)
+            {
+              batch.count = 0;
+              batch.error = ENOMEM;
+              pipeline_commit (&batch, commit, data, stats);
+              break;
+            }
+
+          batch.record = records;
+          batch.size = chunk.count;
+        }
+
+      batch.count = chunk.count;
+      batch.lines = chunk.lines;
+      batch.lines_skipped = chunk.lines_skipped;
+      batch.blank_lines = chunk.blank_lines;
+      batch.input_offset = chunk.input_offset;
+      batch.parse_ns = batch.time_ns = batch.image_ns = 0;
+      batch.image_used = 0;
+
+      for (j = 0 ; j < chunk.count ; j++)
+        {
+          feature = &batch.record[j];
+          bfd_record = &feature->bfd_record;
+
+          memcpy (&record, reader.data + pos, PARSE_CACHE_RECORD_SIZE);
+          ptr = reader.data + pos + PARSE_CACHE_RECORD_SIZE;
+
+          memset (bfd_record, 0, sizeof (BFDATA_RECORD));
+
+          bfd_record->latitude = record.latitude;
+          bfd_record->longitude = record.longitude;
+
+          float_fields (bfd_record, value);
+          for (k = 0 ; k < CACHE_FLOATS ; k++)
+            {
+              if (record.fields & (1 << k))
+                {
+                  memcpy (value[k], ptr, sizeof (float));
+                  ptr += sizeof (float);
+                }
+            }
+
+          bfd_record->confidence_level = FEATURE_CONFIDENCE;
+          strcpy (bfd_record->analyst_activity, FEATURE_ANALYST);
+
+          if (record.fields & PARSE_CACHE_TIME)
+            {
+              memcpy (&tv_sec, ptr, sizeof (int64_t));
+              ptr += sizeof (int64_t);
+              bfd_record->event_tv_sec = (time_t) tv_sec;
+
+              if (record.fields & PARSE_CACHE_WIDE_NSEC)
+                {
+                  memcpy (&wide_nsec, ptr, sizeof (int64_t));
+                  ptr += sizeof (int64_t);
+                  bfd_record->event_tv_nsec = wide_nsec;
+                }
+              else
+                {
+                  memcpy (&tv_nsec, ptr, sizeof (int32_t));
+                  ptr += sizeof (int32_t);
+                  bfd_record->event_tv_nsec = tv_nsec;
+                }
+
+              if (record.fields & PARSE_CACHE_DTG)
+                {
+                  memcpy (&feature->year, ptr, sizeof (int32_t));
+                  memcpy (&feature->day, ptr + 4, sizeof (int32_t));
+                  memcpy (&feature->hour, ptr + 8, sizeof (int32_t));
+                  memcpy (&feature->minute, ptr + 12, sizeof (int32_t));
+                  memcpy (&feature->second, ptr + 16, sizeof (float));
+                  ptr += 4 * sizeof (int32_t) + sizeof (float);
+                }
+              else
+                {
+                  event_dtg (&memo, bfd_record->event_tv_sec, &feature->year, &feature->day, &feature->hour,
+                             &feature->minute, &feature->second);
+                }
+            }
+          else
+            {
+              bfd_record->event_tv_sec = now->tv_sec;
+              bfd_record->event_tv_nsec = now->tv_nsec;
+              feature->year = now->year;
+              feature->day = now->day;
+              feature->hour = now->hour;
+              feature->minute = now->minute;
+              feature->second = now->second;
+            }
+
+          memcpy (bfd_record->remarks, ptr, record.remarks_len);
+          ptr += record.remarks_len;
+
+          memcpy (feature->image_name, ptr, record.image_len);
+          feature->image_name[record.image_len] = 0;
+          feature->image_status = IMAGE_NONE;
+
+          pos = ptr + record.image_len - reader.data;
+        }
+
+      if (stats != NULL) batch.parse_ns = stats_clock_ns () - start;
+
+
+      if (input_has_images (format, options))
+        {
+          if (stats != NULL) start = stats_clock_ns ();
+
+          image_load_batch (&batch);
+
+          if (stats != NULL) batch.image_ns = stats_clock_ns () - start;
+        }
+
+      if (pipeline_commit (&batch, commit, data, stats) < 0) break;
+    }
+
+  record_batch_free (&batch);
+  line_reader_close (&reader);
+
+  return (NVTrue);
+}
+
+
+
+/*  Starts writing a new cache for an input file.  It's written to a temporary file and only renamed into
+    place by parse_cache_finish once the whole input has been parsed.  Returns -1 (errno is set) if the
+    cache can't be written, in which case the input should just be parsed without it.  */
+
+int32_t parse_cache_create (PARSE_CACHE_WRITER *cache, const char *path, const char *input, int32_t format,
+                            const PARSE_OPTIONS *options, COMMIT_FUNC commit, void *data)
+{
+  struct stat         st;
+
+
+  memset (cache, 0, sizeof (PARSE_CACHE_WRITER));
+
+  if (strlen (path) + 4 >= sizeof (cache->temp))
+    {
+      errno = ENAMETOOLONG;
+      return (-1);
+    }
+
+  if (stat (input, &st) < 0) return (-1);
+
+  strcpy (cache->path, path);
+  sprintf (cache->temp, "%s.tmp", path);
+
+  if ((cache->fp = fopen (cache->temp, "wb")) == NULL) return (-1);
+
+  memcpy (cache->header.magic, PARSE_CACHE_MAGIC, sizeof (cache->header.magic));
+  cache->header.version = PARSE_CACHE_VERSION;
+  cache->header.byte_order = PARSE_CACHE_BYTE_ORDER;
+  cache->header.format = format;
+  cache->header.columns = columns_key (format, options);
+  cache->header.record_size = PARSE_CACHE_RECORD_SIZE;
+  cache->header.source_size = (int64_t) st.st_size;
+  cache->header.source_mtime = source_mtime (&st);
+  cache->header.size = sizeof (PARSE_CACHE_HEADER);
+  cache->options = options;
+  cache->commit = commit;
+  cache->data = data;
+
+
+  /*  The header is rewritten with the real counts when we're done.  */
+
+  if (fwrite (&cache->header, sizeof (PARSE_CACHE_HEADER), 1, cache->fp) != 1)
+    {
+      cache->error = errno;
+      fclose (cache->fp);
+      remove (cache->temp);
+      errno = cache->error;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/*  Pipeline commit function.  Adds the batch to the cache (before commit gets to change anything in it)
+    and then hands it on.  A write error just means there won't be a cache, it's what commit returns that
+    counts.  */
+
+int32_t parse_cache_commit (RECORD_BATCH *batch, void *data)
+{
+  PARSE_CACHE_WRITER  *cache = (PARSE_CACHE_WRITER *) data;
+  PARSE_CACHE_CHUNK   chunk;
+  PARSE_CACHE_RECORD  record;
+  FEATURE_RECORD      *feature;
+  uint8_t             *ptr, *buffer;
+  float               *value[CACHE_FLOATS], second;
+  int32_t             year, day, hour, minute;
+  int64_t             tv_sec, tv_nsec;
+  int32_t             short_nsec;
+  size_t              need;
+  int32_t             i, k;
+
+
+  if (batch->error) cache->error = batch->error;
+
+  if (!cache->error)
+    {
+      need = 0;
+      for (i = 0 ; i < batch->count ; i++)
+        need += PARSE_CACHE_RECORD_SIZE + CACHE_OPTIONAL_MAX + strlen (batch->record[i].bfd_record.remarks) +
+          strlen (batch->record[i].image_name);
+
+      if (need > cache->buffer_size)
+        {
+          if ((buffer = (uint8_t *) realloc (cache->buffer, need)) == NULL)
+            {
+              cache->error = ENOMEM;
+              return ((*cache->commit) (batch, cache->data));
+            }
+
+          cache->buffer = buffer;
+          cache->buffer_size = need;
+        }
+
+      ptr = cache->buffer;
+
+      for (i = 0 ; i < batch->count ; i++)
+        {
+          feature = &batch->record[i];
+
+          memset (&record, 0, sizeof (PARSE_CACHE_RECORD));
+
+          record.latitude = feature->bfd_record.latitude;
+          record.longitude = feature->bfd_record.longitude;
+          record.remarks_len = (uint8_t) strlen (feature->bfd_record.remarks);
+          record.image_len = (uint16_t) strlen (feature->image_name);
+
+          float_fields (&feature->bfd_record, value);
+          for (k = 0 ; k < CACHE_FLOATS ; k++) if (*value[k] != 0.0) record.fields |= (1 << k);
+
+          if (input_has_times (cache->header.format, cache->options))
+            {
+              record.fields |= PARSE_CACHE_TIME;
+
+              event_dtg (&cache->day, feature->bfd_record.event_tv_sec, &year, &day, &hour, &minute, &second);
+
+              if (feature->year != year || feature->day != day || feature->hour != hour || feature->minute != minute ||
+                  !(feature->second >= 0.0 && (int32_t) feature->second == (int32_t) second))
+                record.fields |= PARSE_CACHE_DTG;
+
+              if (feature->bfd_record.event_tv_nsec < INT32_MIN || feature->bfd_record.event_tv_nsec > INT32_MAX)
+                record.fields |= PARSE_CACHE_WIDE_NSEC;
+            }
+
+          memcpy (ptr, &record, PARSE_CACHE_RECORD_SIZE);
+          ptr += PARSE_CACHE_RECORD_SIZE;
+
+          for (k = 0 ; k < CACHE_FLOATS ; k++)
+            {
+              if (record.fields & (1 << k))
+                {
+                  memcpy (ptr, value[k], sizeof (float));
+                  ptr += sizeof (float);
+                }
+            }
+
+          if (record.fields & PARSE_CACHE_TIME)
+            {
+              tv_sec = (int64_t) feature->bfd_record.event_tv_sec;
+              memcpy (ptr, &tv_sec, sizeof (int64_t));
+              ptr += sizeof (int64_t);
+
+              tv_nsec = (int64_t) feature->bfd_record.event_tv_nsec;
+              if (record.fields & PARSE_CACHE_WIDE_NSEC)
+                {
+                  memcpy (ptr, &tv_nsec, sizeof (int64_t));
+                  ptr += sizeof (int64_t);
+                }
+              else
+                {
+                  short_nsec = (int32_t) tv_nsec;
+                  memcpy (ptr, &short_nsec, sizeof (int32_t));
+                  ptr += sizeof (int32_t);
+                }
+            }
+
+          if (record.fields & PARSE_CACHE_DTG)
+            {
+              memcpy (ptr, &feature->year, sizeof (int32_t));
+              memcpy (ptr + 4, &feature->day, sizeof (int32_t));
+              memcpy (ptr + 8, &feature->hour, sizeof (int32_t));
+              memcpy (ptr + 12, &feature->minute, sizeof (int32_t));
+              memcpy (ptr + 16, &feature->second, sizeof (float));
+              ptr += 4 * sizeof (int32_t) + sizeof (float);
+            }
+
+          memcpy (ptr, feature->bfd_record.remarks, record.remarks_len);
+          ptr += record.remarks_len;
+
+          memcpy (ptr, feature->image_name, record.image_len);
+          ptr += record.image_len;
+        }
+
+      chunk.input_offset = batch->input_offset;
+      chunk.size = ptr - cache->buffer;
+      chunk.count = batch->count;
+      chunk.lines = batch->lines;
+      chunk.lines_skipped = batch->lines_skipped;
+      chunk.blank_lines = batch->blank_lines;
+
+      if (fwrite (&chunk, sizeof (PARSE_CACHE_CHUNK), 1, cache->fp) != 1 ||
+          (chunk.size && fwrite (cache->buffer, chunk.size, 1, cache->fp) != 1))
+        {
+          cache->error = errno ? errno : EIO;
+        }
+      else
+        {
+          cache->header.chunks++;
+          cache->header.records += batch->count;
+          cache->header.size += sizeof (PARSE_CACHE_CHUNK) + chunk.size;
+        }
+    }
+
+  return ((*cache->commit) (batch, cache->data));
+}
+
+
+
+/*  Finishes the cache and renames it into place if keep is set and nothing went wrong, otherwise throws
+    it away.  Returns -1 (errno is set) if the cache couldn't be written.  */
+
+int32_t parse_cache_finish (PARSE_CACHE_WRITER *cache, uint8_t keep)
+{
+  if (keep && !cache->error)
+    {
+      if (fseek (cache->fp, 0, SEEK_SET) || fwrite (&cache->header, sizeof (PARSE_CACHE_HEADER), 1, cache->fp) != 1)
+        cache->error = errno ? errno : EIO;
+    }
+
+  if (fclose (cache->fp) && !cache->error) cache->error = errno ? errno : EIO;
+
+  free (cache->buffer);
+  cache->buffer = NULL;
+
+  if (!keep || cache->error)
+    {
+      remove (cache->temp);
+
+      if (!cache->error) return (0);
+
+      errno = cache->error;
+      return (-1);
+    }
+
+#ifdef WIN32
+  remove (cache->path);
+#endif
+
+  if (rename (cache->temp, cache->path) < 0)
+    {
+      cache->error = errno;
+      remove (cache->temp);
+      errno = cache->error;
+      return (-1);
+    }
+
+  return (0);
+}
@@ -0,0 +1,150 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __PARSE_CACHE_H__
+#define __PARSE_CACHE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "pipeline.h"
+
+
+/*  A parse cache holds the records parsed from one input file so later runs can load them without
+    parsing the text again.  It's laid out as
+
+        PARSE_CACHE_HEADER
+        for each batch (the same batches the text was parsed in):
+            PARSE_CACHE_CHUNK
+            for each record:
+                PARSE_CACHE_RECORD (the first PARSE_CACHE_RECORD_SIZE bytes of it)
+                the optional values its fields bits say are there, in bit order
+                remarks, then image name (no terminators)
+
+    in native byte order with no padding (everything is copied in and out with memcpy).  It's only used if
+    the version, byte order, record size, input format (and column mapping), and the input file's size and
+    modification time all match, otherwise it's rebuilt.  */
+
+#define PARSE_CACHE_MAGIC       "BFDPCACH"
+#define PARSE_CACHE_VERSION     3
+#define PARSE_CACHE_BYTE_ORDER  0x01020304
+#define PARSE_CACHE_EXTENSION   ".bfp"
+
+
+typedef struct
+{
+  char                magic[8];
+  uint32_t            version;
+  uint32_t            byte_order;
+  int32_t             format;
+  int32_t             record_size;        /*  PARSE_CACHE_RECORD_SIZE  */
+  uint32_t            columns;            /*  Column mapping key for INPUT_FORMAT_MAPPED (0 otherwise)  */
+  uint32_t            spare;
+  int64_t             source_size;        /*  Input file size and modification time when it was parsed  */
+  int64_t             source_mtime;       /*  Nanoseconds  */
+  uint64_t            chunks;
+  uint64_t            records;
+  uint64_t            size;               /*  Size of the whole cache file  */
+} PARSE_CACHE_HEADER;
+
+
+typedef struct
+{
+  uint64_t            input_offset;       /*  Input byte offset just past the chunk's lines  */
+  uint64_t            size;               /*  Bytes of records (and their strings) that follow  */
+  uint32_t            count;
+  uint32_t            lines;
+  uint32_t            lines_skipped;
+  uint32_t            blank_lines;
+} PARSE_CACHE_CHUNK;
+
+
+/*  The optional values that can follow a record, in this order.  A float that's zero isn't stored.  The event
+    time is only stored for formats that have one (.txt and .csv records get the time of the run that loads
+    them).  The DTG the contact ID is built from is only stored when it isn't what the event time breaks down
+    to (an out of range DTG that mktime normalized).  */
+
+#define PARSE_CACHE_DEPTH       0x01    /*  float  */
+#define PARSE_CACHE_HEADING     0x02    /*  float  */
+#define PARSE_CACHE_LENGTH      0x04    /*  float  */
+#define PARSE_CACHE_WIDTH       0x08    /*  float  */
+#define PARSE_CACHE_HEIGHT      0x10    /*  float  */
+#define PARSE_CACHE_TIME        0x20    /*  int64_t seconds, int32_t (or int64_t) nanoseconds  */
+#define PARSE_CACHE_DTG         0x40    /*  int32_t year, day, hour, minute, float second  */
+#define PARSE_CACHE_WIDE_NSEC   0x80    /*  The event time nanoseconds are an int64_t (a DTG like 07:25:-3.5)  */
+
+
+/*  The fixed part of a record.  Everything else in the BFD record is either constant or filled in when it's
+    committed.  */
+
+typedef struct
+{
+  double              latitude;
+  double              longitude;
+  uint16_t            image_len;
+  uint8_t             remarks_len;
+  uint8_t             fields;             /*  PARSE_CACHE_ bits of the values that follow  */
+} PARSE_CACHE_RECORD;
+
+#define PARSE_CACHE_RECORD_SIZE (offsetof (PARSE_CACHE_RECORD, fields) + 1)
+
+
+/*  The last day an event time was broken down for, so cvtime is only called once a day.  */
+
+typedef struct
+{
+  int64_t             day;                /*  Days since 1970  */
+  int32_t             year;
+  int32_t             jday;
+  uint8_t             valid;
+} PARSE_CACHE_DAY;
+
+
+/*  Writes a cache as a side effect of committing the batches parsed from the text.  parse_cache_commit
+    is used as the pipeline commit function and passes each batch on to commit.  */
+
+typedef struct
+{
+  FILE                *fp;
+  char                path[1024];
+  char                temp[1024];
+  PARSE_CACHE_HEADER  header;
+  uint8_t             *buffer;
+  size_t              buffer_size;
+  PARSE_CACHE_DAY     day;
+  const PARSE_OPTIONS *options;
+  int32_t             error;              /*  errno from a failed write (0 if none)  */
+  COMMIT_FUNC         commit;
+  void                *data;
+} PARSE_CACHE_WRITER;
+
+
+int32_t parse_cache_name (const char *dir, const char *input, char *path, size_t size);
+int32_t parse_cache_load (const char *path, const char *input, int32_t format, const CONTACT_TIME *now,
+                          const PARSE_OPTIONS *options, COMMIT_FUNC commit, void *data, INGEST_STATS *stats);
+int32_t parse_cache_create (PARSE_CACHE_WRITER *cache, const char *path, const char *input, int32_t format,
+                            const PARSE_OPTIONS *options, COMMIT_FUNC commit, void *data);
+int32_t parse_cache_commit (RECORD_BATCH *batch, void *data);
+int32_t parse_cache_finish (PARSE_CACHE_WRITER *cache, uint8_t keep);
+
+
+#endif
@@ -0,0 +1,768 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <math.h>
+
+#include "parse_record.h"
+#include "column_map.h"
+#include "image_loader.h"
+#include "sget_coord.h"
+
+
+static const char *format_name[4] = {".csv", ".txt", ".uni", "mapped"};
+
+static const char *reject_name[REJECT_REASONS] = {"none", "too few fields", "bad latitude", "bad longitude",
+                                                  "bad DTG"};
+
+
+const char *input_format_name (int32_t format)
+{
+  return (format_name[format]);
+}
+
+
+
+/*  Pick the input format from the file name.  */
+
+int32_t input_format (const char *path)
+{
+  if (strstr (path, ".txt")) return (INPUT_FORMAT_TXT);
+  if (strstr (path, ".uni")) return (INPUT_FORMAT_UNI);
+
+  return (INPUT_FORMAT_CSV);
+}
+
+
+
+/*  Pick the input format from a --format option value ("txt", "uni", or "csv", with or without the dot).
+    Returns -1 if we don't recognize it.  */
+
+int32_t input_format_from_name (const char *name)
+{
+  int32_t             i;
+
+
+  if (name[0] == '.') name++;
+
+  for (i = INPUT_FORMAT_CSV ; i <= INPUT_FORMAT_UNI ; i++) if (!strcmp (name, &format_name[i][1])) return (i);
+
+  return (-1);
+}
+
+
+
+/*  Whether the records of a format get their event times from the input (instead of the run time).  */
+
+uint8_t input_has_times (int32_t format, const PARSE_OPTIONS *options)
+{
+  if (format == INPUT_FORMAT_MAPPED) return (options->map->has_time);
+
+  return (format == INPUT_FORMAT_UNI);
+}
+
+
+
+/*  Whether the records of a format can have snippet images.  */
+
+uint8_t input_has_images (int32_t format, const PARSE_OPTIONS *options)
+{
+  if (format == INPUT_FORMAT_MAPPED) return (options->map->has_image);
+
+  return (format == INPUT_FORMAT_UNI);
+}
+
+
+
+const char *reject_reason_name (int32_t reason)
+{
+  return (reject_name[reason]);
+}
+
+
+
+/*  Whether a format's DTGs have to be converted to event times.  */
+
+static uint8_t has_dtg (int32_t format, const PARSE_OPTIONS *options)
+{
+  if (format == INPUT_FORMAT_MAPPED) return (options->map->has_dtg);
+
+  return (format == INPUT_FORMAT_UNI);
+}
+
+
+
+/*  Why a position is bad (REJECT_NONE if it isn't).  */
+
+static uint8_t position_reject (double latitude, double longitude)
+{
+  if (!(fabs (latitude) <= 90.0)) return (REJECT_LATITUDE);
+  if (!(fabs (longitude) <= 180.0)) return (REJECT_LONGITUDE);
+
+  return (REJECT_NONE);
+}
+
+
+
+/*  Why a .txt line is bad (REJECT_NONE if it isn't).  */
+
+static uint8_t coord_reject (const COORD_RECORD *coord)
+{
+  if (coord->fields < 2) return (REJECT_FIELDS);
+  if (!coord->lat_values || coord->lat_degrees > 90.0) return (REJECT_LATITUDE);
+  if (!coord->lon_values || coord->lon_degrees > 180.0) return (REJECT_LONGITUDE);
+
+  return (REJECT_NONE);
+}
+
+
+
+/*  Everything parse_line does except converting the .uni DTG to the event time.  fields walks the line's
+    comma separated fields.  Only lines with an L or l in them (maybe_header) can be header lines.  If
+    convert is set the position (or DTG) isn't converted, it's staged in the next convert row for
+    convert_rows.  If reason is set the line is checked as well and, if it's bad, NVFalse is returned with
+    *reason set to why (it's REJECT_NONE for header and blank lines).  */
+
+static uint8_t parse_fields (int32_t format, const PARSE_OPTIONS *options, STRING_VIEW line, FIELD_CURSOR *fields,
+                             uint8_t maybe_header, const CONTACT_TIME *now, FEATURE_RECORD *feature,
+                             CONVERT_BATCH *convert, uint8_t *reason)
+{
+  BFDATA_RECORD       *bfd_record = &feature->bfd_record;
+  const COLUMN_MAP    *map;
+  STRING_VIEW         field;
+  COORD_RECORD        coord;
+  int32_t             month = 0, mday = 0, row, col, check, latdeg = 0, latmin = 0, latsec = 0, londeg = 0,
+                      lonmin = 0, lonsec = 0, values, found;
+  size_t              i;
+  float               depth;
+  int32_t             n;
+
+
+  if (reason != NULL) *reason = REJECT_NONE;
+
+
+  /*  Skip blank lines.  */
+
+  if (!line.len || (line.len == 1 && line.ptr[0] == '\r')) return (NVFalse);
+
+
+  /*  Drop the header if it's there.  A column mapping has its own test (see column_map_parse).  */
+
+  if (format != INPUT_FORMAT_MAPPED && maybe_header && ((sv_contains (line, "LONG") && sv_contains (line, "LAT")) || sv_contains (line, "latitude")))
+    return (NVFalse);
+
+
+  memset (bfd_record, 0, sizeof (BFDATA_RECORD));
+
+
+  /*  The .txt and .csv records don't have a time so they get the time of the run.  It was broken down once
+      up front so there's nothing to convert here.  */
+
+  feature->year = now->year;
+  feature->day = now->day;
+  feature->hour = now->hour;
+  feature->minute = now->minute;
+  feature->second = now->second;
+  bfd_record->event_tv_sec = now->tv_sec;
+  bfd_record->event_tv_nsec = now->tv_nsec;
+
+
+  feature->image_name[0] = 0;
+  feature->image_status = IMAGE_NONE;
+
+  switch (format)
+    {
+    case INPUT_FORMAT_TXT:
+      if (convert != NULL)
+        {
+          sget_coord_scan (fields, &coord);
+
+          if (reason != NULL && (*reason = coord_reject (&coord))) return (NVFalse);
+
+          n = convert->count;
+          convert->lat_total[n] = coord.lat_degrees;
+          convert->lat_negative[n] = (coord.lat_hemi == 'S');
+          convert->lon_total[n] = coord.lon_degrees;
+          convert->lon_negative[n] = (coord.lon_hemi == 'W');
+
+          sv_copy (coord.remarks, bfd_record->remarks, sizeof (bfd_record->remarks));
+          bfd_record->depth = coord.depth;
+          break;
+        }
+
+      sget_coord_fields (fields, &coord);
+
+      if (reason != NULL && (*reason = coord_reject (&coord))) return (NVFalse);
+
+      sv_copy (coord.remarks, bfd_record->remarks, sizeof (bfd_record->remarks));
+      bfd_record->depth = coord.depth;
+
+      bfd_record->latitude = convert_dms_degrees ((double) coord.lat_deg, (double) coord.lat_min, (double) coord.lat_sec,
+                                                  coord.lat_hemi == 'S');
+      bfd_record->longitude = convert_dms_degrees ((double) coord.lon_deg, (double) coord.lon_min, (double) coord.lon_sec,
+                                                   coord.lon_hemi == 'W');
+      break;
+
+
+    case INPUT_FORMAT_UNI:
+
+      /*  Skip the unisips file name.  */
+
+      found = field_next (fields, &field);
+
+      found += field_next (fields, &field);
+      sv_copy (field, feature->image_name, sizeof (feature->image_name));
+
+      found += field_next (fields, &field);
+      values = sv_scanf (field, "%lf", &bfd_record->latitude);
+
+      if (reason != NULL && (values != 1 || !(fabs (bfd_record->latitude) <= 90.0))) *reason = REJECT_LATITUDE;
+
+      found += field_next (fields, &field);
+      values = sv_scanf (field, "%lf", &bfd_record->longitude);
+
+      if (reason != NULL && !*reason && (values != 1 || !(fabs (bfd_record->longitude) <= 180.0)))
+        *reason = REJECT_LONGITUDE;
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%d", &row);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%d", &col);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "B: %f / T: %f /  A: %f", &bfd_record->depth, &bfd_record->width, &bfd_record->height);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%f", &bfd_record->heading);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%f", &bfd_record->length);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%f", &bfd_record->width);
+
+      found += field_next (fields, &field);
+      sv_scanf (field, "%f", &bfd_record->height);
+
+      found += field_next (fields, &field);
+      values = dtg_parse (field, &feature->year, &month, &mday, &feature->hour, &feature->minute, &feature->second);
+
+
+      /*  A line that's been cut short is reported as that, not as whatever field it happened to end in.  */
+
+      if (reason != NULL)
+        {
+          if (found < 12)
+            {
+              *reason = REJECT_FIELDS;
+            }
+          else if (!*reason && (values != 6 || !dtg_valid (feature->year, month, mday, feature->hour, feature->minute,
+                                                           feature->second)))
+            {
+              *reason = REJECT_DTG;
+            }
+
+          if (*reason) return (NVFalse);
+        }
+
+      if (convert != NULL)
+        {
+          n = convert->count;
+          convert->year[n] = feature->year;
+          convert->month[n] = month;
+          convert->mday[n] = mday;
+          convert->hour[n] = feature->hour;
+          convert->minute[n] = feature->minute;
+          convert->second[n] = feature->second;
+          break;
+        }
+
+      dtg_jday (feature->year, month, mday, &feature->day);
+      break;
+
+
+    case INPUT_FORMAT_MAPPED:
+      map = options->map;
+
+      found = column_map_parse (map, fields, feature, convert);
+
+      if (reason != NULL && found > 0 && found < map->columns)
+        {
+          *reason = REJECT_FIELDS;
+          return (NVFalse);
+        }
+
+      if (found <= map->header_column) return (NVFalse);
+
+      /*  The positions have already been converted.  A DTG is still sitting in its convert row.  */
+
+      if (reason != NULL)
+        {
+          *reason = position_reject (bfd_record->latitude, bfd_record->longitude);
+
+          if (!*reason && map->has_dtg && convert != NULL)
+            {
+              n = convert->count;
+
+              if (!dtg_valid (convert->year[n], convert->month[n], convert->mday[n], convert->hour[n], convert->minute[n],
+                              convert->second[n]))
+                *reason = REJECT_DTG;
+            }
+
+          if (*reason) return (NVFalse);
+        }
+      break;
+
+
+    default:
+
+      /*  Look for the second comma.  */
+
+      if (fields->comma != NULL)
+        {
+          i = (fields->comma_end - fields->comma >= 2) ? (size_t) (fields->base + fields->comma[1] - line.ptr) : line.len;
+        }
+      else
+        {
+          check = 0;
+          for (i = 0 ; i < line.len ; i++)
+            {
+              if (line.ptr[i] == ',') check++;
+              if (check == 2) break;
+            }
+        }
+
+      snprintf (bfd_record->remarks, sizeof (bfd_record->remarks), "NAVO - %.*s", (int32_t) i, line.ptr);
+
+      if (i < line.len)
+        {
+          field = sv_make (line.ptr + i + 1, line.len - i - 1);
+        }
+      else
+        {
+          field = sv_make (line.ptr + line.len, 0);
+        }
+
+      values = sv_scanf (field, "%d %d %d,%d %d %d, %f", &londeg, &lonmin, &lonsec, &latdeg, &latmin, &latsec, &depth);
+
+      if (reason != NULL)
+        {
+          if (i >= line.len)
+            {
+              *reason = REJECT_FIELDS;
+            }
+          else if (values < 3 || lonmin < 0 || lonmin >= 60 || lonsec < 0 || lonsec >= 60 ||
+                   abs (londeg) * 3600 + lonmin * 60 + lonsec > 180 * 3600)
+            {
+              *reason = REJECT_LONGITUDE;
+            }
+          else if (values < 6 || latmin < 0 || latmin >= 60 || latsec < 0 || latsec >= 60 ||
+                   abs (latdeg) * 3600 + latmin * 60 + latsec > 90 * 3600)
+            {
+              *reason = REJECT_LATITUDE;
+            }
+
+          if (*reason) return (NVFalse);
+        }
+
+      if (convert != NULL)
+        {
+          n = convert->count;
+          convert->lat_deg[n] = (double) latdeg;
+          convert->lat_min[n] = (double) latmin;
+          convert->lat_sec[n] = (double) latsec;
+          convert->lat_negative[n] = (latdeg < 0);
+          convert->lon_deg[n] = (double) londeg;
+          convert->lon_min[n] = (double) lonmin;
+          convert->lon_sec[n] = (double) lonsec;
+          convert->lon_negative[n] = (londeg < 0);
+          break;
+        }
+
+      bfd_record->latitude = convert_dms_degrees ((double) latdeg, (double) latmin, (double) latsec, latdeg < 0);
+      bfd_record->longitude = convert_dms_degrees ((double) londeg, (double) lonmin, (double) lonsec, londeg < 0);
+      break;
+    }
+
+  bfd_record->confidence_level = FEATURE_CONFIDENCE;
+  strcpy (bfd_record->analyst_activity, FEATURE_ANALYST);
+
+  if (convert != NULL) convert->count++;
+
+  return (NVTrue);
+}
+
+
+
+/*  Converts the DTG of a .uni (or mapped) record to the BFD event time.  */
+
+static void uni_event_time (CONVERT_CHECK *check, FEATURE_RECORD *feature)
+{
+  convert_event_time (check, feature->year, feature->day, feature->hour, feature->minute, feature->second,
+                      &feature->bfd_record.event_tv_sec, &feature->bfd_record.event_tv_nsec);
+}
+
+
+
+/*  Runs the conversions on the rows parse_fields staged and puts the results in their records.  */
+
+static void convert_rows (int32_t format, const PARSE_OPTIONS *options, RECORD_BATCH *batch)
+{
+  CONVERT_BATCH       *convert = batch->convert;
+  FEATURE_RECORD      *feature = &batch->record[convert->first];
+  uint64_t            start = 0;
+  int32_t             i;
+
+
+  switch (format)
+    {
+    case INPUT_FORMAT_MAPPED:
+
+      /*  The positions were converted as they were parsed.  */
+
+      if (!has_dtg (format, options)) break;
+#ifdef NVLinux
+      __attribute__ ((fallthrough));
+#endif
+
+    case INPUT_FORMAT_UNI:
+      if (batch->timed) start = stats_clock_ns ();
+
+      convert_event_times (convert);
+
+      if (batch->timed) batch->time_ns += stats_clock_ns () - start;
+
+      for (i = 0 ; i < convert->count ; i++)
+        {
+          feature[i].day = convert->day[i];
+          feature[i].bfd_record.event_tv_sec = convert->tv_sec[i];
+          feature[i].bfd_record.event_tv_nsec = convert->tv_nsec[i];
+        }
+      break;
+
+
+    case INPUT_FORMAT_TXT:
+      convert_split_degrees (convert->count, convert->lat_total, convert->lat_deg, convert->lat_min, convert->lat_sec);
+      convert_split_degrees (convert->count, convert->lon_total, convert->lon_deg, convert->lon_min, convert->lon_sec);
+#ifdef NVLinux
+      __attribute__ ((fallthrough));
+#endif
+
+    default:
+      convert_degrees (convert->count, convert->lat_deg, convert->lat_min, convert->lat_sec, convert->lat_negative,
+                       convert->latitude);
+      convert_degrees (convert->count, convert->lon_deg, convert->lon_min, convert->lon_sec, convert->lon_negative,
+                       convert->longitude);
+
+      for (i = 0 ; i < convert->count ; i++)
+        {
+          feature[i].bfd_record.latitude = convert->latitude[i];
+          feature[i].bfd_record.longitude = convert->longitude[i];
+        }
+      break;
+    }
+
+  convert->first += convert->count;
+  convert->count = 0;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        parse_line                                          *
+*                                                                           *
+*   Purpose:            Parses a single input line into a FEATURE_RECORD.   *
+*                       This only touches its arguments so any number of    *
+*                       threads can be parsing at the same time.            *
+*                                                                           *
+*   Inputs:             format              -   INPUT_FORMAT_CSV, _TXT,     *
+*                                               _UNI, or _MAPPED            *
+*                       line                -   input line (string view)    *
+*                       now                 -   run time to use as the      *
+*                                               event time for .txt and     *
+*                                               .csv                        *
+*                       options             -   column mapping (tolerant    *
+*                                               isn't used)                 *
+*                       check               -   DTG conversion checks       *
+*                                               (zeroed before the first    *
+*                                               line)                       *
+*                       feature             -   returned record             *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse if the line is a    *
+*                                               header or blank line        *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t parse_line (int32_t format, STRING_VIEW line, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                    CONVERT_CHECK *check, FEATURE_RECORD *feature)
+{
+  FIELD_CURSOR        fields;
+
+
+  field_cursor_init (&fields, line, NULL, NULL, NULL);
+
+  if (!parse_fields (format, options, line, &fields, NVTrue, now, feature, NULL, NULL)) return (NVFalse);
+
+  if (has_dtg (format, options)) uni_event_time (check, feature);
+
+  return (NVTrue);
+}
+
+
+
+/*  Adds a rejected line to the batch.  Returns -1 if there wasn't memory for it.  */
+
+static int32_t add_reject (RECORD_BATCH *batch, STRING_VIEW chunk, STRING_VIEW line, uint8_t reason)
+{
+  PARSE_REJECT        *reject;
+  char                *text;
+  size_t              size;
+  int32_t             count;
+
+
+  if (batch->rejects == batch->reject_size)
+    {
+      count = batch->reject_size ? batch->reject_size * 2 : 64;
+
+      if ((reject = (PARSE_REJECT *) realloc (batch->reject, count * sizeof (PARSE_REJECT))) == NULL) return (-1);
+
+      batch->reject = reject;
+      batch->reject_size = count;
+    }
+
+  if (line.len && line.ptr[line.len - 1] == '\r') line.len--;
+
+  if (batch->reject_text_used + line.len > batch->reject_text_size)
+    {
+      size = batch->reject_text_size ? batch->reject_text_size : 4096;
+      while (size < batch->reject_text_used + line.len) size *= 2;
+
+      if ((text = (char *) realloc (batch->reject_text, size)) == NULL) return (-1);
+
+      batch->reject_text = text;
+      batch->reject_text_size = size;
+    }
+
+  reject = &batch->reject[batch->rejects++];
+
+  reject->line = batch->lines;
+  reject->offset = line.ptr - chunk.ptr;
+  reject->text = batch->reject_text_used;
+  reject->length = line.len;
+  reject->reason = reason;
+
+  memcpy (batch->reject_text + batch->reject_text_used, line.ptr, line.len);
+  batch->reject_text_used += line.len;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        parse_chunk                                         *
+*                                                                           *
+*   Purpose:            Parses a block of complete lines into a batch of    *
+*                       records (in input order).  Used by the serial       *
+*                       loop and by the pipeline worker threads so both     *
+*                       give exactly the same output.  If load_images is    *
+*                       set the .uni snippet images are read into the       *
+*                       batch as well.  When options->tolerant is set, bad  *
+*                       lines go in the batch reject list instead.          *
+*                                                                           *
+*   Inputs:             format              -   input format                *
+*                       chunk               -   one or more complete lines  *
+*                       now                 -   run time for .txt/.csv      *
+*                       options             -   column mapping and tolerant *
+*                       batch               -   returned records            *
+*                                                                           *
+*   Outputs:            none (batch->error is set to ENOMEM, and the batch  *
+*                       has to be thrown away, if there wasn't memory to    *
+*                       parse the chunk)                                    *
+*                                                                           *
+\***************************************************************************/
+
+void parse_chunk (int32_t format, STRING_VIEW chunk, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                  RECORD_BATCH *batch)
+{
+  const char          *ptr = chunk.ptr, *end = chunk.ptr + chunk.len, *nl;
+  STRING_VIEW         line;
+  FEATURE_RECORD      *feature, *record;
+  DELIM_INDEX         *index = &batch->index;
+  FIELD_CURSOR        fields;
+  uint64_t            start = 0, total_ns;
+  size_t              line_end, next_newline = 0, next_comma = 0, last_comma, next_l = 0;
+  uint8_t             indexed, maybe_header, reason;
+  int32_t             size;
+
+
+  batch->error = 0;
+  batch->count = batch->rejects = 0;
+  batch->lines = batch->lines_skipped = batch->blank_lines = 0;
+  batch->reject_text_used = 0;
+  batch->chunk_size = chunk.len;
+  batch->parse_ns = batch->time_ns = batch->image_ns = 0;
+  batch->image_used = 0;
+
+
+  /*  The positions (and .uni DTGs) are staged and converted CONVERT_BATCH_SIZE records at a time.  */
+
+  if (batch->convert == NULL && (batch->convert = (CONVERT_BATCH *) calloc (1, sizeof (CONVERT_BATCH))) == NULL)
+    {
+      batch->error = ENOMEM;
+      return;
+    }
+
+  batch->convert->count = batch->convert->first = 0;
+
+  if (batch->timed) start = stats_clock_ns ();
+
+
+  /*  Find all of the newlines and commas in one pass instead of searching each line and field.  If
+      there isn't memory for the offsets the lines are just searched.  */
+
+  indexed = ((uint64_t) chunk.len <= DELIM_INDEX_MAX_TEXT && delim_index_build (chunk, index) == 0);
+
+  while (ptr < end)
+    {
+      if (indexed)
+        {
+          nl = (next_newline < index->newlines) ? chunk.ptr + index->newline[next_newline++] : end;
+        }
+      else if ((nl = (const char *) memchr (ptr, '\n', end - ptr)) == NULL)
+        {
+          nl = end;
+        }
+
+      line = sv_make (ptr, nl - ptr);
+      ptr = nl + 1;
+
+      batch->lines++;
+
+
+      /*  The line's commas (and L's) are the ones we haven't used yet that come before its end.  */
+
+      if (indexed)
+        {
+          line_end = nl - chunk.ptr;
+
+          for (last_comma = next_comma ; last_comma < index->commas && index->comma[last_comma] < line_end ; last_comma++);
+
+          field_cursor_init (&fields, line, chunk.ptr, index->comma + next_comma, index->comma + last_comma);
+          next_comma = last_comma;
+
+          maybe_header = NVFalse;
+          while (next_l < index->letter_ls && index->letter_l[next_l] < line_end)
+            {
+              maybe_header = NVTrue;
+              next_l++;
+            }
+        }
+      else
+        {
+          field_cursor_init (&fields, line, NULL, NULL, NULL);
+          maybe_header = NVTrue;
+        }
+
+
+      if (batch->count == batch->size)
+        {
+          size = batch->size ? batch->size * 2 : 1024;
+
+          if ((record = (FEATURE_RECORD *) realloc (batch->record, size * sizeof (FEATURE_RECORD))) == NULL)
+            {
+              batch->error = ENOMEM;
+              return;
+            }
+
+          batch->record = record;
+          batch->size = size;
+        }
+
+      feature = &batch->record[batch->count];
+
+      if (!parse_fields (format, options, line, &fields, maybe_header, now, feature, batch->convert,
+                         options->tolerant ? &reason : NULL))
+        {
+          if (options->tolerant && reason)
+            {
+              if (add_reject (batch, chunk, line, reason) < 0)
+                {
+                  batch->error = ENOMEM;
+                  return;
+                }
+            }
+          else if (!line.len || (line.len == 1 && line.ptr[0] == '\r'))
+            {
+              batch->blank_lines++;
+            }
+          else
+            {
+              batch->lines_skipped++;
+            }
+
+          continue;
+        }
+
+      batch->count++;
+
+      if (batch->convert->count == CONVERT_BATCH_SIZE) convert_rows (format, options, batch);
+    }
+
+  if (batch->convert->count) convert_rows (format, options, batch);
+
+
+  if (batch->timed)
+    {
+      total_ns = stats_clock_ns () - start;
+
+      batch->parse_ns = total_ns - batch->time_ns;
+    }
+
+
+  /*  Only .uni (and mapped records with an image column) have snippet images.  */
+
+  if (batch->load_images && input_has_images (format, options))
+    {
+      if (batch->timed) start = stats_clock_ns ();
+
+      image_load_batch (batch);
+
+      if (batch->timed) batch->image_ns = stats_clock_ns () - start;
+    }
+}
+
+
+
+void record_batch_free (RECORD_BATCH *batch)
+{
+  free (batch->record);
+  free (batch->image);
+  free (batch->convert);
+  free (batch->reject);
+  free (batch->reject_text);
+  delim_index_free (&batch->index);
+  memset (batch, 0, sizeof (RECORD_BATCH));
+}
@@ -0,0 +1,166 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __PARSE_RECORD_H__
+#define __PARSE_RECORD_H__
+
+#include <time.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+#include "contact_id.h"
+#include "convert.h"
+#include "delim_index.h"
+#include "stats.h"
+#include "string_view.h"
+
+
+/*  Input formats.  */
+
+#define INPUT_FORMAT_CSV        0       /*  NAVO .csv  */
+#define INPUT_FORMAT_TXT        1       /*  Position/remarks/depth .txt  */
+#define INPUT_FORMAT_UNI        2       /*  Unisips target .uni  */
+#define INPUT_FORMAT_MAPPED     3       /*  Any comma separated layout, described by a --columns spec  */
+
+
+/*  Confidence level and analyst activity given to every feature we build.  */
+
+#define FEATURE_CONFIDENCE      3
+#define FEATURE_ANALYST         "NAVOCEANO BHY"
+
+
+/*  What happened to a record's snippet image (see image_load_batch).  */
+
+#define IMAGE_NONE              0       /*  No image  */
+#define IMAGE_LOADED            1       /*  In the batch image buffer  */
+#define IMAGE_MISSING           2       /*  Couldn't be opened or read  */
+#define IMAGE_DEFERRED          3       /*  Not loaded, the BFD writer reads it from image_name  */
+
+
+/*  Why a line was rejected (only when PARSE_OPTIONS tolerant is set, otherwise bad lines are loaded as they
+    are).  */
+
+#define REJECT_NONE             0
+#define REJECT_FIELDS           1       /*  Too few fields  */
+#define REJECT_LATITUDE         2       /*  No latitude or out of range  */
+#define REJECT_LONGITUDE        3       /*  No longitude or out of range  */
+#define REJECT_DTG              4       /*  Missing or impossible date/time group  */
+#define REJECT_REASONS          5
+
+
+/*  How the lines of a run are parsed.  They're set up before any parsing starts and only read after that,
+    so every parsing thread shares one.  With tolerant off (the default) every line that isn't a header or
+    blank is loaded, whatever is in it (this is the way it has always worked).  With it on, lines with too
+    few fields, positions that are missing or out of range, or impossible DTGs are rejected instead (see the
+    batch reject list).  */
+
+struct COLUMN_MAP_S;
+
+typedef struct
+{
+  const struct COLUMN_MAP_S *map;         /*  Column mapping for INPUT_FORMAT_MAPPED input  */
+  uint8_t             tolerant;
+} PARSE_OPTIONS;
+
+
+/*  One parsed input line.  The time fields are what the contact ID is built from (the run time for .txt
+    and .csv, the DTG for .uni).  The contact ID itself is filled in when the record is committed
+    since it depends on the record's position in the output.  */
+
+typedef struct
+{
+  BFDATA_RECORD       bfd_record;
+  char                image_name[512];
+  uint8_t             image_status;       /*  IMAGE_NONE, _LOADED, _MISSING, or _DEFERRED  */
+  size_t              image_offset;       /*  Offset of a loaded image in the batch image buffer  */
+  uint32_t            image_size;
+  char                contact_id[60];
+  int32_t             year;               /*  Full year (e.g. 2005)  */
+  int32_t             day;                /*  Day of year  */
+  int32_t             hour;
+  int32_t             minute;
+  float               second;
+} FEATURE_RECORD;
+
+
+/*  A rejected line.  The line number and offset are relative to the start of the chunk it was in and the
+    text (without the line end) is kept in the batch since the chunk may be gone by the time the batch is
+    committed.  */
+
+typedef struct
+{
+  uint32_t            line;               /*  1 based  */
+  size_t              offset;             /*  Byte offset of the start of the line  */
+  size_t              text;               /*  Offset of the line in the batch reject_text  */
+  size_t              length;
+  uint8_t             reason;             /*  REJECT_FIELDS, _LATITUDE, ...  */
+} PARSE_REJECT;
+
+
+/*  All of the records parsed from one chunk of input lines.  The record array is reused from chunk to
+    chunk so it only grows.  The line counts are always kept, the times only if timed is set.  */
+
+typedef struct
+{
+  FEATURE_RECORD      *record;
+  int32_t             count;
+  int32_t             size;               /*  Allocated size of record  */
+  uint8_t             timed;              /*  Set to have parse_chunk time itself  */
+  uint8_t             load_images;        /*  Set to have parse_chunk load the snippet images  */
+  uint8_t             *image;             /*  Loaded snippet images  */
+  size_t              image_used;
+  size_t              image_size;         /*  Allocated size of image  */
+  uint32_t            lines;
+  uint32_t            lines_skipped;      /*  Header lines  */
+  uint32_t            blank_lines;
+  PARSE_REJECT        *reject;            /*  Rejected lines  */
+  int32_t             rejects;
+  int32_t             reject_size;        /*  Allocated size of reject  */
+  char                *reject_text;
+  size_t              reject_text_used;
+  size_t              reject_text_size;   /*  Allocated size of reject_text  */
+  uint64_t            parse_ns;           /*  Parse time not counting time conversion  */
+  uint64_t            time_ns;            /*  .uni DTG to event time conversion  */
+  uint64_t            image_ns;           /*  Loading images  */
+  uint64_t            input_offset;       /*  Input byte offset just past this batch's lines  */
+  uint64_t            chunk_size;         /*  Bytes of input the lines came from (0 if they weren't parsed)  */
+  DELIM_INDEX         index;              /*  Delimiter offsets for the chunk being parsed  */
+  CONVERT_BATCH       *convert;           /*  Positions and DTGs waiting to be converted  */
+  int32_t             error;              /*  errno if the chunk couldn't be parsed (0 if it was)  */
+} RECORD_BATCH;
+
+
+int32_t input_format (const char *path);
+int32_t input_format_from_name (const char *name);
+const char *input_format_name (int32_t format);
+uint8_t input_has_times (int32_t format, const PARSE_OPTIONS *options);
+uint8_t input_has_images (int32_t format, const PARSE_OPTIONS *options);
+const char *reject_reason_name (int32_t reason);
+uint8_t parse_line (int32_t format, STRING_VIEW line, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                    CONVERT_CHECK *check, FEATURE_RECORD *feature);
+void parse_chunk (int32_t format, STRING_VIEW chunk, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                  RECORD_BATCH *batch);
+void record_batch_free (RECORD_BATCH *batch);
+
+
+#endif
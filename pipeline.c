@@ -0,0 +1,354 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+
+
+/*  States of a pipeline slot.  */
+
+#define SLOT_EMPTY              0       /*  Free for the reader  */
+#define SLOT_READY              1       /*  Holds a chunk waiting for a worker  */
+#define SLOT_PARSING            2       /*  A worker is parsing the chunk  */
+#define SLOT_PARSED             3       /*  Parsed, waiting for the writer  */
+
+
+typedef struct
+{
+  int32_t             state;
+  STRING_VIEW         chunk;
+  RECORD_BATCH        batch;
+} PIPELINE_SLOT;
+
+
+/*  Chunks are numbered in input order.  Chunk n always goes into slot n % window so the writer can pick
+    up the parsed batches in order no matter which worker finished first.  */
+
+typedef struct
+{
+  pthread_mutex_t     mutex;
+  pthread_cond_t      reader_cond;        /*  A slot was emptied  */
+  pthread_cond_t      worker_cond;        /*  A chunk is ready (or end of input)  */
+  pthread_cond_t      writer_cond;        /*  A batch was parsed (or end of input)  */
+  PIPELINE_SLOT       *slot;
+  int32_t             window;
+  uint64_t            next_read;
+  uint64_t            next_parse;
+  uint64_t            next_commit;
+  uint8_t             eof;
+  LINE_READER         *reader;
+  int32_t             format;
+  const CONTACT_TIME  *now;
+  const PARSE_OPTIONS *options;
+  COMMIT_FUNC         commit;
+  void                *data;
+  INGEST_STATS        *stats;
+} PIPELINE;
+
+
+
+/*  Gets the next chunk from the reader, timing it if we're keeping stats.  */
+
+static uint8_t read_chunk (LINE_READER *reader, STRING_VIEW *chunk, INGEST_STATS *stats)
+{
+  uint64_t            start;
+  uint8_t             status;
+
+
+  if (stats == NULL) return (line_reader_chunk (reader, PIPELINE_CHUNK_SIZE, chunk));
+
+  start = stats_clock_ns ();
+
+  if ((status = line_reader_chunk (reader, PIPELINE_CHUNK_SIZE, chunk)))
+    {
+      stats->bytes_read += chunk->len;
+      stats->chunks++;
+    }
+
+  stats->read_ns += stats_clock_ns () - start;
+
+  return (status);
+}
+
+
+
+/*  Commits a batch and adds its counts to the stats (from the one thread that commits).  Also used by
+    follow mode, which parses in the thread that reads.  Returns what commit did.  */
+
+int32_t pipeline_commit (RECORD_BATCH *batch, COMMIT_FUNC commit, void *data, INGEST_STATS *stats)
+{
+  uint64_t            start;
+  int32_t             status;
+
+
+  if (stats == NULL) return ((*commit) (batch, data));
+
+  start = stats_clock_ns ();
+
+  status = (*commit) (batch, data);
+
+  stats->commit_ns += stats_clock_ns () - start;
+  stats->parse_ns += batch->parse_ns;
+  stats->time_ns += batch->time_ns;
+  stats->image_ns += batch->image_ns;
+  stats->lines += batch->lines;
+  stats->lines_skipped += batch->lines_skipped;
+  stats->blank_lines += batch->blank_lines;
+  stats->lines_rejected += batch->rejects;
+  stats->records_parsed += batch->count;
+
+  return (status);
+}
+
+
+
+static void *pipeline_worker (void *arg)
+{
+  PIPELINE            *pipe = (PIPELINE *) arg;
+  PIPELINE_SLOT       *slot;
+  uint64_t            seq;
+
+
+  pthread_mutex_lock (&pipe->mutex);
+
+  while (NVTrue)
+    {
+      while (pipe->next_parse == pipe->next_read && !pipe->eof) pthread_cond_wait (&pipe->worker_cond, &pipe->mutex);
+
+      if (pipe->next_parse == pipe->next_read) break;
+
+      seq = pipe->next_parse++;
+      slot = &pipe->slot[seq % pipe->window];
+      slot->state = SLOT_PARSING;
+
+      pthread_mutex_unlock (&pipe->mutex);
+
+      parse_chunk (pipe->format, slot->chunk, pipe->now, pipe->options, &slot->batch);
+
+      pthread_mutex_lock (&pipe->mutex);
+
+      slot->state = SLOT_PARSED;
+
+      if (seq == pipe->next_commit) pthread_cond_signal (&pipe->writer_cond);
+    }
+
+  pthread_mutex_unlock (&pipe->mutex);
+
+  return (NULL);
+}
+
+
+
+static void *pipeline_writer (void *arg)
+{
+  PIPELINE            *pipe = (PIPELINE *) arg;
+  PIPELINE_SLOT       *slot;
+
+
+  pthread_mutex_lock (&pipe->mutex);
+
+  while (NVTrue)
+    {
+      slot = &pipe->slot[pipe->next_commit % pipe->window];
+
+      while (!(pipe->next_commit < pipe->next_read && slot->state == SLOT_PARSED) &&
+             !(pipe->eof && pipe->next_commit == pipe->next_read))
+        pthread_cond_wait (&pipe->writer_cond, &pipe->mutex);
+
+      if (pipe->next_commit == pipe->next_read) break;
+
+      pthread_mutex_unlock (&pipe->mutex);
+
+      pipeline_commit (&slot->batch, pipe->commit, pipe->data, pipe->stats);
+      line_reader_release (pipe->reader, slot->chunk);
+
+      pthread_mutex_lock (&pipe->mutex);
+
+      slot->state = SLOT_EMPTY;
+      pipe->next_commit++;
+
+      pthread_cond_signal (&pipe->reader_cond);
+    }
+
+  pthread_mutex_unlock (&pipe->mutex);
+
+  return (NULL);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        pipeline_run                                        *
+*                                                                           *
+*   Purpose:            Reads, parses, and commits the whole input.  With   *
+*                       threads < 1 everything happens in this thread.      *
+*                       Otherwise this thread cuts the input into line      *
+*                       aligned chunks, threads worker threads parse them,  *
+*                       and a single writer thread hands the parsed         *
+*                       batches to commit in input order.  Both modes use   *
+*                       the same chunking and parsing so the output (and    *
+*                       contact ID numbering) is identical.                 *
+*                                                                           *
+*   Inputs:             reader              -   opened line reader          *
+*                       format              -   input format                *
+*                       now                 -   run time (event time for    *
+*                                               .txt and .csv records)      *
+*                       options             -   parse settings (column map, *
+*                                               tolerant parsing)           *
+*                       threads             -   number of parse threads     *
+*                       commit              -   called with each batch      *
+*                       data                -   passed through to commit    *
+*                       stats               -   stage counters to add to,   *
+*                                               or NULL to skip the timing  *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 (errno is set) if  *
+*                                               the threads couldn't be     *
+*                                               started (nothing has been   *
+*                                               read)                       *
+*                                                                           *
+\***************************************************************************/
+
+int32_t pipeline_run (LINE_READER *reader, int32_t format, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                      int32_t threads, COMMIT_FUNC commit, void *data, INGEST_STATS *stats)
+{
+  PIPELINE            pipe;
+  PIPELINE_SLOT       *slot;
+  pthread_t           *worker, writer;
+  STRING_VIEW         chunk;
+  RECORD_BATCH        batch;
+  int32_t             i, started, status = 0;
+  uint8_t             writing = NVFalse;
+
+
+  if (threads < 1)
+    {
+      memset (&batch, 0, sizeof (RECORD_BATCH));
+      batch.timed = (stats != NULL);
+      batch.load_images = NVTrue;
+
+      while (read_chunk (reader, &chunk, stats))
+        {
+          batch.input_offset = reader->offset;
+          parse_chunk (format, chunk, now, options, &batch);
+          status = pipeline_commit (&batch, commit, data, stats);
+          line_reader_release (reader, chunk);
+
+          if (status < 0) break;
+        }
+
+      record_batch_free (&batch);
+
+      return (0);
+    }
+
+
+  memset (&pipe, 0, sizeof (PIPELINE));
+
+  pipe.reader = reader;
+  pipe.format = format;
+  pipe.now = now;
+  pipe.options = options;
+  pipe.commit = commit;
+  pipe.data = data;
+  pipe.stats = stats;
+
+
+  /*  Enough slots to keep every worker busy while the writer catches up without letting the parsed
+      records pile up in memory.  */
+
+  pipe.window = threads * 2 + 2;
+
+  if ((pipe.slot = (PIPELINE_SLOT *) calloc (pipe.window, sizeof (PIPELINE_SLOT))) == NULL ||
+      (worker = (pthread_t *) calloc (threads, sizeof (pthread_t))) == NULL)
+    {
+      free (pipe.slot);
+      errno = ENOMEM;
+      return (-1);
+    }
+
+  pthread_mutex_init (&pipe.mutex, NULL);
+  pthread_cond_init (&pipe.reader_cond, NULL);
+  pthread_cond_init (&pipe.worker_cond, NULL);
+  pthread_cond_init (&pipe.writer_cond, NULL);
+
+  for (started = 0 ; started < threads ; started++)
+    {
+      if ((status = pthread_create (&worker[started], NULL, pipeline_worker, &pipe))) break;
+    }
+
+  if (!status && !(status = pthread_create (&writer, NULL, pipeline_writer, &pipe))) writing = NVTrue;
+
+
+  /*  This thread is the reader.  If a thread couldn't be started nothing is read, the ones that did start
+      just see the end of the input.  */
+
+  while (!status && read_chunk (reader, &chunk, stats))
+    {
+      pthread_mutex_lock (&pipe.mutex);
+
+      slot = &pipe.slot[pipe.next_read % pipe.window];
+
+      while (slot->state != SLOT_EMPTY) pthread_cond_wait (&pipe.reader_cond, &pipe.mutex);
+
+      slot->chunk = chunk;
+      slot->batch.timed = (stats != NULL);
+      slot->batch.load_images = NVTrue;
+      slot->batch.input_offset = reader->offset;
+      slot->state = SLOT_READY;
+      pipe.next_read++;
+
+      pthread_cond_signal (&pipe.worker_cond);
+
+      pthread_mutex_unlock (&pipe.mutex);
+    }
+
+  pthread_mutex_lock (&pipe.mutex);
+  pipe.eof = NVTrue;
+  pthread_cond_broadcast (&pipe.worker_cond);
+  pthread_cond_broadcast (&pipe.writer_cond);
+  pthread_mutex_unlock (&pipe.mutex);
+
+  for (i = 0 ; i < started ; i++) pthread_join (worker[i], NULL);
+  if (writing) pthread_join (writer, NULL);
+
+
+  for (i = 0 ; i < pipe.window ; i++) record_batch_free (&pipe.slot[i].batch);
+
+  pthread_mutex_destroy (&pipe.mutex);
+  pthread_cond_destroy (&pipe.reader_cond);
+  pthread_cond_destroy (&pipe.worker_cond);
+  pthread_cond_destroy (&pipe.writer_cond);
+
+  free (pipe.slot);
+  free (worker);
+
+  if (status)
+    {
+      errno = status;
+      return (-1);
+    }
+
+  return (0);
+}
@@ -0,0 +1,54 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "line_reader.h"
+#include "parse_record.h"
+#include "stats.h"
+
+
+/*  Size of the blocks of lines that the reader hands to the parser.  */
+
+#define PIPELINE_CHUNK_SIZE     (1024 * 1024)
+
+
+/*  Most parse threads we'll start.  Each one has up to two chunks in flight (and a group of image files
+    open) so more than this just costs memory and file descriptors.  */
+
+#define PIPELINE_MAX_THREADS    64
+
+
+/*  Called (always from a single thread, in input order) with each parsed batch of records.  A batch with
+    error set couldn't be parsed and has to be treated as a failure.  Returns 0, or -1 if the records
+    couldn't be committed (nothing more should be committed after that).  */
+
+typedef int32_t (*COMMIT_FUNC) (RECORD_BATCH *batch, void *data);
+
+
+int32_t pipeline_run (LINE_READER *reader, int32_t format, const CONTACT_TIME *now, const PARSE_OPTIONS *options,
+                      int32_t threads, COMMIT_FUNC commit, void *data, INGEST_STATS *stats);
+int32_t pipeline_commit (RECORD_BATCH *batch, COMMIT_FUNC commit, void *data, INGEST_STATS *stats);
+
+
+#endif
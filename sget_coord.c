@@ -0,0 +1,317 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "convert.h"
+#include "sget_coord.h"
+
+
+/*  Classification of the characters in a lat or lon field.  */
+
+#define COORD_OTHER     0
+#define COORD_SPACE     1
+#define COORD_DIGIT     2
+#define COORD_POINT     3
+#define COORD_SIGN      4       /*  Minus sign, treated as COORD_SPACE once the sign is noted  */
+
+
+/*  Character class lookup table.  Hemisphere letters and plus signs are white space.  Anything not
+    listed is COORD_OTHER (which stops the number scan).  */
+
+static const uint8_t coord_class[256] =
+  {
+    [' '] = COORD_SPACE, ['\t'] = COORD_SPACE, ['\n'] = COORD_SPACE, ['\r'] = COORD_SPACE, ['\v'] = COORD_SPACE,
+    ['\f'] = COORD_SPACE, ['n'] = COORD_SPACE, ['N'] = COORD_SPACE, ['e'] = COORD_SPACE, ['E'] = COORD_SPACE,
+    ['+'] = COORD_SPACE,
+    ['0'] = COORD_DIGIT, ['1'] = COORD_DIGIT, ['2'] = COORD_DIGIT, ['3'] = COORD_DIGIT, ['4'] = COORD_DIGIT,
+    ['5'] = COORD_DIGIT, ['6'] = COORD_DIGIT, ['7'] = COORD_DIGIT, ['8'] = COORD_DIGIT, ['9'] = COORD_DIGIT,
+    ['.'] = COORD_POINT,
+    ['-'] = COORD_SIGN
+  };
+
+
+
+/*  Scans the degrees, minutes, and seconds out of one half of a position and returns total degrees.
+    Hemisphere letters and signs are treated as white space anywhere in the field (the negative ones
+    set *sign), even after the numbers stop.  The numbers follow the rules of sscanf ("%lf %lf %lf")
+    run over the field with those characters blanked out, which is what the old code did.  *values is set
+    to how many numbers were found.  */
+
+static double scan_dms (STRING_VIEW field, char neg_hemi, uint8_t *sign, uint8_t *values)
+{
+  const char          *ptr, *end, *start = NULL;
+  double              f[3] = {0.0, 0.0, 0.0}, fdeg = 0.0, fmin = 0.0, fsec = 0.0;
+  uint64_t            m = 0;
+  int32_t             count = 0, e = 0, sig = 0, digits = 0, type;
+  uint8_t             in_number = NVFalse, point = NVFalse, stopped = NVFalse;
+  char                c;
+
+
+  *sign = NVFalse;
+
+  end = field.ptr + field.len;
+
+
+  /*  One pass over the field.  We run one character past the end (as white space) to close out the
+      last number.  */
+
+  for (ptr = field.ptr ; ptr <= end ; ptr++)
+    {
+      c = (ptr < end) ? *ptr : ' ';
+
+      type = coord_class[(uint8_t) c];
+
+      if (type == COORD_SIGN || c == neg_hemi || c == neg_hemi + ('a' - 'A'))
+        {
+          *sign = NVTrue;
+          type = COORD_SPACE;
+        }
+
+
+      /*  Once the numbers stop we only keep looking for sign indicators.  */
+
+      if (stopped) continue;
+
+
+      if (type == COORD_DIGIT)
+        {
+          if (!in_number)
+            {
+              in_number = NVTrue;
+              start = ptr;
+              m = 0;
+              e = sig = digits = 0;
+              point = NVFalse;
+            }
+
+          digits++;
+
+          if (point) e--;
+
+          if (m || c != '0')
+            {
+              sig++;
+              m = m * 10 + (c - '0');
+            }
+
+          continue;
+        }
+
+      if (type == COORD_POINT && !(in_number && point))
+        {
+          if (!in_number)
+            {
+              in_number = NVTrue;
+              start = ptr;
+              m = 0;
+              e = sig = digits = 0;
+            }
+
+          point = NVTrue;
+          continue;
+        }
+
+
+      /*  Anything else ends the current number.  */
+
+      if (in_number)
+        {
+          in_number = NVFalse;
+
+
+          /*  A lone decimal point is a matching failure.  */
+
+          if (!digits)
+            {
+              stopped = NVTrue;
+              continue;
+            }
+
+          if (sig > 19 || !sv_exact_double (m, e, &f[count])) sv_scan_double (start, ptr, &f[count]);
+
+          if (++count == 3)
+            {
+              stopped = NVTrue;
+              continue;
+            }
+
+
+          /*  A second decimal point starts the next number (e.g. 28.5.5 is 28.5 and .5).  */
+
+          if (type == COORD_POINT)
+            {
+              in_number = NVTrue;
+              start = ptr;
+              m = 0;
+              e = sig = digits = 0;
+              point = NVTrue;
+              continue;
+            }
+        }
+
+      if (type == COORD_OTHER) stopped = NVTrue;
+    }
+
+
+  /*  Based on the number of values scanned, compute the total degrees.  */
+
+  *values = (uint8_t) count;
+
+  switch (count)
+    {
+    case 3:
+      fsec = f[2] / 3600.0;
+#ifdef NVLinux
+      __attribute__ ((fallthrough));
+#endif
+
+    case 2:
+      fmin = f[1] / 60.0;
+#ifdef NVLinux
+      __attribute__ ((fallthrough));
+#endif
+
+    case 1:
+      fdeg = f[0];
+    }
+
+  fdeg += fmin + fsec;
+
+  return (fdeg);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        sget_coord                                          *
+*                                                                           *
+*   Programmer:         Jan C. Depner                                       *
+*                                                                           *
+*   Date Written:       November 2005                                       *
+*                                                                           *
+*   Module Security                                                         *
+*   Classification:     Unclassified                                        *
+*                                                                           *
+*   Data Security                                                           *
+*   Classification:     Unknown                                             *
+*                                                                           *
+*   Purpose:            Gets a pair of geographic coordinates, a remark,    *
+*                       and a depth from a string.  This is a single pass,  *
+*                       allocation free, reentrant parser.  All results go  *
+*                       into the caller's COORD_RECORD so it is safe to     *
+*                       call from multiple threads.  It doesn't use         *
+*                       sscanf or strtod so it isn't affected by locale.    *
+*                                                                           *
+*   Inputs:             string              -   input line (string view)    *
+*                       coord               -   returned coordinates,       *
+*                                               depth, and remarks          *
+*                                                                           *
+*   Outputs:            none                                                *
+*                                                                           *
+*   Restrictions:       Geographic positions are entered as a lat, lon pair *
+*                       separated by a comma.  A lat or lon may be in any   *
+*                       of the following formats (degrees, minutes, and     *
+*                       seconds must be separated by a space or tab) :      *
+*                                                                           *
+*                           Degrees decimal                 : S 28.4532     *
+*                           Degrees minutes decimal         : S 28 27.192   *
+*                           Degrees minutes seconds decimal : S 28 27 11.52 *
+*                                                                           *
+*                       Hemisphere may be indicated by letter or by sign.   *
+*                       West longitude and south latitude are negative :    *
+*                                                                           *
+*                           Ex. : -28 27 11.52 = S28 27 11.52 = s 28 27.192 *
+*                                                                           *
+\***************************************************************************/
+
+void sget_coord (STRING_VIEW string, COORD_RECORD *coord)
+{
+  FIELD_CURSOR        fields;
+
+
+  field_cursor_init (&fields, string, NULL, NULL, NULL);
+
+  sget_coord_fields (&fields, coord);
+}
+
+
+
+/*  sget_coord for a line whose fields are already being walked with a FIELD_CURSOR (e.g. from the
+    delimiter index built by parse_chunk).  */
+
+void sget_coord_fields (FIELD_CURSOR *fields, COORD_RECORD *coord)
+{
+  sget_coord_scan (fields, coord);
+
+  convert_split_dms (coord->lat_degrees, &coord->lat_deg, &coord->lat_min, &coord->lat_sec);
+  convert_split_dms (coord->lon_degrees, &coord->lon_deg, &coord->lon_min, &coord->lon_sec);
+}
+
+
+
+/*  The scanning half of sget_coord_fields.  The total degrees are left for the caller to split (parse_chunk
+    does a whole batch of them at once).  */
+
+void sget_coord_scan (FIELD_CURSOR *fields, COORD_RECORD *coord)
+{
+  STRING_VIEW         lat, lon, depth;
+  uint8_t             sign;
+
+
+  /*  Break the input into lat, lon, remarks, and depth.  Missing fields are just empty.  */
+
+  coord->fields = field_next (fields, &lat);
+  coord->fields += field_next (fields, &lon);
+  coord->fields += field_next (fields, &coord->remarks);
+  coord->fields += field_next (fields, &depth);
+
+
+  /*  Save the depth if it's there.  */
+
+  if (sv_scan_float (depth.ptr, depth.ptr + depth.len, &coord->depth) == NULL) coord->depth = 0.0;
+
+
+  /*  Get the sign and the total degrees.  */
+
+  coord->lat_degrees = scan_dms (lat, 'S', &sign, &coord->lat_values);
+  coord->lat_hemi = sign ? 'S' : 'N';
+
+  coord->lon_degrees = scan_dms (lon, 'W', &sign, &coord->lon_values);
+  coord->lon_hemi = sign ? 'W' : 'E';
+}
+
+
+
+/*  One lat or lon field (any of the forms sget_coord takes) to signed decimal degrees, rounded exactly the
+    way a .txt position is.  neg_hemi is 'S' for a latitude and 'W' for a longitude.  */
+
+double sget_coord_degrees (STRING_VIEW field, char neg_hemi)
+{
+  int32_t             deg, min;
+  float               sec;
+  uint8_t             sign, values;
+
+
+  convert_split_dms (scan_dms (field, neg_hemi, &sign, &values), &deg, &min, &sec);
+
+  return (convert_dms_degrees ((double) deg, (double) min, (double) sec, sign));
+}
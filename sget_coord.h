@@ -0,0 +1,60 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __SGET_COORD_H__
+#define __SGET_COORD_H__
+
+#include "delim_index.h"
+#include "string_view.h"
+
+
+/*  Everything sget_coord pulls out of a .txt record.  The remarks are a view into the caller's input
+    text so they are only valid as long as that text is.  sget_coord_scan only fills in the hemispheres,
+    the total degrees, the depth, the remarks, and the counts.  */
+
+typedef struct
+{
+  char                lat_hemi;           /*  N or S  */
+  double              lat_degrees;        /*  Total (unsigned) degrees  */
+  int32_t             lat_deg;
+  int32_t             lat_min;
+  float               lat_sec;
+  char                lon_hemi;           /*  E or W  */
+  double              lon_degrees;
+  int32_t             lon_deg;
+  int32_t             lon_min;
+  float               lon_sec;
+  float               depth;              /*  0.0 if not present  */
+  STRING_VIEW         remarks;
+  uint8_t             fields;             /*  Number of fields found (lat, lon, remarks, depth)  */
+  uint8_t             lat_values;         /*  Numbers found in the lat field (0 if it had none)  */
+  uint8_t             lon_values;
+} COORD_RECORD;
+
+
+void sget_coord (STRING_VIEW string, COORD_RECORD *coord);
+void sget_coord_fields (FIELD_CURSOR *fields, COORD_RECORD *coord);
+void sget_coord_scan (FIELD_CURSOR *fields, COORD_RECORD *coord);
+double sget_coord_degrees (STRING_VIEW field, char neg_hemi);
+
+
+#endif
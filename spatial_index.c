@@ -0,0 +1,877 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "spatial_index.h"
+#include "spatial_order.h"
+#include "stats.h"
+
+
+/*  Entries read from the index at a time when a whole node is inside the query box.  */
+
+#define SPATIAL_INDEX_READ      65536
+
+
+void spatial_index_name (const char *bfd_name, char *path)
+{
+  sprintf (path, "%s%s", bfd_name, SPATIAL_INDEX_EXTENSION);
+}
+
+
+
+/*  Works out how many nodes there are on each level of a segment's tree.  Returns the number of levels.  */
+
+static uint32_t level_counts (uint32_t entries, uint32_t *level_nodes)
+{
+  uint32_t            levels = 0, n;
+
+
+  level_nodes[0] = 0;
+
+  if (!entries) return (0);
+
+  n = (entries + SPATIAL_INDEX_FANOUT - 1) / SPATIAL_INDEX_FANOUT;
+
+  while (levels < SPATIAL_INDEX_MAX_LEVELS)
+    {
+      level_nodes[levels++] = n;
+
+      if (n == 1) break;
+
+      n = (n + SPATIAL_INDEX_FANOUT - 1) / SPATIAL_INDEX_FANOUT;
+    }
+
+  return (levels);
+}
+
+
+
+/*  Reads a segment header and its nodes.  offset is where the segment starts and end is the end of the index.
+    Returns 0, or -1 if the segment doesn't make sense (errno is set).  */
+
+static int32_t read_part (FILE *fp, int64_t offset, int64_t end, SPATIAL_INDEX_PART *part)
+{
+  uint32_t            level_nodes[SPATIAL_INDEX_MAX_LEVELS], levels, nodes = 0, i;
+
+
+  if (fseek (fp, (long) offset, SEEK_SET) || fread (&part->header, sizeof (SPATIAL_INDEX_SEGMENT), 1, fp) != 1)
+    {
+      if (!ferror (fp)) errno = EINVAL;
+      return (-1);
+    }
+
+  levels = level_counts (part->header.entries, level_nodes);
+
+  for (i = 0 ; i < levels ; i++)
+    {
+      part->level_start[i] = nodes;
+      part->level_nodes[i] = level_nodes[i];
+      nodes += level_nodes[i];
+    }
+
+  part->entry_offset = offset + sizeof (SPATIAL_INDEX_SEGMENT) + (int64_t) nodes * sizeof (SPATIAL_INDEX_NODE);
+
+  if (part->header.entries > part->header.records || part->header.levels != levels || part->header.nodes != nodes ||
+      (levels && level_nodes[levels - 1] != 1) ||
+      part->entry_offset + (int64_t) part->header.entries * (int64_t) sizeof (SPATIAL_INDEX_ENTRY) > end)
+    {
+      errno = EINVAL;
+      return (-1);
+    }
+
+  if ((part->node = (SPATIAL_INDEX_NODE *) malloc ((nodes ? nodes : 1) * sizeof (SPATIAL_INDEX_NODE))) == NULL) return (-1);
+
+  if (nodes && fread (part->node, nodes * sizeof (SPATIAL_INDEX_NODE), 1, fp) != 1)
+    {
+      if (!ferror (fp)) errno = EINVAL;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_index_open                                  *
+*                                                                           *
+*   Purpose:            Opens a spatial index for queries.  The segment     *
+*                       headers and tree nodes are read in and checked,     *
+*                       the entries are read as they're needed.             *
+*                                                                           *
+*   Inputs:             path                -   index file name (see        *
+*                                               spatial_index_name)         *
+*                                                                           *
+*   Outputs:            SPATIAL_INDEX *     -   index or NULL on error      *
+*                                               (errno is set, EINVAL if    *
+*                                               it isn't a usable index)    *
+*                                                                           *
+\***************************************************************************/
+
+SPATIAL_INDEX *spatial_index_open (const char *path)
+{
+  SPATIAL_INDEX       *index;
+  int64_t             offset, end;
+  uint64_t            records = 0;
+  uint32_t            i;
+  int32_t             err;
+
+
+  if ((index = (SPATIAL_INDEX *) calloc (1, sizeof (SPATIAL_INDEX))) == NULL) return (NULL);
+
+  if ((index->fp = fopen (path, "rb")) == NULL)
+    {
+      free (index);
+      return (NULL);
+    }
+
+  if (fread (&index->header, sizeof (SPATIAL_INDEX_HEADER), 1, index->fp) != 1 || fseek (index->fp, 0, SEEK_END) ||
+      (end = (int64_t) ftell (index->fp)) < 0)
+    {
+      if (!ferror (index->fp)) errno = EINVAL;
+      goto fail;
+    }
+
+  if (memcmp (index->header.magic, SPATIAL_INDEX_MAGIC, sizeof (index->header.magic)) ||
+      index->header.version != SPATIAL_INDEX_VERSION || index->header.byte_order != SPATIAL_INDEX_BYTE_ORDER ||
+      index->header.fanout != SPATIAL_INDEX_FANOUT || index->header.size < sizeof (SPATIAL_INDEX_HEADER) ||
+      (int64_t) index->header.size > end)
+    {
+      errno = EINVAL;
+      goto fail;
+    }
+
+  if (index->header.segments &&
+      (index->part = (SPATIAL_INDEX_PART *) calloc (index->header.segments, sizeof (SPATIAL_INDEX_PART))) == NULL)
+    goto fail;
+
+
+  /*  The segments follow each other and cover the record numbers in order.  */
+
+  offset = sizeof (SPATIAL_INDEX_HEADER);
+
+  for (i = 0 ; i < index->header.segments ; i++)
+    {
+      if (read_part (index->fp, offset, (int64_t) index->header.size, &index->part[i]) < 0) goto fail;
+
+      if (index->part[i].header.first_record != records)
+        {
+          errno = EINVAL;
+          goto fail;
+        }
+
+      records += index->part[i].header.records;
+      offset = index->part[i].entry_offset + (int64_t) index->part[i].header.entries * sizeof (SPATIAL_INDEX_ENTRY);
+    }
+
+  if (records != index->header.records || offset != (int64_t) index->header.size)
+    {
+      errno = EINVAL;
+      goto fail;
+    }
+
+  return (index);
+
+
+ fail:
+  err = errno;
+  spatial_index_close (index);
+  errno = err;
+
+  return (NULL);
+}
+
+
+
+void spatial_index_close (SPATIAL_INDEX *index)
+{
+  uint32_t            i;
+
+
+  if (index == NULL) return;
+
+  if (index->fp != NULL) fclose (index->fp);
+
+  if (index->part != NULL)
+    {
+      for (i = 0 ; i < index->header.segments ; i++) free (index->part[i].node);
+      free (index->part);
+    }
+
+  free (index->entry);
+  free (index);
+}
+
+
+
+static int32_t add_hit (SPATIAL_INDEX_HITS *hits, uint32_t record)
+{
+  uint32_t            *new_record;
+  uint32_t            size;
+
+
+  if (hits->count == hits->size)
+    {
+      size = hits->size ? hits->size * 2 : 1024;
+
+      if ((new_record = (uint32_t *) realloc (hits->record, size * sizeof (uint32_t))) == NULL) return (-1);
+
+      hits->record = new_record;
+      hits->size = size;
+    }
+
+  hits->record[hits->count++] = record;
+
+  return (0);
+}
+
+
+
+/*  Reads count entries, starting with entry first, of a segment into index->entry.  Returns 0 or -1 (errno is
+    set).  */
+
+static int32_t read_entries (SPATIAL_INDEX *index, SPATIAL_INDEX_PART *part, uint32_t first, uint32_t count)
+{
+  SPATIAL_INDEX_ENTRY *entry;
+
+
+  if (count > index->entry_size)
+    {
+      if ((entry = (SPATIAL_INDEX_ENTRY *) realloc (index->entry, count * sizeof (SPATIAL_INDEX_ENTRY))) == NULL)
+        return (-1);
+
+      index->entry = entry;
+      index->entry_size = count;
+    }
+
+  if (fseek (index->fp, (long) (part->entry_offset + (int64_t) first * sizeof (SPATIAL_INDEX_ENTRY)), SEEK_SET) ||
+      fread (index->entry, count * sizeof (SPATIAL_INDEX_ENTRY), 1, index->fp) != 1)
+    {
+      if (!ferror (index->fp)) errno = EINVAL;
+      return (-1);
+    }
+
+  return (0);
+}
+
+
+
+/*  Reads a record from the BFD file and adds it if it's inside any of the boxes.  Returns 0, or -1 on error
+    (index->bfd_error is set if it was the BFD library).  */
+
+static int32_t check_record (SPATIAL_INDEX *index, int32_t bfd_handle, uint32_t record, const SPATIAL_INDEX_NODE *box,
+                             int32_t boxes, SPATIAL_INDEX_HITS *hits)
+{
+  BFDATA_RECORD       bfd_record;
+  int32_t             i;
+
+
+  if (binaryFeatureData_read_record (bfd_handle, record, &bfd_record) < 0)
+    {
+      index->bfd_error = NVTrue;
+      return (-1);
+    }
+
+  hits->checked++;
+
+  for (i = 0 ; i < boxes ; i++)
+    {
+      if (bfd_record.latitude >= box[i].south && bfd_record.latitude <= box[i].north &&
+          bfd_record.longitude >= box[i].west && bfd_record.longitude <= box[i].east) return (add_hit (hits, record));
+    }
+
+  return (0);
+}
+
+
+
+/*  Sorts out the entries of a leaf that's partly inside the box.  Each entry's quantized position puts it in a
+    small cell of the leaf, if that cell is all inside (or all outside) the box so is the feature.  Otherwise
+    it's read from the BFD file.  */
+
+static int32_t search_leaf (SPATIAL_INDEX *index, SPATIAL_INDEX_PART *part, uint32_t leaf, const SPATIAL_INDEX_NODE *box,
+                            int32_t bfd_handle, SPATIAL_INDEX_HITS *hits)
+{
+  SPATIAL_INDEX_NODE  *node = &part->node[part->level_start[0] + leaf];
+  SPATIAL_INDEX_ENTRY *entry;
+  uint32_t            first = leaf * SPATIAL_INDEX_FANOUT, count, i;
+  double              height, width, south, north, west, east;
+
+
+  count = part->header.entries - first;
+  if (count > SPATIAL_INDEX_FANOUT) count = SPATIAL_INDEX_FANOUT;
+
+  if (read_entries (index, part, first, count) < 0) return (-1);
+
+  height = (node->north - node->south) / 65536.0;
+  width = (node->east - node->west) / 65536.0;
+
+  for (i = 0 ; i < count ; i++)
+    {
+      entry = &index->entry[i];
+
+      south = node->south + (double) entry->latitude * height - SPATIAL_INDEX_SLOP;
+      north = node->south + (double) (entry->latitude + 1) * height + SPATIAL_INDEX_SLOP;
+      west = node->west + (double) entry->longitude * width - SPATIAL_INDEX_SLOP;
+      east = node->west + (double) (entry->longitude + 1) * width + SPATIAL_INDEX_SLOP;
+
+      if (north < box->south || south > box->north || east < box->west || west > box->east) continue;
+
+      if (south >= box->south && north <= box->north && west >= box->west && east <= box->east)
+        {
+          if (add_hit (hits, entry->record) < 0) return (-1);
+        }
+      else if (check_record (index, bfd_handle, entry->record, box, 1, hits) < 0)
+        {
+          return (-1);
+        }
+    }
+
+  return (0);
+}
+
+
+
+/*  Searches the subtree under node n on a level of a segment's tree.  */
+
+static int32_t search (SPATIAL_INDEX *index, SPATIAL_INDEX_PART *part, uint32_t level, uint32_t n,
+                       const SPATIAL_INDEX_NODE *box, int32_t bfd_handle, SPATIAL_INDEX_HITS *hits)
+{
+  SPATIAL_INDEX_NODE  *node = &part->node[part->level_start[level] + n];
+  uint64_t            span, first, last;
+  uint32_t            count, child, end, i;
+
+
+  if (node->north < box->south || node->south > box->north || node->east < box->west || node->west > box->east)
+    return (0);
+
+
+  /*  Everything under a node that's inside the box is a hit.  The entries under it are all in a row.  */
+
+  if (node->south >= box->south && node->north <= box->north && node->west >= box->west && node->east <= box->east)
+    {
+      for (span = SPATIAL_INDEX_FANOUT, i = 0 ; i < level ; i++) span *= SPATIAL_INDEX_FANOUT;
+
+      first = (uint64_t) n * span;
+      last = first + span;
+      if (last > part->header.entries) last = part->header.entries;
+
+      for ( ; first < last ; first += count)
+        {
+          count = (last - first > SPATIAL_INDEX_READ) ? SPATIAL_INDEX_READ : (uint32_t) (last - first);
+
+          if (read_entries (index, part, (uint32_t) first, count) < 0) return (-1);
+
+          for (i = 0 ; i < count ; i++)
+            {
+              if (add_hit (hits, index->entry[i].record) < 0) return (-1);
+            }
+        }
+
+      return (0);
+    }
+
+  if (!level) return (search_leaf (index, part, n, box, bfd_handle, hits));
+
+  end = (n + 1) * SPATIAL_INDEX_FANOUT;
+  if (end > part->level_nodes[level - 1]) end = part->level_nodes[level - 1];
+
+  for (child = n * SPATIAL_INDEX_FANOUT ; child < end ; child++)
+    {
+      if (search (index, part, level - 1, child, box, bfd_handle, hits) < 0) return (-1);
+    }
+
+  return (0);
+}
+
+
+
+static int32_t compare_records (const void *a, const void *b)
+{
+  uint32_t            ra = *(const uint32_t *) a, rb = *(const uint32_t *) b;
+
+
+  return (ra < rb ? -1 : (ra > rb));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_index_query                                 *
+*                                                                           *
+*   Purpose:            Finds the BFD records inside a box (edges           *
+*                       included).  A box with west greater than east       *
+*                       crosses the 180 degree meridian.  Features that     *
+*                       the index can't settle, and any records past the    *
+*                       end of the index, are read from the BFD file.       *
+*                                                                           *
+*   Inputs:             index               -   spatial index               *
+*                       bfd_handle          -   open BFD file handle        *
+*                       bfd_records         -   records in the BFD file     *
+*                       south, west,        -   box in degrees              *
+*                       north, east                                         *
+*                       hits                -   gets the record numbers in  *
+*                                               ascending order (zero it    *
+*                                               before the first query,     *
+*                                               it's reused after that)     *
+*                                                                           *
+*   Outputs:            int32_t             -   number of records found or  *
+*                                               -1 on error (errno is set,  *
+*                                               or index->bfd_error if the  *
+*                                               BFD library failed)         *
+*                                                                           *
+\***************************************************************************/
+
+int32_t spatial_index_query (SPATIAL_INDEX *index, int32_t bfd_handle, uint32_t bfd_records, double south, double west,
+                             double north, double east, SPATIAL_INDEX_HITS *hits)
+{
+  SPATIAL_INDEX_NODE  box[2];
+  SPATIAL_INDEX_PART  *part;
+  uint32_t            i, record;
+  int32_t             boxes = 1, j;
+
+
+  hits->count = hits->checked = 0;
+  index->bfd_error = NVFalse;
+
+  box[0].south = box[1].south = south;
+  box[0].north = box[1].north = north;
+  box[0].west = west;
+  box[0].east = east;
+
+  if (west > east)
+    {
+      box[0].east = 180.0;
+      box[1].west = -180.0;
+      box[1].east = east;
+      boxes = 2;
+    }
+
+  for (i = 0 ; i < index->header.segments ; i++)
+    {
+      part = &index->part[i];
+
+      if (!part->header.entries) continue;
+
+      for (j = 0 ; j < boxes ; j++)
+        {
+          if (search (index, part, part->header.levels - 1, 0, &box[j], bfd_handle, hits) < 0) return (-1);
+        }
+    }
+
+
+  /*  Records added since the index was last updated.  */
+
+  for (record = (uint32_t) index->header.records ; record < bfd_records ; record++)
+    {
+      if (check_record (index, bfd_handle, record, box, boxes, hits) < 0) return (-1);
+    }
+
+  qsort (hits->record, hits->count, sizeof (uint32_t), compare_records);
+
+  return ((int32_t) hits->count);
+}
+
+
+
+void spatial_index_hits_free (SPATIAL_INDEX_HITS *hits)
+{
+  free (hits->record);
+  memset (hits, 0, sizeof (SPATIAL_INDEX_HITS));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_index_writer_open                           *
+*                                                                           *
+*   Purpose:            Starts a new segment for the BFD file's spatial     *
+*                       index.  If the index exists and doesn't cover       *
+*                       more records than the BFD file has, the segment     *
+*                       will be appended to it.  Otherwise (no index, or    *
+*                       one that's damaged or for a different file) a new   *
+*                       index is written.  Either way the records between   *
+*                       the end of the index and the end of the BFD file    *
+*                       have to be added (see spatial_index_load_bfd)       *
+*                       before any new ones.                                *
+*                                                                           *
+*   Inputs:             bfd_name            -   BFD file name               *
+*                       bfd_records         -   records in the BFD file     *
+*                                                                           *
+*   Outputs:            SPATIAL_INDEX_WRITER *  -   writer or NULL if we    *
+*                                               ran out of memory           *
+*                                                                           *
+\***************************************************************************/
+
+SPATIAL_INDEX_WRITER *spatial_index_writer_open (const char *bfd_name, uint32_t bfd_records)
+{
+  SPATIAL_INDEX_WRITER  *writer;
+  SPATIAL_INDEX         *index;
+
+
+  if ((writer = (SPATIAL_INDEX_WRITER *) calloc (1, sizeof (SPATIAL_INDEX_WRITER))) == NULL) return (NULL);
+
+  spatial_index_name (bfd_name, writer->path);
+
+  if ((index = spatial_index_open (writer->path)) != NULL && index->header.records <= bfd_records)
+    {
+      writer->header = index->header;
+      writer->first_record = (uint32_t) index->header.records;
+    }
+  else
+    {
+      writer->rebuild = NVTrue;
+    }
+
+  spatial_index_close (index);
+
+  return (writer);
+}
+
+
+
+/*  Adds the records that are in the BFD file but not in the index (or the segment so far), up to bfd_records.
+    Returns the number added, or -1 on error (writer->error is set unless it was the BFD library).  */
+
+int32_t spatial_index_load_bfd (SPATIAL_INDEX_WRITER *writer, int32_t bfd_handle, uint32_t bfd_records)
+{
+  BFDATA_RECORD       bfd_record;
+  uint32_t            record;
+  int32_t             loaded = 0;
+
+
+  for (record = writer->first_record + writer->records ; record < bfd_records ; record++)
+    {
+      if (binaryFeatureData_read_record (bfd_handle, record, &bfd_record) < 0 ||
+          spatial_index_add (writer, bfd_record.latitude, bfd_record.longitude) < 0) return (-1);
+
+      loaded++;
+    }
+
+  writer->caught_up += loaded;
+
+  return (loaded);
+}
+
+
+
+/*  Adds the next BFD record (they have to be added in record number order).  A record without a usable position
+    takes up its record number but can't be found.  Returns 0, or -1 if we ran out of memory.  */
+
+int32_t spatial_index_add (SPATIAL_INDEX_WRITER *writer, double latitude, double longitude)
+{
+  double              *position;
+  uint32_t            *record, size;
+
+
+  if (writer->error) return (-1);
+
+  writer->records++;
+
+  if (!isfinite (latitude) || !isfinite (longitude)) return (0);
+
+  if (writer->count == writer->size)
+    {
+      size = writer->size ? writer->size * 2 : 4096;
+
+      if ((position = (double *) realloc (writer->position, size * 2 * sizeof (double))) == NULL)
+        {
+          writer->error = ENOMEM;
+          return (-1);
+        }
+
+      writer->position = position;
+
+      if ((record = (uint32_t *) realloc (writer->record, size * sizeof (uint32_t))) == NULL)
+        {
+          writer->error = ENOMEM;
+          return (-1);
+        }
+
+      writer->record = record;
+      writer->size = size;
+    }
+
+  writer->position[writer->count * 2] = latitude;
+  writer->position[writer->count * 2 + 1] = longitude;
+  writer->record[writer->count++] = writer->first_record + writer->records - 1;
+
+  return (0);
+}
+
+
+
+static int32_t compare_keys (const void *a, const void *b)
+{
+  const SPATIAL_INDEX_KEY  *ka = (const SPATIAL_INDEX_KEY *) a, *kb = (const SPATIAL_INDEX_KEY *) b;
+
+
+  if (ka->key != kb->key) return (ka->key < kb->key ? -1 : 1);
+
+  return (ka->entry < kb->entry ? -1 : (ka->entry > kb->entry));
+}
+
+
+
+/*  Position within [min, max] to 1/65536 of the range.  */
+
+static uint16_t quantize (double value, double min, double max)
+{
+  double              q;
+
+
+  if (max <= min) return (0);
+
+  q = floor ((value - min) / (max - min) * 65536.0);
+
+  if (q < 0.0) return (0);
+  if (q > 65535.0) return (65535);
+
+  return ((uint16_t) q);
+}
+
+
+
+/*  Packs the features into a tree.  The entries are sorted along the Hilbert curve, cut into leaves, and each
+    leaf gets the bounds of its features.  Each level above that gets the bounds of its children.  */
+
+static void pack_segment (SPATIAL_INDEX_WRITER *writer, SPATIAL_INDEX_KEY *keys, SPATIAL_INDEX_SEGMENT *segment,
+                          SPATIAL_INDEX_NODE *node, SPATIAL_INDEX_ENTRY *entry)
+{
+  uint32_t            level_nodes[SPATIAL_INDEX_MAX_LEVELS], start = 0, level, n, first, last, i;
+  SPATIAL_INDEX_NODE  *bounds;
+  double              *position;
+
+
+  for (i = 0 ; i < writer->count ; i++)
+    {
+      keys[i].key = spatial_order_key (SPATIAL_ORDER_HILBERT, writer->position[i * 2], writer->position[i * 2 + 1]);
+      keys[i].entry = i;
+    }
+
+  qsort (keys, writer->count, sizeof (SPATIAL_INDEX_KEY), compare_keys);
+
+  segment->levels = level_counts (writer->count, level_nodes);
+
+  for (n = 0 ; n < level_nodes[0] ; n++)
+    {
+      bounds = &node[n];
+      first = n * SPATIAL_INDEX_FANOUT;
+      last = first + SPATIAL_INDEX_FANOUT;
+      if (last > writer->count) last = writer->count;
+
+      position = &writer->position[keys[first].entry * 2];
+      bounds->south = bounds->north = position[0];
+      bounds->west = bounds->east = position[1];
+
+      for (i = first + 1 ; i < last ; i++)
+        {
+          position = &writer->position[keys[i].entry * 2];
+
+          if (position[0] < bounds->south) bounds->south = position[0];
+          if (position[0] > bounds->north) bounds->north = position[0];
+          if (position[1] < bounds->west) bounds->west = position[1];
+          if (position[1] > bounds->east) bounds->east = position[1];
+        }
+
+      for (i = first ; i < last ; i++)
+        {
+          position = &writer->position[keys[i].entry * 2];
+
+          entry[i].record = writer->record[keys[i].entry];
+          entry[i].latitude = quantize (position[0], bounds->south, bounds->north);
+          entry[i].longitude = quantize (position[1], bounds->west, bounds->east);
+        }
+    }
+
+  segment->nodes = level_nodes[0];
+
+  for (level = 1 ; level < segment->levels ; level++)
+    {
+      for (n = 0 ; n < level_nodes[level] ; n++)
+        {
+          bounds = &node[segment->nodes + n];
+          first = start + n * SPATIAL_INDEX_FANOUT;
+          last = first + SPATIAL_INDEX_FANOUT;
+          if (last > start + level_nodes[level - 1]) last = start + level_nodes[level - 1];
+
+          *bounds = node[first];
+
+          for (i = first + 1 ; i < last ; i++)
+            {
+              if (node[i].south < bounds->south) bounds->south = node[i].south;
+              if (node[i].north > bounds->north) bounds->north = node[i].north;
+              if (node[i].west < bounds->west) bounds->west = node[i].west;
+              if (node[i].east > bounds->east) bounds->east = node[i].east;
+            }
+        }
+
+      start += level_nodes[level - 1];
+      segment->nodes += level_nodes[level];
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_index_finish                                *
+*                                                                           *
+*   Purpose:            Builds the segment from everything added so far     *
+*                       and appends it to the index (or writes a new        *
+*                       index).  The segment is synced to disk before the   *
+*                       header is updated to include it so a crash never    *
+*                       leaves a header pointing at a partial segment.      *
+*                       The writer can go on to build another segment.      *
+*                                                                           *
+*   Inputs:             writer              -   index writer                *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error           *
+*                                               (writer->error is set)      *
+*                                                                           *
+\***************************************************************************/
+
+int32_t spatial_index_finish (SPATIAL_INDEX_WRITER *writer)
+{
+  SPATIAL_INDEX_SEGMENT  segment;
+  SPATIAL_INDEX_KEY   *keys = NULL;
+  SPATIAL_INDEX_NODE  *node = NULL;
+  SPATIAL_INDEX_ENTRY *entry = NULL;
+  FILE                *fp = NULL;
+  uint32_t            level_nodes[SPATIAL_INDEX_MAX_LEVELS], nodes = 0, levels, i;
+  int32_t             status;
+  uint64_t            start = stats_clock_ns ();
+
+
+  if (writer->error) return (-1);
+
+  if (!writer->records && !writer->rebuild) return (0);
+
+  errno = 0;
+
+  memset (&segment, 0, sizeof (SPATIAL_INDEX_SEGMENT));
+  segment.first_record = writer->first_record;
+  segment.records = writer->records;
+  segment.entries = writer->count;
+
+  levels = level_counts (writer->count, level_nodes);
+  for (i = 0 ; i < levels ; i++) nodes += level_nodes[i];
+
+  if ((keys = (SPATIAL_INDEX_KEY *) malloc ((writer->count ? writer->count : 1) * sizeof (SPATIAL_INDEX_KEY))) == NULL ||
+      (node = (SPATIAL_INDEX_NODE *) malloc ((nodes ? nodes : 1) * sizeof (SPATIAL_INDEX_NODE))) == NULL ||
+      (entry = (SPATIAL_INDEX_ENTRY *) malloc ((writer->count ? writer->count : 1) * sizeof (SPATIAL_INDEX_ENTRY))) == NULL)
+    {
+      errno = ENOMEM;
+      goto fail;
+    }
+
+  if (writer->count) pack_segment (writer, keys, &segment, node, entry);
+
+  free (keys);
+  keys = NULL;
+
+
+  /*  A new index starts out empty.  */
+
+  if (writer->rebuild)
+    {
+      memset (&writer->header, 0, sizeof (SPATIAL_INDEX_HEADER));
+      memcpy (writer->header.magic, SPATIAL_INDEX_MAGIC, sizeof (writer->header.magic));
+      writer->header.version = SPATIAL_INDEX_VERSION;
+      writer->header.byte_order = SPATIAL_INDEX_BYTE_ORDER;
+      writer->header.fanout = SPATIAL_INDEX_FANOUT;
+      writer->header.size = sizeof (SPATIAL_INDEX_HEADER);
+
+      if ((fp = fopen (writer->path, "wb")) == NULL ||
+          fwrite (&writer->header, sizeof (SPATIAL_INDEX_HEADER), 1, fp) != 1) goto fail;
+    }
+  else if ((fp = fopen (writer->path, "r+b")) == NULL || fseek (fp, (long) writer->header.size, SEEK_SET))
+    {
+      goto fail;
+    }
+
+  if (writer->records)
+    {
+      if (fwrite (&segment, sizeof (SPATIAL_INDEX_SEGMENT), 1, fp) != 1 ||
+          (nodes && fwrite (node, nodes * sizeof (SPATIAL_INDEX_NODE), 1, fp) != 1) ||
+          (writer->count && fwrite (entry, writer->count * sizeof (SPATIAL_INDEX_ENTRY), 1, fp) != 1) ||
+          fflush (fp) || checkpoint_sync_file (writer->path) < 0) goto fail;
+
+      writer->header.segments++;
+      writer->header.records += writer->records;
+      writer->header.size += sizeof (SPATIAL_INDEX_SEGMENT) + (uint64_t) nodes * sizeof (SPATIAL_INDEX_NODE) +
+        (uint64_t) writer->count * sizeof (SPATIAL_INDEX_ENTRY);
+    }
+
+  if (fseek (fp, 0, SEEK_SET) || fwrite (&writer->header, sizeof (SPATIAL_INDEX_HEADER), 1, fp) != 1)
+    goto fail;
+
+  status = fclose (fp);
+  fp = NULL;
+
+  if (status) goto fail;
+
+  free (node);
+  free (entry);
+
+
+  /*  Anything added from here on goes in the next segment.  */
+
+  writer->rebuild = NVFalse;
+  writer->first_record += writer->records;
+  writer->records = writer->count = 0;
+  writer->ns += stats_clock_ns () - start;
+
+  return (0);
+
+
+ fail:
+  writer->error = errno ? errno : EIO;
+
+  if (fp != NULL) fclose (fp);
+
+  free (keys);
+  free (node);
+  free (entry);
+
+  return (-1);
+}
+
+
+
+void spatial_index_writer_close (SPATIAL_INDEX_WRITER *writer)
+{
+  if (writer == NULL) return;
+
+  free (writer->position);
+  free (writer->record);
+  free (writer);
+}
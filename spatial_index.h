@@ -0,0 +1,180 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __SPATIAL_INDEX_H__
+#define __SPATIAL_INDEX_H__
+
+#include <stdio.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+
+
+/*  A spatial index is a sidecar file (BFD_FILE.bfx) that maps positions to BFD record numbers so a client that
+    only wants the features inside a box doesn't have to read every record.  It's laid out as
+
+        SPATIAL_INDEX_HEADER
+        for each segment (one per run that wrote to the BFD file):
+            SPATIAL_INDEX_SEGMENT
+            SPATIAL_INDEX_NODE for each node, leaves first and the root last
+            SPATIAL_INDEX_ENTRY for each feature
+
+    in native byte order.  A segment is a packed R-tree over the features of a run of consecutive record
+    numbers.  The entries are in Hilbert curve order and every SPATIAL_INDEX_FANOUT of them make a leaf, every
+    SPATIAL_INDEX_FANOUT leaves make a node on the next level up, and so on up to the root.  Since the tree is
+    packed the children of a node and the entries under it are found by arithmetic.  Appending to the BFD file
+    just adds a segment and then updates the header, so an index is never rebuilt unless it doesn't match the
+    BFD file any more.  Records past the header's record count (e.g. appended without an index) aren't
+    indexed, spatial_index_query reads them from the BFD file.  */
+
+#define SPATIAL_INDEX_MAGIC       "BFDSPIDX"
+#define SPATIAL_INDEX_VERSION     1
+#define SPATIAL_INDEX_BYTE_ORDER  0x01020304
+#define SPATIAL_INDEX_EXTENSION   ".bfx"
+#define SPATIAL_INDEX_FANOUT      64
+#define SPATIAL_INDEX_MAX_LEVELS  8
+
+
+/*  Positions in a leaf are stored to 1/65536 of the leaf's extent.  A feature whose quantized cell straddles
+    the edge of a query box (or is within this many degrees of it, to cover rounding) is read from the BFD
+    file to settle it.  */
+
+#define SPATIAL_INDEX_SLOP        1.0e-9
+
+
+typedef struct
+{
+  char                magic[8];
+  uint32_t            version;
+  uint32_t            byte_order;
+  uint32_t            fanout;
+  uint32_t            segments;
+  uint64_t            records;            /*  BFD records 0 through records - 1 are indexed  */
+  uint64_t            size;               /*  Size of the index (anything past this is an unfinished segment)  */
+} SPATIAL_INDEX_HEADER;
+
+
+typedef struct
+{
+  uint32_t            first_record;
+  uint32_t            records;            /*  Record numbers first_record through first_record + records - 1  */
+  uint32_t            entries;            /*  Features with a usable position (fewer than records if any aren't)  */
+  uint32_t            nodes;              /*  On all levels  */
+  uint32_t            levels;
+  uint32_t            spare;
+} SPATIAL_INDEX_SEGMENT;
+
+
+typedef struct
+{
+  double              south;
+  double              west;
+  double              north;
+  double              east;
+} SPATIAL_INDEX_NODE;
+
+
+typedef struct
+{
+  uint32_t            record;
+  uint16_t            latitude;           /*  Quantized within the leaf's bounds  */
+  uint16_t            longitude;
+} SPATIAL_INDEX_ENTRY;
+
+
+/*  A segment as read by spatial_index_open.  The nodes are kept in memory, the entries are read as needed.  */
+
+typedef struct
+{
+  SPATIAL_INDEX_SEGMENT  header;
+  SPATIAL_INDEX_NODE  *node;
+  uint32_t            level_start[SPATIAL_INDEX_MAX_LEVELS];  /*  Index in node of each level's first node  */
+  uint32_t            level_nodes[SPATIAL_INDEX_MAX_LEVELS];
+  int64_t             entry_offset;       /*  File offset of the entries  */
+} SPATIAL_INDEX_PART;
+
+
+typedef struct
+{
+  FILE                *fp;
+  SPATIAL_INDEX_HEADER  header;
+  SPATIAL_INDEX_PART  *part;
+  SPATIAL_INDEX_ENTRY *entry;             /*  Entries read for the current query  */
+  uint32_t            entry_size;         /*  Allocated size of entry  */
+  uint8_t             bfd_error;          /*  The last query failed reading the BFD file  */
+} SPATIAL_INDEX;
+
+
+/*  The record numbers found by a query, in ascending order.  checked is how many records had to be read
+    from the BFD file (features on the edge of the box and records the index doesn't cover).  */
+
+typedef struct
+{
+  uint32_t            *record;
+  uint32_t            count;
+  uint32_t            size;               /*  Allocated size of record  */
+  uint32_t            checked;
+} SPATIAL_INDEX_HITS;
+
+
+/*  Features waiting to go into the next segment.  They're added in record number order while the BFD file is
+    written and the segment is built and appended by spatial_index_finish.  Not thread safe.  */
+
+typedef struct
+{
+  uint64_t            key;                /*  Hilbert curve position  */
+  uint32_t            entry;              /*  Index in position  */
+} SPATIAL_INDEX_KEY;
+
+
+typedef struct
+{
+  char                path[1024];
+  uint8_t             rebuild;            /*  The old index didn't match the BFD file, write a new one  */
+  SPATIAL_INDEX_HEADER  header;           /*  Of the index we're appending to  */
+  uint32_t            first_record;
+  uint32_t            records;
+  double              *position;          /*  Latitude, longitude pairs in record order  */
+  uint32_t            count;              /*  Features with a usable position  */
+  uint32_t            size;               /*  Allocated size of position (in pairs)  */
+  uint32_t            *record;            /*  Record number of each position  */
+  uint32_t            caught_up;          /*  Records that were already in the BFD file but not indexed  */
+  uint64_t            ns;                 /*  Building and writing the segment  */
+  int32_t             error;              /*  errno of a failure (0 if none)  */
+} SPATIAL_INDEX_WRITER;
+
+
+void spatial_index_name (const char *bfd_name, char *path);
+SPATIAL_INDEX *spatial_index_open (const char *path);
+int32_t spatial_index_query (SPATIAL_INDEX *index, int32_t bfd_handle, uint32_t bfd_records, double south, double west,
+                             double north, double east, SPATIAL_INDEX_HITS *hits);
+void spatial_index_hits_free (SPATIAL_INDEX_HITS *hits);
+void spatial_index_close (SPATIAL_INDEX *index);
+SPATIAL_INDEX_WRITER *spatial_index_writer_open (const char *bfd_name, uint32_t bfd_records);
+int32_t spatial_index_load_bfd (SPATIAL_INDEX_WRITER *writer, int32_t bfd_handle, uint32_t bfd_records);
+int32_t spatial_index_add (SPATIAL_INDEX_WRITER *writer, double latitude, double longitude);
+int32_t spatial_index_finish (SPATIAL_INDEX_WRITER *writer);
+void spatial_index_writer_close (SPATIAL_INDEX_WRITER *writer);
+
+
+#endif
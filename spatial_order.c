@@ -0,0 +1,534 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spatial_order.h"
+#include "stats.h"
+
+
+/*  Returns SPATIAL_ORDER_HILBERT or SPATIAL_ORDER_MORTON for a curve name, or -1 if we don't know it.  */
+
+int32_t spatial_order_from_name (const char *name)
+{
+  if (!strcmp (name, "hilbert")) return (SPATIAL_ORDER_HILBERT);
+  if (!strcmp (name, "morton")) return (SPATIAL_ORDER_MORTON);
+
+  return (-1);
+}
+
+
+
+/*  Scales a coordinate to the full 32 bit range.  */
+
+static uint32_t grid (double value, double min, double range)
+{
+  double              scaled = (value - min) / range;
+
+
+  if (!(scaled > 0.0)) return (0);
+  if (scaled >= 1.0) return (0xffffffff);
+
+  return ((uint32_t) (scaled * 4294967296.0));
+}
+
+
+
+/*  Spreads the bits of a 32 bit value out to the even bits of a 64 bit value.  */
+
+static uint64_t spread (uint32_t value)
+{
+  uint64_t            v = value;
+
+
+  v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+  v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+  v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  v = (v | (v << 2)) & 0x3333333333333333ULL;
+  v = (v | (v << 1)) & 0x5555555555555555ULL;
+
+  return (v);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_order_key                                   *
+*                                                                           *
+*   Purpose:            Computes a position's distance along a space        *
+*                       filling curve over a 2^32 by 2^32 longitude/        *
+*                       latitude grid (about a centimeter per cell).        *
+*                       Positions that are close on the curve are close on  *
+*                       the ground.  The Hilbert curve keeps them closer    *
+*                       (no long jumps between quadrants), the Morton       *
+*                       (Z order) curve is cheaper to compute.              *
+*                                                                           *
+*   Inputs:             curve               -   SPATIAL_ORDER_HILBERT or    *
+*                                               SPATIAL_ORDER_MORTON        *
+*                       latitude            -   degrees                     *
+*                       longitude           -   degrees                     *
+*                                                                           *
+*   Outputs:            uint64_t            -   curve key                   *
+*                                                                           *
+\***************************************************************************/
+
+uint64_t spatial_order_key (int32_t curve, double latitude, double longitude)
+{
+  uint32_t            x, y, s, rx, ry, t;
+  uint64_t            d = 0;
+
+
+  x = grid (longitude, -180.0, 360.0);
+  y = grid (latitude, -90.0, 180.0);
+
+  if (curve == SPATIAL_ORDER_MORTON) return (spread (x) | (spread (y) << 1));
+
+
+  /*  Hilbert.  Work down from the biggest quadrants, rotating and flipping the lower half of the grid at each
+      level so the curve stays connected.  */
+
+  for (s = 0x80000000 ; s ; s >>= 1)
+    {
+      rx = (x & s) ? 1 : 0;
+      ry = (y & s) ? 1 : 0;
+
+      d += (uint64_t) s * (uint64_t) s * ((3 * rx) ^ ry);
+
+      if (!ry)
+        {
+          if (rx)
+            {
+              x = ~x;
+              y = ~y;
+            }
+
+          t = x;
+          x = y;
+          y = t;
+        }
+    }
+
+  return (d);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_order_open                                  *
+*                                                                           *
+*   Purpose:            Starts buffering records for curve ordered output.  *
+*                                                                           *
+*   Inputs:             curve               -   SPATIAL_ORDER_HILBERT or    *
+*                                               SPATIAL_ORDER_MORTON        *
+*                       memory              -   memory budget in bytes (0   *
+*                                               for the default)            *
+*                       bfd_name            -   BFD file name (spilled runs *
+*                                               go next to it)              *
+*                                                                           *
+*   Outputs:            SPATIAL_ORDER *     -   sorter or NULL if we ran    *
+*                                               out of memory               *
+*                                                                           *
+\***************************************************************************/
+
+SPATIAL_ORDER *spatial_order_open (int32_t curve, size_t memory, const char *bfd_name)
+{
+  SPATIAL_ORDER       *order;
+  char                *dot;
+
+
+  if ((order = (SPATIAL_ORDER *) calloc (1, sizeof (SPATIAL_ORDER))) == NULL) return (NULL);
+
+  order->curve = curve;
+  order->memory = memory ? memory : (size_t) SPATIAL_ORDER_MEMORY * 1024 * 1024;
+
+  strcpy (order->run_base, bfd_name);
+  if ((dot = strrchr (order->run_base, '.')) != NULL && strchr (dot, '/') == NULL) *dot = 0;
+
+  return (order);
+}
+
+
+
+static int32_t compare_keys (const void *a, const void *b)
+{
+  const SPATIAL_KEY   *ka = (const SPATIAL_KEY *) a, *kb = (const SPATIAL_KEY *) b;
+
+
+  if (ka->key != kb->key) return (ka->key < kb->key ? -1 : 1);
+
+  return (ka->entry < kb->entry ? -1 : (ka->entry > kb->entry));
+}
+
+
+
+/*  Sorts the buffered records.  Returns the keys in order (the caller frees them) or NULL if we ran out of
+    memory.  */
+
+static SPATIAL_KEY *sort_entries (SPATIAL_ORDER *order)
+{
+  SPATIAL_KEY         *keys;
+  uint32_t            i;
+
+
+  if ((keys = (SPATIAL_KEY *) malloc ((order->count ? order->count : 1) * sizeof (SPATIAL_KEY))) == NULL) return (NULL);
+
+  for (i = 0 ; i < order->count ; i++)
+    {
+      keys[i].key = order->entry[i].key;
+      keys[i].entry = i;
+    }
+
+  qsort (keys, order->count, sizeof (SPATIAL_KEY), compare_keys);
+
+  return (keys);
+}
+
+
+
+/*  Sorts what's buffered and writes it to a new run file.  Each record is the entry followed by its image
+    and image file name.  Returns 0, or -1 on error (errno is set).  */
+
+static int32_t spill (SPATIAL_ORDER *order)
+{
+  SPATIAL_RUN         *run;
+  SPATIAL_ENTRY       *entry;
+  SPATIAL_KEY         *keys;
+  uint32_t            i;
+  int32_t             err;
+  uint64_t            start = stats_clock_ns ();
+
+
+  if ((run = (SPATIAL_RUN *) realloc (order->run, (order->runs + 1) * sizeof (SPATIAL_RUN))) == NULL) return (-1);
+
+  order->run = run;
+  run = &order->run[order->runs];
+  memset (run, 0, sizeof (SPATIAL_RUN));
+
+  snprintf (run->name, sizeof (run->name), "%s.sort%03d", order->run_base, order->runs);
+
+  if ((run->fp = fopen (run->name, "w+b")) == NULL) return (-1);
+
+  order->runs++;
+
+  if ((keys = sort_entries (order)) == NULL) return (-1);
+
+  for (i = 0 ; i < order->count ; i++)
+    {
+      entry = &order->entry[keys[i].entry];
+
+      if (fwrite (entry, sizeof (SPATIAL_ENTRY), 1, run->fp) != 1 ||
+          (entry->image_size + entry->name_length &&
+           fwrite (order->data + entry->data, entry->image_size + entry->name_length, 1, run->fp) != 1))
+        {
+          err = errno;
+          free (keys);
+          errno = err;
+          return (-1);
+        }
+    }
+
+  free (keys);
+
+  order->count = 0;
+  order->data_used = 0;
+  order->ns += stats_clock_ns () - start;
+
+  return (0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_order_add                                   *
+*                                                                           *
+*   Purpose:            Buffers a record (and its image or image file       *
+*                       name) until spatial_order_finish.  Spills a sorted  *
+*                       run to disk first if it won't fit in the memory     *
+*                       budget.                                             *
+*                                                                           *
+*   Inputs:             order               -   sorter                      *
+*                       record              -   BFD record                  *
+*                       image               -   loaded image or NULL        *
+*                       image_size          -   size of image               *
+*                       image_name          -   image file name (if the     *
+*                                               image isn't loaded) or NULL *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error (errno is *
+*                                               set)                        *
+*                                                                           *
+\***************************************************************************/
+
+int32_t spatial_order_add (SPATIAL_ORDER *order, BFDATA_RECORD *record, const uint8_t *image, uint32_t image_size,
+                           const char *image_name)
+{
+  SPATIAL_ENTRY       *entry;
+  size_t              name_length = 0, size;
+  uint8_t             *data;
+
+
+  if (image == NULL) image_size = 0;
+  if (!image_size && image_name != NULL) name_length = strlen (image_name);
+
+
+  /*  The spilled run has to fit in the budget along with the records we're about to buffer.  */
+
+  if (order->count && (size_t) order->count * sizeof (SPATIAL_ENTRY) + order->data_used + image_size + name_length +
+      sizeof (SPATIAL_ENTRY) > order->memory && spill (order) < 0)
+    return (-1);
+
+  if (order->count == order->size)
+    {
+      order->size = order->size ? order->size * 2 : 4096;
+
+      if ((entry = (SPATIAL_ENTRY *) realloc (order->entry, order->size * sizeof (SPATIAL_ENTRY))) == NULL) return (-1);
+
+      order->entry = entry;
+    }
+
+  if (order->data_used + image_size + name_length > order->data_size)
+    {
+      size = order->data_size ? order->data_size : 1024 * 1024;
+      while (size < order->data_used + image_size + name_length) size *= 2;
+
+      if ((data = (uint8_t *) realloc (order->data, size)) == NULL) return (-1);
+
+      order->data = data;
+      order->data_size = size;
+    }
+
+  entry = &order->entry[order->count++];
+
+  entry->key = spatial_order_key (order->curve, record->latitude, record->longitude);
+  entry->record = *record;
+  entry->data = order->data_used;
+  entry->image_size = image_size;
+  entry->name_length = (uint16_t) name_length;
+
+  if (image_size) memcpy (order->data + order->data_used, image, image_size);
+  if (name_length) memcpy (order->data + order->data_used + image_size, image_name, name_length);
+
+  order->data_used += image_size + name_length;
+  order->records++;
+
+  return (0);
+}
+
+
+
+/*  Reads the next record from a spilled run.  Returns 0, or -1 on error.  */
+
+static int32_t read_run (SPATIAL_RUN *run)
+{
+  uint8_t             *buffer;
+  uint32_t            size;
+
+
+  if (fread (&run->entry, sizeof (SPATIAL_ENTRY), 1, run->fp) != 1)
+    {
+      if (ferror (run->fp)) return (-1);
+
+      run->done = NVTrue;
+      return (0);
+    }
+
+  size = run->entry.image_size + run->entry.name_length + 1;
+
+  if (size > run->buffer_size)
+    {
+      if ((buffer = (uint8_t *) realloc (run->buffer, size)) == NULL) return (-1);
+
+      run->buffer = buffer;
+      run->buffer_size = size;
+    }
+
+  if (size > 1 && fread (run->buffer, size - 1, 1, run->fp) != 1)
+    {
+      if (!ferror (run->fp)) errno = EIO;
+      return (-1);
+    }
+
+  run->buffer[size - 1] = 0;
+
+  return (0);
+}
+
+
+
+/*  Hands a buffered record (image at data, name after it) to the output function.  */
+
+static int32_t output_entry (SPATIAL_ENTRY *entry, uint8_t *data, SPATIAL_OUTPUT_FUNC output, void *user)
+{
+  char                name[512];
+
+
+  if (entry->name_length)
+    {
+      memcpy (name, data + entry->image_size, entry->name_length < sizeof (name) ? entry->name_length : sizeof (name) - 1);
+      name[entry->name_length < sizeof (name) ? entry->name_length : sizeof (name) - 1] = 0;
+    }
+
+  return ((*output) (&entry->record, entry->image_size ? data : NULL, entry->image_size,
+                     entry->name_length ? name : NULL, user));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        spatial_order_finish                                *
+*                                                                           *
+*   Purpose:            Hands every buffered record to output in curve      *
+*                       order.  If nothing was spilled the buffer is just   *
+*                       sorted, otherwise what's left is spilled too and    *
+*                       the runs are merged.                                *
+*                                                                           *
+*   Inputs:             order               -   sorter                      *
+*                       output              -   output function             *
+*                       data                -   passed to output            *
+*                                                                           *
+*   Outputs:            int32_t             -   0, or -1 on error (errno is *
+*                                               set unless output failed)   *
+*                                                                           *
+\***************************************************************************/
+
+int32_t spatial_order_finish (SPATIAL_ORDER *order, SPATIAL_OUTPUT_FUNC output, void *data)
+{
+  SPATIAL_KEY         *keys;
+  SPATIAL_RUN         *run;
+  uint64_t            start;
+  uint32_t            i;
+  int32_t             j, next;
+
+
+  start = stats_clock_ns ();
+
+
+  /*  Everything fit in memory.  */
+
+  if (!order->runs)
+    {
+      if ((keys = sort_entries (order)) == NULL) return (-1);
+
+      order->ns += stats_clock_ns () - start;
+
+      for (i = 0 ; i < order->count ; i++)
+        {
+          if (output_entry (&order->entry[keys[i].entry], order->data + order->entry[keys[i].entry].data, output,
+                            data) < 0)
+            {
+              free (keys);
+              errno = 0;
+              return (-1);
+            }
+        }
+
+      free (keys);
+      order->count = 0;
+      order->data_used = 0;
+
+      return (0);
+    }
+
+
+  /*  Merge the runs.  There are only ever a few of them (each one is a memory budget's worth of records) so
+      the next record is found by just looking at the head of each run.  Ties go to the earlier run so equal
+      keys stay in the order they were added.  */
+
+  if (order->count && spill (order) < 0) return (-1);
+
+  start = stats_clock_ns ();
+
+  free (order->entry);
+  free (order->data);
+  order->entry = NULL;
+  order->data = NULL;
+  order->size = order->count = 0;
+  order->data_size = order->data_used = 0;
+
+  for (j = 0 ; j < order->runs ; j++)
+    {
+      run = &order->run[j];
+
+      if (fseek (run->fp, 0, SEEK_SET) < 0 || read_run (run) < 0) return (-1);
+    }
+
+  order->ns += stats_clock_ns () - start;
+
+  while (1)
+    {
+      next = -1;
+
+      for (j = 0 ; j < order->runs ; j++)
+        {
+          run = &order->run[j];
+
+          if (!run->done && (next < 0 || run->entry.key < order->run[next].entry.key)) next = j;
+        }
+
+      if (next < 0) break;
+
+      run = &order->run[next];
+
+      if (output_entry (&run->entry, run->buffer, output, data) < 0)
+        {
+          errno = 0;
+          return (-1);
+        }
+
+      start = stats_clock_ns ();
+
+      if (read_run (run) < 0) return (-1);
+
+      order->ns += stats_clock_ns () - start;
+    }
+
+  return (0);
+}
+
+
+
+/*  Frees the sorter and removes any run files.  */
+
+void spatial_order_close (SPATIAL_ORDER *order)
+{
+  int32_t             j;
+
+
+  if (order == NULL) return;
+
+  for (j = 0 ; j < order->runs ; j++)
+    {
+      if (order->run[j].fp != NULL) fclose (order->run[j].fp);
+      remove (order->run[j].name);
+      free (order->run[j].buffer);
+    }
+
+  free (order->run);
+  free (order->entry);
+  free (order->data);
+  free (order);
+}
@@ -0,0 +1,118 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __SPATIAL_ORDER_H__
+#define __SPATIAL_ORDER_H__
+
+#include <stdio.h>
+
+#include "nvutility.h"
+
+#include "binaryFeatureData.h"
+
+
+/*  Space filling curves.  */
+
+#define SPATIAL_ORDER_NONE      0
+#define SPATIAL_ORDER_HILBERT   1
+#define SPATIAL_ORDER_MORTON    2
+
+
+/*  Default memory budget (in MB) for buffered records and images before a sorted run is spilled to disk.  */
+
+#define SPATIAL_ORDER_MEMORY    512
+
+
+/*  A buffered record.  The image (if it was loaded) and the image file name (if the image is read when the
+    record is written) are in the data buffer, in that order.  */
+
+typedef struct
+{
+  uint64_t            key;                /*  Position on the curve  */
+  BFDATA_RECORD       record;
+  size_t              data;               /*  Offset of the image and name in the data buffer  */
+  uint32_t            image_size;         /*  Loaded image size (0 for none)  */
+  uint16_t            name_length;        /*  Image file name length (0 for none)  */
+} SPATIAL_ENTRY;
+
+
+/*  Sort key for a buffered record.  Ties stay in the order the records were added.  */
+
+typedef struct
+{
+  uint64_t            key;
+  uint32_t            entry;
+} SPATIAL_KEY;
+
+
+/*  A sorted run that was spilled to disk, and the record from it that's next in line during the merge.  */
+
+typedef struct
+{
+  FILE                *fp;
+  char                name[1024];
+  SPATIAL_ENTRY       entry;              /*  data is unused, the image and name are in buffer  */
+  uint8_t             *buffer;
+  uint32_t            buffer_size;
+  uint8_t             done;
+} SPATIAL_RUN;
+
+
+/*  Called with each record in curve order.  image is NULL if there isn't one loaded, image_name is NULL or
+    the file to read the image from.  Returns 0, or -1 to stop.  */
+
+typedef int32_t (*SPATIAL_OUTPUT_FUNC) (BFDATA_RECORD *record, const uint8_t *image, uint32_t image_size,
+                                        const char *image_name, void *data);
+
+
+/*  Buffers records and hands them back in space filling curve order (by latitude/longitude).  Records that
+    don't fit in the memory budget are sorted and spilled to run files which are merged at the end.  Not
+    thread safe.  */
+
+typedef struct
+{
+  int32_t             curve;
+  size_t              memory;             /*  Budget in bytes  */
+  char                run_base[1000];     /*  Run files are run_base.sortNNN  */
+  SPATIAL_ENTRY       *entry;
+  uint32_t            count;
+  uint32_t            size;               /*  Allocated size of entry  */
+  uint8_t             *data;              /*  Images and image file names  */
+  size_t              data_used;
+  size_t              data_size;
+  SPATIAL_RUN         *run;
+  int32_t             runs;
+  uint64_t            records;            /*  Records added  */
+  uint64_t            ns;                 /*  Sorting, spilling, and merging  */
+} SPATIAL_ORDER;
+
+
+int32_t spatial_order_from_name (const char *name);
+uint64_t spatial_order_key (int32_t curve, double latitude, double longitude);
+SPATIAL_ORDER *spatial_order_open (int32_t curve, size_t memory, const char *bfd_name);
+int32_t spatial_order_add (SPATIAL_ORDER *order, BFDATA_RECORD *record, const uint8_t *image, uint32_t image_size,
+                           const char *image_name);
+int32_t spatial_order_finish (SPATIAL_ORDER *order, SPATIAL_OUTPUT_FUNC output, void *data);
+void spatial_order_close (SPATIAL_ORDER *order);
+
+
+#endif
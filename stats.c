@@ -0,0 +1,82 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "version.h"
+
+
+/*  Writes the run stats as a single JSON object.  Throughputs are per second of wall time.  */
+
+void stats_write_json (FILE *fp, INGEST_STATS *stats)
+{
+  double              seconds = (double) stats->wall_ns * 1.0e-9;
+
+
+  if (seconds <= 0.0) seconds = 1.0e-9;
+
+  fprintf (fp, "{\n");
+  fprintf (fp, "  \"version\": \"%s\",\n", VERSION);
+  fprintf (fp, "  \"files\": %d,\n", stats->files);
+  fprintf (fp, "  \"failed_files\": %d,\n", stats->failed);
+  fprintf (fp, "  \"files_from_parse_cache\": %d,\n", stats->cached_files);
+  fprintf (fp, "  \"threads\": %d,\n", stats->threads);
+  fprintf (fp, "  \"bytes_read\": %llu,\n", (unsigned long long) stats->bytes_read);
+  fprintf (fp, "  \"compressed_bytes_read\": %llu,\n", (unsigned long long) stats->compressed_bytes);
+  fprintf (fp, "  \"chunks\": %llu,\n", (unsigned long long) stats->chunks);
+  fprintf (fp, "  \"lines\": %llu,\n", (unsigned long long) stats->lines);
+  fprintf (fp, "  \"header_lines_skipped\": %llu,\n", (unsigned long long) stats->lines_skipped);
+  fprintf (fp, "  \"blank_lines_skipped\": %llu,\n", (unsigned long long) stats->blank_lines);
+  fprintf (fp, "  \"lines_rejected\": %llu,\n", (unsigned long long) stats->lines_rejected);
+  fprintf (fp, "  \"records_parsed\": %llu,\n", (unsigned long long) stats->records_parsed);
+  fprintf (fp, "  \"records_written\": %llu,\n", (unsigned long long) stats->records_written);
+  fprintf (fp, "  \"duplicates\": %llu,\n", (unsigned long long) stats->duplicates);
+  fprintf (fp, "  \"images_attached\": %llu,\n", (unsigned long long) stats->images);
+  fprintf (fp, "  \"image_bytes_attached\": %llu,\n", (unsigned long long) stats->image_bytes);
+  fprintf (fp, "  \"images_left_to_library\": %llu,\n", (unsigned long long) stats->image_fallbacks);
+  fprintf (fp, "  \"images_missing\": %llu,\n", (unsigned long long) stats->images_missing);
+  fprintf (fp, "  \"bfd_flushes\": %llu,\n", (unsigned long long) stats->flushes);
+  fprintf (fp, "  \"spatial_sort_runs\": %d,\n", stats->sort_runs);
+  fprintf (fp, "  \"ogr_outputs\": %d,\n", stats->sinks);
+  fprintf (fp, "  \"ogr_features_written\": %llu,\n", (unsigned long long) stats->sink_features);
+  fprintf (fp, "  \"ogr_output_stalls\": %llu,\n", (unsigned long long) stats->sink_stalls);
+  fprintf (fp, "  \"ns\": {\n");
+  fprintf (fp, "    \"wall\": %llu,\n", (unsigned long long) stats->wall_ns);
+  fprintf (fp, "    \"read\": %llu,\n", (unsigned long long) stats->read_ns);
+  fprintf (fp, "    \"parse\": %llu,\n", (unsigned long long) stats->parse_ns);
+  fprintf (fp, "    \"time_conversion\": %llu,\n", (unsigned long long) stats->time_ns);
+  fprintf (fp, "    \"commit\": %llu,\n", (unsigned long long) stats->commit_ns);
+  fprintf (fp, "    \"image_read\": %llu,\n", (unsigned long long) stats->image_ns);
+  fprintf (fp, "    \"decompress\": %llu,\n", (unsigned long long) stats->decompress_ns);
+  fprintf (fp, "    \"bfd_write\": %llu,\n", (unsigned long long) stats->write_ns);
+  fprintf (fp, "    \"spatial_sort\": %llu,\n", (unsigned long long) stats->sort_ns);
+  fprintf (fp, "    \"ogr_write\": %llu,\n", (unsigned long long) stats->sink_ns);
+  fprintf (fp, "    \"spatial_index\": %llu\n", (unsigned long long) stats->index_ns);
+  fprintf (fp, "  },\n");
+  fprintf (fp, "  \"mb_per_second\": %.3f,\n", (double) stats->bytes_read * 1.0e-6 / seconds);
+  fprintf (fp, "  \"records_per_second\": %.1f\n", (double) stats->records_written / seconds);
+  fprintf (fp, "}\n");
+  fflush (fp);
+}
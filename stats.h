@@ -0,0 +1,105 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef WIN32
+    #include <windows.h>
+#endif
+
+#include "nvutility.h"
+
+
+/*  Per stage counters for a run.  All times are in nanoseconds.  Each field is only ever updated by one
+    thread (the reader, or the pipeline writer for everything that rides along with a parsed batch) so
+    there are no locks or atomics in the hot paths.  */
+
+typedef struct
+{
+  uint64_t            wall_ns;            /*  Whole run  */
+  uint64_t            read_ns;            /*  Cutting the input into chunks (page faults, stream reads)  */
+  uint64_t            parse_ns;           /*  Parsing, not counting time conversion (summed over threads)  */
+  uint64_t            time_ns;            /*  DTG time conversion (summed over threads)  */
+  uint64_t            commit_ns;          /*  Contact IDs, duplicate checks, and staging for the BFD  */
+  uint64_t            image_ns;           /*  Reading snippet images (summed over threads)  */
+  uint64_t            decompress_ns;      /*  Reading and decompressing compressed input (its own thread)  */
+  uint64_t            write_ns;           /*  BFD library writes  */
+  uint64_t            sort_ns;            /*  Spatial ordering (sorting, spilling, and reading back runs)  */
+  uint64_t            sink_ns;            /*  Writing the extra OGR outputs (summed over their threads)  */
+  uint64_t            index_ns;           /*  Building and writing the spatial index segment  */
+  uint64_t            bytes_read;
+  uint64_t            compressed_bytes;   /*  Compressed input read to get (some of) bytes_read  */
+  uint64_t            chunks;
+  uint64_t            lines;
+  uint64_t            lines_skipped;      /*  Header lines  */
+  uint64_t            blank_lines;
+  uint64_t            lines_rejected;     /*  Bad lines (tolerant mode only)  */
+  uint64_t            records_parsed;
+  uint64_t            records_written;
+  uint64_t            duplicates;
+  uint64_t            images;             /*  Images staged in memory  */
+  uint64_t            image_bytes;        /*  Bytes of staged images  */
+  uint64_t            image_fallbacks;    /*  Images left to the BFD library (too big to stage)  */
+  uint64_t            images_missing;     /*  Images that couldn't be read (record written without it)  */
+  uint64_t            flushes;
+  uint64_t            sink_features;      /*  Features written to the extra OGR outputs (all of them)  */
+  uint64_t            sink_stalls;        /*  Times the commit thread waited on a full OGR output queue  */
+  int32_t             files;
+  int32_t             failed;
+  int32_t             cached_files;       /*  Loaded from a parse cache instead of parsed  */
+  int32_t             threads;
+  int32_t             sort_runs;          /*  Sorted runs spilled to disk for spatial ordering  */
+  int32_t             sinks;              /*  Extra OGR outputs  */
+} INGEST_STATS;
+
+
+/*  Monotonic clock in nanoseconds.  */
+
+static inline uint64_t stats_clock_ns ()
+{
+#ifdef WIN32
+  LARGE_INTEGER       count, frequency;
+
+
+  QueryPerformanceCounter (&count);
+  QueryPerformanceFrequency (&frequency);
+
+  return ((uint64_t) ((double) count.QuadPart * 1.0e9 / (double) frequency.QuadPart));
+#else
+  struct timespec     tp;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+
+  return ((uint64_t) tp.tv_sec * 1000000000ULL + (uint64_t) tp.tv_nsec);
+#endif
+}
+
+
+void stats_write_json (FILE *fp, INGEST_STATS *stats);
+
+
+#endif
@@ -0,0 +1,492 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <locale.h>
+
+#include "string_view.h"
+
+
+/*  Powers of ten that are exactly representable as doubles (and, up to 1.0e10, as floats).  */
+
+const double sv_pow10[23] = {1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9, 1.0e10,
+                             1.0e11, 1.0e12, 1.0e13, 1.0e14, 1.0e15, 1.0e16, 1.0e17, 1.0e18, 1.0e19,
+                             1.0e20, 1.0e21, 1.0e22};
+
+static const float pow10f_tab[11] = {1.0e0f, 1.0e1f, 1.0e2f, 1.0e3f, 1.0e4f, 1.0e5f, 1.0e6f, 1.0e7f, 1.0e8f, 1.0e9f,
+                                     1.0e10f};
+
+
+/*  Same set of characters that isspace returns true for in the "C" locale.  We don't call isspace
+    because it is locale dependent.  */
+
+static inline uint8_t sv_isspace (char c)
+{
+  return (c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r');
+}
+
+
+static inline const char *sv_skip_space (const char *ptr, const char *end)
+{
+  while (ptr < end && sv_isspace (*ptr)) ptr++;
+
+  return (ptr);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        sv_next_token                                       *
+*                                                                           *
+*   Purpose:            Returns the next token from rest in the same way    *
+*                       strtok would (leading delimiters are skipped so     *
+*                       empty fields are collapsed) but without modifying   *
+*                       or copying the input.                               *
+*                                                                           *
+*   Inputs:             rest                -   remaining text, updated     *
+*                       delim               -   delimiter character         *
+*                       token               -   returned token              *
+*                                                                           *
+*   Outputs:            uint8_t             -   NVFalse if no more tokens   *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t sv_next_token (STRING_VIEW *rest, char delim, STRING_VIEW *token)
+{
+  const char *ptr = rest->ptr, *end = rest->ptr + rest->len, *start;
+
+
+  while (ptr < end && *ptr == delim) ptr++;
+
+  if (ptr == end)
+    {
+      token->ptr = end;
+      token->len = 0;
+      rest->ptr = end;
+      rest->len = 0;
+      return (NVFalse);
+    }
+
+  start = ptr;
+
+  if ((ptr = memchr (start, delim, end - start)) == NULL) ptr = end;
+
+  token->ptr = start;
+  token->len = ptr - start;
+
+
+  /*  Step over the delimiter that ended the token (if any).  */
+
+  if (ptr < end) ptr++;
+
+  rest->ptr = ptr;
+  rest->len = end - ptr;
+
+  return (NVTrue);
+}
+
+
+
+/*  Equivalent of strstr (sv, needle) != NULL.  */
+
+uint8_t sv_contains (STRING_VIEW sv, const char *needle)
+{
+  size_t nlen = strlen (needle);
+  const char *ptr, *end;
+
+
+  if (!nlen) return (NVTrue);
+  if (nlen > sv.len) return (NVFalse);
+
+  ptr = sv.ptr;
+  end = sv.ptr + sv.len - nlen + 1;
+
+  while (ptr < end && (ptr = memchr (ptr, needle[0], end - ptr)) != NULL)
+    {
+      if (!memcmp (ptr, needle, nlen)) return (NVTrue);
+      ptr++;
+    }
+
+  return (NVFalse);
+}
+
+
+
+/*  Copies a view into a zero terminated buffer of size bytes, truncating if necessary.  Only meant for
+    the final destination of a field (e.g. BFD remarks or an image file name), never as scratch space.  */
+
+size_t sv_copy (STRING_VIEW sv, char *dest, size_t size)
+{
+  size_t len = sv.len;
+
+
+  if (!size) return (0);
+
+  if (len > size - 1) len = size - 1;
+
+  memcpy (dest, sv.ptr, len);
+  dest[len] = 0;
+
+  return (len);
+}
+
+
+
+/*  Fallback for the odd cases that the fast decimal scanner doesn't handle (more than 19 significant
+    digits, large exponents, hex, inf, nan).  This is the only place that copies field text and it
+    should essentially never be hit with real contact data.  Since strtod uses the locale's decimal
+    point we swap it in so that "." always works no matter what locale we (or our caller) are in.  */
+
+static const char *sv_scan_slow (const char *ptr, const char *end, double *dvalue, float *fvalue)
+{
+  char buf[64], *endp, point;
+  size_t len = end - ptr, i;
+
+
+  if (len > sizeof (buf) - 1) len = sizeof (buf) - 1;
+
+  memcpy (buf, ptr, len);
+  buf[len] = 0;
+
+  point = localeconv ()->decimal_point[0];
+
+  if (point != '.')
+    {
+      for (i = 0 ; i < len ; i++)
+        {
+          if (buf[i] == '.')
+            {
+              buf[i] = point;
+            }
+          else if (buf[i] == point)
+            {
+              buf[i] = 0;
+              break;
+            }
+        }
+    }
+
+  if (dvalue)
+    {
+      *dvalue = strtod (buf, &endp);
+    }
+  else
+    {
+      *fvalue = strtof (buf, &endp);
+    }
+
+  if (endp == buf) return (NULL);
+
+  return (ptr + (endp - buf));
+}
+
+
+
+/*  Scans a decimal number (the strtod grammar minus hex/inf/nan) into a mantissa and a power of ten.
+    Returns 1 on success, 0 if there is no number here, and -1 if the caller needs to use the slow path.  */
+
+static int32_t sv_scan_decimal (const char *ptr, const char *end, uint8_t *negative, uint64_t *mantissa,
+                                int32_t *exp10, const char **next)
+{
+  uint64_t m = 0;
+  int32_t e = 0, digits = 0, sig = 0, exp_val, exp_neg;
+  const char *p;
+
+
+  *negative = NVFalse;
+
+  if (ptr < end && (*ptr == '+' || *ptr == '-'))
+    {
+      *negative = (*ptr == '-');
+      ptr++;
+    }
+
+  if (ptr == end) return (0);
+
+
+  /*  Hex, inf, and nan all go to strtod.  */
+
+  if (*ptr == 'i' || *ptr == 'I' || *ptr == 'n' || *ptr == 'N') return (-1);
+  if (*ptr == '0' && ptr + 1 < end && (ptr[1] == 'x' || ptr[1] == 'X')) return (-1);
+
+
+  for ( ; ptr < end && *ptr >= '0' && *ptr <= '9' ; ptr++)
+    {
+      digits++;
+      if (!m && *ptr == '0') continue;
+      if (++sig > 19) return (-1);
+      m = m * 10 + (*ptr - '0');
+    }
+
+  if (ptr < end && *ptr == '.')
+    {
+      for (ptr++ ; ptr < end && *ptr >= '0' && *ptr <= '9' ; ptr++)
+        {
+          digits++;
+          e--;
+          if (!m && *ptr == '0') continue;
+          if (++sig > 19) return (-1);
+          m = m * 10 + (*ptr - '0');
+        }
+    }
+
+  if (!digits) return (0);
+
+
+  /*  An exponent is only consumed if there is at least one digit after the e (and optional sign).  */
+
+  if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+      p = ptr + 1;
+      exp_neg = 0;
+
+      if (p < end && (*p == '+' || *p == '-'))
+        {
+          exp_neg = (*p == '-');
+          p++;
+        }
+
+      if (p < end && *p >= '0' && *p <= '9')
+        {
+          for (exp_val = 0 ; p < end && *p >= '0' && *p <= '9' ; p++)
+            {
+              if (exp_val > 9999) return (-1);
+              exp_val = exp_val * 10 + (*p - '0');
+            }
+
+          e += exp_neg ? -exp_val : exp_val;
+          ptr = p;
+        }
+    }
+
+  *mantissa = m;
+  *exp10 = e;
+  *next = ptr;
+
+  return (1);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        sv_scan_int32, sv_scan_double, sv_scan_float        *
+*                                                                           *
+*   Purpose:            Locale independent equivalents of the sscanf %d,    *
+*                       %lf, and %f conversions that work directly on the   *
+*                       mapped text.  Leading white space is skipped.       *
+*                       Floating point values are correctly rounded (the    *
+*                       fast path only handles values that can be computed  *
+*                       exactly, anything else goes to strtod/strtof) so    *
+*                       the results are bit-for-bit what sscanf returns.    *
+*                                                                           *
+*   Inputs:             ptr                 -   start of text               *
+*                       end                 -   end of text                 *
+*                       value               -   returned value              *
+*                                                                           *
+*   Outputs:            const char *        -   pointer to the first        *
+*                                               unconverted character or    *
+*                                               NULL if nothing converted   *
+*                                                                           *
+\***************************************************************************/
+
+const char *sv_scan_int32 (const char *ptr, const char *end, int32_t *value)
+{
+  uint64_t v = 0;
+  uint8_t negative = NVFalse;
+  const char *start;
+
+
+  ptr = sv_skip_space (ptr, end);
+
+  if (ptr < end && (*ptr == '+' || *ptr == '-'))
+    {
+      negative = (*ptr == '-');
+      ptr++;
+    }
+
+  start = ptr;
+
+  for ( ; ptr < end && *ptr >= '0' && *ptr <= '9' ; ptr++) v = v * 10 + (*ptr - '0');
+
+  if (ptr == start) return (NULL);
+
+  *value = negative ? (int32_t) (0 - v) : (int32_t) v;
+
+  return (ptr);
+}
+
+
+
+const char *sv_scan_double (const char *ptr, const char *end, double *value)
+{
+  uint8_t negative;
+  uint64_t m;
+  int32_t e, status;
+  const char *next;
+  double d;
+
+
+  ptr = sv_skip_space (ptr, end);
+
+  if ((status = sv_scan_decimal (ptr, end, &negative, &m, &e, &next)) == 0) return (NULL);
+
+  if (status < 0 || !sv_exact_double (m, e, &d)) return (sv_scan_slow (ptr, end, value, NULL));
+
+  *value = negative ? -d : d;
+
+  return (next);
+}
+
+
+
+const char *sv_scan_float (const char *ptr, const char *end, float *value)
+{
+  uint8_t negative;
+  uint64_t m;
+  int32_t e, status;
+  const char *next;
+  float f;
+
+
+  ptr = sv_skip_space (ptr, end);
+
+  if ((status = sv_scan_decimal (ptr, end, &negative, &m, &e, &next)) == 0) return (NULL);
+
+  if (status < 0 || (m && (m > (1ULL << 24) || e < -10 || e > 10))) return (sv_scan_slow (ptr, end, NULL, value));
+
+  f = (float) m;
+
+  if (e < 0)
+    {
+      f /= pow10f_tab[-e];
+    }
+  else
+    {
+      f *= pow10f_tab[e];
+    }
+
+  *value = negative ? -f : f;
+
+  return (next);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        sv_scanf                                            *
+*                                                                           *
+*   Purpose:            A small subset of sscanf that works on a string     *
+*                       view.  Only %d, %f, and %lf conversions, white      *
+*                       space, and literal characters are supported which   *
+*                       is all that the input formats need.  The return     *
+*                       value follows the sscanf rules (EOF if the input    *
+*                       runs out before the first conversion).              *
+*                                                                           *
+*   Inputs:             sv                  -   text to scan                *
+*                       format              -   sscanf style format         *
+*                                                                           *
+*   Outputs:            int32_t             -   number of conversions       *
+*                                                                           *
+\***************************************************************************/
+
+int32_t sv_scanf (STRING_VIEW sv, const char *format, ...)
+{
+  const char *ptr = sv.ptr, *end = sv.ptr + sv.len, *next = NULL;
+  int32_t converted = 0;
+  uint8_t input_failure = NVFalse;
+  va_list args;
+
+
+  va_start (args, format);
+
+  while (*format)
+    {
+      if (sv_isspace (*format))
+        {
+          ptr = sv_skip_space (ptr, end);
+          format++;
+          continue;
+        }
+
+      if (*format != '%')
+        {
+          if (ptr == end)
+            {
+              input_failure = NVTrue;
+              break;
+            }
+
+          if (*ptr != *format) break;
+
+          ptr++;
+          format++;
+          continue;
+        }
+
+
+      format++;
+
+
+      /*  All of the supported conversions skip leading white space.  */
+
+      ptr = sv_skip_space (ptr, end);
+
+      if (ptr == end)
+        {
+          input_failure = NVTrue;
+          break;
+        }
+
+      if (*format == 'd')
+        {
+          next = sv_scan_int32 (ptr, end, va_arg (args, int32_t *));
+          format++;
+        }
+      else if (*format == 'f')
+        {
+          next = sv_scan_float (ptr, end, va_arg (args, float *));
+          format++;
+        }
+      else if (*format == 'l' && format[1] == 'f')
+        {
+          next = sv_scan_double (ptr, end, va_arg (args, double *));
+          format += 2;
+        }
+      else
+        {
+          break;
+        }
+
+      if (next == NULL) break;
+
+      ptr = next;
+      converted++;
+    }
+
+  va_end (args);
+
+  if (input_failure && !converted) return (EOF);
+
+  return (converted);
+}
@@ -0,0 +1,97 @@
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef __STRING_VIEW_H__
+#define __STRING_VIEW_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "nvutility.h"
+
+
+/*  A string view is a pointer/length pair that refers to text that lives somewhere else (usually the
+    memory mapped input file).  It is NOT zero terminated so it must never be handed to the C string
+    functions.  Use the sv_ functions instead.  */
+
+typedef struct
+{
+  const char          *ptr;
+  size_t              len;
+} STRING_VIEW;
+
+
+static inline STRING_VIEW sv_make (const char *ptr, size_t len)
+{
+  STRING_VIEW sv;
+
+  sv.ptr = ptr;
+  sv.len = len;
+
+  return (sv);
+}
+
+
+/*  Exact powers of ten, 1.0e0 through 1.0e22.  */
+
+extern const double sv_pow10[23];
+
+
+/*  Converts a decimal mantissa and power of ten to a double if it can be done with a single (and
+    therefore correctly rounded) floating point operation.  Returns NVFalse if the caller has to fall
+    back to sv_scan_double.  */
+
+static inline uint8_t sv_exact_double (uint64_t mantissa, int32_t exp10, double *value)
+{
+  if (!mantissa)
+    {
+      *value = 0.0;
+      return (NVTrue);
+    }
+
+  if (mantissa > (1ULL << 53) || exp10 < -22 || exp10 > 22) return (NVFalse);
+
+  if (exp10 < 0)
+    {
+      *value = (double) mantissa / sv_pow10[-exp10];
+    }
+  else
+    {
+      *value = (double) mantissa * sv_pow10[exp10];
+    }
+
+  return (NVTrue);
+}
+
+
+uint8_t sv_next_token (STRING_VIEW *rest, char delim, STRING_VIEW *token);
+uint8_t sv_contains (STRING_VIEW sv, const char *needle);
+size_t sv_copy (STRING_VIEW sv, char *dest, size_t size);
+const char *sv_scan_int32 (const char *ptr, const char *end, int32_t *value);
+const char *sv_scan_double (const char *ptr, const char *end, double *value);
+const char *sv_scan_float (const char *ptr, const char *end, float *value);
+int32_t sv_scanf (STRING_VIEW sv, const char *format, ...);
+
+
+#endif
@@ -38,7 +38,7 @@
 
 #ifndef VERSION
 
-#define     VERSION     "PFM Software - build_feature V4.05 - 07/29/14"
+#define     VERSION     "PFM Software - build_feature V4.30 - 10/17/26"
 
 #endif
 
@@ -202,4 +202,288 @@
 
     - Fixed errors discovered by cppcheck.
 
+
+    Version 4.06
+    PFM Software
+    10/17/26
+
+    - The input file is now memory mapped and lines are handed to the parsers as pointer/length string views
+      (string_view.c, line_reader.c).  No more 1024 byte fgets buffer (long lines used to get split into
+      multiple records) and no more strtok/strcpy copies of every field.
+    - Replaced sscanf with a locale independent view scanner (sv_scanf) that gives bit-identical results.
+    - Blank lines are skipped instead of crashing the .txt and .uni parsers.
+
+
+    Version 4.07
+    PFM Software
+    10/17/26
+
+    - Replaced sget_coord with a single pass, allocation free, reentrant parser (sget_coord.c).  It writes
+      into a caller supplied COORD_RECORD instead of returning a static buffer, doesn't use strtok, strlen,
+      or sscanf, and isn't affected by locale.  Same hemisphere letter and sign rules as before and the
+      same results (hex numbers are no longer accepted in positions).  About 6x faster.
+
+
+    Version 4.08
+    PFM Software
+    10/17/26
+
+    - Added -j THREADS pipeline mode (pipeline.c).  The main thread cuts the mapped input into line aligned
+      chunks, THREADS worker threads parse them into records (parse_record.c), and a single writer thread
+      commits the batches to the BFD file in input order.  The serial path uses the same chunking and
+      parsing code so record order and contact ID numbering are identical either way.
+    - Moved the usage message into usage () and switched to getopt for the command line.
+
+
+    Version 4.09
+    PFM Software
+    10/17/26
+
+    - Records are now written through a batching BFD writer (bfd_writer.c).  Records and their snippet
+      images are staged in memory (-b RECORDS, default 4096, plus a 64MB image limit) and written to the
+      BFD file in one sweep.  Staged records are always flushed on close and before reporting an error.
+      Images that can't be staged are still read by the BFD library as before.
+    - Added bench/bench_bfd_write.c (built with bench/mk) to compare wall time and read/write system
+      calls per 1M records for the direct and batched write paths.
+
+
+    Version 4.10
+    PFM Software
+    10/17/26
+
+    - Any number of input files (or wildcards) can now be given on the command line, and -m MANIFEST adds
+      the files listed in a manifest file (input_list.c).  The BFD file is opened once for the whole batch,
+      the format is picked per file, and a per file record count is printed.  An input file that can't be
+      opened is reported and skipped, and the program exits with an error status at the end.
+    - Fixed the fully qualified input name on Linux when the input was given with a directory path.
+
+
+    Version 4.11
+    PFM Software
+    10/17/26
+
+    - Input files can now be standard input ("-"), pipes, or FIFOs.  These are read a block at a time as
+      the data arrives instead of being mapped so nothing has to be staged on disk first.
+    - Added --format=txt|uni|csv to override the file name extension (required for standard input).
+
+
+    Version 4.12
+    PFM Software
+    10/17/26
+
+    - Contact IDs now come from an allocator (contact_id.c).  The run time is looked up and broken down
+      once instead of calling time and cvtime for every .txt/.csv record, sequence numbers are reserved a
+      batch at a time with an atomic add, and the sequence starts at the number of records already in the
+      BFD file so appending never reuses an ID.
+
+
+    Version 4.13
+    PFM Software
+    10/17/26
+
+    - Added --dedupe=METERS (dedupe.c).  The features already in the BFD file (and the ones added during the
+      run) go into an in memory spatial hash with tolerance sized cells, and each new feature is only
+      compared to the features in the few cells around it.  Duplicates are dropped, or with --dedupe-flag
+      kept with their description set to the record number they duplicate.
+
+
+    Version 4.14
+    PFM Software
+    10/17/26
+
+    - Added a benchmark suite in bench.  gen_corpus writes reproducible .txt (every position style), .uni,
+      and NAVO .csv files from 1K to 50M rows, bench_stages times each parsing stage (sget_coord, .uni
+      field splitting, the line and chunk parsers, time conversion, contact IDs) on its own, and run_bench
+      times whole runs of build_feature along with the stage and BFD write benchmarks.
+
+
+    Version 4.15
+    PFM Software
+    10/17/26
+
+    - Added --stats=json[:FILE] (stats.c).  Prints per stage nanosecond timers (reading, parsing, DTG
+      time conversion, committing, image reading, BFD writes) and counts (bytes read, lines, header and
+      blank lines skipped, records parsed and written, duplicates, images and image bytes attached) as
+      JSON at exit.  Timers are per chunk, per flush, or per image and the time conversion is sampled so
+      the overhead stays well under 2%.
+
+
+    Version 4.16
+    PFM Software
+    10/17/26
+
+    - .uni snippet images are now read by the parse threads (image_loader.c) instead of one at a time by
+      the writer.  Each batch's images are opened a group at a time with a read ahead hint so the kernel
+      reads them concurrently, then copied into the batch and handed to the BFD writer in record order.
+      A missing or unreadable image is reported and the record is written without it instead of being
+      left to the BFD library.
+
+
+    Version 4.17
+    PFM Software
+    10/17/26
+
+    - Added --checkpoint=RECORDS and --resume.  Every RECORDS records (default 1,000,000) the BFD file is
+      flushed, closed, synced to disk, and reopened, then BFD_FILE.ckpt records the input file, the byte
+      offset just past the last committed line, the BFD record count, and the contact ID sequence.  After
+      a crash --resume (with the same arguments) picks up at that offset.  Records the dead run wrote after
+      its last commit point are recognized and skipped instead of being written again.
+    - Features flagged by --dedupe-flag are no longer loaded into the duplicate index when appending, the
+      same as when they're flagged during a run.
+
+
+    Version 4.18
+    PFM Software
+    10/17/26
+
+    - Added --follow[=MS].  After loading it the last input file is followed like tail -F: complete lines
+      are parsed as they're appended and the BFD file is reopened (so its header is up to date for anyone
+      displaying it) within MS milliseconds (default 250) of the first new record.  The file's directory
+      is watched with inotify on Linux (so we're idle until something changes), elsewhere it's polled.
+      Truncation and rotation start over at the beginning of the new file.  Ctrl-C or kill stops it and
+      closes everything down normally.
+
+
+    Version 4.19
+    PFM Software
+    10/17/26
+
+    - Added --parse-cache[=DIR].  The records parsed from each input file are saved in a compact binary
+      FILE.bfp (parse_cache.c) next to the input, or in DIR.  The next time the same file is loaded
+      the cache is mapped and its records are committed in the same batches without parsing the text.
+      A cache is versioned and is rebuilt if the input file's size or modification time has changed (or
+      the input format is different).
+
+
+    Version 4.20
+    PFM Software
+    10/17/26
+
+    - parse_chunk now finds every newline and comma (and L) in a chunk in one pass (delim_index.c, the
+      SSE2 or AVX2 version is picked at run time with a scalar fallback) and the field parsers walk the
+      offsets instead of searching each line.  Only lines with an L in them are checked for the header.
+
+
+    Version 4.21
+    PFM Software
+    10/17/26
+
+    - Compressed input files (.gz and .zst) are loaded directly.  They're decompressed on their own thread
+      (decompress.c) into a ring buffer that the stream reader takes the text from, so decompression
+      overlaps with parsing and writing.  The format comes from the extension inside the compression
+      extension (targets.uni.zst is a .uni file).  --resume and --parse-cache work with compressed files,
+      --follow doesn't.  Added -lzstd -lz to the libraries.
+
+
+    Version 4.22
+    PFM Software
+    10/17/26
+
+    - Positions and .uni DTGs are staged in structure of arrays batches of 4096 records and converted in
+      loops the compiler vectorizes.  mday2jday and inv_cvtime are called once per day instead of once per
+      record (checked against a full inv_cvtime, falling back to one record at a time if they ever
+      disagree).  The DTG conversion time in --stats is now measured instead of sampled.
+
+
+    Version 4.23
+    PFM Software
+    10/17/26
+
+    - Added --columns=SPEC (or --columns=@FILE) to load comma separated files with any column layout.
+      The spec maps each column to a BFD record field with a unit (e.g. skip,lat,lon,depth:ft,remarks)
+      and is compiled once into a table of per column parsers (column_map.c).  Parse caches now record
+      the column mapping they were built with (cache version 2).
+
+
+    Version 4.24
+    PFM Software
+    10/17/26
+
+    - Split everything after parsing (contact IDs, duplicate checks, staged BFD writes, checkpoints) out of
+      main into ingest.c/ingest.h, a linkable library with a C (and C++ callable) API.  Open it on a BFD
+      handle, push text buffers (partial lines are held) or parsed FEATURE_RECORDs, flush, and close.
+      Errors are returned instead of exiting.  The command line program is now a thin wrapper around it.
+
+
+    Version 4.25
+    PFM Software
+    10/17/26
+
+    - Added --spatial-order=hilbert|morton[:MB].  New records are buffered (sorted runs are spilled next to the
+      BFD file past the MB memory budget and merged at the end) and written in Hilbert or Morton curve order
+      by position, with their images, so features that are close together are close together in the BFD
+      file (spatial_order.c).  Checkpoints are turned off with it.
+
+
+    Version 4.26
+    PFM Software
+    10/17/26
+
+    - Added --tolerant[=FILE].  Lines with too few fields, missing or out of range positions, or impossible
+      DTGs are written to FILE (default BFD_FILE.rej) with their line number, byte offset, and reason instead
+      of being loaded as zeroed records.  The checks are made as the lines are parsed.  Exits with status 2
+      if anything was rejected.
+
+
+    Version 4.27
+    PFM Software
+    10/17/26
+
+    - Added --also=FILE[,FILE...].  Every feature written to the BFD file is also written to GeoJSON,
+      Shapefile, GeoPackage, KML, or GML files (by extension, through GDAL/OGR) in the same pass.  Each output
+      has its own thread fed through a queue of buffers so a slow one doesn't hold up the parse (ogr_sink.c).
+
+
+    Version 4.28
+    PFM Software
+    10/17/26
+
+    - Added --index to keep a spatial index (BFD_FILE.bfx) built as the records are written.  Each run appends
+      a packed Hilbert R-tree segment for its records, and records that aren't indexed yet are read back first.
+      Added bench/bfx_query (box queries) and bench/bench_bfx (box lookups against a 10M feature file).
+
+
+    Version 4.29
+    PFM Software
+    10/17/26
+
+    - .uni and --columns dtg fields are parsed by a dedicated DTG parser (dtg.c) instead of sv_scanf.  It takes the
+      MM-DD-YYYY layout with any white space before the time and also ISO 8601 (YYYY-MM-DDTHH:MM[:SS.SS] with an
+      optional Z or +/-HH:MM zone, converted to UTC).  Day of year and the midnight event time of each day are
+      worked out from day count tables instead of mktime, so a record's event time is a table lookup plus the time
+      of day.  --tolerant now also rejects days past the end of the month (e.g. 02-30).
+
+
+    Version 4.30
+    PFM Software
+    10/17/26
+
+    - Checkpoints are off by default (--checkpoint=RECORDS turns them on) so a plain run doesn't leave a journal
+      or pay for the syncs and BFD reopens.
+    - Parse cache records are variable length (cache version 3).  Only the position, the nonzero floats, the
+      event time for formats that have one, and the strings are stored, so a .bfp is about the size of the input
+      (under half for a .uni file) instead of about twice it.  The DTG is rebuilt from the event time unless it
+      didn't match it.
+    - ingest_flush just writes what's staged to the BFD file, it no longer closes and reopens it.  The file is
+      only reopened at checkpoints and when follow mode publishes.
+    - Moved reading an input file (parse threads, parse cache, --follow, and picking up a resumed file) and the
+      checkpoint journal checks out of main into ingest_file and ingest_resume.  The ingest library reports
+      the journal errors through ingest_perror instead of the program printing them.
+    - ingest_close returns the BFD file handle through an argument and the status separately.  The BFD file is
+      closed even when writing, the spatial index, or an --also output fails, so the header covers the records
+      that were written.
+    - The pipeline commit and follow publish functions return a status.  --follow stops (and the run fails)
+      on the first batch that couldn't be written or published instead of tailing the file with nothing
+      getting into the BFD file.
+    - Each parse thread keeps at most 32 image files open at once (it was 256).  An image that can't be opened
+      because we're out of file descriptors is left for the BFD writer to read instead of being reported
+      missing.
+    - Documented that contact IDs are only unique within one BFD file.  Runs into different files that start
+      in the same second can hand out the same IDs.
+    - The BFD writer is described as what it is: it stages snippet images ahead of the writes, the records
+      still go to the BFD library one call at a time.  bench_bfd_write shows the same read and write system
+      call counts for the direct and staged paths and no consistent wall time difference.
+    - Checkpoints sync just the BFD file and its .bfa attachment file instead of everything matching the BFD
+      file's name with any extension.
+
 */